@@ -24,6 +24,8 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <malloc.h>
+#include <sys/epoll.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <signal.h>
@@ -48,6 +50,8 @@
 #include <twclient/image_cache.h>
 #include <twclient/shmpool.h>
 #include <shared_config.h>
+#include <trace.h>
+#include <pressure.h>
 
 #include "console.h"
 
@@ -75,6 +79,8 @@ struct desktop_console {
 	struct dhash_table icons_table;
 	struct wl_array icon_keys;
 	uint32_t requested_icons;
+	int64_t icon_bytes; /**< atlases and keys, charged to TW_MEM_ICONS */
+	struct tw_pressure *pressure;
 
         /**< exec data */
 	struct wl_buffer *decision_buffer;
@@ -742,6 +748,7 @@ update_console_icon_search(struct desktop_console *console,
 	struct console_icon_key ik;
 	struct dhash_table *icons = &console->icons_table;
 	struct wl_array *icon_keys = &console->icon_keys;
+	int64_t accounted = console->icon_bytes;
 
 	//load images
 	atlas = nk_wl_image_from_buffer(cache->atlas, console->bkend,
@@ -749,11 +756,15 @@ update_console_icon_search(struct desktop_console *console,
 	                              cache->dimension.w * 4, true);
 	nk_wl_add_image(atlas, console->bkend);
 	cache->atlas = NULL;
+	console->icon_bytes += (int64_t)cache->dimension.w *
+		cache->dimension.h * 4;
 
 	//copy the strings into icon_keys
 	base_offset = icon_keys->size;
+	console->icon_bytes -= icon_keys->alloc;
 	memcpy(wl_array_add(icon_keys, cache->strings.size),
 	       cache->strings.data, cache->strings.size);
+	console->icon_bytes += icon_keys->alloc;
 
 	//generate hashing cache for images
 	for (unsigned i = 0; i < cache->handles.size / sizeof(off_t); i++) {
@@ -769,6 +780,7 @@ update_console_icon_search(struct desktop_console *console,
 		ik.data.offset = base_offset + offset;
 		dhash_insert(icons, &ik, &subimg);
 	}
+	tw_mem_account(TW_MEM_ICONS, console->icon_bytes - accounted, 0);
 }
 
 static void
@@ -846,6 +858,49 @@ reload_console_modules(struct desktop_console *console)
 		vector_append(&console->search_results, &empty_res);
 }
 
+/* the icon atlases stay, the modules hold nk_images into them. The search
+ * caches and the lua garbage are rebuilt on the next search */
+static int
+console_dispatch_pressure(struct tw_event *event, UNUSED_ARG(int fd))
+{
+	struct desktop_console *console = event->data;
+	struct console_module *module;
+
+	if (!tw_pressure_dispatch(console->pressure))
+		return TW_EVENT_NOOP;
+	vector_for_each(module, &console->modules)
+		console_module_trim(module);
+	desktop_console_trim_lua_config(console, console->config_data);
+	malloc_trim(0);
+	return TW_EVENT_NOOP;
+}
+
+static void
+console_pressure_init(struct desktop_console *console)
+{
+	struct tw_event event = {
+		.data = console,
+		.cb = console_dispatch_pressure,
+	};
+
+	if (!(console->pressure = tw_pressure_create(NULL)))
+		return;
+	tw_event_queue_add_source(&console->globals.event_queue,
+	                          tw_pressure_get_fd(console->pressure),
+	                          &event, EPOLLIN);
+}
+
+static void
+console_pressure_end(struct desktop_console *console)
+{
+	if (!console->pressure)
+		return;
+	tw_event_queue_remove_source(&console->globals.event_queue,
+	                             tw_pressure_get_fd(console->pressure));
+	tw_pressure_destroy(console->pressure);
+	console->pressure = NULL;
+}
+
 static void
 post_init_console(struct desktop_console *console)
 {
@@ -862,6 +917,7 @@ post_init_console(struct desktop_console *console)
         //prepare shared data
 	console->bkend = nk_cairo_create_backend();
 	console->requested_icons = 0;
+	console->icon_bytes = 0;
 	dhash_init(&console->icons_table, hash_icon_key1, hash_icon_key2,
 	           icon_key_cmp,
 	           sizeof(struct console_icon_key), sizeof(struct nk_image),
@@ -875,6 +931,7 @@ post_init_console(struct desktop_console *console)
 	                 console_free_search_results);
 	//loading modules
 	reload_console_modules(console);
+	console_pressure_init(console);
 }
 
 static void
@@ -889,6 +946,7 @@ init_console(struct desktop_console *console)
 static void
 end_console(struct desktop_console *console)
 {
+	console_pressure_end(console);
 	release_console_modules(console);
 
 	nk_textedit_free(&console->text_edit);
@@ -896,6 +954,8 @@ end_console(struct desktop_console *console)
 	tw_shm_pool_release(&console->pool);
 	dhash_destroy(&console->icons_table);
 	wl_array_release(&console->icon_keys);
+	tw_mem_account(TW_MEM_ICONS, -console->icon_bytes, 0);
+	console->icon_bytes = 0;
 
 	taiwins_console_destroy(console->interface);
 	tw_globals_release(&console->globals);
@@ -1001,6 +1061,9 @@ main(int argc, char *argv[])
 {
 	if (!tw_create_cache_dir())
 		return -1;
+	//before the module threads, they inherit the blocked SIGUSR2
+	tw_trace_dump_on_signal(SIGUSR2, "taiwins-console");
+	tw_trace_thread_name("console");
 
 	struct desktop_console tw_console;
 	struct wl_display *display = wl_display_connect(NULL);
@@ -38,6 +38,7 @@
 #include <twclient/nk_backends.h>
 
 #include <shared_config.h>
+#include <alloc.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -74,6 +75,11 @@ void
 desktop_console_release_lua_config(struct desktop_console *console,
                                    void *config_data);
 
+/* collect the lua garbage, waits for the module searches running in it */
+void
+desktop_console_trim_lua_config(struct desktop_console *console,
+                                void *config_data);
+
 /* critical race condition code is wrapped here, so it would be transparent
  * to console itself */
 int
@@ -112,6 +118,7 @@ struct console_module {
 	struct {
 		pthread_mutex_t command_mutex;
 		char *search_command, *exec_command;
+		bool trim; /**< drop the search cache */
 	};
 	struct {
 		pthread_mutex_t results_mutex;
@@ -142,6 +149,9 @@ void
 console_module_command(struct console_module *module, const char *search,
                        const char *exec);
 
+void
+console_module_trim(struct console_module *module);
+
 
 //all the search component returns this
 typedef struct {
@@ -119,7 +119,8 @@ xdg_app_module_search(struct console_module *module, const char *to_search,
 				strcpy(entry->sstr, app->name);
 				entry->pstr = NULL;
 			} else
-				entry->pstr = strdup(app->name);
+				entry->pstr = tw_strdup(TW_MEM_CONSOLE,
+				                        app->name);
 			entry->img = *icon;
 		}
 	}
@@ -189,6 +190,7 @@ xdg_app_module_init(struct console_module *module)
 	vector_init_zero(images, sizeof(struct nk_image), NULL);
 	vector_resize(images, apps->len);
 	memset(images->elems, 0, sizeof(struct nk_image) * apps->len);
+	tw_mem_account(TW_MEM_ICONS, images->alloc_len * images->elemsize, 1);
 
 	//I can actually directly do it here
 	xdg_app_module_update_icons(module);
@@ -200,6 +202,8 @@ xdg_app_module_destroy(struct console_module *module)
 	struct app_module_data *userdata = module->user_data;
 
 	vector_destroy(&userdata->xdg_app_vector);
+	tw_mem_account(TW_MEM_ICONS, -(int64_t)(userdata->icons.alloc_len *
+	                                        userdata->icons.elemsize), -1);
 	vector_destroy(&userdata->icons);
 }
 
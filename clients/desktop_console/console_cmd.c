@@ -112,7 +112,8 @@ console_cmd_module_search(struct console_module *module, const char *to_search,
 			strop_ncpy(entry->sstr, (char *)iter.key, iter.key_len+1);
 			entry->pstr = NULL;
 		} else {
-			entry->pstr = calloc(1, iter.key_len+1);
+			entry->pstr = tw_zalloc(TW_MEM_CONSOLE,
+			                        iter.key_len+1);
 			strop_ncpy(entry->pstr, (char *)iter.key, iter.key_len+1);
 		}
 	}
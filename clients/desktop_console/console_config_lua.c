@@ -153,7 +153,7 @@ collect_search_entries(lua_State *L, int pos, vector_t *results)
 		if (string && strlen(string) < 32)
 			strcpy(tmp.sstr, string);
 		else if (string)
-			tmp.pstr = strdup(string);
+			tmp.pstr = tw_strdup(TW_MEM_CONSOLE, string);
 		if (img)
 			tmp.img = *img;
 		else
@@ -700,6 +700,16 @@ _lua_register_metatables(lua_State *L, struct desktop_console *console)
 	lua_setfield(L, LUA_REGISTRYINDEX, EMPTY_IMAGE);
 }
 
+static int
+_lua_panic(lua_State *L)
+{
+	const char *msg = lua_tostring(L, -1);
+
+	fprintf(stderr, "console: unprotected lua error: %s\n",
+	        msg ? msg : "(not a string)");
+	return 0;
+}
+
 void *
 desktop_console_run_config_lua(struct desktop_console *console,
                                const char *path)
@@ -715,9 +725,10 @@ desktop_console_run_config_lua(struct desktop_console *console,
 	path_concat(configpath, PATH_MAX, 1, "console.lua");
 	path = (path) ? path : configpath;
 
-	L = luaL_newstate();
+	L = lua_newstate(tw_mem_lua_alloc, (void *)(intptr_t)TW_MEM_CONSOLE);
 	if (!L)
 		return NULL;
+	lua_atpanic(L, _lua_panic);
 	luaL_openlibs(L);
 	_lua_register_metatables(L, console);
 	luaL_requiref(L, "taiwins_console",
@@ -747,6 +758,24 @@ desktop_console_run_config_lua(struct desktop_console *console,
 	return L;
 }
 
+void
+desktop_console_trim_lua_config(UNUSED_ARG(struct desktop_console *console),
+                                void *config_data)
+{
+	pthread_mutex_t *search_lock, *exec_lock;
+	lua_State *L = config_data;
+
+	if (!L)
+		return;
+	search_lock = _lua_get_lock(L, SEARCH_LOCK);
+	exec_lock = _lua_get_lock(L, EXEC_LOCK);
+	pthread_mutex_lock(search_lock);
+	pthread_mutex_lock(exec_lock);
+	lua_gc(L, LUA_GCCOLLECT, 0);
+	pthread_mutex_unlock(exec_lock);
+	pthread_mutex_unlock(search_lock);
+}
+
 void
 desktop_console_release_lua_config(UNUSED_ARG(struct desktop_console *console),
                                    void *config_data)
@@ -25,6 +25,7 @@
 #include <semaphore.h>
 
 #include <ctypes/vector.h>
+#include <trace.h>
 #include "console.h"
 
 /******************************************************************************/
@@ -37,7 +38,7 @@ search_entry_assign(void *dst, const void *src)
 	search_entry_free(dst);
 	strncpy(d->sstr, s->sstr, 32);
 	if (s->pstr)
-		d->pstr = strdup(s->pstr);
+		d->pstr = tw_strdup(TW_MEM_CONSOLE, s->pstr);
 	d->img = s->img;
 }
 
@@ -46,7 +47,7 @@ search_entry_free(void *m)
 {
 	console_search_entry_t *entry = m;
 	if (entry->pstr) {
-		free(entry->pstr);
+		tw_free(entry->pstr);
 		entry->pstr = NULL;
 	}
 	entry->sstr[0] = '\0';
@@ -90,8 +91,8 @@ cache_takes(struct module_search_cache *cache,
 	    vector_t *v, const char *command)
 {
 	if (cache->last_command)
-		free(cache->last_command);
-	cache->last_command = strdup(command);
+		tw_free(cache->last_command);
+	cache->last_command = tw_strdup(TW_MEM_CONSOLE, command);
 	if (cache->last_results.elems) {
 		vector_destroy(&cache->last_results);
 	}
@@ -110,7 +111,7 @@ static inline void
 cache_free(struct module_search_cache *cache)
 {
 	if (cache->last_command)
-		free(cache->last_command);
+		tw_free(cache->last_command);
 	if (cache->last_results.elems)
 		vector_destroy(&cache->last_results);
 	cache_init(cache);
@@ -168,14 +169,30 @@ thread_run_module(void *arg)
 {
 	struct console_module *module = arg;
 	char *exec_command = NULL, *search_command = NULL;
-	char *exec_res;
+	char *exec_res = NULL;
+	bool trim, idle;
 	vector_t search_results = {0};
 	int exec_ret = 0, search_ret = 0;
 	struct module_search_cache cache;
 
 	cache_init(&cache);
+	tw_trace_thread_name("console-module");
 
 	while (!module->quit) {
+		pthread_mutex_lock(&module->command_mutex);
+		trim = module->trim;
+		module->trim = false;
+		idle = !module->exec_command && !module->search_command;
+		pthread_mutex_unlock(&module->command_mutex);
+		//the cache goes, searches after this run on the module again
+		if (trim) {
+			cache_free(&cache);
+			if (idle) {
+				sem_wait(&module->semaphore);
+				continue;
+			}
+		}
+
 		//exec, enter critial
 		pthread_mutex_lock(&module->command_mutex);
 		if (module->exec_command) {
@@ -210,12 +227,18 @@ thread_run_module(void *arg)
 		}
 		pthread_mutex_unlock(&module->command_mutex);
 		//deal with cache first
-		if (module->support_cache && cachable(&cache, search_command))
+		if (module->support_cache && cachable(&cache, search_command)) {
+			TW_TRACE_BEGIN("console", "cache_filter");
 			cache_filter(&cache, search_command, &search_results,
 				module->filter_test);
-		else if (search_command) {
+			TW_TRACE_END("console", "cache_filter");
+		} else if (search_command) {
+			TW_TRACE_BEGIN("console", "module_search");
 			search_ret = module->search(module, search_command,
 						    &search_results);
+			TW_TRACE_END("console", "module_search");
+			TW_TRACE_COUNTER("console", "search_results",
+			                 search_results.len);
 			//fprintf(stderr, "search for %s has %d results\n", search_command,
 			//	search_results.len);
 			cache_takes(&cache, &search_results, search_command);
@@ -267,6 +290,7 @@ console_module_init(struct console_module *module,
 	//cleanup the module data
 	module->exec_command = NULL;
 	module->search_command = NULL;
+	module->trim = false;
 	module->search_ret = 0;
 	module->exec_ret = 0;
 	vector_init_zero(&module->search_results,
@@ -334,6 +358,15 @@ console_module_command(struct console_module *module,
 	/* fprintf(stderr, "sem value now : %d\n", value); */
 }
 
+void
+console_module_trim(struct console_module *module)
+{
+	pthread_mutex_lock(&module->command_mutex);
+	module->trim = true;
+	pthread_mutex_unlock(&module->command_mutex);
+	sem_post(&module->semaphore);
+}
+
 int
 desktop_console_take_search_result(struct console_module *module,
 				  vector_t *ret)
@@ -24,9 +24,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <malloc.h>
 #include <linux/input.h>
 #include <cairo/cairo.h>
 #include <poll.h>
+#include <signal.h>
+#include <sys/epoll.h>
 #include <wayland-client.h>
 #include <ctypes/sequential.h>
 #include <ctypes/os/file.h>
@@ -37,6 +40,7 @@
 #include <wayland-taiwins-theme-client-protocol.h>
 #include <wayland-taiwins-theme-server-protocol.h>
 #include <shared_config.h>
+#include <trace.h>
 #include <widget/widget.h>
 #include "shell.h"
 
@@ -200,6 +204,88 @@ static const struct taiwins_theme_listener tw_theme_impl = {
  * desktop_shell_interface
  ******************************************************************************/
 
+static int
+shell_dispatch_jobs(struct tw_event *event, UNUSED_ARG(int fd))
+{
+	tw_job_sink_dispatch(event->data);
+	return TW_EVENT_NOOP;
+}
+
+static void
+shell_jobs_init(struct desktop_shell *shell)
+{
+	struct tw_event event = {
+		.cb = shell_dispatch_jobs,
+	};
+
+	shell->job_sink = NULL;
+	if (!(shell->jobs = tw_job_pool_create(1)))
+		return;
+	if (!(shell->job_sink = tw_job_sink_create(shell->jobs))) {
+		tw_job_pool_destroy(shell->jobs);
+		shell->jobs = NULL;
+		return;
+	}
+	event.data = shell->job_sink;
+	tw_event_queue_add_source(&shell->globals.event_queue,
+	                          tw_job_sink_get_fd(shell->job_sink),
+	                          &event, EPOLLIN);
+}
+
+static void
+shell_jobs_end(struct desktop_shell *shell)
+{
+	if (!shell->jobs)
+		return;
+	tw_event_queue_remove_source(&shell->globals.event_queue,
+	                             tw_job_sink_get_fd(shell->job_sink));
+	tw_job_sink_destroy(shell->job_sink);
+	tw_job_pool_destroy(shell->jobs);
+	shell->job_sink = NULL;
+	shell->jobs = NULL;
+}
+
+/* the wallpaper and the widgets draw straight into their buffers, what we
+ * can drop is the lua garbage and the free malloc pages */
+static int
+shell_dispatch_pressure(struct tw_event *event, UNUSED_ARG(int fd))
+{
+	struct desktop_shell *shell = event->data;
+
+	if (!tw_pressure_dispatch(shell->pressure))
+		return TW_EVENT_NOOP;
+	if (shell->config.trim_config)
+		shell->config.trim_config(&shell->config);
+	malloc_trim(0);
+	return TW_EVENT_NOOP;
+}
+
+static void
+shell_pressure_init(struct desktop_shell *shell)
+{
+	struct tw_event event = {
+		.data = shell,
+		.cb = shell_dispatch_pressure,
+	};
+
+	if (!(shell->pressure = tw_pressure_create(NULL)))
+		return;
+	tw_event_queue_add_source(&shell->globals.event_queue,
+	                          tw_pressure_get_fd(shell->pressure),
+	                          &event, EPOLLIN);
+}
+
+static void
+shell_pressure_end(struct desktop_shell *shell)
+{
+	if (!shell->pressure)
+		return;
+	tw_event_queue_remove_source(&shell->globals.event_queue,
+	                             tw_pressure_get_fd(shell->pressure));
+	tw_pressure_destroy(shell->pressure);
+	shell->pressure = NULL;
+}
+
 static void
 desktop_shell_init(struct desktop_shell *shell, struct wl_display *display)
 {
@@ -207,6 +293,8 @@ desktop_shell_init(struct desktop_shell *shell, struct wl_display *display)
 
 	tw_globals_init(&shell->globals, display);
 	shell_tdbus_init(shell);
+	shell_jobs_init(shell);
+	shell_pressure_init(shell);
 	tw_theme_init_default(&shell->theme);
 
 	shell->globals.theme = &shell->theme;
@@ -263,6 +351,8 @@ desktop_shell_release(struct desktop_shell *shell)
 	for (int i = 0; i < desktop_shell_n_outputs(shell); i++)
 		shell_output_release(&shell->shell_outputs[i]);
 
+	shell_pressure_end(shell);
+	shell_jobs_end(shell);
         tw_globals_release(&shell->globals);
 	shell_tdbus_end(shell);
 	nk_cairo_destroy_backend(shell->widget_backend);
@@ -323,6 +413,9 @@ int
 main(UNUSED_ARG(int argc), UNUSED_ARG(char *argv[]))
 {
 	struct desktop_shell oneshell; //singleton
+	//before any other threads, they inherit the blocked SIGUSR2
+	tw_trace_dump_on_signal(SIGUSR2, "taiwins-shell");
+	tw_trace_thread_name("shell");
 	//shell-taiwins size is 112 it is not that
 	struct wl_display *display = wl_display_connect(NULL);
 	if (!display) {
@@ -45,6 +45,8 @@
 #include <tdbus.h>
 
 #include <shared_config.h>
+#include <jobs.h>
+#include <pressure.h>
 #include <widget/widget.h>
 
 #ifdef __cplusplus
@@ -76,6 +78,7 @@ struct shell_config {
 	void *(*run_config)(struct shell_config *, const char *);
 	void (*fini_config)(struct shell_config *);
 	char *(*request_wallpaper)(struct shell_config *);
+	void (*trim_config)(struct shell_config *);
 	void *config_data;
 };
 
@@ -113,6 +116,8 @@ struct desktop_shell {
 	enum taiwins_shell_panel_pos panel_pos;
 	struct tdbus *system_bus;
 	struct tdbus *session_bus;
+	/**< battery widget's UPower connection */
+	struct power_bus *upower;
 	struct shell_config config;
 	/**< panel bg configurations */
 	struct {
@@ -144,6 +149,11 @@ struct desktop_shell {
 	} notifs;
 
 	vector_t menu;
+	/**< blocking work off the event queue, like pam */
+	struct tw_job_pool *jobs;
+	struct tw_job_sink *job_sink;
+	/**< drops the lua garbage on memory pressure */
+	struct tw_pressure *pressure;
 	//outputs
 	struct shell_output *main_output;
 	struct shell_output shell_outputs[16];
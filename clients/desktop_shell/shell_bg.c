@@ -21,6 +21,7 @@
 
 #include <twclient/image_cache.h>
 #include <ctypes/strops.h>
+#include <trace.h>
 #include "shell.h"
 
 static bool
@@ -46,6 +47,7 @@ shell_background_frame(struct tw_appsurf *surf, struct wl_buffer *buffer,
 	void *buffer_data = tw_shm_pool_buffer_access(buffer);
 	char *wallpaper_path = (shell->config.request_wallpaper) ?
 		shell->config.request_wallpaper(&shell->config) : NULL;
+	TW_TRACE_SCOPE("shell", "shell_background_frame");
 	*geo = surf->allocation;
 	if (!image_load_for_buffer(wallpaper_path, surf->pool->format,
 		       surf->allocation.w*surf->allocation.s,
@@ -25,6 +25,7 @@
 #include <ctypes/helpers.h>
 #include "shell.h"
 #include "tdbus.h"
+#include "widget/power.h"
 
 static int
 dispatch_watch(struct tw_event *event, UNUSED_ARG(int fd))
@@ -75,7 +76,7 @@ shell_bus_change_watch(void *user_data, int fd, struct tdbus *bus,
 	        if (mask & TDBUS_WRITABLE)
 		        epoll_mask |= EPOLLOUT;
 
-	        tw_event_queue_modify_source(queue, fd, &event, mask);
+	        tw_event_queue_modify_source(queue, fd, &event, epoll_mask);
         }
 }
 
@@ -96,6 +97,13 @@ dispatch_tdbus(struct tw_event *event, int fd)
 	return TW_EVENT_NOOP;
 }
 
+static int
+dispatch_upower(struct tw_event *event, UNUSED_ARG(int fd))
+{
+	power_bus_upower_dispatch(event->data);
+	return TW_EVENT_NOOP;
+}
+
 void
 shell_tdbus_init(struct desktop_shell *shell)
 {
@@ -119,10 +127,29 @@ shell_tdbus_init(struct desktop_shell *shell)
 
 	tw_event_queue_add_idle(&shell->globals.event_queue, &session_event);
 	tw_event_queue_add_idle(&shell->globals.event_queue, &system_event);
+
+	//UPower has its own system bus connection, it speaks plain libdbus
+	shell->upower = power_bus_upower_connect();
+	if (shell->upower) {
+		struct tw_event upower_event = {
+			.data = shell->upower,
+			.cb = dispatch_upower,
+		};
+		tw_event_queue_add_source(&shell->globals.event_queue,
+		                          power_bus_upower_get_fd(shell->upower),
+		                          &upower_event, EPOLLIN);
+	}
+	shell_widget_battery_set_bus(shell->upower);
 }
 
 void shell_tdbus_end(struct desktop_shell *shell)
 {
+	if (shell->upower) {
+		tw_event_queue_remove_source(&shell->globals.event_queue,
+		                             power_bus_upower_get_fd(shell->upower));
+		power_bus_upower_disconnect(shell->upower);
+		shell->upower = NULL;
+	}
 	tdbus_delete(shell->system_bus);
 	tdbus_delete(shell->session_bus);
 }
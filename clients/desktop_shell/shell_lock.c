@@ -39,8 +39,16 @@ static struct auth_buffer {
 	char stars[256];
 	char codes[256];
 	int len;
+	//authentication in flight, the input is ignored until it comes back
+	struct tw_job *job;
 } AUTH;
 
+struct auth_job {
+	struct desktop_shell *shell;
+	char codes[256];
+	int retval;
+};
+
 /**
  * @brief This function performs a conversation between our application and and
  * the module. It receives an array of messages in the parameters (set by the
@@ -58,6 +66,7 @@ static int
 conversation(int num_msg, const struct pam_message **msgs,
 	     struct pam_response **resp, void *appdata_ptr)
 {
+	struct auth_job *auth = appdata_ptr;
 	struct pam_response *arr_response =
 		malloc(num_msg * sizeof(struct pam_response));
 	//we will be asked for password here
@@ -69,8 +78,8 @@ conversation(int num_msg, const struct pam_message **msgs,
 		case PAM_PROMPT_ECHO_ON:
 		{
 			arr_response[i].resp =
-				(char *)malloc(strlen(AUTH.codes)+1);
-			strcpy(arr_response[i].resp, AUTH.codes);
+				(char *)malloc(strlen(auth->codes)+1);
+			strcpy(arr_response[i].resp, auth->codes);
 		}
 		break;
 		case PAM_ERROR_MSG:
@@ -81,35 +90,67 @@ conversation(int num_msg, const struct pam_message **msgs,
 	return PAM_SUCCESS;
 }
 
-//this is a idle event
-static int run_pam(struct tw_event *event, int fd)
+static void
+clear_auth_buffer(void)
 {
+	memset(AUTH.stars, 0, 256);
+	memset(AUTH.codes, 0, 256);
+	AUTH.len = 0;
+}
+
+//pam may take seconds to fail, it runs on a worker
+static void
+run_pam(UNUSED_ARG(struct tw_job *job), void *data)
+{
+	struct auth_job *auth = data;
 	struct passwd *passwd = getpwuid(getuid());
 	char *username = passwd->pw_name;
-	struct tw_appsurf *app = event->data;
-	struct desktop_shell *shell =
-		container_of(app, struct desktop_shell, transient);
 	int retval = 0;
 	const struct pam_conv conv = {
 		.conv = conversation,
-		.appdata_ptr = NULL,
+		.appdata_ptr = auth,
 	};
 	pam_handle_t *auth_handle = NULL;
 
+	auth->retval = PAM_AUTH_ERR;
 	if ((retval = pam_start("i3lock", username, &conv, &auth_handle))
 	    != PAM_SUCCESS)
-		goto locked;
+		return;
 	if (retval == PAM_SUCCESS)
 		retval = pam_authenticate(auth_handle, 0);
 	if (pam_end(auth_handle, retval) != PAM_SUCCESS)
-		goto locked;
-	if (retval == PAM_SUCCESS)
-		shell_end_transient_surface(shell);
-locked:
-	memset(AUTH.stars, 0, 256);
-	memset(AUTH.codes, 0, 256);
-	AUTH.len = 0;
-	return TW_EVENT_DEL;
+		return;
+	auth->retval = retval;
+}
+
+static void
+pam_done(void *data, bool cancelled)
+{
+	struct auth_job *auth = data;
+
+	if (!cancelled && auth->retval == PAM_SUCCESS)
+		shell_end_transient_surface(auth->shell);
+	AUTH.job = NULL;
+	clear_auth_buffer();
+	explicit_bzero(auth->codes, sizeof(auth->codes));
+	free(auth);
+}
+
+static void
+start_pam(struct desktop_shell *shell)
+{
+	struct auth_job *auth;
+
+	if (AUTH.job || !(auth = calloc(1, sizeof(struct auth_job))))
+		return;
+	auth->shell = shell;
+	memcpy(auth->codes, AUTH.codes, sizeof(auth->codes));
+	if (shell->job_sink &&
+	    (AUTH.job = tw_job_submit(shell->job_sink, run_pam, pam_done,
+	                              auth)))
+		return;
+	run_pam(NULL, auth);
+	pam_done(auth, false);
 }
 
 
@@ -145,13 +186,9 @@ shell_locker_frame(struct nk_context *ctx, float width, float height,
 		AUTH.stars[AUTH.len - 1] = '*';
 	}
 	//we need to swap out the buffer and copy the last char to
-	if (nk_input_is_key_pressed(&ctx->input, NK_KEY_ENTER) || clicked) {
-		struct tw_event e = {
-			.data = locker,
-			.cb = run_pam,
-		};
-		tw_event_queue_add_idle(&locker->tw_globals->event_queue, &e);
-	}
+	if (nk_input_is_key_pressed(&ctx->input, NK_KEY_ENTER) || clicked)
+		start_pam(container_of(locker, struct desktop_shell,
+		                       transient));
 }
 
 
@@ -170,7 +207,5 @@ void shell_locker_init(struct desktop_shell *shell)
 	nk_cairo_impl_app_surface(&shell->transient, shell->widget_backend,
 				  shell_locker_frame, output->bbox);
 
-	memset(AUTH.stars, 0, 256);
-	memset(AUTH.codes, 0, 256);
-	AUTH.len = 0;
+	clear_auth_buffer();
 }
@@ -34,6 +34,7 @@
 #include <ctypes/vector.h>
 #include <twclient/ui.h>
 #include <shared_config.h>
+#include <alloc.h>
 
 #include <nuklear_love.h>
 #include <widget/widget.h>
@@ -729,6 +730,13 @@ shell_config_fini_lua(struct shell_config *config)
 	lua_close(config->config_data);
 }
 
+static void
+shell_config_trim_lua(struct shell_config *config)
+{
+	if (config->config_data)
+		lua_gc(config->config_data, LUA_GCCOLLECT, 0);
+}
+
 static char *
 shell_config_request_lua_wallpaper(struct shell_config *config)
 {
@@ -744,6 +752,17 @@ shell_config_request_lua_wallpaper(struct shell_config *config)
 	return (char *)wallpaper;
 }
 
+/* lua_newstate has no panic handler, say why before the abort */
+static int
+_lua_panic(lua_State *L)
+{
+	const char *msg = lua_tostring(L, -1);
+
+	fprintf(stderr, "shell: unprotected lua error: %s\n",
+	        msg ? msg : "(not a string)");
+	return 0;
+}
+
 void *
 shell_config_run_lua(struct shell_config *config, const char *path)
 {
@@ -758,8 +777,10 @@ shell_config_run_lua(struct shell_config *config, const char *path)
 	path_concat(default_path, PATH_MAX, 1, "shell.lua");
 	path = (path) ? path : default_path;
 
-	if (!(L = luaL_newstate()))
+	if (!(L = lua_newstate(tw_mem_lua_alloc,
+	                       (void *)(intptr_t)TW_MEM_SHELL_UI)))
 		return NULL;
+	lua_atpanic(L, _lua_panic);
 	luaL_openlibs(L);
 
 	lua_newtable(L);
@@ -797,6 +818,7 @@ shell_config_run_lua(struct shell_config *config, const char *path)
 	}
 	config->fini_config = shell_config_fini_lua;
 	config->request_wallpaper = shell_config_request_lua_wallpaper;
+	config->trim_config = shell_config_trim_lua;
 	config->config_data = L;
 
 	return L;
@@ -21,6 +21,7 @@
 
 #include <twclient/event_queue.h>
 #include <ctypes/helpers.h>
+#include <trace.h>
 #include "shell.h"
 
 
@@ -103,6 +104,7 @@ shell_panel_frame(struct nk_context *ctx, float width, float height,
 	struct shell_widget *widget = NULL, *clicked = NULL;
 	struct nk_vec2 label_span = nk_vec2(0, 0);
 	struct nk_style_button *style = &ctx->style.contextual_button;
+	TW_TRACE_SCOPE("shell", "shell_panel_frame");
 
 	int h = panel_surf->allocation.h;
 	int w = panel_surf->allocation.w;
@@ -20,114 +20,126 @@
  */
 
 #include <stdio.h>
-#include <fcntl.h>
 #include <string.h>
-#include <dirent.h>
-#include <unistd.h>
 #include <ctypes/strops.h>
-#include <ctypes/os/file.h>
 
 #include "widget.h"
-
-
-//256 should be more than enough
-struct battery_widget_data {
-	char energy_now[256];
-	char energy_full[256];
-	char charging[256];
-} battery_sys_files = {
-	.energy_now = "\0",
-	.energy_full = "\0",
-	.charging = "\0",
-};
+#include "power.h"
+
+#define BATTERY_MAX_WIDGETS 8
+#define BATTERY_SYSFS_ROOT "/sys/class/power_supply"
+
+/* there is one battery for the shell, every panel hooks its own battery widget
+ * on the same source */
+static struct battery_widget_data {
+	struct power_source source;
+	struct power_bus *bus;
+	struct shell_widget *widgets[BATTERY_MAX_WIDGETS];
+	unsigned n_widgets;
+	bool initialized;
+} battery_data;
+
+void
+shell_widget_battery_set_bus(struct power_bus *bus)
+{
+	battery_data.bus = bus;
+}
 
 static int
 battery_anchor(struct shell_widget *widget, struct shell_widget_label *label)
 {
-	//this is the current design
-	const char *energy_full = battery_sys_files.energy_full;
-	const char *energy_now = battery_sys_files.energy_now;
-	const char *online = battery_sys_files.charging;
-
-	char energies[256]; int ef = 0, en = 0, ol = 0;
-	if (!strlen(energy_now))
-		ol = 1;
-	else {
-		file_read(energy_full, energies, 256);
-		ef = atoi((const char *)energies);
-		file_read(energy_now, energies, 256);
-		en = atoi((const char *)energies);
-		file_read(online, energies, 256);
-		ol = atoi((const char *)energies);
-	}
-
-	float percent = (float)en / (float)ef;
-
-	if (ol == 1)
-		strop_ncpy(label->label, u8"\uf5e7", 256); //charging
-	else if (percent <= 0.1)
-		strop_ncpy(label->label, u8"\uf244", 256); //battery empty
-	else if (percent > 0.1 && percent <= 0.3)
-		strop_ncpy(label->label, u8"\uf243", 256); //battery quarter
-	else if (percent > 0.3 && percent <= 0.6)
-		strop_ncpy(label->label, u8"\uf242", 256); //battery half
-	else if (percent > 0.6 && percent <= 0.8)
-		strop_ncpy(label->label, u8"\uf241", 256); //three quater
+	//only cached values here, no file reading in drawing
+	const struct power_state *state = &battery_data.source.state;
+	int percent = state->percent;
+
+	if (battery_data.source.type == POWER_SOURCE_NONE || !state->present)
+		strop_ncpy(label->label, u8"\uf5e7", 32); //on AC
+	else if (state->charging)
+		strop_ncpy(label->label, u8"\uf5e7", 32); //charging
+	else if (percent <= 10)
+		strop_ncpy(label->label, u8"\uf244", 32); //battery empty
+	else if (percent <= 30)
+		strop_ncpy(label->label, u8"\uf243", 32); //battery quarter
+	else if (percent <= 60)
+		strop_ncpy(label->label, u8"\uf242", 32); //battery half
+	else if (percent <= 80)
+		strop_ncpy(label->label, u8"\uf241", 32); //three quater
 	else
-		strop_ncpy(label->label,  u8"\uf240", 256); //full
+		strop_ncpy(label->label,  u8"\uf240", 32); //full
 	return strlen(label->label);
 }
 
-//find your battery!
-static int
-battery_sysfile_find(struct shell_widget *widget, char *path)
+static void
+battery_changed(struct power_source *source, void *data)
 {
-	char batt_file[128];
-	char adp_file[128];
-	const char *power_supply = "/sys/class/power_supply";
-	int bat_no = -1; int adp_no = -1;
-	struct dirent *batt;
-	DIR *dir = opendir(power_supply);
-	if (!dir || is_dir_empty(dir)) {
-		closedir(dir);
-		return 0;
-	}
-	batt = dir_find_pattern(dir, "BAT%d", &bat_no);
-	if (!batt)
-		return 0;
-	strop_ncpy(batt_file, batt->d_name, 128);
-	seekdir(dir, 0);
-
-	batt = dir_find_pattern(dir, "ADP%d", &adp_no);
-	if (!batt)
-		return 0;
-	strop_ncpy(adp_file, batt->d_name, 128);
-	closedir(dir);
-
-	//we need to have additional checks
-	if (bat_no == -1)
-		return 0;
-	sprintf(battery_sys_files.energy_now, "%s/%s/%s", power_supply, batt_file, "energy_now");
-	sprintf(battery_sys_files.energy_full, "%s/%s/%s", power_supply, batt_file, "energy_full_design");
-	if (adp_no != -1)
-		sprintf(battery_sys_files.charging, "%s/%s/%s", power_supply, adp_file, "online");
+	struct battery_widget_data *battery = data;
+	for (unsigned i = 0; i < battery->n_widgets; i++)
+		shell_widget_redraw(battery->widgets[i]);
+}
 
-	int total_len = strlen(battery_sys_files.energy_now);
+/* sysfs is woken by power_supply uevents, we only redraw if the cached values
+ * actually moved */
+static bool
+battery_update(struct shell_widget *widget)
+{
+	return power_source_refresh(&battery_data.source);
+}
 
-	if (path)
-		strcpy(path, battery_sys_files.energy_now);
-	return total_len;
+static void
+battery_add_widget(struct shell_widget *widget)
+{
+	for (unsigned i = 0; i < battery_data.n_widgets; i++)
+		if (battery_data.widgets[i] == widget)
+			return;
+	if (battery_data.n_widgets < BATTERY_MAX_WIDGETS)
+		battery_data.widgets[battery_data.n_widgets++] = widget;
 }
 
+static int
+battery_setup(struct shell_widget *widget)
+{
+	struct power_state snapshot;
+	struct power_source *source = &battery_data.source;
+
+	//setup is called for every panel
+	battery_add_widget(widget);
+	if (!battery_data.initialized) {
+		battery_data.initialized = true;
+
+		//sysfs gives us the first snapshot either way
+		power_source_init_sysfs(source, BATTERY_SYSFS_ROOT);
+		snapshot = source->state;
+
+		if (battery_data.bus) {
+			//the bus keeps the source pointer, so init it in place
+			power_source_release(source);
+			if (power_source_init_upower(source, battery_data.bus)) {
+				//no battery in sysfs means AC until UPower says
+				//otherwise
+				source->state = snapshot;
+				source->changed = battery_changed;
+				source->data = &battery_data;
+				return 0;
+			}
+			power_source_init_sysfs(source, BATTERY_SYSFS_ROOT);
+		}
+	}
+	//fallback, listen to the kernel instead
+	if (source->type == POWER_SOURCE_SYSFS) {
+		widget->subsystem = "power_supply";
+		widget->devname = source->name;
+	}
+	return 0;
+}
 
 struct shell_widget battery_widget = {
 	.ancre_cb = battery_anchor,
 	.draw_cb = NULL,
+	.setup_cb = battery_setup,
+	.update_cb = battery_update,
 	.w = 200,
 	.h = 150,
-	.path_find = battery_sysfile_find,
-	.user_data = &battery_sys_files,
+	.user_data = &battery_data,
 	.interval = {{0}, {0}},
 	.file_path = NULL,
-
 };
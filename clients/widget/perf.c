@@ -0,0 +1,142 @@
+/*
+ * perf.c - taiwins client shell performance widget
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <ctypes/helpers.h>
+#include <shared_stats.h>
+
+#include "widget.h"
+
+/* the numbers come from the compositor's stats page, we never touch /proc. All
+ * the text is formatted into these buffers on update, drawing only reads
+ * them */
+static struct perf_widget_data {
+	const struct tw_stats_page *page;
+	struct tw_stats_page snapshot;
+	char frames[48];
+	char procs[TW_STATS_MAX_PROCS][64];
+} perf_data;
+
+static bool
+perf_map_page(struct perf_widget_data *perf)
+{
+	char path[256];
+	void *map;
+	int fd;
+
+	if (perf->page)
+		return true;
+	if (!tw_stats_page_path(path, sizeof(path)))
+		return false;
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	map = mmap(NULL, sizeof(struct tw_stats_page), PROT_READ, MAP_SHARED,
+	           fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+	perf->page = map;
+	return true;
+}
+
+static int
+perf_anchor(struct shell_widget *widget, struct shell_widget_label *label)
+{
+	const struct tw_stats_page *s = &perf_data.snapshot;
+
+	if (!s->magic)
+		return snprintf(label->label, sizeof(label->label), "--");
+	return snprintf(label->label, sizeof(label->label), "%u.%ums %u%%",
+	                s->frame_time_us / 1000,
+	                (s->frame_time_us % 1000) / 100,
+	                s->procs[0].cpu_permille / 10);
+}
+
+static void
+perf_popup(struct nk_context *ctx, float width, float height,
+           struct tw_appsurf *app)
+{
+	nk_layout_row_dynamic(ctx, 20, 1);
+	nk_label(ctx, perf_data.frames, NK_TEXT_LEFT);
+	for (unsigned i = 0; i < perf_data.snapshot.nprocs &&
+		     i < TW_STATS_MAX_PROCS; i++)
+		nk_label(ctx, perf_data.procs[i], NK_TEXT_LEFT);
+}
+
+static bool
+perf_update(struct shell_widget *widget)
+{
+	struct perf_widget_data *perf = &perf_data;
+	struct tw_stats_page *s = &perf->snapshot;
+	uint64_t last = s->updated_ms;
+
+	if (!perf_map_page(perf) || !tw_stats_page_read(perf->page, s))
+		return false;
+	if (s->updated_ms == last)
+		return false;
+
+	snprintf(perf->frames, sizeof(perf->frames),
+	         "%u frames, %u dropped, max %u.%ums", s->frames,
+	         s->dropped_frames, s->frame_time_max_us / 1000,
+	         (s->frame_time_max_us % 1000) / 100);
+	for (unsigned i = 0; i < MIN(s->nprocs, TW_STATS_MAX_PROCS); i++)
+		snprintf(perf->procs[i], sizeof(perf->procs[i]),
+		         "%.15s: %u.%u%% cpu, %llu MiB",
+		         s->procs[i].name, s->procs[i].cpu_permille / 10,
+		         s->procs[i].cpu_permille % 10,
+		         (unsigned long long)s->procs[i].rss_kb / 1024);
+	return true;
+}
+
+static int
+perf_setup(struct shell_widget *widget)
+{
+	perf_map_page(&perf_data);
+	perf_update(widget);
+	return 0;
+}
+
+struct shell_widget perf_widget = {
+	.ancre_cb = perf_anchor,
+	.draw_cb = perf_popup,
+	.setup_cb = perf_setup,
+	.update_cb = perf_update,
+	.w = 300,
+	.h = 120,
+	.user_data = &perf_data,
+	//the page changes once per second, no point to look more often
+	.interval = {
+		.it_value = {
+			.tv_sec = 1,
+			.tv_nsec = 0,
+		},
+		.it_interval = {
+			.tv_sec = 1,
+			.tv_nsec = 0,
+		},
+	},
+	.file_path = NULL,
+};
@@ -0,0 +1,200 @@
+/*
+ * power.c - taiwins client power sources
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <ctypes/strops.h>
+
+#include "power.h"
+
+//UPower device state
+enum upower_state {
+	UPOWER_STATE_CHARGING = 1,
+	UPOWER_STATE_DISCHARGING = 2,
+	UPOWER_STATE_EMPTY = 3,
+	UPOWER_STATE_FULL = 4,
+	UPOWER_STATE_PENDING_CHARGE = 5,
+	UPOWER_STATE_PENDING_DISCHARGE = 6,
+};
+
+static inline bool
+power_state_update(struct power_source *source, const struct power_state *now)
+{
+	if (!memcmp(&source->state, now, sizeof(*now)))
+		return false;
+	source->state = *now;
+	return true;
+}
+
+/******************************************************************************
+ * upower
+ *****************************************************************************/
+
+bool
+power_source_init_upower(struct power_source *source, struct power_bus *bus)
+{
+	memset(source, 0, sizeof(*source));
+	source->fd = -1;
+	source->bus = bus;
+	source->type = POWER_SOURCE_UPOWER;
+	//the display device is present until told otherwise
+	source->state.present = true;
+	if (!bus || !bus->watch(bus, source)) {
+		source->type = POWER_SOURCE_NONE;
+		source->bus = NULL;
+		return false;
+	}
+	strop_ncpy(source->name, "DisplayDevice", sizeof(source->name));
+	return true;
+}
+
+bool
+power_source_upower_property(struct power_source *source, const char *name,
+                             double value)
+{
+	struct power_state now = source->state;
+
+	if (!strcmp(name, "Percentage")) {
+		now.percent = (int)(value + 0.5);
+	} else if (!strcmp(name, "State")) {
+		int state = (int)value;
+		now.charging = state == UPOWER_STATE_CHARGING ||
+			state == UPOWER_STATE_FULL ||
+			state == UPOWER_STATE_PENDING_CHARGE;
+	} else if (!strcmp(name, "IsPresent")) {
+		now.present = value != 0.0;
+	} else
+		return false;
+
+	if (!power_state_update(source, &now))
+		return false;
+	if (source->changed)
+		source->changed(source, source->data);
+	return true;
+}
+
+/******************************************************************************
+ * sysfs
+ *****************************************************************************/
+
+static bool
+sysfs_find_battery(const char *root, char *name, size_t len)
+{
+	DIR *dir = opendir(root);
+	struct dirent *entry;
+	bool found = false;
+
+	if (!dir)
+		return false;
+	while ((entry = readdir(dir))) {
+		if (!strncmp(entry->d_name, "BAT", 3)) {
+			strop_ncpy(name, entry->d_name, len);
+			found = true;
+			break;
+		}
+	}
+	closedir(dir);
+	return found;
+}
+
+bool
+power_source_init_sysfs(struct power_source *source, const char *root)
+{
+	char path[PATH_MAX];
+
+	memset(source, 0, sizeof(*source));
+	source->fd = -1;
+	if (!sysfs_find_battery(root, source->name, sizeof(source->name)))
+		return false;
+	snprintf(path, sizeof(path), "%s/%s/uevent", root, source->name);
+	source->fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (source->fd < 0)
+		return false;
+	source->type = POWER_SOURCE_SYSFS;
+	power_source_refresh(source);
+	return true;
+}
+
+static inline long
+uevent_value(const char *line, const char *key)
+{
+	size_t len = strlen(key);
+	if (strncmp(line, key, len) || line[len] != '=')
+		return -1;
+	return atol(line + len + 1);
+}
+
+/* uevent has everything in one file, one pread gives us a consistent
+ * snapshot, instead of opening capacity, status, energy_* one by one. */
+bool
+power_source_refresh(struct power_source *source)
+{
+	char buf[2048];
+	ssize_t n;
+	long capacity = -1, now_e = -1, full_e = -1, v;
+	struct power_state now = source->state;
+
+	if (source->type != POWER_SOURCE_SYSFS)
+		return false;
+	n = pread(source->fd, buf, sizeof(buf)-1, 0);
+	if (n <= 0)
+		return false;
+	buf[n] = '\0';
+
+	now.present = true;
+	for (char *sv, *line = strtok_r(buf, "\n", &sv); line;
+	     line = strtok_r(NULL, "\n", &sv)) {
+		if ((v = uevent_value(line, "POWER_SUPPLY_CAPACITY")) >= 0)
+			capacity = v;
+		else if ((v = uevent_value(line, "POWER_SUPPLY_ENERGY_NOW")) >= 0 ||
+		         (v = uevent_value(line, "POWER_SUPPLY_CHARGE_NOW")) >= 0)
+			now_e = v;
+		else if ((v = uevent_value(line, "POWER_SUPPLY_ENERGY_FULL")) >= 0 ||
+		         (v = uevent_value(line, "POWER_SUPPLY_CHARGE_FULL")) >= 0)
+			full_e = v;
+		else if ((v = uevent_value(line, "POWER_SUPPLY_PRESENT")) >= 0)
+			now.present = v != 0;
+		else if (!strncmp(line, "POWER_SUPPLY_STATUS=", 20))
+			now.charging = !strcmp(line+20, "Charging") ||
+				!strcmp(line+20, "Full");
+	}
+	if (capacity < 0 && now_e >= 0 && full_e > 0)
+		capacity = now_e * 100 / full_e;
+	now.percent = capacity < 0 ? 0 : (capacity > 100 ? 100 : capacity);
+
+	return power_state_update(source, &now);
+}
+
+void
+power_source_release(struct power_source *source)
+{
+	if (source->type == POWER_SOURCE_UPOWER && source->bus &&
+	    source->bus->unwatch)
+		source->bus->unwatch(source->bus, source);
+	if (source->fd >= 0)
+		close(source->fd);
+	source->fd = -1;
+	source->type = POWER_SOURCE_NONE;
+}
@@ -0,0 +1,136 @@
+/*
+ * power.h - taiwins client power source abstraction
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SHELL_WIDGET_POWER_H
+#define SHELL_WIDGET_POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief cached battery state
+ *
+ * The values are kept in the source, reading them is free. They only get
+ * updated when UPower tells us something changed, or when we do the sysfs
+ * refresh.
+ */
+struct power_state {
+	int percent;
+	bool charging;
+	bool present;
+};
+
+struct power_source;
+typedef void (*power_source_changed_f)(struct power_source *source,
+                                       void *data);
+
+/**
+ * @brief the bus side of UPower
+ *
+ * the real one is a system bus connection (power_bus_upower_connect), tests
+ * can implement it by hand and feed power_source_upower_property directly.
+ */
+struct power_bus {
+	void *user_data;
+	/** start listening to PropertiesChanged of the display device */
+	bool (*watch)(struct power_bus *bus, struct power_source *source);
+	void (*unwatch)(struct power_bus *bus, struct power_source *source);
+};
+
+enum power_source_type {
+	POWER_SOURCE_NONE = 0,
+	POWER_SOURCE_UPOWER,
+	POWER_SOURCE_SYSFS,
+};
+
+struct power_source {
+	enum power_source_type type;
+	struct power_state state;
+	/**< sysfs: the uevent file of the battery, kept open */
+	int fd;
+	char name[32];
+	/**< upower */
+	struct power_bus *bus;
+
+	power_source_changed_f changed;
+	void *data;
+};
+
+bool
+power_source_init_upower(struct power_source *source, struct power_bus *bus);
+
+/**
+ * @brief use the first battery under root
+ *
+ * root is normally /sys/class/power_supply, tests give it a fake tree.
+ */
+bool
+power_source_init_sysfs(struct power_source *source, const char *root);
+
+void
+power_source_release(struct power_source *source);
+
+/**
+ * @brief sysfs only, re-read the uevent file with one read
+ *
+ * @return true if any cached value changed
+ */
+bool
+power_source_refresh(struct power_source *source);
+
+/**
+ * @brief upower only, apply one entry of PropertiesChanged
+ *
+ * @return true if any cached value changed, the changed callback is called as
+ * well in that case.
+ */
+bool
+power_source_upower_property(struct power_source *source, const char *name,
+                             double value);
+
+/**
+ * @brief open a private system bus connection for UPower
+ *
+ * The caller polls the fd from power_bus_upower_get_fd and calls
+ * power_bus_upower_dispatch when it is readable.
+ */
+struct power_bus *
+power_bus_upower_connect(void);
+
+int
+power_bus_upower_get_fd(struct power_bus *bus);
+
+void
+power_bus_upower_dispatch(struct power_bus *bus);
+
+void
+power_bus_upower_disconnect(struct power_bus *bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,204 @@
+/*
+ * power_upower.c - taiwins client UPower bus adapter
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <string.h>
+#include <dbus/dbus.h>
+#include <ctypes/helpers.h>
+
+#include "power.h"
+
+#define UPOWER_SERVICE "org.freedesktop.UPower"
+#define UPOWER_DISPLAY_DEVICE "/org/freedesktop/UPower/devices/DisplayDevice"
+#define UPOWER_DEVICE_IFACE "org.freedesktop.UPower.Device"
+#define UPOWER_MATCH "type='signal',sender='" UPOWER_SERVICE "'," \
+	"path='" UPOWER_DISPLAY_DEVICE "'," \
+	"interface='" DBUS_INTERFACE_PROPERTIES "'," \
+	"member='PropertiesChanged'"
+
+/* the adapter talks to libdbus directly on its own system bus connection, so
+ * the widget only depends on calls libdbus documents. There is only one
+ * display device, so only one source. */
+static struct power_bus_upower {
+	struct power_bus base;
+	DBusConnection *conn;
+	struct power_source *source;
+} s_power_bus;
+
+static inline double
+upower_variant_value(DBusMessageIter *variant)
+{
+	DBusBasicValue value;
+
+	switch (dbus_message_iter_get_arg_type(variant)) {
+	case DBUS_TYPE_DOUBLE:
+		dbus_message_iter_get_basic(variant, &value);
+		return value.dbl;
+	case DBUS_TYPE_UINT32:
+		dbus_message_iter_get_basic(variant, &value);
+		return value.u32;
+	case DBUS_TYPE_BOOLEAN:
+		dbus_message_iter_get_basic(variant, &value);
+		return value.bool_val;
+	default:
+		return 0.0;
+	}
+}
+
+/* PropertiesChanged(s interface, a{sv} changed, as invalidated), we only take
+ * the values we care, the rest goes away with the message */
+static DBusHandlerResult
+upower_read_changed(UNUSED_ARG(DBusConnection *conn), DBusMessage *message,
+                    void *data)
+{
+	struct power_bus_upower *bus = data;
+	DBusMessageIter args, changed, entry, variant;
+	const char *iface, *name;
+
+	if (!bus->source ||
+	    !dbus_message_is_signal(message, DBUS_INTERFACE_PROPERTIES,
+	                            "PropertiesChanged") ||
+	    !dbus_message_has_path(message, UPOWER_DISPLAY_DEVICE))
+		return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+
+	if (!dbus_message_iter_init(message, &args) ||
+	    dbus_message_iter_get_arg_type(&args) != DBUS_TYPE_STRING)
+		return DBUS_HANDLER_RESULT_HANDLED;
+	dbus_message_iter_get_basic(&args, &iface);
+	if (strcmp(iface, UPOWER_DEVICE_IFACE) ||
+	    !dbus_message_iter_next(&args) ||
+	    dbus_message_iter_get_arg_type(&args) != DBUS_TYPE_ARRAY)
+		return DBUS_HANDLER_RESULT_HANDLED;
+
+	dbus_message_iter_recurse(&args, &changed);
+	for (; dbus_message_iter_get_arg_type(&changed) == DBUS_TYPE_DICT_ENTRY;
+	     dbus_message_iter_next(&changed)) {
+		dbus_message_iter_recurse(&changed, &entry);
+		if (dbus_message_iter_get_arg_type(&entry) != DBUS_TYPE_STRING)
+			continue;
+		dbus_message_iter_get_basic(&entry, &name);
+		if (!dbus_message_iter_next(&entry) ||
+		    dbus_message_iter_get_arg_type(&entry) != DBUS_TYPE_VARIANT)
+			continue;
+		dbus_message_iter_recurse(&entry, &variant);
+		power_source_upower_property(bus->source, name,
+		                             upower_variant_value(&variant));
+	}
+	return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+static bool
+power_bus_upower_watch(struct power_bus *base, struct power_source *source)
+{
+	struct power_bus_upower *bus =
+		(struct power_bus_upower *)base;
+	DBusError err;
+
+	if (bus->source)
+		return false;
+	//no UPower on this bus, caller falls back to sysfs
+	if (!dbus_bus_name_has_owner(bus->conn, UPOWER_SERVICE, NULL))
+		return false;
+	dbus_error_init(&err);
+	dbus_bus_add_match(bus->conn, UPOWER_MATCH, &err);
+	if (dbus_error_is_set(&err)) {
+		dbus_error_free(&err);
+		return false;
+	}
+	if (!dbus_connection_add_filter(bus->conn, upower_read_changed, bus,
+	                                NULL)) {
+		dbus_bus_remove_match(bus->conn, UPOWER_MATCH, NULL);
+		return false;
+	}
+	bus->source = source;
+	return true;
+}
+
+static void
+power_bus_upower_unwatch(struct power_bus *base,
+                         UNUSED_ARG(struct power_source *source))
+{
+	struct power_bus_upower *bus =
+		(struct power_bus_upower *)base;
+
+	if (!bus->source)
+		return;
+	dbus_connection_remove_filter(bus->conn, upower_read_changed, bus);
+	//NULL error does not wait for the reply
+	dbus_bus_remove_match(bus->conn, UPOWER_MATCH, NULL);
+	bus->source = NULL;
+}
+
+struct power_bus *
+power_bus_upower_connect(void)
+{
+	DBusConnection *conn;
+
+	if (s_power_bus.conn)
+		return &s_power_bus.base;
+	conn = dbus_bus_get_private(DBUS_BUS_SYSTEM, NULL);
+	if (!conn)
+		return NULL;
+	dbus_connection_set_exit_on_disconnect(conn, FALSE);
+
+	s_power_bus.conn = conn;
+	s_power_bus.source = NULL;
+	s_power_bus.base.user_data = conn;
+	s_power_bus.base.watch = power_bus_upower_watch;
+	s_power_bus.base.unwatch = power_bus_upower_unwatch;
+	return &s_power_bus.base;
+}
+
+int
+power_bus_upower_get_fd(struct power_bus *base)
+{
+	struct power_bus_upower *bus =
+		(struct power_bus_upower *)base;
+	int fd = -1;
+
+	if (!dbus_connection_get_unix_fd(bus->conn, &fd))
+		return -1;
+	return fd;
+}
+
+void
+power_bus_upower_dispatch(struct power_bus *base)
+{
+	struct power_bus_upower *bus =
+		(struct power_bus_upower *)base;
+
+	dbus_connection_read_write(bus->conn, 0);
+	while (dbus_connection_dispatch(bus->conn) ==
+	       DBUS_DISPATCH_DATA_REMAINS);
+}
+
+void
+power_bus_upower_disconnect(struct power_bus *base)
+{
+	struct power_bus_upower *bus =
+		(struct power_bus_upower *)base;
+
+	if (!bus->conn)
+		return;
+	power_bus_upower_unwatch(base, bus->source);
+	dbus_connection_close(bus->conn);
+	dbus_connection_unref(bus->conn);
+	bus->conn = NULL;
+}
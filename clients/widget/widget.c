@@ -35,19 +35,34 @@
 extern struct shell_widget clock_widget;
 extern struct shell_widget what_up_widget;
 extern struct shell_widget battery_widget;
+extern struct shell_widget perf_widget;
 extern void shell_widget_release_with_runtime(struct shell_widget *widget);
 
-static int
-redraw_panel_for_file(struct tw_event *e, int fd)
+void
+shell_widget_redraw(struct shell_widget *widget)
 {
-	struct shell_widget *widget = e->data;
 	struct tw_app_event ae = {
 		.type = TW_TIMER,
 		.time = widget->ancre.tw_globals->inputs.millisec,
 	};
 
-	//panel gets redrawed for once we have a event
 	widget->ancre.do_frame(&widget->ancre, &ae);
+}
+
+static inline void
+shell_widget_update(struct shell_widget *widget)
+{
+	if (!widget->update_cb || widget->update_cb(widget))
+		shell_widget_redraw(widget);
+}
+
+static int
+redraw_panel_for_file(struct tw_event *e, int fd)
+{
+	struct shell_widget *widget = e->data;
+
+	//panel gets redrawed for once we have a event
+	shell_widget_update(widget);
 	//if somehow my fd changes, it means I no longer watch this fd anymore
 	if (widget->fd != fd)
 		return TW_EVENT_DEL;
@@ -60,12 +75,9 @@ redraw_panel_for_dev(struct tw_event *e, int fd)
 {
 	struct shell_widget *widget = e->data;
 	struct tw_event_queue *queue = widget->queue;
-	struct tw_app_event ae = {
-		.type = TW_TIMER,
-		.time = widget->ancre.tw_globals->inputs.millisec,
-	};
+
 	widget->dev = tw_event_get_udev_device(queue, widget->fd);
-	widget->ancre.do_frame(&widget->ancre, &ae);
+	shell_widget_update(widget);
 	udev_device_unref(widget->dev);
 	widget->dev = NULL;
 
@@ -76,12 +88,8 @@ static int
 redraw_panel_for_timer(struct tw_event *e, int fd)
 {
 	struct shell_widget *widget = e->data;
-	struct tw_app_event ae = {
-		.type = TW_TIMER,
-		.time = widget->ancre.tw_globals->inputs.millisec,
-	};
 
-	widget->ancre.do_frame(&widget->ancre, &ae);
+	shell_widget_update(widget);
 	//test if this is a one time event
 	if (!(widget->interval).it_interval.tv_sec &&
 	    !widget->interval.it_interval.tv_nsec)
@@ -136,7 +144,8 @@ shell_widget_builtin(struct shell_widget *widget)
 {
 	return widget == &clock_widget ||
 		widget == &what_up_widget  ||
-		widget == &battery_widget;
+		widget == &battery_widget ||
+		widget == &perf_widget;
 }
 
 const struct shell_widget *
@@ -148,6 +157,8 @@ shell_widget_get_builtin_by_name(const char *name)
 		return &what_up_widget;
 	if (!strcmp("battery", name))
 		return &battery_widget;
+	if (!strcmp("perf", name))
+		return &perf_widget;
 	return NULL;
 }
 
@@ -165,6 +176,7 @@ shell_widget_activate(struct shell_widget *widget, struct tw_event_queue *queue)
 		int len = widget->path_find(widget, NULL);
 		if (len) {
 			char path[len + 1];
+			widget->path_find(widget, path);
 			shell_widget_event_from_file(widget, path, queue);
 		}
 	} else if (widget->subsystem && widget->devname)
@@ -53,6 +53,8 @@ struct shell_widget_label {
 };
 typedef int (*shell_widget_draw_label_t)(struct shell_widget *, struct shell_widget_label *);
 typedef int (*shell_widget_setup_cb_t)(struct shell_widget *);
+//return true if the widget has to redraw
+typedef bool (*shell_widget_update_cb_t)(struct shell_widget *);
 
 //free it afterwards
 typedef int (*shell_widget_path_find_t)(struct shell_widget *, char *path);
@@ -71,6 +73,8 @@ struct shell_widget {
 	struct wl_list link;
 	shell_widget_draw_label_t ancre_cb;
 	shell_widget_setup_cb_t setup_cb;
+	/**< if present, the watchers only redraw when it returns true */
+	shell_widget_update_cb_t update_cb;
 	nk_wl_drawcall_t draw_cb;
 	//watchers
 	struct {
@@ -108,6 +112,14 @@ shell_widgets_load_script(struct wl_list *head, struct tw_event_queue *queue,
 
 const struct shell_widget *shell_widget_get_builtin_by_name(const char *name);
 
+void
+shell_widget_redraw(struct shell_widget *widget);
+
+struct power_bus;
+/* battery prefers UPower over sysfs if shell gives it a bus */
+void
+shell_widget_battery_set_bus(struct power_bus *bus);
+
 static inline void
 shell_widget_hook_panel(struct shell_widget *widget, struct tw_appsurf *panel)
 {
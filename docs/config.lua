@@ -18,6 +18,7 @@ shell:set_menus({
 -- shell:init_widgets("safjklksajfla")
 
 desktop = compositor:desktop()
+-- layouts are 'floating', 'tiling', 'master', 'grid' and 'monocle'
 for _,ws in ipairs(desktop:workspaces()) do
    ws:set_layout('floating')
 end
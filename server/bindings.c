@@ -30,6 +30,8 @@
 
 #include <ctypes/tree.h>
 #include <ctypes/helpers.h>
+#include <alloc.h>
+#include <trace.h>
 #include "bindings.h"
 
 
@@ -108,6 +110,8 @@ tw_keybinding_key(struct weston_keyboard_grab *grab,
 	//we get it twice
 	if (state != WL_KEYBOARD_KEY_STATE_PRESSED)
 		return;
+	TW_TRACE_SCOPE("input", "tw_keybinding_key");
+	TW_WATCHDOG_SOURCE("key binding");
 
 	xkb_keycode_t keycode = kc_linux2xkb(key);
 	uint32_t mod = modifier_mask_from_xkb_state(keyboard->xkb_state.state);
@@ -150,7 +154,7 @@ tw_keybinding_cancel(struct weston_keyboard_grab *grab)
 	struct keybinding_container *container =
 		container_of(grab, struct keybinding_container, grab);
 	weston_keyboard_end_grab(grab->keyboard);
-	free(container);
+	tw_free(container);
 }
 
 static struct weston_keyboard_grab_interface tw_keybinding_grab = {
@@ -178,7 +182,8 @@ tw_start_keybinding(struct weston_keyboard *keyboard,
 	//double click
 	struct tw_bindings *bindings = data;
 	struct keybinding_container *container =
-		zalloc(sizeof(struct keybinding_container));
+		tw_zalloc(TW_MEM_BINDINGS,
+		          sizeof(struct keybinding_container));
 	container->node = &bindings->root_node;
 	container->grab.interface = &tw_keybinding_grab;
 	weston_keyboard_start_grab(keyboard,
@@ -191,7 +196,8 @@ tw_start_keybinding(struct weston_keyboard *keyboard,
 struct tw_bindings *
 tw_bindings_create(struct weston_compositor *ec)
 {
-	struct tw_bindings *root = zalloc(sizeof(struct tw_bindings));
+	struct tw_bindings *root =
+		tw_zalloc(TW_MEM_BINDINGS, sizeof(struct tw_bindings));
 	if (root) {
 		root->ec = ec;
 		vtree_node_init(&root->root_node.node,
@@ -207,7 +213,7 @@ tw_bindings_create(struct weston_compositor *ec)
 void
 tw_bindings_destroy(struct tw_bindings *bindings)
 {
-	vtree_destroy_children(&bindings->root_node.node, free);
+	vtree_destroy_children(&bindings->root_node.node, tw_free);
 	if (bindings->apply_list.elems)
 		vector_destroy(&bindings->apply_list);
 
@@ -216,7 +222,7 @@ tw_bindings_destroy(struct tw_bindings *bindings)
 		weston_binding_destroy(*wb);
 	vector_destroy(&bindings->weston_bindings);
 
-	free(bindings);
+	tw_free(bindings);
 }
 
 static inline struct tw_binding_node *
@@ -224,7 +230,8 @@ make_binding_node(xkb_keycode_t code, uint32_t mod, uint32_t option,
 		  tw_key_binding fuc, const void *data, bool end)
 {
 	//allocate new ones
-	struct tw_binding_node *binding = zalloc(sizeof(struct tw_binding_node));
+	struct tw_binding_node *binding =
+		tw_zalloc(TW_MEM_BINDINGS, sizeof(struct tw_binding_node));
 	vtree_node_init(&binding->node, offsetof(struct tw_binding_node, node));
 	binding->keycode = code;
 	binding->modifier = mod;
@@ -22,17 +22,56 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <fcntl.h>
 #include <sys/eventfd.h>
+#include <sys/epoll.h>
 #include <libweston/libweston.h>
 #include <tdbus.h>
 
 #include "compositor.h"
+#include "spsc_queue.h"
+
+#define TW_BUS_QUEUE_SIZE 64
+
+/**
+ * @brief a decoded method call travelling between bus thread and main thread
+ *
+ * The bus thread decodes the arguments and creates the reply message, the main
+ * thread runs the handler which only fills the result string. The call then
+ * travels back to the bus thread which writes and sends the reply, so the main
+ * thread never touches the dbus connection.
+ */
+struct tw_bus_call {
+	void (*handle)(struct tw_bus_call *call);
+	struct tdbus_message *reply;
+	char result[128];
+};
+
+struct tw_bus_watch {
+	int fd;
+	void *watch_data;
+};
 
 static struct tw_bus {
 	struct weston_compositor *compositor;
 	struct tdbus *dbus;
 	struct wl_event_source *source;
 
+	pthread_t thread;
+	atomic_bool quit;
+	bool thread_running;
+	int epoll_fd;
+	int thread_wakeup; /**< eventfd for the bus thread */
+	int main_wakeup; /**< eventfd for the main loop */
+	struct tw_spsc_queue calls; /**< bus thread -> main thread */
+	struct tw_spsc_queue replies; /**< main thread -> bus thread */
+	/**< main thread, a reply the full queue did not take yet */
+	struct tw_bus_call held;
+	bool holding;
+	atomic_bool replies_full; /**< wake main thread once replies drained */
+
 	struct wl_listener compositor_distroy_listener;
 } s_bus;
 
@@ -42,86 +81,193 @@ get_bus(void)
 	return &s_bus;
 }
 
-static int
-tw_dbus_dispatch_watch(UNUSED_ARG(int fd), UNUSED_ARG(uint32_t mask),
-                       UNUSED_ARG(void *data))
+static inline void
+tw_bus_wakeup(int fd)
 {
-	struct tw_bus *twbus = get_bus();
-	struct tdbus *bus = twbus->dbus;
-	void *watch_data = data;
-
-	tdbus_handle_watch(bus, watch_data);
-
-	return 0;
+	eventfd_write(fd, 1);
 }
 
+/******************************************************************************
+ * bus thread
+ *****************************************************************************/
 
-static void
-tw_bus_add_watch(void *user_data, int unix_fd, UNUSED_ARG(struct tdbus *bus),
-                 uint32_t mask, void *watch_data)
+static inline uint32_t
+tw_bus_epoll_flags(uint32_t mask)
 {
-	struct wl_event_loop *loop;
-	struct tw_bus *twbus = user_data;
 	uint32_t flags = 0;
-	struct wl_event_source *s;
 
-	loop = wl_display_get_event_loop(twbus->compositor->wl_display);
 	if (mask & TDBUS_ENABLED) {
 		if (mask & TDBUS_READABLE)
-			flags |= WL_EVENT_READABLE;
+			flags |= EPOLLIN;
 		if (mask & TDBUS_WRITABLE)
-			flags |= WL_EVENT_WRITABLE;
+			flags |= EPOLLOUT;
+	}
+	return flags;
+}
+
+/* the watch callbacks may be called from both threads, epoll_ctl is thread
+ * safe, the fd is duplicated like wl_event_loop does since dbus may install
+ * reading and writing watches on the same fd. */
+static void
+tw_bus_add_watch(void *user_data, int unix_fd, UNUSED_ARG(struct tdbus *bus),
+                 uint32_t mask, void *watch_data)
+{
+	struct tw_bus *twbus = user_data;
+	struct tw_bus_watch *w;
+	struct epoll_event ev = {0};
 
-		s = wl_event_loop_add_fd(loop, unix_fd, flags,
-		                         tw_dbus_dispatch_watch,
-		                         watch_data);
-		tdbus_watch_set_user_data(watch_data, s);
+	w = zalloc(sizeof(*w));
+	if (!w)
+		return;
+	w->fd = fcntl(unix_fd, F_DUPFD_CLOEXEC, 0);
+	w->watch_data = watch_data;
+	ev.events = tw_bus_epoll_flags(mask);
+	ev.data.ptr = w;
+	if (w->fd < 0 ||
+	    epoll_ctl(twbus->epoll_fd, EPOLL_CTL_ADD, w->fd, &ev) < 0) {
+		if (w->fd >= 0)
+			close(w->fd);
+		free(w);
+		return;
 	}
+	tdbus_watch_set_user_data(watch_data, w);
 }
 
 static void
-tw_bus_ch_watch(UNUSED_ARG(void *user_data), UNUSED_ARG(int unix_fd),
+tw_bus_ch_watch(void *user_data, UNUSED_ARG(int unix_fd),
                 UNUSED_ARG(struct tdbus *bus),
                 uint32_t mask, void *watch_data)
 {
-	struct wl_event_source *s;
-	uint32_t flags = 0;
+	struct tw_bus *twbus = user_data;
+	struct tw_bus_watch *w;
+	struct epoll_event ev = {0};
 
-	s = tdbus_watch_get_user_data(watch_data);
-	if (!s)
+	w = tdbus_watch_get_user_data(watch_data);
+	if (!w)
 		return;
+	ev.events = tw_bus_epoll_flags(mask);
+	ev.data.ptr = w;
+	epoll_ctl(twbus->epoll_fd, EPOLL_CTL_MOD, w->fd, &ev);
+}
 
-	if (mask & TDBUS_ENABLED) {
-		if (flags & TDBUS_READABLE)
-			flags |= WL_EVENT_READABLE;
-		if (flags & TDBUS_WRITABLE)
-			flags |= WL_EVENT_WRITABLE;
-	}
-	wl_event_source_fd_update(s, flags);
+static void
+tw_bus_rm_watch(void *user_data, UNUSED_ARG(int unix_fd),
+                UNUSED_ARG(struct tdbus *bus), void *watch_data)
+{
+	struct tw_bus *twbus = user_data;
+	struct tw_bus_watch *w;
 
+	w = tdbus_watch_get_user_data(watch_data);
+	if (!w)
+		return;
 
+	epoll_ctl(twbus->epoll_fd, EPOLL_CTL_DEL, w->fd, NULL);
+	close(w->fd);
+	free(w);
+	tdbus_watch_set_user_data(watch_data, NULL);
 }
 
 static void
-tw_bus_rm_watch(UNUSED_ARG(void *user_data), UNUSED_ARG(int unix_fd),
-                UNUSED_ARG(struct tdbus *bus), void *watch_data)
+tw_bus_send_replies(struct tw_bus *bus)
+{
+	struct tw_bus_call call;
+
+	while (tw_spsc_queue_pop(&bus->replies, &call)) {
+		tdbus_write(call.reply, "%s", call.result);
+		tdbus_send_message(bus->dbus, call.reply);
+	}
+	//main thread is holding a reply for us, there is room now
+	if (atomic_exchange(&bus->replies_full, false))
+		tw_bus_wakeup(bus->main_wakeup);
+}
+
+static void *
+tw_bus_thread_run(void *data)
 {
-	struct wl_event_source *s;
+	struct tw_bus *bus = data;
+	struct epoll_event events[16];
+	eventfd_t count;
+	int n;
+
+	while (!atomic_load(&bus->quit)) {
+		n = epoll_wait(bus->epoll_fd, events, NUMOF(events), -1);
+		for (int i = 0; i < n; i++) {
+			struct tw_bus_watch *w = events[i].data.ptr;
+			//NULL is our own wakeup
+			if (!w)
+				eventfd_read(bus->thread_wakeup, &count);
+			else
+				tdbus_handle_watch(bus->dbus, w->watch_data);
+		}
+		tw_bus_send_replies(bus);
+		//one read may carry several messages
+		while (tdbus_dispatch_once(bus->dbus));
+	}
+	return NULL;
+}
 
-	s = tdbus_watch_get_user_data(watch_data);
-	if (!s)
+/**
+ * @brief hand a decoded call to the main thread, called in bus thread
+ *
+ * if the queue is full we reply right away with an error instead of blocking
+ * the bus thread.
+ */
+static void
+tw_bus_post_call(struct tw_bus *bus, struct tw_bus_call *call)
+{
+	if (!tw_spsc_queue_push(&bus->calls, call)) {
+		tdbus_write(call->reply, "%s", "compositor busy");
+		tdbus_send_message(bus->dbus, call->reply);
 		return;
+	}
+	tw_bus_wakeup(bus->main_wakeup);
+}
 
-	wl_event_source_remove(s);
+/******************************************************************************
+ * main thread
+ *****************************************************************************/
+
+/* the bus thread may not have sent the replies of last round yet, so the reply
+ * queue can be full. The reply is then held here and we stop taking calls, the
+ * bus thread wakes us once it drained the queue. */
+static bool
+tw_bus_push_reply(struct tw_bus *bus, struct tw_bus_call *call)
+{
+	if (tw_spsc_queue_push(&bus->replies, call))
+		return true;
+	atomic_store(&bus->replies_full, true);
+	//it may have drained before seeing the flag
+	if (tw_spsc_queue_push(&bus->replies, call))
+		return true;
+	bus->held = *call;
+	bus->holding = true;
+	return false;
 }
 
 static int
-tw_bus_dispatch(UNUSED_ARG(int fd), UNUSED_ARG(uint32_t mask),
-                UNUSED_ARG(void *data))
+tw_bus_dispatch(int fd, UNUSED_ARG(uint32_t mask), void *data)
 {
 	struct tw_bus *bus = data;
-
-	tdbus_dispatch_once(bus->dbus);
+	struct tw_bus_call call;
+	eventfd_t count;
+	bool replied = false;
+	TW_WATCHDOG_SOURCE("dbus call");
+
+	eventfd_read(fd, &count);
+	if (bus->holding) {
+		bus->holding = false;
+		if (!tw_bus_push_reply(bus, &bus->held))
+			return 0;
+		replied = true;
+	}
+	while (tw_spsc_queue_pop(&bus->calls, &call)) {
+		call.handle(&call);
+		replied = true;
+		if (!tw_bus_push_reply(bus, &call))
+			break;
+	}
+	if (replied)
+		tw_bus_wakeup(bus->thread_wakeup);
 
 	return 0;
 }
@@ -131,14 +277,41 @@ tw_bus_end(struct wl_listener *listener, UNUSED_ARG(void *data))
 {
 	struct tw_bus *bus = container_of(listener, struct tw_bus,
 	                                  compositor_distroy_listener);
-	struct tdbus *dbus = bus->dbus;
+	struct tw_bus_call call;
 
+	if (bus->thread_running) {
+		atomic_store(&bus->quit, true);
+		tw_bus_wakeup(bus->thread_wakeup);
+		pthread_join(bus->thread, NULL);
+		bus->thread_running = false;
+	}
 	if (bus->source)
 		wl_event_source_remove(bus->source);
-
-	tdbus_delete(dbus);
+	bus->source = NULL;
+	//the pending replies are simply dropped with the connection
+	if (bus->calls.data)
+		while (tw_spsc_queue_pop(&bus->calls, &call));
+	if (bus->dbus)
+		tdbus_delete(bus->dbus);
+	bus->dbus = NULL;
+
+	if (bus->main_wakeup >= 0)
+		close(bus->main_wakeup);
+	if (bus->thread_wakeup >= 0)
+		close(bus->thread_wakeup);
+	if (bus->epoll_fd >= 0)
+		close(bus->epoll_fd);
+	bus->main_wakeup = bus->thread_wakeup = bus->epoll_fd = -1;
+	tw_spsc_queue_release(&bus->calls);
+	tw_spsc_queue_release(&bus->replies);
 }
 
+/******************************************************************************
+ * methods
+ *****************************************************************************/
+
+/* Hello does not need any compositor state, so it is answered directly in bus
+ * thread */
 static int tw_bus_read_request(const struct tdbus_method_call *call)
 {
 	char *msg_received = NULL, msg_reply[128];
@@ -155,6 +328,8 @@ static int tw_bus_read_request(const struct tdbus_method_call *call)
 	free(msg_received);
 
 	reply = tdbus_reply_method(call->message, NULL);
+	if (!reply)
+		return 0;
 	tdbus_write(reply, "%s", msg_reply);
 	tdbus_send_message(bus, reply);
 
@@ -163,30 +338,70 @@ err_call:
 	if (msg_received)
 		free(msg_received);
 	reply = tdbus_reply_method(call->message, invalid_reply);
+	if (!reply)
+		return 0;
 	tdbus_write(reply, "%s", invalid_reply);
 	tdbus_send_message(bus, reply);
 	return 0;
 }
 
-static struct tdbus_call_answer tw_bus_answer = {
-	.interface = "org.taiwins.example",
-	.method = "Hello",
-	.in_signature = "s",
-	.out_signature = "s",
-	.reader = tw_bus_read_request,
+static void
+tw_bus_handle_current_workspace(struct tw_bus_call *call)
+{
+	struct desktop *desktop = tw_desktop_get_global();
+	int ws = tw_desktop_get_current_workspace(desktop);
+
+	snprintf(call->result, sizeof(call->result), "%d:%s", ws+1,
+	         tw_desktop_get_workspace_layout(desktop, ws));
+}
+
+/* this one reads desktop state, so it has to run in the main thread */
+static int
+tw_bus_read_current_workspace(const struct tdbus_method_call *call)
+{
+	struct tw_bus_call bus_call = {
+		.handle = tw_bus_handle_current_workspace,
+		.reply = tdbus_reply_method(call->message, NULL),
+	};
+
+	//out of memory, nothing we can answer with
+	if (!bus_call.reply)
+		return 0;
+	tw_bus_post_call(get_bus(), &bus_call);
+	return 0;
+}
+
+static struct tdbus_call_answer tw_bus_answers[] = {
+	{
+		.interface = "org.taiwins.example",
+		.method = "Hello",
+		.in_signature = "s",
+		.out_signature = "s",
+		.reader = tw_bus_read_request,
+	},
+	{
+		.interface = "org.taiwins.desktop",
+		.method = "CurrentWorkspace",
+		.in_signature = "",
+		.out_signature = "s",
+		.reader = tw_bus_read_current_workspace,
+	},
 };
 
 struct tw_bus *
 tw_setup_bus(struct weston_compositor *ec)
 {
-	int fd;
 	struct tw_bus *bus = get_bus();
 	struct wl_display *display;
 	struct wl_event_loop *loop;
+	struct epoll_event ev = {0};
 
 	display = ec->wl_display;
 	loop = wl_display_get_event_loop(display);
 	bus->compositor = ec;
+	bus->epoll_fd = bus->main_wakeup = bus->thread_wakeup = -1;
+	atomic_init(&bus->quit, false);
+	atomic_init(&bus->replies_full, false);
 	bus->dbus = tdbus_new_server(SESSION_BUS, "org.taiwins");
 
 	wl_list_init(&bus->compositor_distroy_listener.link);
@@ -196,21 +411,42 @@ tw_setup_bus(struct weston_compositor *ec)
 	if (!bus->dbus)
 		return NULL;
 
-	/* idle events cannot reschedule themselves */
-	fd = eventfd(0, EFD_CLOEXEC);
-	if (fd < 0)
-		return NULL;
-	bus->source = wl_event_loop_add_fd(loop, fd, 0, tw_bus_dispatch, bus);
-	if (!bus->source) {
-		tw_bus_end(&bus->compositor_distroy_listener, bus);
-		return NULL;
-	}
-	wl_event_source_check(bus->source);
-
+	if (!tw_spsc_queue_init(&bus->calls, sizeof(struct tw_bus_call),
+	                        TW_BUS_QUEUE_SIZE) ||
+	    !tw_spsc_queue_init(&bus->replies, sizeof(struct tw_bus_call),
+	                        TW_BUS_QUEUE_SIZE))
+		goto err;
+
+	bus->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	bus->thread_wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	bus->main_wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (bus->epoll_fd < 0 || bus->thread_wakeup < 0 || bus->main_wakeup < 0)
+		goto err;
+	ev.events = EPOLLIN;
+	ev.data.ptr = NULL;
+	if (epoll_ctl(bus->epoll_fd, EPOLL_CTL_ADD, bus->thread_wakeup, &ev))
+		goto err;
+
+	bus->source = wl_event_loop_add_fd(loop, bus->main_wakeup,
+	                                   WL_EVENT_READABLE,
+	                                   tw_bus_dispatch, bus);
+	if (!bus->source)
+		goto err;
+
+	//everything has to be setup before bus thread starts
 	tdbus_set_nonblock(bus->dbus, bus,
 	                   tw_bus_add_watch, tw_bus_ch_watch, tw_bus_rm_watch);
+	tdbus_server_add_methods(bus->dbus, "/org/taiwins",
+	                         NUMOF(tw_bus_answers), tw_bus_answers);
 
-	tdbus_server_add_methods(bus->dbus, "/org/taiwins", 1, &tw_bus_answer);
+	if (pthread_create(&bus->thread, NULL, tw_bus_thread_run, bus))
+		goto err;
+	bus->thread_running = true;
 
 	return &s_bus;
+err:
+	wl_list_remove(&bus->compositor_distroy_listener.link);
+	wl_list_init(&bus->compositor_distroy_listener.link);
+	tw_bus_end(&bus->compositor_distroy_listener, bus);
+	return NULL;
 }
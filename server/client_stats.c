@@ -0,0 +1,376 @@
+/*
+ * client_stats.c - taiwins per client resource accounting
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <libweston/libweston.h>
+#include <ctypes/helpers.h>
+
+#include "taiwins.h"
+#include "client_stats.h"
+
+/* no client draws faster than this for long, if it does, it is spinning */
+#define TW_CLIENT_RUNAWAY_COMMITS 500
+
+struct tw_client_entry {
+	struct wl_list link;
+	struct wl_list surfaces;
+	struct wl_listener destroy_listener;
+	struct tw_client_stats stats;
+	uint64_t last_commits, last_damage;
+	bool warned;
+};
+
+struct tw_surface_entry {
+	struct wl_list link;
+	struct weston_surface *surface;
+	struct tw_client_entry *client;
+	struct wl_listener destroy_listener;
+	uint64_t shm_bytes;
+	uint64_t configure_sent;
+	uint64_t damage_pending; /**< declared since the last repaint */
+	uint64_t damage_declared, repainted;
+};
+
+static struct tw_client_accounting {
+	struct weston_compositor *compositor;
+	struct wl_list clients;
+	struct wl_event_source *timer;
+	struct wl_listener surface_created_listener;
+	struct wl_listener compositor_destroy_listener;
+} s_accounting;
+
+static inline uint64_t
+stats_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void
+client_entry_destroy(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_surface_entry *se, *tmp;
+	struct tw_client_entry *ce =
+		container_of(listener, struct tw_client_entry,
+		             destroy_listener);
+
+	//client goes before its resources, surfaces hang around a bit longer
+	wl_list_for_each_safe(se, tmp, &ce->surfaces, link) {
+		wl_list_remove(&se->link);
+		wl_list_init(&se->link);
+		se->client = NULL;
+	}
+	wl_list_remove(&ce->destroy_listener.link);
+	wl_list_remove(&ce->link);
+	free(ce);
+}
+
+static struct tw_client_entry *
+client_entry_get(struct wl_client *client)
+{
+	struct tw_client_entry *ce;
+	struct wl_listener *listener =
+		wl_client_get_destroy_listener(client, client_entry_destroy);
+
+	if (listener)
+		return container_of(listener, struct tw_client_entry,
+		                    destroy_listener);
+	ce = zalloc(sizeof(*ce));
+	if (!ce)
+		return NULL;
+	ce->stats.client = client;
+	wl_client_get_credentials(client, &ce->stats.pid, NULL, NULL);
+	wl_list_init(&ce->surfaces);
+	ce->destroy_listener.notify = client_entry_destroy;
+	wl_client_add_destroy_listener(client, &ce->destroy_listener);
+	wl_list_insert(&s_accounting.clients, &ce->link);
+	return ce;
+}
+
+static void
+surface_entry_destroy(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_surface_entry *se =
+		container_of(listener, struct tw_surface_entry,
+		             destroy_listener);
+	if (se->client) {
+		se->client->stats.surfaces--;
+		se->client->stats.shm_bytes -= se->shm_bytes;
+	}
+	wl_list_remove(&se->link);
+	wl_list_remove(&se->destroy_listener.link);
+	free(se);
+}
+
+static inline struct tw_surface_entry *
+surface_entry_get(struct weston_surface *surface)
+{
+	struct wl_listener *listener =
+		wl_signal_get(&surface->destroy_signal, surface_entry_destroy);
+
+	return listener ? container_of(listener, struct tw_surface_entry,
+	                               destroy_listener) : NULL;
+}
+
+static void
+notify_surface_created(UNUSED_ARG(struct wl_listener *listener), void *data)
+{
+	struct weston_surface *surface = data;
+	struct tw_client_entry *ce;
+	struct tw_surface_entry *se;
+
+	//compositor internal surfaces have no client
+	if (!surface->resource)
+		return;
+	ce = client_entry_get(wl_resource_get_client(surface->resource));
+	se = ce ? zalloc(sizeof(*se)) : NULL;
+	if (!se)
+		return;
+	se->surface = surface;
+	se->client = ce;
+	wl_list_insert(&ce->surfaces, &se->link);
+	se->destroy_listener.notify = surface_entry_destroy;
+	wl_signal_add(&surface->destroy_signal, &se->destroy_listener);
+	ce->stats.surfaces++;
+}
+
+void
+tw_client_stats_commit(struct weston_surface *surface)
+{
+	struct tw_surface_entry *se = surface_entry_get(surface);
+	struct tw_client_stats *stats;
+	struct weston_buffer *buffer = surface->buffer_ref.buffer;
+	struct wl_shm_buffer *shm = NULL;
+	pixman_box32_t *rects;
+	uint64_t bytes = 0, damage = 0, rtt;
+	int n;
+
+	if (!se || !se->client)
+		return;
+	stats = &se->client->stats;
+	stats->commits++;
+
+	rects = pixman_region32_rectangles(&surface->damage, &n);
+	for (int i = 0; i < n; i++)
+		damage += (uint64_t)(rects[i].x2 - rects[i].x1) *
+			(rects[i].y2 - rects[i].y1);
+	stats->damage += damage;
+	se->damage_pending += damage;
+	se->damage_declared += damage;
+
+	if (buffer && buffer->resource)
+		shm = wl_shm_buffer_get(buffer->resource);
+	if (shm)
+		bytes = (uint64_t)wl_shm_buffer_get_stride(shm) *
+			wl_shm_buffer_get_height(shm);
+	stats->shm_bytes += bytes - se->shm_bytes;
+	se->shm_bytes = bytes;
+
+	if (se->configure_sent) {
+		rtt = stats_now_us() - se->configure_sent;
+		stats->configure_rtt_us = stats->configure_rtt_us ?
+			(stats->configure_rtt_us * 7 + rtt) / 8 : rtt;
+		stats->configure_rtt_max_us =
+			MAX(stats->configure_rtt_max_us, (uint32_t)rtt);
+		se->configure_sent = 0;
+	}
+}
+
+void
+tw_client_stats_configure(struct weston_surface *surface, bool fits)
+{
+	struct tw_surface_entry *se = surface_entry_get(surface);
+
+	if (!se || !se->client)
+		return;
+	se->client->stats.configures++;
+	if (!fits)
+		se->client->stats.configures_unfit++;
+	//keep the oldest, the client may coalesce configures.
+	if (!se->configure_sent)
+		se->configure_sent = stats_now_us();
+}
+
+uint64_t
+tw_client_stats_take_damage(struct weston_surface *surface)
+{
+	struct tw_surface_entry *se = surface_entry_get(surface);
+	uint64_t damage = se ? se->damage_pending : 0;
+
+	if (se)
+		se->damage_pending = 0;
+	return damage;
+}
+
+void
+tw_client_stats_repainted(struct weston_surface *surface, uint64_t pixels)
+{
+	struct tw_surface_entry *se = surface_entry_get(surface);
+
+	if (se)
+		se->repainted += pixels;
+}
+
+bool
+tw_client_stats_surface_damage(struct weston_surface *surface,
+                               uint64_t *declared, uint64_t *repainted)
+{
+	struct tw_surface_entry *se = surface_entry_get(surface);
+
+	if (!se)
+		return false;
+	*declared = se->damage_declared;
+	*repainted = se->repainted;
+	return true;
+}
+
+static int
+client_stats_tick(void *data)
+{
+	struct tw_client_accounting *accounting = data;
+	struct tw_client_entry *ce;
+	struct tw_client_stats *stats;
+
+	wl_list_for_each(ce, &accounting->clients, link) {
+		stats = &ce->stats;
+		stats->commits_per_sec = stats->commits - ce->last_commits;
+		stats->damage_per_sec = stats->damage - ce->last_damage;
+		ce->last_commits = stats->commits;
+		ce->last_damage = stats->damage;
+
+		if (stats->commits_per_sec > TW_CLIENT_RUNAWAY_COMMITS &&
+		    !ce->warned) {
+			tw_log_warn("clients", "pid %d commits %u times/s",
+			            stats->pid, stats->commits_per_sec);
+			ce->warned = true;
+		} else if (stats->commits_per_sec <= TW_CLIENT_RUNAWAY_COMMITS)
+			ce->warned = false;
+	}
+	wl_event_source_timer_update(accounting->timer, 1000);
+	return 0;
+}
+
+void
+tw_client_stats_for_each(void (*iter)(const struct tw_client_stats *,
+                                      void *), void *data)
+{
+	struct tw_client_entry *ce;
+	struct tw_surface_entry *se;
+
+	wl_list_for_each(ce, &s_accounting.clients, link) {
+		ce->stats.views = 0;
+		wl_list_for_each(se, &ce->surfaces, link)
+			ce->stats.views += wl_list_length(&se->surface->views);
+		iter(&ce->stats, data);
+	}
+}
+
+static void
+collect_stats(const struct tw_client_stats *stats, void *data)
+{
+	struct wl_array *array = data;
+	struct tw_client_stats *s = wl_array_add(array, sizeof(*s));
+
+	if (s)
+		*s = *stats;
+}
+
+static int
+cmp_stats(const void *a, const void *b)
+{
+	const struct tw_client_stats *sa = a, *sb = b;
+
+	if (sa->commits_per_sec != sb->commits_per_sec)
+		return sa->commits_per_sec < sb->commits_per_sec ? 1 : -1;
+	return sa->shm_bytes < sb->shm_bytes ? 1 :
+		(sa->shm_bytes > sb->shm_bytes ? -1 : 0);
+}
+
+void
+tw_client_stats_dump(void)
+{
+	struct wl_array array;
+	struct tw_client_stats *s;
+
+	wl_array_init(&array);
+	tw_client_stats_for_each(collect_stats, &array);
+	qsort(array.data, array.size / sizeof(*s), sizeof(*s), cmp_stats);
+	wl_array_for_each(s, &array)
+		tw_log_info("clients", "pid %d: %u surfaces, %u views, "
+		            "%llu shm bytes, %u commits/s, %llu damage/s, "
+		            "configure rtt %uus (max %uus), "
+		            "%llu configures (%llu unfit)", s->pid,
+		            s->surfaces, s->views,
+		            (unsigned long long)s->shm_bytes,
+		            s->commits_per_sec,
+		            (unsigned long long)s->damage_per_sec,
+		            s->configure_rtt_us, s->configure_rtt_max_us,
+		            (unsigned long long)s->configures,
+		            (unsigned long long)s->configures_unfit);
+	wl_array_release(&array);
+}
+
+static void
+end_client_stats(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_client_accounting *accounting =
+		container_of(listener, struct tw_client_accounting,
+		             compositor_destroy_listener);
+	struct tw_client_entry *ce, *tmp;
+
+	wl_list_for_each_safe(ce, tmp, &accounting->clients, link)
+		client_entry_destroy(&ce->destroy_listener, NULL);
+	wl_list_remove(&accounting->surface_created_listener.link);
+	wl_list_remove(&accounting->compositor_destroy_listener.link);
+	if (accounting->timer)
+		wl_event_source_remove(accounting->timer);
+	accounting->timer = NULL;
+}
+
+bool
+tw_setup_client_stats(struct weston_compositor *ec)
+{
+	struct tw_client_accounting *accounting = &s_accounting;
+	struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+
+	accounting->compositor = ec;
+	wl_list_init(&accounting->clients);
+	accounting->timer = wl_event_loop_add_timer(loop, client_stats_tick,
+	                                            accounting);
+	if (!accounting->timer)
+		return false;
+	wl_event_source_timer_update(accounting->timer, 1000);
+
+	wl_list_init(&accounting->surface_created_listener.link);
+	accounting->surface_created_listener.notify = notify_surface_created;
+	wl_signal_add(&ec->create_surface_signal,
+	              &accounting->surface_created_listener);
+
+	wl_list_init(&accounting->compositor_destroy_listener.link);
+	accounting->compositor_destroy_listener.notify = end_client_stats;
+	wl_signal_add(&ec->destroy_signal,
+	              &accounting->compositor_destroy_listener);
+	return true;
+}
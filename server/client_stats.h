@@ -0,0 +1,113 @@
+/*
+ * client_stats.h - taiwins per client resource accounting
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_CLIENT_STATS_H
+#define TW_CLIENT_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+struct wl_client;
+struct weston_surface;
+struct weston_compositor;
+
+struct tw_client_stats {
+	struct wl_client *client;
+	pid_t pid;
+	uint32_t surfaces;
+	uint32_t views;
+	uint64_t shm_bytes; /**< shm buffers currently attached */
+	uint64_t commits;
+	uint64_t damage; /**< total damaged pixels */
+	//rates over the last full second
+	uint32_t commits_per_sec;
+	uint64_t damage_per_sec;
+	//from a configure to the next commit of the surface
+	uint32_t configure_rtt_us; /**< moving average */
+	uint32_t configure_rtt_max_us;
+	uint64_t configures;
+	//sizes out of the min and max of the surface, the client refuses them
+	//and the layout sends them again
+	uint64_t configures_unfit;
+};
+
+/**
+ * @brief start counting surfaces of every wl_client
+ *
+ * surfaces are tracked from creation, the rest comes from the hooks below,
+ * they are cheap and do nothing for surfaces we don't know.
+ */
+bool
+tw_setup_client_stats(struct weston_compositor *ec);
+
+/**
+ * @brief account a commit, call it from the surface committed handlers
+ */
+void
+tw_client_stats_commit(struct weston_surface *surface);
+
+/**
+ * @brief a configure is sent to the surface, the next commit ends the round
+ * trip
+ *
+ * fits is false if the size is out of the limits the surface has set.
+ */
+void
+tw_client_stats_configure(struct weston_surface *surface, bool fits);
+
+/**
+ * @brief damage the surface declared since the last call, in pixels
+ *
+ * the repaint takes it, to compare with what the compositor repaints for it.
+ */
+uint64_t
+tw_client_stats_take_damage(struct weston_surface *surface);
+
+void
+tw_client_stats_repainted(struct weston_surface *surface, uint64_t pixels);
+
+/**
+ * @brief total damage declared by the surface and repainted for it
+ */
+bool
+tw_client_stats_surface_damage(struct weston_surface *surface,
+                               uint64_t *declared, uint64_t *repainted);
+
+void
+tw_client_stats_for_each(void (*iter)(const struct tw_client_stats *,
+                                      void *), void *data);
+
+/**
+ * @brief log every client, the busiest first
+ */
+void
+tw_client_stats_dump(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -41,8 +41,6 @@
 #include "taiwins.h"
 #include "compositor.h"
 
-FILE *logfile;
-
 static struct xkb_rule_names default_xkb_rules = {0};
 
 static void
@@ -138,8 +136,13 @@ int main(int argc, char *argv[])
 	struct weston_compositor *compositor;
 	struct tw_config *config;
 	char path[PATH_MAX];
+	const char *watchdog_env = getenv("TAIWINS_WATCHDOG_MS");
+	unsigned int watchdog_ms = watchdog_env ? atoi(watchdog_env) : 500;
 
-	logfile = fopen("/tmp/taiwins_log", "w");
+	//rotate at 4MB, the logger takes care of the disk
+	tw_logger_init("/tmp/taiwins_log", 4 * 1024 * 1024);
+	if (getenv("TAIWINS_DEBUG"))
+		tw_logger_set_level(TW_LOG_DBUG);
 	weston_log_set_handler(tw_log, tw_log);
 
 	tw_compositor_get_socket(path);
@@ -169,6 +172,21 @@ int main(int argc, char *argv[])
 	weston_log_set_handler(tw_log, tw_log);
 	compositor->exit = tw_compositor_handle_exit;
 	weston_compositor_set_xkb_rule_names(compositor, &default_xkb_rules);
+	if (!tw_setup_tracer(compositor))
+		weston_log("failed to setup tracer, SIGUSR2 dumps are off\n");
+	if (!tw_setup_client_stats(compositor))
+		weston_log("failed to setup client accounting\n");
+	if (!tw_setup_stats_page(compositor))
+		weston_log("failed to create the stats page\n");
+	if (!tw_setup_damage(compositor))
+		weston_log("failed to setup damage accounting\n");
+	//after the signals, the workers inherit the blocked mask
+	if (!tw_setup_jobs(compositor))
+		weston_log("failed to start the workers, jobs run in place\n");
+	if (!tw_setup_pressure(compositor))
+		weston_log("failed to watch memory pressure\n");
+	if (!tw_watchdog_start(event_loop, watchdog_ms))
+		weston_log("event loop watchdog is off\n");
 
 	tw_create_config_dir();
 	tw_config_dir(path);
@@ -182,16 +200,19 @@ int main(int argc, char *argv[])
 
 	wl_display_run(display);
 out:
+	tw_watchdog_stop();
 	tw_config_destroy(config);
 	weston_compositor_tear_down(compositor);
 	weston_log_ctx_compositor_destroy(compositor);
 	wl_display_destroy(display);
 	weston_compositor_destroy(compositor);
+	tw_logger_fini();
 	return 0;
 err_signal:
 	for (unsigned i = 0; i < 3; i++)
 		wl_event_source_remove(signals[i]);
 err_connect:
 	wl_display_destroy(display);
+	tw_logger_fini();
 	return -1;
 }
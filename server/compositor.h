@@ -41,6 +41,12 @@ extern "C" {
 #endif
 
 struct tw_bus;
+struct tw_ipc;
+struct tw_tracer;
+struct tw_damage;
+struct tw_stats;
+struct tw_job_sink;
+struct tw_pressure;
 struct tw_backend;
 struct tw_xwayland;
 struct tw_theme;
@@ -49,6 +55,82 @@ struct tw_config;
 struct tw_bus *
 tw_setup_bus(struct weston_compositor *ec);
 
+/**
+ * @brief binary ipc socket for scripts, the protocol is in shared_ipc.h
+ */
+struct tw_ipc *
+tw_setup_ipc(struct weston_compositor *ec, struct desktop *desktop);
+
+/**
+ * @brief repaint hooks and SIGUSR2 dump for the trace recorder
+ *
+ * SIGUSR2 also logs the client accounting, damage and the watchdog stalls
+ */
+struct tw_tracer *
+tw_setup_tracer(struct weston_compositor *ec);
+
+/**
+ * @brief dump the trace rings to $XDG_RUNTIME_DIR/taiwins-trace-<pid>-<n>.json
+ */
+bool
+tw_tracer_dump(void);
+
+/**
+ * @brief count declared and repainted pixels per output and surface
+ */
+struct tw_damage *
+tw_setup_damage(struct weston_compositor *ec);
+
+/**
+ * @brief tint what every frame repaints
+ */
+void
+tw_damage_toggle_overlay(void);
+
+void
+tw_damage_dump(void);
+
+/**
+ * @brief publish frame times and process usage in the shared_stats.h page
+ *
+ * it has to be setup before launching the clients, they find the page from
+ * TAIWINS_STATS.
+ */
+struct tw_stats *
+tw_setup_stats_page(struct weston_compositor *ec);
+
+/**
+ * @brief account a repaint, from the output repaint hook
+ */
+void
+tw_stats_page_frame(struct weston_output *output, uint32_t repaint_us);
+
+/**
+ * @brief worker pool for the compositor, completions run on the display loop
+ *
+ * The workers must not touch libweston, copy what the job needs first.
+ */
+struct tw_job_sink *
+tw_setup_jobs(struct weston_compositor *ec);
+
+/**
+ * @brief the sink from tw_setup_jobs, NULL without it
+ */
+struct tw_job_sink *
+tw_get_job_sink(void);
+
+/**
+ * @brief drop caches on memory pressure, see shared/pressure.h
+ */
+struct tw_pressure *
+tw_setup_pressure(struct weston_compositor *ec);
+
+/**
+ * @brief notified on a trim, drop what can be rebuilt on demand
+ */
+void
+tw_pressure_add_trim_listener(struct wl_listener *listener);
+
 struct tw_xwayland *
 tw_setup_xwayland(struct weston_compositor *ec);
 
@@ -35,6 +35,8 @@
 #include <ctypes/os/file.h>
 #include <ctypes/strops.h>
 #include <libweston/libweston.h>
+#include <alloc.h>
+#include <trace.h>
 
 #include "config_internal.h"
 
@@ -53,11 +55,24 @@ tw_luaconfig_fini(struct tw_config *c);
 void
 tw_luaconfig_init(struct tw_config *c);
 
+void
+tw_luaconfig_trim(struct tw_config *c);
+
+static void
+notify_config_trim(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_config *config =
+		container_of(listener, struct tw_config, trim_listener);
+
+	if (config->user_data && !config->_config_time)
+		config->trim(config);
+}
+
 struct tw_config*
 tw_config_create(struct weston_compositor *ec, log_func_t log)
 {
 	struct tw_config *config =
-		calloc(1, sizeof(struct tw_config));
+		tw_zalloc(TW_MEM_CONFIG, sizeof(struct tw_config));
 	config->err_msg = NULL;
 	config->compositor = ec;
 	config->print = log;
@@ -70,6 +85,7 @@ tw_config_create(struct weston_compositor *ec, log_func_t log)
 	config->fini = tw_luaconfig_fini;
 	config->read_error = tw_luaconfig_read_error;
 	config->read_config = tw_luaconfig_read;
+	config->trim = tw_luaconfig_trim;
 
 	tw_config_default_bindings(config);
 
@@ -80,6 +96,10 @@ tw_config_create(struct weston_compositor *ec, log_func_t log)
 
 	wl_list_init(&config->output_created_listener.link);
 	wl_list_init(&config->output_destroyed_listener.link);
+
+	wl_list_init(&config->trim_listener.link);
+	config->trim_listener.notify = notify_config_trim;
+	tw_pressure_add_trim_listener(&config->trim_listener);
 	return config;
 }
 
@@ -91,7 +111,7 @@ _tw_config_release(struct tw_config *config)
 	if (config->config_table)
 		tw_config_table_destroy(config->config_table);
 	if (config->err_msg)
-		free(config->err_msg);
+		tw_free(config->err_msg);
 	config->fini(config);
 
 	vector_destroy(&config->config_bindings);
@@ -105,7 +125,8 @@ void
 tw_config_destroy(struct tw_config *config)
 {
 	_tw_config_release(config);
-	free(config);
+	wl_list_remove(&config->trim_listener.link);
+	tw_free(config);
 }
 
 const char *
@@ -127,6 +148,8 @@ tw_config_copy_waken(struct tw_config *dst, struct tw_config *src)
 		tw_config_request_object(src, "console"));
 	tw_config_register_object(dst, "desktop",
 		tw_config_request_object(src, "desktop"));
+	tw_config_register_object(dst, "ipc",
+		tw_config_request_object(src, "ipc"));
 	tw_config_register_object(dst, "theme",
 		tw_config_request_object(src, "theme"));
 	tw_config_register_object(dst, "xwayland",
@@ -241,7 +264,8 @@ tw_try_config(struct tw_config *tmp_config, struct tw_config *main_config)
 	tw_config_dir(path);
 	strcat(path, "/config.lua");
 	if (main_config->err_msg)
-		free(main_config->err_msg);
+		tw_free(main_config->err_msg);
+	main_config->err_msg = NULL;
 	tw_config_register_object(tmp_config, "shell_path",
 	                          tw_config_request_object(main_config,
 	                                                   "shell_path"));
@@ -288,6 +312,8 @@ tw_run_config(struct tw_config *config)
 {
 	bool safe;
 	struct tw_config *temp_config;
+	TW_TRACE_SCOPE("config", "tw_run_config");
+	TW_WATCHDOG_SOURCE("config reload");
 
 	temp_config = tw_config_create(config->compositor, config->print);
 
@@ -324,6 +350,7 @@ tw_config_wake_compositor(struct tw_config *c)
 	struct console *console;
 	struct tw_backend *backend;
 	struct tw_bus *bus;
+	struct tw_ipc *ipc;
 	struct tw_theme *theme;
 	struct tw_xwayland *xwayland;
 	struct desktop *desktop;
@@ -362,6 +389,10 @@ tw_config_wake_compositor(struct tw_config *c)
 		goto out;
 	tw_config_register_object(c, "desktop", desktop);
 
+	if (!(ipc = tw_setup_ipc(ec, desktop)))
+		goto out;
+	tw_config_register_object(c, "ipc", ipc);
+
 	if (!(theme = tw_setup_theme(ec)))
 		goto out;
 	tw_config_register_object(c, "theme", theme);
@@ -440,7 +471,7 @@ struct tw_config_table *
 tw_config_table_new(struct tw_config *c)
 {
 	struct tw_config_table *table =
-		calloc(1, sizeof(struct tw_config_table));
+		tw_zalloc(TW_MEM_CONFIG, sizeof(struct tw_config_table));
 	if (!table)
 		return NULL;
 	table->config = c;
@@ -451,7 +482,7 @@ void
 tw_config_table_destroy(struct tw_config_table *table)
 {
 	purge_xkb_rules(&table->xkb_rules);
-	free(table);
+	tw_free(table);
 }
 
 void
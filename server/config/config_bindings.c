@@ -177,7 +177,7 @@ switch_workspace(struct weston_keyboard *keyboard,
 	if (switch_left == true)
 		ws_idx = MAX(0, curr_ws-1);
 	else
-		ws_idx = MIN(n_ws, curr_ws+1);
+		ws_idx = MIN(n_ws-1, curr_ws+1);
 	view = tw_desktop_switch_workspace(desktop, ws_idx);
 
 	if (keyboard->focus)
@@ -300,6 +300,72 @@ merge_desktop_view(struct weston_keyboard *keyboard,
 	tw_desktop_merge_view(desktop, tw_default_view_from_surface(surface));
 }
 
+void
+tab_desktop_view(struct weston_keyboard *keyboard,
+                 UNUSED_ARG(const struct timespec *time),
+                 UNUSED_ARG(uint32_t key), uint32_t option,
+                 void *data)
+{
+	struct weston_surface *surface = keyboard->focus;
+	struct tw_config *config = data;
+	struct desktop *desktop =
+		tw_config_request_object(config, "desktop");
+	if (!surface)
+		return;
+	tw_desktop_tab_view(desktop, tw_default_view_from_surface(surface),
+	                    option == 1);
+}
+
+void
+undo_desktop_layout(UNUSED_ARG(struct weston_keyboard *keyboard),
+                    UNUSED_ARG(const struct timespec *time),
+                    UNUSED_ARG(uint32_t key), uint32_t option,
+                    void *data)
+{
+	struct tw_config *config = data;
+	struct desktop *desktop =
+		tw_config_request_object(config, "desktop");
+	tw_desktop_undo_layout(desktop, option == 1);
+}
+
+void
+focus_desktop_view(struct weston_keyboard *keyboard,
+                   UNUSED_ARG(const struct timespec *time),
+                   UNUSED_ARG(uint32_t key), uint32_t option,
+                   void *data)
+{
+	struct weston_surface *surface = keyboard->focus;
+	struct tw_config *config = data;
+	struct desktop *desktop =
+		tw_config_request_object(config, "desktop");
+	struct weston_view *view;
+
+	if (!surface)
+		return;
+	view = tw_desktop_nearest_view(desktop,
+	                               tw_default_view_from_surface(surface),
+	                               option);
+	if (view && tw_desktop_activate_view(desktop, view))
+		weston_view_activate(view, keyboard->seat,
+		                     WESTON_ACTIVATE_FLAG_NONE);
+}
+
+void
+move_desktop_view(struct weston_keyboard *keyboard,
+                  UNUSED_ARG(const struct timespec *time),
+                  UNUSED_ARG(uint32_t key), uint32_t option,
+                  void *data)
+{
+	struct weston_surface *surface = keyboard->focus;
+	struct tw_config *config = data;
+	struct desktop *desktop =
+		tw_config_request_object(config, "desktop");
+	if (!surface)
+		return;
+	tw_desktop_move_view(desktop, tw_default_view_from_surface(surface),
+	                     option);
+}
+
 void
 desktop_recent_view(struct weston_keyboard *keyboard,
                     UNUSED_ARG(const struct timespec *time),
@@ -314,6 +380,18 @@ desktop_recent_view(struct weston_keyboard *keyboard,
 	tw_desktop_start_task_switch_grab(desktop, keyboard);
 }
 
+void
+desktop_overview(struct weston_keyboard *keyboard,
+                 UNUSED_ARG(const struct timespec *time),
+                 UNUSED_ARG(uint32_t key), uint32_t option,
+                 void *data)
+{
+	struct tw_config *config = data;
+	struct desktop *desktop =
+		tw_config_request_object(config, "desktop");
+	tw_desktop_start_overview(desktop, keyboard, option == 1);
+}
+
 static void
 quit_compositor(UNUSED_ARG(struct weston_keyboard *keyboard),
                 UNUSED_ARG(const struct timespec *time),
@@ -328,6 +406,24 @@ quit_compositor(UNUSED_ARG(struct weston_keyboard *keyboard),
 	wl_display_terminate(wl_display);
 }
 
+static void
+dump_trace(UNUSED_ARG(struct weston_keyboard *keyboard),
+           UNUSED_ARG(const struct timespec *time),
+           UNUSED_ARG(uint32_t key), UNUSED_ARG(uint32_t option),
+           UNUSED_ARG(void *data))
+{
+	tw_tracer_dump();
+}
+
+static void
+toggle_damage_overlay(UNUSED_ARG(struct weston_keyboard *keyboard),
+                      UNUSED_ARG(const struct timespec *time),
+                      UNUSED_ARG(uint32_t key), UNUSED_ARG(uint32_t option),
+                      UNUSED_ARG(void *data))
+{
+	tw_damage_toggle_overlay();
+}
+
 void
 tw_config_default_bindings(struct tw_config *c)
 {
@@ -413,6 +509,27 @@ tw_config_default_bindings(struct tw_config *c)
 		.type = TW_BINDING_key,
 		.name = "TW_VIEW_MERGE",
 	};
+	c->builtin_bindings[TW_TABBED_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_W, MODIFIER_SUPER}, {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_VIEW_TABBED",
+	};
+	c->builtin_bindings[TW_STACKED_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_S, MODIFIER_SUPER}, {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_VIEW_STACKED",
+	};
+	c->builtin_bindings[TW_UNDO_LAYOUT_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_Z, MODIFIER_SUPER}, {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_LAYOUT_UNDO",
+	};
+	c->builtin_bindings[TW_REDO_LAYOUT_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_Z, MODIFIER_SUPER | MODIFIER_SHIFT},
+			     {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_LAYOUT_REDO",
+	};
 	c->builtin_bindings[TW_RESIZE_ON_LEFT_BINDING] = (struct tw_binding){
 		.keypress = {{KEY_LEFT, MODIFIER_ALT}, {0}, {0}, {0}, {0}},
 		.type = TW_BINDING_key,
@@ -423,12 +540,79 @@ tw_config_default_bindings(struct tw_config *c)
 		.type = TW_BINDING_key,
 		.name = "TW_VIEW_RESIZE_RIGHT",
 	};
+	c->builtin_bindings[TW_FOCUS_LEFT_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_LEFT, MODIFIER_SUPER}, {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_FOCUS_LEFT",
+	};
+	c->builtin_bindings[TW_FOCUS_RIGHT_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_RIGHT, MODIFIER_SUPER}, {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_FOCUS_RIGHT",
+	};
+	c->builtin_bindings[TW_FOCUS_UP_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_UP, MODIFIER_SUPER}, {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_FOCUS_UP",
+	};
+	c->builtin_bindings[TW_FOCUS_DOWN_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_DOWN, MODIFIER_SUPER}, {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_FOCUS_DOWN",
+	};
+	c->builtin_bindings[TW_MOVE_LEFT_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_LEFT, MODIFIER_SUPER | MODIFIER_SHIFT},
+			     {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_VIEW_MOVE_LEFT",
+	};
+	c->builtin_bindings[TW_MOVE_RIGHT_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_RIGHT, MODIFIER_SUPER | MODIFIER_SHIFT},
+			     {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_VIEW_MOVE_RIGHT",
+	};
+	c->builtin_bindings[TW_MOVE_UP_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_UP, MODIFIER_SUPER | MODIFIER_SHIFT},
+			     {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_VIEW_MOVE_UP",
+	};
+	c->builtin_bindings[TW_MOVE_DOWN_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_DOWN, MODIFIER_SUPER | MODIFIER_SHIFT},
+			     {0}, {0}, {0}, {0}},
+		.type = TW_BINDING_key,
+		.name = "TW_VIEW_MOVE_DOWN",
+	};
 	c->builtin_bindings[TW_NEXT_VIEW_BINDING] = (struct tw_binding){
 		.keypress = {{KEY_J, MODIFIER_ALT | MODIFIER_SHIFT},
 		             {0},{0},{0},{0}},
 		.type = TW_BINDING_key,
 		.name = "TW_NEXT_VIEW",
 	};
+	c->builtin_bindings[TW_OVERVIEW_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_TAB, MODIFIER_SUPER}, {0},{0},{0},{0}},
+		.type = TW_BINDING_key,
+		.name = "TW_OVERVIEW",
+	};
+	c->builtin_bindings[TW_OVERVIEW_ALL_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_TAB, MODIFIER_SUPER | MODIFIER_SHIFT},
+		             {0},{0},{0},{0}},
+		.type = TW_BINDING_key,
+		.name = "TW_OVERVIEW_ALL",
+	};
+	c->builtin_bindings[TW_TRACE_DUMP_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_T, MODIFIER_CTRL | MODIFIER_ALT | MODIFIER_SHIFT},
+		             {0},{0},{0},{0}},
+		.type = TW_BINDING_key,
+		.name = "TW_TRACE_DUMP",
+	};
+	c->builtin_bindings[TW_DAMAGE_OVERLAY_BINDING] = (struct tw_binding){
+		.keypress = {{KEY_D, MODIFIER_CTRL | MODIFIER_ALT | MODIFIER_SHIFT},
+		             {0},{0},{0},{0}},
+		.type = TW_BINDING_key,
+		.name = "TW_DAMAGE_OVERLAY",
+	};
 }
 
 bool
@@ -516,6 +700,26 @@ tw_config_install_bindings(struct tw_config *c, struct tw_bindings *root)
 	if (!tw_bindings_add_key(root, keypress, merge_desktop_view, 0, c))
 		return false;
 
+	b = tw_config_get_builtin_binding(c,TW_TABBED_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, tab_desktop_view, 0, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_STACKED_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, tab_desktop_view, 1, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_UNDO_LAYOUT_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, undo_desktop_layout, 0, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_REDO_LAYOUT_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, undo_desktop_layout, 1, c))
+		return false;
+
 	b = tw_config_get_builtin_binding(c,TW_RESIZE_ON_LEFT_BINDING);
 	keypress = b->keypress;
 	if (!tw_bindings_add_key(root, keypress, resize_view, RESIZE_LEFT, c))
@@ -526,11 +730,79 @@ tw_config_install_bindings(struct tw_config *c, struct tw_bindings *root)
 	if (!tw_bindings_add_key(root, keypress, resize_view, RESIZE_RIGHT, c))
 		return false;
 
+	b = tw_config_get_builtin_binding(c,TW_FOCUS_LEFT_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, focus_desktop_view,
+	                         TW_DIRECTION_LEFT, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_FOCUS_RIGHT_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, focus_desktop_view,
+	                         TW_DIRECTION_RIGHT, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_FOCUS_UP_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, focus_desktop_view,
+	                         TW_DIRECTION_UP, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_FOCUS_DOWN_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, focus_desktop_view,
+	                         TW_DIRECTION_DOWN, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_MOVE_LEFT_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, move_desktop_view,
+	                         TW_DIRECTION_LEFT, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_MOVE_RIGHT_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, move_desktop_view,
+	                         TW_DIRECTION_RIGHT, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_MOVE_UP_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, move_desktop_view,
+	                         TW_DIRECTION_UP, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_MOVE_DOWN_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, move_desktop_view,
+	                         TW_DIRECTION_DOWN, c))
+		return false;
+
 	b = tw_config_get_builtin_binding(c,TW_NEXT_VIEW_BINDING);
 	keypress = b->keypress;
 	if (!tw_bindings_add_key(root, keypress, desktop_recent_view, 0, c))
 		return false;
 
+	b = tw_config_get_builtin_binding(c,TW_OVERVIEW_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, desktop_overview, 0, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_OVERVIEW_ALL_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, desktop_overview, 1, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_TRACE_DUMP_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, dump_trace, 0, c))
+		return false;
+
+	b = tw_config_get_builtin_binding(c,TW_DAMAGE_OVERLAY_BINDING);
+	keypress = b->keypress;
+	if (!tw_bindings_add_key(root, keypress, toggle_damage_overlay, 0, c))
+		return false;
+
 	vector_for_each(ub, &c->config_bindings) {
 		switch (ub->type) {
 		case TW_BINDING_key:
@@ -59,11 +59,29 @@ enum tw_builtin_binding_t {
 	TW_VSPLIT_WS_BINDING,
 	TW_HSPLIT_WS_BINDING,
 	TW_MERGE_BINDING,
+	TW_TABBED_BINDING,
+	TW_STACKED_BINDING,
+	TW_UNDO_LAYOUT_BINDING,
+	TW_REDO_LAYOUT_BINDING,
 	//resize
 	TW_RESIZE_ON_LEFT_BINDING,
 	TW_RESIZE_ON_RIGHT_BINDING,
+	//directions, across the outputs
+	TW_FOCUS_LEFT_BINDING,
+	TW_FOCUS_RIGHT_BINDING,
+	TW_FOCUS_UP_BINDING,
+	TW_FOCUS_DOWN_BINDING,
+	TW_MOVE_LEFT_BINDING,
+	TW_MOVE_RIGHT_BINDING,
+	TW_MOVE_UP_BINDING,
+	TW_MOVE_DOWN_BINDING,
 	//view cycling
 	TW_NEXT_VIEW_BINDING,
+	TW_OVERVIEW_BINDING,
+	TW_OVERVIEW_ALL_BINDING,
+	//debugging
+	TW_TRACE_DUMP_BINDING,
+	TW_DAMAGE_OVERLAY_BINDING,
 	//sizeof
 	TW_BUILTIN_BINDING_SIZE
 };
@@ -83,12 +101,15 @@ struct tw_config {
 	/**< lua code may use this */
 	struct wl_listener output_created_listener;
 	struct wl_listener output_destroyed_listener;
+	//drops the lua garbage on memory pressure
+	struct wl_listener trim_listener;
 
 	//ideally, we would use function pointers to wrap lua code together
 	void (*init)(struct tw_config *);
 	void (*fini)(struct tw_config *);
 	bool (*read_config)(struct tw_config *, const char *);
 	char *(*read_error)(struct tw_config *);
+	void (*trim)(struct tw_config *);
 	void *user_data;
 	char *err_msg;
 };
@@ -35,6 +35,7 @@
 #include <ctypes/os/file.h>
 #include <ctypes/vector.h>
 #include <ctypes/helpers.h>
+#include <alloc.h>
 
 #include "lua_helper.h"
 #include "config_internal.h"
@@ -615,6 +616,15 @@ _lua_set_ws_layout(lua_State *L)
 	else if (strcmp(layout, "tiling") == 0)
 		SET_PENDING(&table->workspaces[index].layout,
 		            layout, LAYOUT_TILING);
+	else if (strcmp(layout, "master") == 0)
+		SET_PENDING(&table->workspaces[index].layout,
+		            layout, LAYOUT_MASTER);
+	else if (strcmp(layout, "grid") == 0)
+		SET_PENDING(&table->workspaces[index].layout,
+		            layout, LAYOUT_GRID);
+	else if (strcmp(layout, "monocle") == 0)
+		SET_PENDING(&table->workspaces[index].layout,
+		            layout, LAYOUT_MONOCLE);
 	else
 		return luaL_error(L, "%s: invaild layout\n",
 		                  "workspace.set_layout");
@@ -915,7 +925,8 @@ tw_luaconfig_read(struct tw_config *c, const char *path)
 char *
 tw_luaconfig_read_error(struct tw_config *c)
 {
-	return strdup(lua_tostring((lua_State *)c->user_data, -1));
+	return tw_strdup(TW_MEM_CONFIG,
+	                 lua_tostring((lua_State *)c->user_data, -1));
 }
 
 void
@@ -925,6 +936,23 @@ tw_luaconfig_fini(struct tw_config *c)
 		lua_close(c->user_data);
 }
 
+void
+tw_luaconfig_trim(struct tw_config *c)
+{
+	lua_gc((lua_State *)c->user_data, LUA_GCCOLLECT, 0);
+}
+
+/* what luaL_newstate would have said, the abort comes right after */
+static int
+_lua_panic(lua_State *L)
+{
+	const char *msg = lua_tostring(L, -1);
+
+	fprintf(stderr, "config: unprotected lua error: %s\n",
+	        msg ? msg : "(not a string)");
+	return 0;
+}
+
 void
 tw_luaconfig_init(struct tw_config *c)
 {
@@ -932,8 +960,11 @@ tw_luaconfig_init(struct tw_config *c)
 
 	if (c->user_data)
 		lua_close(c->user_data);
-	if (!(L = luaL_newstate()))
+	//the lua heap is most of the config memory
+	if (!(L = lua_newstate(tw_mem_lua_alloc,
+	                       (void *)(intptr_t)TW_MEM_CONFIG)))
 		return;
+	lua_atpanic(L, _lua_panic);
 	luaL_openlibs(L);
 	c->user_data = L;
 
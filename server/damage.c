@@ -0,0 +1,409 @@
+/*
+ * damage.c - taiwins damage accounting and overlay
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <libweston/libweston.h>
+#include <ctypes/helpers.h>
+
+#include <trace.h>
+#include "compositor.h"
+
+/* overlay tints at most this many rectangles of a frame */
+#define TW_DAMAGE_OVERLAY_RECTS 64
+/* the tint stays for this long after the last damage */
+#define TW_DAMAGE_OVERLAY_FADE 300
+
+typedef int (*output_repaint_t)(struct weston_output *output,
+                                pixman_region32_t *damage,
+                                void *repaint_data);
+
+struct tw_damage_output {
+	struct wl_list link;
+	struct weston_output *output;
+	output_repaint_t repaint;
+	struct wl_listener destroy_listener;
+	//the next frame is caused by the overlay itself
+	bool overlay_frame;
+
+	uint64_t frames;
+	uint64_t declared; /**< pixels the clients said they changed */
+	uint64_t repainted; /**< pixels we repainted */
+};
+
+static struct tw_damage {
+	struct weston_compositor *compositor;
+	struct wl_list outputs;
+
+	bool overlay;
+	struct weston_layer layer;
+	struct weston_surface *tints[TW_DAMAGE_OVERLAY_RECTS];
+	pixman_region32_t pending;
+	struct wl_event_source *idle;
+	struct wl_event_source *fade;
+
+	struct wl_listener output_created_listener;
+	struct wl_listener compositor_destroy_listener;
+} s_damage;
+
+static uint64_t
+region_area(pixman_region32_t *region)
+{
+	int n;
+	uint64_t area = 0;
+	pixman_box32_t *rects = pixman_region32_rectangles(region, &n);
+
+	for (int i = 0; i < n; i++)
+		area += (uint64_t)(rects[i].x2 - rects[i].x1) *
+			(rects[i].y2 - rects[i].y1);
+	return area;
+}
+
+static void damage_output_destroy(struct wl_listener *listener, void *data);
+
+static inline struct tw_damage_output *
+damage_output_get(struct weston_output *output)
+{
+	struct wl_listener *listener =
+		wl_signal_get(&output->destroy_signal, damage_output_destroy);
+
+	return listener ? container_of(listener, struct tw_damage_output,
+	                               destroy_listener) : NULL;
+}
+
+/******************************************************************************
+ * overlay
+ *****************************************************************************/
+
+static void
+damage_overlay_changed(struct tw_damage *damage)
+{
+	struct tw_damage_output *dout;
+
+	wl_list_for_each(dout, &damage->outputs, link)
+		dout->overlay_frame = true;
+	weston_compositor_schedule_repaint(damage->compositor);
+}
+
+static void
+damage_overlay_clear(struct tw_damage *damage)
+{
+	struct weston_view *view, *tmp;
+
+	if (wl_list_empty(&damage->layer.view_list.link))
+		return;
+	wl_list_for_each_safe(view, tmp, &damage->layer.view_list.link,
+	                      layer_link.link) {
+		weston_view_damage_below(view);
+		weston_layer_entry_remove(&view->layer_link);
+		weston_view_geometry_dirty(view);
+	}
+	damage_overlay_changed(damage);
+}
+
+static int
+damage_overlay_fade(void *data)
+{
+	damage_overlay_clear(data);
+	return 0;
+}
+
+static struct weston_view *
+damage_overlay_tint(struct tw_damage *damage, int i)
+{
+	struct weston_surface *surface = damage->tints[i];
+	struct weston_view *view;
+
+	if (surface)
+		return container_of(surface->views.next, struct weston_view,
+		                    surface_link);
+	surface = weston_surface_create(damage->compositor);
+	if (!surface)
+		return NULL;
+	view = weston_view_create(surface);
+	if (!view) {
+		weston_surface_destroy(surface);
+		return NULL;
+	}
+	weston_surface_set_color(surface, 1.0, 0.0, 0.3, 1.0);
+	//never takes input
+	pixman_region32_fini(&surface->input);
+	pixman_region32_init(&surface->input);
+	view->alpha = 0.25;
+	tw_map_view(view);
+	damage->tints[i] = surface;
+	return view;
+}
+
+/* we can't touch the scene inside of a repaint, so the tints are moved on idle
+ * and it costs an extra frame, which is not counted. */
+static void
+damage_overlay_update(void *data)
+{
+	struct tw_damage *damage = data;
+	struct weston_view *view;
+	pixman_box32_t *rects;
+	int n;
+
+	damage->idle = NULL;
+	damage_overlay_clear(damage);
+	rects = pixman_region32_rectangles(&damage->pending, &n);
+	for (int i = 0; i < MIN(n, TW_DAMAGE_OVERLAY_RECTS); i++) {
+		view = damage_overlay_tint(damage, i);
+		if (!view)
+			break;
+		weston_surface_set_size(view->surface,
+		                        rects[i].x2 - rects[i].x1,
+		                        rects[i].y2 - rects[i].y1);
+		weston_view_set_position(view, rects[i].x1, rects[i].y1);
+		weston_layer_entry_insert(&damage->layer.view_list,
+		                          &view->layer_link);
+		weston_view_geometry_dirty(view);
+		weston_view_update_transform(view);
+		weston_view_damage_below(view);
+	}
+	if (n)
+		damage_overlay_changed(damage);
+	pixman_region32_clear(&damage->pending);
+	wl_event_source_timer_update(damage->fade, TW_DAMAGE_OVERLAY_FADE);
+}
+
+void
+tw_damage_toggle_overlay(void)
+{
+	struct tw_damage *damage = &s_damage;
+
+	if (!damage->compositor)
+		return;
+	damage->overlay = !damage->overlay;
+	if (!damage->overlay) {
+		if (damage->idle)
+			wl_event_source_remove(damage->idle);
+		damage->idle = NULL;
+		pixman_region32_clear(&damage->pending);
+		damage_overlay_clear(damage);
+	}
+	weston_compositor_damage_all(damage->compositor);
+}
+
+/******************************************************************************
+ * accounting
+ *****************************************************************************/
+
+static void
+damage_account(struct tw_damage_output *dout, pixman_region32_t *output_damage)
+{
+	struct weston_output *output = dout->output;
+	struct weston_compositor *ec = output->compositor;
+	struct weston_view *view;
+	pixman_region32_t repaint, covered;
+	uint64_t repainted;
+
+	pixman_region32_init(&repaint);
+	pixman_region32_init(&covered);
+	pixman_region32_intersect(&repaint, output_damage, &output->region);
+	repainted = region_area(&repaint);
+	dout->frames++;
+	dout->repainted += repainted;
+
+	wl_list_for_each(view, &ec->view_list, link) {
+		if (!(view->output_mask & (1u << output->id)) ||
+		    !view->surface->resource)
+			continue;
+		dout->declared += tw_client_stats_take_damage(view->surface);
+		pixman_region32_intersect(&covered,
+		                          &view->transform.boundingbox,
+		                          &repaint);
+		tw_client_stats_repainted(view->surface,
+		                          region_area(&covered));
+	}
+	TW_TRACE_COUNTER("damage", "repainted_px", repainted);
+
+	if (s_damage.overlay) {
+		pixman_region32_union(&s_damage.pending, &s_damage.pending,
+		                      &repaint);
+		if (!s_damage.idle)
+			s_damage.idle = wl_event_loop_add_idle(
+				wl_display_get_event_loop(ec->wl_display),
+				damage_overlay_update, &s_damage);
+	}
+	pixman_region32_fini(&covered);
+	pixman_region32_fini(&repaint);
+}
+
+static int
+damage_output_repaint(struct weston_output *output, pixman_region32_t *damage,
+                      void *repaint_data)
+{
+	struct tw_damage_output *dout = damage_output_get(output);
+	struct timespec start, end;
+	int ret;
+
+	if (!dout->overlay_frame)
+		damage_account(dout, damage);
+	dout->overlay_frame = false;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	ret = dout->repaint(output, damage, repaint_data);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	tw_stats_page_frame(output, (end.tv_sec - start.tv_sec) * 1000000 +
+	                    (end.tv_nsec - start.tv_nsec) / 1000);
+	return ret;
+}
+
+static void
+damage_output_destroy(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_damage_output *dout =
+		container_of(listener, struct tw_damage_output,
+		             destroy_listener);
+
+	if (dout->output->repaint == damage_output_repaint)
+		dout->output->repaint = dout->repaint;
+	wl_list_remove(&dout->destroy_listener.link);
+	wl_list_remove(&dout->link);
+	free(dout);
+}
+
+static void
+damage_add_output(struct tw_damage *damage, struct weston_output *output)
+{
+	struct tw_damage_output *dout;
+
+	//backend sets repaint on enabling, an output can be enabled again
+	if (!output->repaint || output->repaint == damage_output_repaint)
+		return;
+	dout = damage_output_get(output);
+	if (!dout) {
+		dout = zalloc(sizeof(*dout));
+		if (!dout)
+			return;
+		dout->output = output;
+		wl_list_init(&dout->destroy_listener.link);
+		dout->destroy_listener.notify = damage_output_destroy;
+		wl_signal_add(&output->destroy_signal,
+		              &dout->destroy_listener);
+		wl_list_insert(&damage->outputs, &dout->link);
+	}
+	dout->repaint = output->repaint;
+	output->repaint = damage_output_repaint;
+}
+
+static void
+damage_output_created(struct wl_listener *listener, void *data)
+{
+	struct tw_damage *damage =
+		container_of(listener, struct tw_damage,
+		             output_created_listener);
+	damage_add_output(damage, data);
+}
+
+void
+tw_damage_dump(void)
+{
+	struct tw_damage_output *dout;
+	struct weston_view *view;
+	uint64_t declared, repainted;
+
+	if (!s_damage.compositor)
+		return;
+	wl_list_for_each(dout, &s_damage.outputs, link)
+		tw_log_info("damage", "output %s: %llu frames, %llu pixels "
+		            "declared, %llu repainted",
+		            dout->output->name ? dout->output->name : "",
+		            (unsigned long long)dout->frames,
+		            (unsigned long long)dout->declared,
+		            (unsigned long long)dout->repainted);
+	wl_list_for_each(view, &s_damage.compositor->view_list, link) {
+		struct weston_surface *surface = view->surface;
+		pid_t pid = 0;
+
+		//only the first view of a surface
+		if (surface->views.next != &view->surface_link ||
+		    !surface->resource ||
+		    !tw_client_stats_surface_damage(surface, &declared,
+		                                    &repainted))
+			continue;
+		wl_client_get_credentials(
+			wl_resource_get_client(surface->resource),
+			&pid, NULL, NULL);
+		tw_log_info("damage", "surface %u of pid %d: %llu pixels "
+		            "declared, %llu repainted",
+		            wl_resource_get_id(surface->resource), pid,
+		            (unsigned long long)declared,
+		            (unsigned long long)repainted);
+	}
+}
+
+static void
+end_damage(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_damage *damage =
+		container_of(listener, struct tw_damage,
+		             compositor_destroy_listener);
+	struct tw_damage_output *dout, *tmp;
+
+	wl_list_for_each_safe(dout, tmp, &damage->outputs, link)
+		damage_output_destroy(&dout->destroy_listener, NULL);
+	for (int i = 0; i < TW_DAMAGE_OVERLAY_RECTS; i++)
+		if (damage->tints[i])
+			weston_surface_destroy(damage->tints[i]);
+	if (damage->idle)
+		wl_event_source_remove(damage->idle);
+	if (damage->fade)
+		wl_event_source_remove(damage->fade);
+	pixman_region32_fini(&damage->pending);
+	wl_list_remove(&damage->output_created_listener.link);
+	wl_list_remove(&damage->compositor_destroy_listener.link);
+	damage->compositor = NULL;
+}
+
+struct tw_damage *
+tw_setup_damage(struct weston_compositor *ec)
+{
+	struct tw_damage *damage = &s_damage;
+	struct weston_output *output;
+	struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+
+	damage->fade = wl_event_loop_add_timer(loop, damage_overlay_fade,
+	                                       damage);
+	if (!damage->fade)
+		return NULL;
+	damage->compositor = ec;
+	wl_list_init(&damage->outputs);
+	pixman_region32_init(&damage->pending);
+	weston_layer_init(&damage->layer, ec);
+	weston_layer_set_position(&damage->layer,
+	                          WESTON_LAYER_POSITION_CURSOR - 1);
+
+	wl_list_for_each(output, &ec->output_list, link)
+		damage_add_output(damage, output);
+	wl_list_init(&damage->output_created_listener.link);
+	damage->output_created_listener.notify = damage_output_created;
+	wl_signal_add(&ec->output_created_signal,
+	              &damage->output_created_listener);
+
+	wl_list_init(&damage->compositor_destroy_listener.link);
+	damage->compositor_destroy_listener.notify = end_damage;
+	wl_signal_add(&ec->destroy_signal,
+	              &damage->compositor_destroy_listener);
+	return damage;
+}
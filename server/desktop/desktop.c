@@ -36,11 +36,16 @@
 #include <libweston/libweston.h>
 
 #include <shared_config.h>
+#include <alloc.h>
+#include <trace.h>
 #include "../taiwins.h"
 #include "shell.h"
 #include "desktop.h"
 #include "layout.h"
 #include "workspace.h"
+#include "session.h"
+#include "switcher.h"
+#include "overview.h"
 
 /**
  * grab decleration, with different options.
@@ -60,7 +65,9 @@ static struct desktop {
 	struct shell *shell;
 	/* managing current status */
 	struct workspace *actived_workspace[2];
-	struct workspace workspaces[9];
+	/**< NULL for the ones not in use, see tw_desktop_get_workspace */
+	struct workspace *workspaces[MAX_WORKSPACE];
+	struct workspace_conf workspace_confs[MAX_WORKSPACE];
 	struct weston_desktop *api;
 	const struct weston_xwayland_surface_api *xwayland_api;
 
@@ -77,7 +84,12 @@ static struct desktop {
 	struct grab_interface resizing_grab;
 	struct grab_interface alpha_grab;
 	struct grab_interface task_switch_grab;
+	struct grab_interface overview_key_grab;
+	struct grab_interface overview_pointer_grab;
 
+	struct tw_desktop_signals signals;
+	/**< output changes of the current workspace are arranged in here */
+	struct wl_event_source *arrange_idle;
         /**< params */
 	int32_t inner_gap, outer_gap;
 } s_desktop;
@@ -90,29 +102,60 @@ tw_desktop_get_global() {return &s_desktop; }
  ******************************************************************************/
 
 static inline struct workspace*
-get_workspace_for_view(struct weston_view *v, struct desktop *d)
+get_workspace_for_view(struct weston_view *v, UNUSED_ARG(struct desktop *d))
 {
-	struct workspace *wp = NULL;
-	for (int i = 0; i < MAX_WORKSPACE+1; i++) {
-		wp = &d->workspaces[i];
-		if (is_view_on_workspace(v, wp))
-			break;
-	}
-	return wp;
+	struct recent_view *rv = get_recent_view(v);
+	return rv ? rv->workspace : NULL;
 }
 
-static inline void
-desktop_set_worksace_layout(struct desktop *d, unsigned int i,
-                            enum tw_layout_type type)
+static inline int
+get_workspace_index(const struct workspace *ws, const struct desktop *d)
+{
+	for (int i = 0; ws && i < MAX_WORKSPACE; i++)
+		if (d->workspaces[i] == ws)
+			return i;
+	return -1;
+}
+
+static inline struct tw_output
+desktop_tw_output(struct desktop *d, struct weston_output *output)
 {
-	struct workspace *w;
+	return (struct tw_output){
+		.output = output,
+		.desktop_area = shell_output_available_space(d->shell, output),
+		.inner_gap = d->inner_gap,
+		.outer_gap = d->outer_gap,
+	};
+}
 
-	if (i > MAX_WORKSPACE)
+/* an empty workspace nobody looks at goes away, its conf stays */
+static void
+desktop_reclaim_workspace(struct desktop *d, struct workspace *ws)
+{
+	int i = get_workspace_index(ws, d);
+
+	if (i < 0 || ws == d->actived_workspace[0] ||
+	    ws == d->actived_workspace[1] ||
+	    !wl_list_empty(&ws->recent_views) || !is_workspace_empty(ws) ||
+	    desktop_overview_active() || desktop_session_waiting())
 		return;
-	w = &d->workspaces[i];
-	w->current_layout = type;
+	workspace_get_conf(ws, &d->workspace_confs[i]);
+	workspace_release(ws);
+	tw_free(ws);
+	d->workspaces[i] = NULL;
+}
+
+static inline void
+desktop_view_info(struct desktop *d, const struct recent_view *rv,
+                  const struct workspace *ws, struct tw_desktop_view_info *info)
+{
+	info->view = rv->view;
+	info->id = rv->id;
+	info->workspace = get_workspace_index(ws, d);
+	info->type = rv->type;
 }
 
+
 static inline bool
 is_desktop_surface(struct weston_surface *surface)
 {
@@ -175,6 +218,37 @@ grab_interface_start_keyboard(struct grab_interface *gi, struct weston_view *v,
 		weston_keyboard_start_grab(keyboard, &gi->keyboard_grab);
 }
 
+/* the overview holds the keyboard and the pointer, both go back together */
+static void
+desktop_end_overview(struct desktop *d, bool activate)
+{
+	struct weston_keyboard *keyboard =
+		d->overview_key_grab.keyboard_grab.keyboard;
+	struct weston_pointer *pointer =
+		d->overview_pointer_grab.pointer_grab.pointer;
+	struct weston_view *view = desktop_overview_end();
+	struct workspace *ws;
+
+	if (keyboard && keyboard->grab == &d->overview_key_grab.keyboard_grab)
+		weston_keyboard_end_grab(keyboard);
+	if (pointer && pointer->grab == &d->overview_pointer_grab.pointer_grab)
+		weston_pointer_end_grab(pointer);
+	grab_interface_fini(&d->overview_key_grab);
+	grab_interface_fini(&d->overview_pointer_grab);
+	//the ones emptied while the overview was up, the view keeps its own
+	tw_desktop_reclaim_workspaces(d);
+	if (!activate || !view)
+		return;
+
+	ws = get_workspace_for_view(view, d);
+	if (!ws)
+		return;
+	if (ws != d->actived_workspace[0])
+		tw_desktop_switch_workspace(d, get_workspace_index(ws, d));
+	if (workspace_focus_view(ws, view))
+		tw_focus_surface(view->surface);
+}
+
 /*******************************************************************************
  * libwestop desktop implementaiton
  ******************************************************************************/
@@ -214,6 +288,8 @@ twdesk_surface_added(struct weston_desktop_surface *surface,
 	struct workspace *wsp = NULL;
 	struct recent_view *rv = NULL;
 	struct desktop *desktop = user_data;
+	struct desktop_session_place place;
+	bool restored = false;
 	struct weston_view *view, *next;
 	struct weston_surface *wt_surface =
 		weston_desktop_surface_get_surface(surface);
@@ -238,14 +314,37 @@ twdesk_surface_added(struct weston_desktop_surface *surface,
 	if (desktop->xwayland_api &&
 	    desktop->xwayland_api->is_xwayland_surface(wt_surface))
 		layout = LAYOUT_FLOATING;
-	else
-		layout = wsp->current_layout;
+	else if ((restored = desktop_session_claim(surface, &place))) {
+		//a window of the last session goes back to its place
+		wsp = tw_desktop_get_workspace(desktop, place.workspace, true);
+		wsp = wsp ? wsp : desktop->actived_workspace[0];
+		layout = place.type;
+		if (place.output) {
+			view->output = place.output;
+			wt_surface->output = place.output;
+		}
+	} else
+		layout = (wsp->current_layout == LAYOUT_FLOATING) ?
+			LAYOUT_FLOATING : LAYOUT_TILING;
 
 	rv = recent_view_create(view, layout);
 	weston_desktop_surface_set_user_data(surface, rv);
 
-	workspace_add_view(wsp, view);
-	tw_focus_surface(wt_surface);
+	if (restored)
+		workspace_restore_view(wsp, view, place.placeholder,
+		                       &place.geometry,
+		                       wsp == desktop->actived_workspace[0]);
+	else
+		workspace_add_view(wsp, view);
+	desktop_switcher_add(rv);
+	if (wsp == desktop->actived_workspace[0])
+		tw_focus_surface(wt_surface);
+
+	if (!wl_list_empty(&desktop->signals.view_created.listener_list)) {
+		struct tw_desktop_view_info info;
+		desktop_view_info(desktop, rv, wsp, &info);
+		wl_signal_emit(&desktop->signals.view_created, &info);
+	}
 }
 
 static void
@@ -258,8 +357,18 @@ twdesk_surface_removed(struct weston_desktop_surface *surface,
 	struct weston_view *view, *next;
 	//although this should never happen, but if desktop destroyed is not on
 	//current view, we have to deal with that as well.
+	struct recent_view *rv =
+		weston_desktop_surface_get_user_data(surface);
+	struct workspace *from = rv ? rv->workspace : NULL;
 	wl_list_for_each_safe(view, next, &wt_surface->views, surface_link) {
 		struct workspace *wp = get_workspace_for_view(view, desktop);
+		if (rv && rv->view == view) {
+			struct tw_desktop_view_info info;
+			desktop_view_info(desktop, rv, wp, &info);
+			wl_signal_emit(&desktop->signals.view_destroyed, &info);
+		}
+		if (desktop_overview_remove(view))
+			desktop_end_overview(desktop, false);
 		workspace_remove_view(wp, view);
 		weston_view_unmap(view);
 		if (!weston_surface_is_mapped(wt_surface))
@@ -270,8 +379,7 @@ twdesk_surface_removed(struct weston_desktop_surface *surface,
 	weston_surface_set_label_func(wt_surface, NULL);
 	weston_surface_unmap(wt_surface);
 	//destroy the recent view
-	struct recent_view *rv =
-		weston_desktop_surface_get_user_data(surface);
+	desktop_switcher_remove(rv);
 	recent_view_destroy(rv);
 	//focus a surface
 	struct workspace *ws = desktop->actived_workspace[0];
@@ -281,6 +389,7 @@ twdesk_surface_removed(struct weston_desktop_surface *surface,
 			tw_focus_surface(rv->view->surface);
 			break;
 		}
+	desktop_reclaim_workspace(desktop, from);
 }
 
 static void
@@ -298,14 +407,23 @@ twdesk_surface_committed(struct weston_desktop_surface *desktop_surface,
 		             surface_link);
 	struct weston_geometry geo =
 		weston_desktop_surface_get_geometry(desktop_surface);
-	//check the current surface geometry
-	if (geo.x != rv->visible_geometry.x ||
-	    geo.y != rv->visible_geometry.y) {
-		recent_view_get_origin_coord(rv, &x, &y);
+	TW_TRACE_SCOPE("desktop", "twdesk_surface_committed");
+	tw_client_stats_commit(surface);
+	//a view the layout resized goes to its place with the new size,
+	//otherwise check the current surface geometry
+	if (!recent_view_commit_pending(rv, &geo, false) &&
+	    (geo.x != rv->visible_geometry.x ||
+	     geo.y != rv->visible_geometry.y)) {
+		x = view->geometry.x + rv->visible_geometry.x;
+		y = view->geometry.y + rv->visible_geometry.y;
 		weston_view_set_position(view, x - geo.x, y - geo.y);
 		weston_view_geometry_dirty(view);
 		rv->visible_geometry = geo;
 	}
+	//a new title mostly
+	desktop_switcher_update(rv);
+	desktop_switcher_commit(rv);
+	desktop_overview_commit(view);
 	weston_view_damage_below(view);
 	weston_view_schedule_repaint(view);
 }
@@ -479,16 +597,40 @@ desktop_output_created(struct wl_listener *listener, void *data)
 	struct weston_output *output = data;
 	struct desktop *desktop =
 		container_of(listener, struct desktop, output_create_listener);
+	struct tw_output tw_output = desktop_tw_output(desktop, output);
+
+	//the ones allocated later get it then
+	for (int i = 0; i < MAX_WORKSPACE; i++)
+		if (desktop->workspaces[i])
+			workspace_add_output(desktop->workspaces[i],
+			                     &tw_output);
+	desktop_session_add_output(output);
+}
 
-	struct tw_output tw_output = {
-		.output = output,
-		.desktop_area = shell_output_available_space(
-			desktop->shell, output),
-		.inner_gap = desktop->inner_gap,
-		.outer_gap = desktop->outer_gap,
-	};
-	for (int i = 0; i < MAX_WORKSPACE+1; i++)
-		workspace_add_output(&desktop->workspaces[i], &tw_output);
+static void
+desktop_arrange_idle(void *data)
+{
+	struct desktop *desktop = data;
+
+	desktop->arrange_idle = NULL;
+	workspace_arrange(desktop->actived_workspace[0]);
+}
+
+/* all workspaces get marked, only the current one is arranged, and only once
+ * however many changes come in this dispatch, the others wait for a switch */
+static void
+desktop_schedule_arrange(struct desktop *desktop)
+{
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(desktop->compositor->wl_display);
+
+	if (desktop->arrange_idle)
+		return;
+	desktop->arrange_idle =
+		wl_event_loop_add_idle(loop, desktop_arrange_idle, desktop);
+	//out of memory, better do it now
+	if (!desktop->arrange_idle)
+		workspace_arrange(desktop->actived_workspace[0]);
 }
 
 static void
@@ -497,16 +639,13 @@ desktop_output_resized(struct wl_listener *listener, void *data)
 	struct weston_output *output = data;
 	struct desktop *desktop =
 		container_of(listener, struct desktop, output_resize_listener);
+	struct tw_output tw_output = desktop_tw_output(desktop, output);
 
-	struct tw_output tw_output = {
-		.output = output,
-		.desktop_area = shell_output_available_space(
-			desktop->shell, output),
-		.inner_gap = desktop->inner_gap,
-		.outer_gap = desktop->outer_gap,
-	};
-	for (int i = 0; i < MAX_WORKSPACE+1; i++)
-		workspace_resize_output(&desktop->workspaces[i], &tw_output);
+	for (int i = 0; i < MAX_WORKSPACE; i++)
+		if (desktop->workspaces[i])
+			workspace_resize_output(desktop->workspaces[i],
+			                        &tw_output);
+	desktop_schedule_arrange(desktop);
 }
 
 static void
@@ -516,10 +655,11 @@ desktop_output_destroyed(struct wl_listener *listener, void *data)
 	struct desktop *desktop =
 		container_of(listener, struct desktop, output_destroy_listener);
 
-	for (int i = 0; i < MAX_WORKSPACE+1; i++) {
-		struct workspace *w = &desktop->workspaces[i];
+	for (int i = 0; i < MAX_WORKSPACE; i++) {
+		struct workspace *w = desktop->workspaces[i];
 		//you somehow need to move the views to other output
-		workspace_remove_output(w, output);
+		if (w)
+			workspace_remove_output(w, output);
 	}
 }
 
@@ -529,15 +669,13 @@ desktop_area_changed(struct wl_listener *listener, void *data)
 	struct weston_output *output = data;
 	struct desktop *desktop =
 		container_of(listener, struct desktop, desktop_area_listener);
-	struct tw_output tw_output = {
-		.output = output,
-		.desktop_area = shell_output_available_space(
-			desktop->shell, output),
-		.inner_gap = desktop->inner_gap,
-		.outer_gap = desktop->outer_gap,
-	};
-	for (int i = 0; i < MAX_WORKSPACE+1; i++)
-		workspace_resize_output(&desktop->workspaces[i], &tw_output);
+	struct tw_output tw_output = desktop_tw_output(desktop, output);
+
+	for (int i = 0; i < MAX_WORKSPACE; i++)
+		if (desktop->workspaces[i])
+			workspace_resize_output(desktop->workspaces[i],
+			                        &tw_output);
+	desktop_schedule_arrange(desktop);
 }
 
 static void
@@ -618,8 +756,9 @@ move_grab_pointer_motion(struct weston_pointer_grab *grab,
 		return;
 	//so this function will have no effect on tiling views
 	//you don't need to arrange view here
-	workspace_move_view(ws, gi->view, &(struct weston_position) {
-			gi->view->geometry.x + dx, gi->view->geometry.y + dy});
+	if (workspace_move_view(ws, gi->view, &(struct weston_position) {
+			gi->view->geometry.x + dx, gi->view->geometry.y + dy}))
+		desktop_switcher_update(get_recent_view(gi->view));
 }
 
 static void
@@ -688,6 +827,47 @@ alpha_grab_pointer_axis(struct weston_pointer_grab *grab,
 	weston_view_schedule_repaint(view);
 }
 
+static void
+overview_grab_pointer_motion(struct weston_pointer_grab *grab,
+                             UNUSED_ARG(const struct timespec *time),
+                             struct weston_pointer_motion_event *event)
+{
+	weston_pointer_move(grab->pointer, event);
+	desktop_overview_pick(wl_fixed_to_double(grab->pointer->x),
+	                      wl_fixed_to_double(grab->pointer->y));
+}
+
+static void
+overview_grab_button(struct weston_pointer_grab *grab,
+                     UNUSED_ARG(const struct timespec *time),
+                     UNUSED_ARG(uint32_t button), uint32_t state)
+{
+	struct grab_interface *gi = container_of(grab, struct grab_interface,
+	                                         pointer_grab);
+	struct desktop *d = container_of(gi, struct desktop,
+	                                 overview_pointer_grab);
+	struct weston_pointer *pointer = grab->pointer;
+
+	//on the release, the client under it never sees half a click.
+	//Outside of the views it leaves the overview as it was
+	if (pointer->button_count == 0 &&
+	    state == WL_POINTER_BUTTON_STATE_RELEASED)
+		desktop_end_overview(d, desktop_overview_pick(
+			                     wl_fixed_to_double(pointer->x),
+			                     wl_fixed_to_double(pointer->y)) != NULL);
+}
+
+static void
+overview_grab_pointer_cancel(struct weston_pointer_grab *grab)
+{
+	struct grab_interface *gi = container_of(grab, struct grab_interface,
+	                                         pointer_grab);
+	struct desktop *d = container_of(gi, struct desktop,
+	                                 overview_pointer_grab);
+
+	desktop_end_overview(d, false);
+}
+
 /*************************************************
  * keyboard grab
  ************************************************/
@@ -700,40 +880,27 @@ task_switch_grab_key(struct weston_keyboard_grab *grab,
 		container_of(grab, struct grab_interface, keyboard_grab);
 	struct desktop *d = container_of(gi, struct desktop, task_switch_grab);
 	struct workspace *w = d->actived_workspace[0];
-	struct wl_list *link = w->recent_views.next;
-	struct wl_array tosent;
-	struct tw_window_brief *brief;
+	uint32_t slot;
+	//the windows are in the switcher table already, only where we are goes
+	struct wl_array tosent = {
+		.size = sizeof(slot),
+		.alloc = 0,
+		.data = &slot,
+	};
+	TW_WATCHDOG_SOURCE("task switch");
 
         if (state == WL_KEYBOARD_KEY_STATE_RELEASED) {
 		grab->interface->cancel(grab);
 		return;
 	}
 
-	wl_array_init(&tosent);
-	wl_array_add(&tosent, sizeof(struct tw_window_brief) *
-		     wl_list_length(&w->recent_views));
-	//build the list of recent views.
-	wl_array_for_each(brief, &tosent) {
-		struct recent_view *rv =
-			container_of(link, struct recent_view, link);
-		struct weston_desktop_surface *surface =
-			weston_surface_get_desktop_surface(rv->view->surface);
-		strop_ncpy(brief->name,
-		           weston_desktop_surface_get_title(surface),
-		           sizeof(brief->name));
-		recent_view_get_origin_coord(rv, &brief->x, &brief->y);
-		brief->w = rv->view->surface->width;
-		brief->h = rv->view->surface->height;
-		link = link->next;
-	}
+	slot = desktop_switcher_order(w);
 	shell_post_data(d->shell, TAIWINS_SHELL_MSG_TYPE_TASK_SWITCHING,
 			&tosent);
-	wl_array_release(&tosent);
-
 }
 
 static void
-task_switch_grab_modifier(UNUSED_ARG(struct weston_keyboard_grab *grab),
+noop_grab_modifiers(UNUSED_ARG(struct weston_keyboard_grab *grab),
                           UNUSED_ARG(uint32_t serial),
                           UNUSED_ARG(uint32_t mods_depressed),
                           UNUSED_ARG(uint32_t mods_latched),
@@ -753,13 +920,72 @@ task_switch_grab_cancel(struct weston_keyboard_grab *grab)
 	shell_post_message(d->shell,
 	                   TAIWINS_SHELL_MSG_TYPE_SWITCH_WORKSPACE,
 	                   "");
+	desktop_switcher_show(false);
 	weston_keyboard_end_grab(grab->keyboard);
 	grab_interface_fini(gi);
 }
 
+static void
+overview_grab_key(struct weston_keyboard_grab *grab,
+                  UNUSED_ARG(const struct timespec *time),
+                  uint32_t key, uint32_t state)
+{
+	struct grab_interface *gi =
+		container_of(grab, struct grab_interface, keyboard_grab);
+	struct desktop *d = container_of(gi, struct desktop,
+	                                 overview_key_grab);
+
+	if (state != WL_KEYBOARD_KEY_STATE_PRESSED)
+		return;
+	switch (key) {
+	case KEY_LEFT:
+		desktop_overview_select(TW_DIRECTION_LEFT);
+		break;
+	case KEY_RIGHT:
+		desktop_overview_select(TW_DIRECTION_RIGHT);
+		break;
+	case KEY_UP:
+		desktop_overview_select(TW_DIRECTION_UP);
+		break;
+	case KEY_DOWN:
+		desktop_overview_select(TW_DIRECTION_DOWN);
+		break;
+	case KEY_TAB:
+		desktop_overview_select_next();
+		break;
+	case KEY_ENTER:
+	case KEY_KPENTER:
+	case KEY_SPACE:
+		desktop_end_overview(d, true);
+		break;
+	case KEY_ESC:
+		desktop_end_overview(d, false);
+		break;
+	default:
+		break;
+	}
+}
+
+static void
+overview_grab_key_cancel(struct weston_keyboard_grab *grab)
+{
+	struct grab_interface *gi =
+		container_of(grab, struct grab_interface, keyboard_grab);
+	struct desktop *d = container_of(gi, struct desktop,
+	                                 overview_key_grab);
+
+	desktop_end_overview(d, false);
+}
+
+static struct weston_keyboard_grab_interface desktop_overview_key_grab = {
+	.key = overview_grab_key,
+	.modifiers = noop_grab_modifiers,
+	.cancel = overview_grab_key_cancel,
+};
+
 static struct weston_keyboard_grab_interface desktop_task_switch_grab = {
 	.key = task_switch_grab_key,
-	.modifiers = task_switch_grab_modifier,
+	.modifiers = noop_grab_modifiers,
 	.cancel = task_switch_grab_cancel,
 };
 
@@ -783,6 +1009,16 @@ static struct weston_pointer_grab_interface desktop_resizing_grab = {
 	.axis_source = noop_grab_axis_source,
 };
 
+static struct weston_pointer_grab_interface desktop_overview_pointer_grab = {
+	.focus = noop_grab_focus,
+	.motion = overview_grab_pointer_motion,
+	.button = overview_grab_button,
+	.axis = noop_grab_axis,
+	.frame = noop_grab_frame,
+	.cancel = overview_grab_pointer_cancel,
+	.axis_source = noop_grab_axis_source,
+};
+
 static struct weston_pointer_grab_interface desktop_alpha_grab = {
 	.focus = noop_grab_focus,
 	.motion = noop_grab_pointer_motion,
@@ -799,23 +1035,15 @@ static struct weston_pointer_grab_interface desktop_alpha_grab = {
 int
 tw_desktop_get_current_workspace(struct desktop *desktop)
 {
-	struct workspace *ws = desktop->actived_workspace[0];
-	for (int i = 0; i < MAX_WORKSPACE; i++) {
-		if (ws == &desktop->workspaces[i])
-			return i;
-	}
-	return 0;
+	return MAX(get_workspace_index(desktop->actived_workspace[0],
+	                               desktop), 0);
 }
 
 int
 tw_desktop_get_last_workspace(struct desktop *desktop)
 {
-	struct workspace *ws = desktop->actived_workspace[1];
-	for (int i = 0; i < MAX_WORKSPACE; i++) {
-		if (ws == &desktop->workspaces[i])
-			return i;
-	}
-	return 0;
+	return MAX(get_workspace_index(desktop->actived_workspace[1],
+	                               desktop), 0);
 }
 
 void
@@ -854,6 +1082,7 @@ tw_desktop_start_task_switch_grab(struct desktop *desktop,
 	wl_list_for_each_safe(rv, tmp, &ws->recent_views, link) {
 		view = workspace_defocus_view(ws, rv->view);
 
+		desktop_switcher_show(true);
 		grab_interface_start_keyboard(&desktop->task_switch_grab,
 					      view, keyboard->seat);
 		//and we need run the key as well.
@@ -867,6 +1096,27 @@ tw_desktop_start_task_switch_grab(struct desktop *desktop,
 	}
 }
 
+void
+tw_desktop_start_overview(struct desktop *desktop,
+                          struct weston_keyboard *keyboard, bool all)
+{
+	struct workspace *ws = desktop->actived_workspace[0];
+	struct weston_seat *seat = keyboard->seat;
+	struct weston_view *view;
+
+	if (desktop_overview_active() ||
+	    keyboard->grab != &keyboard->default_grab ||
+	    !desktop_overview_start(desktop->compositor,
+	                            all ? desktop->workspaces : &ws,
+	                            all ? MAX_WORKSPACE : 1, ws,
+	                            desktop->shell))
+		return;
+	view = desktop_overview_selected();
+	grab_interface_start_keyboard(&desktop->overview_key_grab, view, seat);
+	grab_interface_start_pointer(&desktop->overview_pointer_grab, view,
+	                             seat);
+}
+
 bool
 tw_desktop_activate_view(struct desktop *desktop,
                          struct weston_view *view)
@@ -893,15 +1143,24 @@ tw_desktop_switch_workspace(struct desktop *desktop, uint32_t to)
 	char msg[32];
 	struct weston_view *focused;
 	struct workspace *ws = desktop->actived_workspace[0];
-
-	desktop->actived_workspace[0] = &desktop->workspaces[to];
-	focused = workspace_switch(&desktop->workspaces[to], ws);
+	struct workspace *last = desktop->actived_workspace[1];
+	struct workspace *next = tw_desktop_get_workspace(desktop, to, true);
+	int switched[2] = {get_workspace_index(ws, desktop), to};
+
+	if (!next)
+		return NULL;
+	if (next != ws)
+		desktop->actived_workspace[1] = ws;
+	desktop->actived_workspace[0] = next;
+	focused = workspace_switch(next, ws);
+	desktop_reclaim_workspace(desktop, last);
 
 	//send msgs, those type of message
 	snprintf(msg, 32, "%d", to);
 	shell_post_message(desktop->shell,
 	                   TAIWINS_SHELL_MSG_TYPE_SWITCH_WORKSPACE,
 	                   msg);
+	wl_signal_emit(&desktop->signals.workspace_switched, switched);
 	return focused;
 }
 
@@ -917,6 +1176,8 @@ tw_desktop_start_resize_grab(struct desktop *desktop,
 	if (!weston_surface_is_desktop_surface(surface))
 		return;
 	ws = get_workspace_for_view(view, desktop);
+	if (!ws)
+		return;
 	switch (option) {
 	case RESIZE_LEFT:
 		dx = -10;
@@ -994,6 +1255,101 @@ tw_desktop_merge_view(struct desktop *desktop, struct weston_view *view)
 		workspace_view_run_command(ws, view, DPSR_merge);
 }
 
+void
+tw_desktop_tab_view(struct desktop *desktop, struct weston_view *view,
+                    bool stacked)
+{
+	struct workspace *ws;
+	struct weston_surface *surface = view->surface;
+
+	if (!weston_surface_is_desktop_surface(surface))
+		return;
+	ws = get_workspace_for_view(view, desktop);
+	if (ws)
+		workspace_view_run_command(ws, view,
+		                           stacked ? DPSR_stacked : DPSR_tabbed);
+}
+
+void
+tw_desktop_undo_layout(struct desktop *desktop, bool redo)
+{
+	workspace_undo_layout(desktop->actived_workspace[0], redo);
+}
+
+struct weston_view *
+tw_desktop_nearest_view(struct desktop *desktop, struct weston_view *view,
+                        enum tw_desktop_direction direction)
+{
+	return workspace_nearest_view(desktop->actived_workspace[0], view,
+	                              direction);
+}
+
+bool
+tw_desktop_move_view(struct desktop *desktop, struct weston_view *view,
+                     enum tw_desktop_direction direction)
+{
+	struct workspace *ws = desktop->actived_workspace[0];
+	struct weston_view *other =
+		workspace_nearest_view(ws, view, direction);
+
+	return other && workspace_swap_views(ws, view, other);
+}
+
+struct tw_desktop_signals *
+tw_desktop_get_signals(struct desktop *desktop)
+{
+	return &desktop->signals;
+}
+
+void
+tw_desktop_for_each_view(struct desktop *desktop, tw_desktop_view_iter_t iter,
+                         void *data)
+{
+	struct recent_view *rv;
+	struct tw_desktop_view_info info;
+
+	for (int i = 0; i < MAX_WORKSPACE; i++) {
+		struct workspace *ws = desktop->workspaces[i];
+		if (!ws)
+			continue;
+		wl_list_for_each(rv, &ws->recent_views, link) {
+			desktop_view_info(desktop, rv, ws, &info);
+			iter(&info, data);
+		}
+	}
+}
+
+bool
+tw_desktop_get_view_info(struct desktop *desktop, struct weston_view *view,
+                         struct tw_desktop_view_info *info)
+{
+	struct recent_view *rv;
+	struct workspace *ws;
+
+	if (!view || !is_desktop_surface(view->surface))
+		return false;
+	rv = get_recent_view(view);
+	ws = get_workspace_for_view(view, desktop);
+	desktop_view_info(desktop, rv, ws, info);
+	return true;
+}
+
+struct weston_view *
+tw_desktop_find_view(struct desktop *desktop, uint32_t id)
+{
+	struct recent_view *rv;
+
+	for (int i = 0; i < MAX_WORKSPACE; i++) {
+		if (!desktop->workspaces[i])
+			continue;
+		wl_list_for_each(rv, &desktop->workspaces[i]->recent_views,
+		                 link)
+			if (rv->id == id)
+				return rv->view;
+	}
+	return NULL;
+}
+
 int
 tw_desktop_num_workspaces(UNUSED_ARG(struct desktop *desktop))
 {
@@ -1003,20 +1359,86 @@ tw_desktop_num_workspaces(UNUSED_ARG(struct desktop *desktop))
 const char *
 tw_desktop_get_workspace_layout(struct desktop *desktop, unsigned int i)
 {
-	return (i > MAX_WORKSPACE) ? NULL :
-		workspace_layout_name(&desktop->workspaces[i]);
+	struct workspace_conf conf;
+
+	if (i >= MAX_WORKSPACE)
+		return NULL;
+	tw_desktop_get_workspace_conf(desktop, i, &conf);
+	return workspace_layout_name(conf.layout);
 }
 
 bool
 tw_desktop_set_workspace_layout(struct desktop *desktop, unsigned int i,
                                 enum tw_layout_type layout)
 {
-	bool ret = true;
-	if (i > MAX_WORKSPACE)
-		ret = false;
-	desktop_set_worksace_layout(desktop, i, layout);
+	struct workspace_conf conf;
 
-	return ret;
+	if (i >= MAX_WORKSPACE)
+		return false;
+	tw_desktop_get_workspace_conf(desktop, i, &conf);
+	conf.layout = layout;
+	return tw_desktop_set_workspace_conf(desktop, i, &conf);
+}
+
+struct workspace *
+tw_desktop_get_workspace(struct desktop *desktop, unsigned int i, bool create)
+{
+	struct weston_output *output;
+	struct workspace *ws;
+
+	if (i >= MAX_WORKSPACE)
+		return NULL;
+	if (desktop->workspaces[i] || !create)
+		return desktop->workspaces[i];
+	if (!(ws = tw_zalloc(TW_MEM_WORKSPACE, sizeof(*ws))))
+		return NULL;
+	workspace_init(ws, desktop->compositor);
+	workspace_set_conf(ws, &desktop->workspace_confs[i]);
+	wl_list_for_each(output, &desktop->compositor->output_list, link) {
+		struct tw_output tw_output = desktop_tw_output(desktop, output);
+		workspace_add_output(ws, &tw_output);
+	}
+	desktop->workspaces[i] = ws;
+	return ws;
+}
+
+void
+tw_desktop_reclaim_workspaces(struct desktop *desktop)
+{
+	for (int i = 0; i < MAX_WORKSPACE; i++)
+		if (desktop->workspaces[i])
+			desktop_reclaim_workspace(desktop,
+			                          desktop->workspaces[i]);
+}
+
+void
+tw_desktop_get_workspace_conf(struct desktop *desktop, unsigned int i,
+                              struct workspace_conf *conf)
+{
+	if (i >= MAX_WORKSPACE)
+		return;
+	if (desktop->workspaces[i])
+		workspace_get_conf(desktop->workspaces[i], conf);
+	else
+		*conf = desktop->workspace_confs[i];
+}
+
+bool
+tw_desktop_set_workspace_conf(struct desktop *desktop, unsigned int i,
+                              const struct workspace_conf *conf)
+{
+	struct workspace *ws;
+
+	if (i >= MAX_WORKSPACE)
+		return false;
+	desktop->workspace_confs[i] = *conf;
+	if (!(ws = desktop->workspaces[i]))
+		return true;
+	workspace_set_conf(ws, conf);
+	//a hidden workspace is arranged when it is switched to
+	if (ws == desktop->actived_workspace[0])
+		desktop_schedule_arrange(desktop);
+	return true;
 }
 void
 tw_desktop_get_gap(struct desktop *desktop, int *inner, int *outer)
@@ -1053,8 +1475,19 @@ end_desktop(struct wl_listener *listener, UNUSED_ARG(void *data))
 
 	wl_list_remove(&d->output_create_listener.link);
 	wl_list_remove(&d->output_destroy_listener.link);
-	for (int i = 0; i < MAX_WORKSPACE+1; i++)
-		workspace_release(&d->workspaces[i]);
+	if (d->arrange_idle)
+		wl_event_source_remove(d->arrange_idle);
+	d->arrange_idle = NULL;
+	desktop_overview_end();
+	desktop_session_end();
+	desktop_switcher_end();
+	for (int i = 0; i < MAX_WORKSPACE; i++) {
+		if (!d->workspaces[i])
+			continue;
+		workspace_release(d->workspaces[i]);
+		tw_free(d->workspaces[i]);
+		d->workspaces[i] = NULL;
+	}
 	weston_desktop_destroy(d->api);
 }
 
@@ -1070,15 +1503,20 @@ tw_setup_desktop(struct weston_compositor *ec,  struct shell *shell)
 	s_desktop.inner_gap = 10;
 	s_desktop.outer_gap = 10;
 
-	struct workspace *wss = s_desktop.workspaces;
-	{
-		for (int i = 0; i < MAX_WORKSPACE+1; i++)
-			workspace_init(&wss[i], ec);
-		s_desktop.actived_workspace[0] = &wss[0];
-		s_desktop.actived_workspace[1] = &wss[1];
-		workspace_switch(s_desktop.actived_workspace[0],
-		                 s_desktop.actived_workspace[0]);
-	}
+	//the workspaces come when first used, with what they were set to
+	for (int i = 0; i < MAX_WORKSPACE; i++)
+		s_desktop.workspace_confs[i] = (struct workspace_conf){
+			.layout = LAYOUT_TILING,
+			.masters = 1,
+			.master_portion = 0.5,
+		};
+	desktop_session_init(ec, &s_desktop);
+	if (!desktop_switcher_init())
+		tw_log_warn("desktop", "no task switcher table, the shell "
+		            "cannot show the windows");
+	wl_signal_init(&s_desktop.signals.view_created);
+	wl_signal_init(&s_desktop.signals.view_destroyed);
+	wl_signal_init(&s_desktop.signals.workspace_switched);
 	s_desktop.api = weston_desktop_create(ec, &desktop_impl, &s_desktop);
 	//install grab
 	grab_interface_init(&s_desktop.moving_grab,
@@ -1089,6 +1527,10 @@ tw_setup_desktop(struct weston_compositor *ec,  struct shell *shell)
 			    NULL, &desktop_task_switch_grab, NULL);
 	grab_interface_init(&s_desktop.alpha_grab,
 	                    &desktop_alpha_grab, NULL, NULL);
+	grab_interface_init(&s_desktop.overview_key_grab,
+	                    NULL, &desktop_overview_key_grab, NULL);
+	grab_interface_init(&s_desktop.overview_pointer_grab,
+	                    &desktop_overview_pointer_grab, NULL, NULL);
 
 	//install signals
 	wl_list_init(&s_desktop.widget_closed_listener.link);
@@ -1123,6 +1565,14 @@ tw_setup_desktop(struct weston_compositor *ec,  struct shell *shell)
 	wl_list_for_each(output, &ec->output_list, link)
 		desktop_output_created(&s_desktop.output_create_listener,
 				       output);
+	//the first one is shown, the outputs are already there for it
+	s_desktop.actived_workspace[0] = tw_desktop_get_workspace(
+		&s_desktop, 0, true);
+	s_desktop.actived_workspace[1] = s_desktop.actived_workspace[0];
+	if (!s_desktop.actived_workspace[0])
+		return NULL;
+	workspace_switch(s_desktop.actived_workspace[0],
+	                 s_desktop.actived_workspace[0]);
 
 	wl_list_init(&s_desktop.compositor_destroy_listener.link);
 	s_desktop.compositor_destroy_listener.notify = end_desktop;
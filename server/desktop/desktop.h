@@ -46,12 +46,44 @@ struct tw_output {
 	uint32_t outer_gap;
 };
 
+/**
+ * @brief plain data about a desktop view for the outside world
+ *
+ * the id is unique for the lifetime of the compositor, unlike the pointers,
+ * they are safe to hand to clients.
+ */
+struct tw_desktop_view_info {
+	struct weston_view *view;
+	uint32_t id;
+	int workspace;
+	enum tw_layout_type type;
+};
+
+/**
+ * @brief desktop events, all of them are emitted with a struct
+ * tw_desktop_view_info, except workspace_switched, which gives you a int[2]
+ * of {from, to}.
+ */
+struct tw_desktop_signals {
+	struct wl_signal view_created;
+	struct wl_signal view_destroyed;
+	struct wl_signal workspace_switched;
+};
+
+typedef void (*tw_desktop_view_iter_t)(const struct tw_desktop_view_info *info,
+                                       void *data);
+
 //not sure if we want to make it here
 enum tw_desktop_view_resize_option {
 	RESIZE_LEFT, RESIZE_RIGHT,
 	RESIZE_UP, RESIZE_DOWN,
 };
 
+enum tw_desktop_direction {
+	TW_DIRECTION_LEFT, TW_DIRECTION_RIGHT,
+	TW_DIRECTION_UP, TW_DIRECTION_DOWN,
+};
+
 /*******************************************************************************
  * desktop functions
  ******************************************************************************/
@@ -64,6 +96,18 @@ tw_setup_desktop(struct weston_compositor *compositor,
 
 struct desktop *tw_desktop_get_global();
 
+struct tw_desktop_signals *
+tw_desktop_get_signals(struct desktop *desktop);
+
+void
+tw_desktop_for_each_view(struct desktop *desktop, tw_desktop_view_iter_t iter,
+                         void *data);
+bool
+tw_desktop_get_view_info(struct desktop *desktop, struct weston_view *view,
+                         struct tw_desktop_view_info *info);
+struct weston_view *
+tw_desktop_find_view(struct desktop *desktop, uint32_t id);
+
 int
 tw_desktop_num_workspaces(struct desktop *desktop);
 
@@ -94,6 +138,13 @@ tw_desktop_start_moving_grab(struct desktop *desktop,
 void
 tw_desktop_start_task_switch_grab(struct desktop *desktop,
                                   struct weston_keyboard *keyboard);
+/**
+ * @brief show the views of the current workspace, or of all, scaled down side
+ * by side until one is picked with the keyboard or the pointer
+ */
+void
+tw_desktop_start_overview(struct desktop *desktop,
+                          struct weston_keyboard *keyboard, bool all);
 bool
 tw_desktop_activate_view(struct desktop *desktop, struct weston_view *view);
 
@@ -115,6 +166,66 @@ tw_desktop_split_on_view(struct desktop *desktop, struct weston_view *view,
 void
 tw_desktop_merge_view(struct desktop *desktop, struct weston_view *view);
 
+/**
+ * @brief turn the container of the view into tabs, or stacked, or back to a
+ * split if it already is
+ */
+void
+tw_desktop_tab_view(struct desktop *desktop, struct weston_view *view,
+                    bool stacked);
+
+void
+tw_desktop_undo_layout(struct desktop *desktop, bool redo);
+
+/**
+ * @brief the closest view on that side of the view, on any output of the
+ * current workspace
+ */
+struct weston_view *
+tw_desktop_nearest_view(struct desktop *desktop, struct weston_view *view,
+                        enum tw_desktop_direction direction);
+
+/**
+ * @brief the view trades places with the closest view on that side, on any
+ * output, if both are tiled
+ */
+bool
+tw_desktop_move_view(struct desktop *desktop, struct weston_view *view,
+                     enum tw_desktop_direction direction);
+
+/*******************************************************************************
+ * workspaces, for the desktop modules
+ ******************************************************************************/
+struct workspace;
+struct workspace_conf;
+
+/**
+ * @brief the workspace i, allocated first if create, NULL if it is not in use
+ *
+ * A workspace is freed again once it is empty and neither shown nor the last
+ * one shown.
+ */
+struct workspace *
+tw_desktop_get_workspace(struct desktop *desktop, unsigned int i, bool create);
+
+/**
+ * @brief free the workspaces that can go now
+ *
+ * For whoever held them, the overview and the session waiting for its windows.
+ */
+void
+tw_desktop_reclaim_workspaces(struct desktop *desktop);
+
+/**
+ * @brief the conf of the workspace i, in use or not
+ */
+void
+tw_desktop_get_workspace_conf(struct desktop *desktop, unsigned int i,
+                              struct workspace_conf *conf);
+bool
+tw_desktop_set_workspace_conf(struct desktop *desktop, unsigned int i,
+                              const struct workspace_conf *conf);
+
 #ifdef  __cplusplus
 }
 #endif
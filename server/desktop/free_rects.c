@@ -0,0 +1,178 @@
+/*
+ * free_rects.c - taiwins desktop free space of the floating layout
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <string.h>
+#include <alloc.h>
+#include <ctypes/helpers.h>
+
+#include "free_rects.h"
+
+void
+free_rects_init(struct free_rects *fr)
+{
+	memset(fr, 0, sizeof(*fr));
+}
+
+void
+free_rects_release(struct free_rects *fr)
+{
+	tw_free(fr->rects);
+	free_rects_init(fr);
+}
+
+static bool
+free_rects_reserve(struct free_rects *fr, int len)
+{
+	struct weston_geometry *rects;
+	int cap = fr->cap ? fr->cap : 16;
+
+	if (len <= fr->cap)
+		return true;
+	while (cap < len)
+		cap *= 2;
+	rects = tw_realloc(TW_MEM_LAYOUT, fr->rects, cap * sizeof(*rects));
+	if (!rects)
+		return false;
+	fr->rects = rects;
+	fr->cap = cap;
+	return true;
+}
+
+void
+free_rects_reset(struct free_rects *fr, const struct weston_geometry *area)
+{
+	fr->area = *area;
+	fr->len = 0;
+	if (area->width > 0 && area->height > 0 && free_rects_reserve(fr, 1))
+		fr->rects[fr->len++] = *area;
+}
+
+static inline bool
+rect_intersects(const struct weston_geometry *a, const struct weston_geometry *b)
+{
+	return a->x < b->x + b->width && b->x < a->x + a->width &&
+		a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+static inline bool
+rect_contains(const struct weston_geometry *a, const struct weston_geometry *b)
+{
+	return b->x >= a->x && b->y >= a->y &&
+		b->x + b->width <= a->x + a->width &&
+		b->y + b->height <= a->y + a->height;
+}
+
+/* the parts of r around geo, each as large as it can be */
+static int
+rect_split(const struct weston_geometry *r, const struct weston_geometry *geo,
+           struct weston_geometry *pieces)
+{
+	int n = 0;
+
+	if (geo->x > r->x)
+		pieces[n++] = (struct weston_geometry){
+			r->x, r->y, geo->x - r->x, r->height};
+	if (geo->x + geo->width < r->x + r->width)
+		pieces[n++] = (struct weston_geometry){
+			geo->x + geo->width, r->y,
+			r->x + r->width - (geo->x + geo->width), r->height};
+	if (geo->y > r->y)
+		pieces[n++] = (struct weston_geometry){
+			r->x, r->y, r->width, geo->y - r->y};
+	if (geo->y + geo->height < r->y + r->height)
+		pieces[n++] = (struct weston_geometry){
+			r->x, geo->y + geo->height,
+			r->width, r->y + r->height - (geo->y + geo->height)};
+	return n;
+}
+
+bool
+free_rects_occupy(struct free_rects *fr, const struct weston_geometry *geo)
+{
+	int len = fr->len, kept = 0, total;
+
+	if (geo->width <= 0 || geo->height <= 0)
+		return true;
+	//the pieces go after the old ones, which are packed to the front
+	for (int i = 0; i < len; i++) {
+		struct weston_geometry r = fr->rects[i];
+		if (!rect_intersects(&r, geo)) {
+			fr->rects[kept++] = r;
+			continue;
+		}
+		if (!free_rects_reserve(fr, fr->len + 4))
+			return false;
+		fr->len += rect_split(&r, geo, &fr->rects[fr->len]);
+	}
+	total = kept + (fr->len - len);
+	memmove(&fr->rects[kept], &fr->rects[len],
+	        (fr->len - len) * sizeof(*fr->rects));
+	fr->len = total;
+
+	//a piece is inside of the rectangle it came from, so an old one which
+	//was not inside of that cannot be inside of a piece either, only the
+	//pieces have to be checked
+	for (int i = kept; i < fr->len; i++) {
+		bool inside = false;
+		for (int j = 0; j < fr->len && !inside; j++) {
+			if (j == i)
+				continue;
+			//of two same ones the first stays
+			inside = rect_contains(&fr->rects[j], &fr->rects[i]) &&
+				(j < i || !rect_contains(&fr->rects[i],
+				                         &fr->rects[j]));
+		}
+		if (inside)
+			fr->rects[i--] = fr->rects[--fr->len];
+	}
+	return true;
+}
+
+bool
+free_rects_find(const struct free_rects *fr, int32_t width, int32_t height,
+                struct weston_position *pos)
+{
+	int32_t best_short = INT32_MAX, best_long = INT32_MAX;
+	const struct weston_geometry *best = NULL;
+
+	for (int i = 0; i < fr->len; i++) {
+		const struct weston_geometry *r = &fr->rects[i];
+		int32_t dw = r->width - width, dh = r->height - height;
+		int32_t short_side = MIN(dw, dh), long_side = MAX(dw, dh);
+
+		if (dw < 0 || dh < 0)
+			continue;
+		//the same fit, then the top left one
+		if (short_side < best_short ||
+		    (short_side == best_short && long_side < best_long) ||
+		    (short_side == best_short && long_side == best_long &&
+		     (r->y < best->y || (r->y == best->y && r->x < best->x)))) {
+			best_short = short_side;
+			best_long = long_side;
+			best = r;
+		}
+	}
+	if (!best)
+		return false;
+	pos->x = best->x;
+	pos->y = best->y;
+	return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * free_rects.h - taiwins desktop free space of the floating layout
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_FREE_RECTS_H
+#define TW_FREE_RECTS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libweston/libweston.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The space of an output nobody covers, as the largest rectangles that fit in
+ * it (maxrects). They overlap each other, but none is inside an other one, so
+ * a window fits somewhere free only if it fits in one of them.
+ *
+ * Covering a rectangle only cuts the free ones it touches, freeing one is not
+ * possible, the owner starts again from the views it has.
+ */
+struct free_rects {
+	struct weston_geometry area;
+	struct weston_geometry *rects;
+	int len, cap;
+};
+
+void
+free_rects_init(struct free_rects *fr);
+
+void
+free_rects_release(struct free_rects *fr);
+
+/**
+ * @brief all of area free again, the memory is kept
+ */
+void
+free_rects_reset(struct free_rects *fr, const struct weston_geometry *area);
+
+/**
+ * @brief take geo out of the free space, what is outside the area is ignored
+ *
+ * @return false if out of memory, the free space is then too large
+ */
+bool
+free_rects_occupy(struct free_rects *fr, const struct weston_geometry *geo);
+
+/**
+ * @brief where a width x height window fits best, in the free rectangle that
+ * leaves the least along its shorter side
+ *
+ * @return false if it fits nowhere
+ */
+bool
+free_rects_find(const struct free_rects *fr, int32_t width, int32_t height,
+                struct weston_position *pos);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
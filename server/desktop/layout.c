@@ -51,6 +51,15 @@ emplace_float(const enum layout_command command, const struct layout_op *arg,
 	       struct weston_view *v, struct layout *l,
 	       struct layout_op *ops);
 
+extern void floating_rm_output(struct layout *l, struct weston_output *o);
+
+//the engines sharing the outputs of the tiling layout
+static inline bool
+layout_is_tiling(const struct layout *l)
+{
+	return l->command == emplace_tiling || l->command == emplace_master ||
+		l->command == emplace_grid || l->command == emplace_monocle;
+}
 
 void
 layout_init(struct layout *l, struct weston_layer *layer)
@@ -61,32 +70,68 @@ layout_init(struct layout *l, struct weston_layer *layer)
 	l->layer = layer;
 	l->command = emplace_noop;
 	l->user_data = NULL;
+	l->stack.master_portion = 0.5;
+	l->stack.masters = 1;
+	wl_array_init(&l->stack.order);
 }
 
 void
 layout_release(struct layout *l)
 {
+	wl_array_release(&l->stack.order);
 	*l = (struct layout){0};
 }
 
 void
 layout_add_output(struct layout *l, struct tw_output *o)
 {
-	if (l->command == emplace_tiling)
+	if (layout_is_tiling(l))
 		tiling_add_output(l, o);
 }
 
 void
 layout_rm_output(struct layout *l, struct weston_output *o)
 {
-	if (l->command == emplace_tiling)
+	if (layout_is_tiling(l))
 		tiling_rm_output(l, o);
+	else if (l->command == emplace_float)
+		floating_rm_output(l, o);
 }
 
 
 void
 layout_resize_output(struct layout *l, struct tw_output *o)
 {
-	if (l->command == emplace_tiling)
+	if (layout_is_tiling(l))
 		tiling_resize_output(l, o);
 }
+
+bool
+layout_set_engine(struct layout *l, enum tw_layout_type type)
+{
+	layout_fun_t engine;
+
+	if (!layout_is_tiling(l))
+		return false;
+	switch (type) {
+	case LAYOUT_TILING:
+		engine = emplace_tiling;
+		break;
+	case LAYOUT_MASTER:
+		engine = emplace_master;
+		break;
+	case LAYOUT_GRID:
+		engine = emplace_grid;
+		break;
+	case LAYOUT_MONOCLE:
+		engine = emplace_monocle;
+		break;
+	default:
+		return false;
+	}
+	//the tree missed the views coming and going in the meantime
+	if (engine == emplace_tiling && l->command != emplace_tiling)
+		tiling_layout_rebuild(l);
+	l->command = engine;
+	return true;
+}
@@ -26,6 +26,7 @@
 #include <wayland-server.h>
 #include <ctypes/helpers.h>
 #include "desktop.h"
+#include "session_file.h"
 
 #ifdef  __cplusplus
 extern "C" {
@@ -47,6 +48,11 @@ enum layout_command {
 	DPSR_hsplit,
 	DPSR_merge,
 	DPSR_output_resize,
+	DPSR_undo, //the last tiling change on the workspace
+	DPSR_redo,
+	DPSR_tabbed, //one child of the container at a time, or back to a split
+	DPSR_stacked,
+	DPSR_swap, //v trades places with arg->v
 };
 
 /* the operation correspond to the command, I am not sure if it is good to have
@@ -60,7 +66,12 @@ struct layout_op {
 	struct weston_size size;
 	float scale;
 	bool end;
-	//input
+	//output, behind an other tab of its container. It keeps the size of the
+	//container but it is not shown
+	bool hidden;
+	//input, on DPSR_add the placeholder of a restored session to take, 0 for
+	//none
+	uint32_t placeholder;
 	union {
 		//resizing/moving parameters,
 		struct {
@@ -87,6 +98,13 @@ struct layout {
 	struct weston_layer *layer;
 	layout_fun_t command;
 	void *user_data; //this user_dat is useful
+	//parameters of the master stack engine
+	struct {
+		float master_portion;
+		int masters;
+		//the views in the order they came, the slots go by it
+		struct wl_array order;
+	} stack;
 };
 
 void
@@ -104,6 +122,15 @@ layout_rm_output(struct layout *l, struct weston_output *o);
 void
 layout_resize_output(struct layout *l, struct tw_output *o);
 
+/**
+ * @brief pick the engine of a tiling layout, LAYOUT_TILING, LAYOUT_MASTER,
+ * LAYOUT_GRID or LAYOUT_MONOCLE
+ *
+ * The views are not moved, arrange the outputs after this.
+ */
+bool
+layout_set_engine(struct layout *l, enum tw_layout_type type);
+
 void
 floating_layout_init(struct layout *layout, struct weston_layer *ly);
 
@@ -117,6 +144,67 @@ tiling_layout_init(struct layout *layout, struct weston_layer *ly,
 void
 tiling_layout_end(struct layout *l);
 
+/**
+ * @brief the space of an output in a tiling layout, for all the engines
+ */
+bool
+tiling_output_area(struct layout *l, struct weston_output *o,
+                   struct tw_output *area);
+
+/**
+ * @brief put the views of the layer back in the tree, flat, after an other
+ * engine ran
+ */
+void
+tiling_layout_rebuild(struct layout *l);
+
+/**
+ * @brief the tree of an output in preorder for the session file, root first
+ *
+ * slot_of gives the slot of a view, or of a placeholder still waiting when v
+ * is NULL, -1 leaves it out.
+ *
+ * @return the number of nodes, 0 if the tiling engine is not on, -1 if max is
+ * not enough
+ */
+int
+tiling_layout_save(struct layout *l, struct weston_output *o,
+                   struct tw_session_node *nodes, int max,
+                   int32_t (*slot_of)(struct weston_view *v,
+                                      uint32_t placeholder, void *data),
+                   void *data);
+
+/**
+ * @brief put back a saved tree on an empty output, the leaf of slot n becomes
+ * the placeholder n+1, see layout_op::placeholder
+ */
+bool
+tiling_layout_load(struct layout *l, struct weston_output *o,
+                   const struct tw_session_node *nodes, uint32_t len);
+
+/**
+ * @brief give up on the placeholders no view took, the outputs need to be
+ * arranged after
+ *
+ * @return true if there were any
+ */
+bool
+tiling_layout_drop_placeholders(struct layout *l);
+
+void
+emplace_master(const enum layout_command command, const struct layout_op *arg,
+               struct weston_view *v, struct layout *l,
+               struct layout_op *ops);
+void
+emplace_grid(const enum layout_command command, const struct layout_op *arg,
+             struct weston_view *v, struct layout *l,
+             struct layout_op *ops);
+void
+emplace_monocle(const enum layout_command command,
+                const struct layout_op *arg,
+                struct weston_view *v, struct layout *l,
+                struct layout_op *ops);
+
 
 #ifdef  __cplusplus
 }
@@ -0,0 +1,153 @@
+/*
+ * layout_constraint.c - taiwins desktop size constraints of the tiling layout
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stddef.h>
+
+#include "layout_constraint.h"
+
+static inline int64_t
+span_slack(const struct layout_span *span, bool grow)
+{
+	if (grow)
+		return span->max ? span->max - span->size : 0;
+	return span->size - span->min;
+}
+
+/* take or give amount, each span in proportion to its slack, which is at least
+ * amount in total. The shares are rounded down, so nobody goes past its
+ * limits, the pixels left go one by one to the spans with slack left, there
+ * are fewer of them than spans with a rounded share. */
+static void
+span_distribute(struct layout_span *spans, int n, int64_t amount,
+                int64_t slack, bool grow)
+{
+	int64_t given = 0;
+	int sign = grow ? 1 : -1;
+
+	for (int i = 0; i < n; i++) {
+		int64_t share = amount * span_slack(&spans[i], grow) / slack;
+		spans[i].size += sign * share;
+		given += share;
+	}
+	for (int i = 0; i < n && given < amount; i++)
+		if (span_slack(&spans[i], grow) > 0) {
+			spans[i].size += sign;
+			given++;
+		}
+}
+
+/* all of amount goes to the spans without a max, by their portions, or the
+ * same for all if they have none */
+static void
+span_grow_unbounded(struct layout_span *spans, int n, int64_t amount,
+                    float portions, int unbounded)
+{
+	int64_t given = 0;
+	int last = -1;
+	float weights = (portions > 0.0f) ? portions : unbounded;
+
+	for (int i = 0; i < n; i++) {
+		float weight = (portions > 0.0f) ? spans[i].portion : 1.0f;
+		int64_t share;
+
+		if (spans[i].max)
+			continue;
+		share = (int64_t)(amount * (weight / weights));
+		spans[i].size += share;
+		given += share;
+		last = i;
+	}
+	if (last >= 0)
+		spans[last].size += amount - given;
+}
+
+bool
+layout_span_solve(struct layout_span *spans, int n, int32_t total)
+{
+	int64_t sum = 0, mins = 0, slack = 0, diff;
+	float portions = 0.0f, unbounded_portions = 0.0f;
+	int unbounded = 0;
+
+	if (n <= 0)
+		return true;
+	for (int i = 0; i < n; i++) {
+		if (!(spans[i].portion > 0.0f))
+			spans[i].portion = 0.0f;
+		//a max under the min is a client bug, the min wins
+		if (spans[i].max && spans[i].max < spans[i].min)
+			spans[i].max = 0;
+		portions += spans[i].portion;
+	}
+	//the portions first, then clamped
+	for (int i = 0; i < n; i++) {
+		struct layout_span *span = &spans[i];
+		float want = (portions > 0.0f) ?
+			total * (span->portion / portions) :
+			(float)total / n;
+
+		span->size = (int32_t)(want + 0.5f);
+		if (span->size < span->min)
+			span->size = span->min;
+		if (span->max && span->size > span->max)
+			span->size = span->max;
+		sum += span->size;
+		mins += span->min;
+		if (!span->max) {
+			unbounded++;
+			unbounded_portions += span->portion;
+		}
+	}
+	diff = (int64_t)total - sum;
+	if (!diff)
+		return true;
+
+	if (diff > 0 && unbounded) {
+		span_grow_unbounded(spans, n, diff, unbounded_portions,
+		                    unbounded);
+		return true;
+	}
+	for (int i = 0; i < n; i++)
+		slack += span_slack(&spans[i], diff > 0);
+	if (diff > 0) {
+		//all at their max, the rest of the space stays empty
+		if (slack <= diff) {
+			for (int i = 0; i < n; i++)
+				spans[i].size = spans[i].max;
+			return true;
+		}
+		span_distribute(spans, n, diff, slack, true);
+		return true;
+	}
+	if (slack >= -diff) {
+		span_distribute(spans, n, -diff, slack, false);
+		return true;
+	}
+	//the mins do not fit, nobody gets what it wants
+	sum = 0;
+	for (int i = 0; i < n; i++) {
+		spans[i].size = (total > 0 && mins > 0) ?
+			(int32_t)((int64_t)spans[i].min * total / mins) : 0;
+		sum += spans[i].size;
+	}
+	if (total > 0)
+		spans[n-1].size += total - sum;
+	return false;
+}
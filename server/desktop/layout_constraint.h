@@ -0,0 +1,59 @@
+/*
+ * layout_constraint.h - taiwins desktop size constraints of the tiling layout
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_LAYOUT_CONSTRAINT_H
+#define TW_LAYOUT_CONSTRAINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/* a child of a split, along the split */
+struct layout_span {
+	//input
+	int32_t min, max; /**< 0 for none */
+	float portion;
+	//output
+	int32_t size;
+};
+
+/**
+ * @brief share total between the spans by their portions, as far as their min
+ * and max sizes let them, in one pass over the spans
+ *
+ * What a span gets over or under its portion comes from the others in
+ * proportion to how far they are from their own limits, so nobody is pushed
+ * past them. When the mins do not fit, the spans shrink under their mins by
+ * the same ratio; when the maxes do not fill total, the rest is left empty.
+ *
+ * @return false if some span did not get a size within its limits
+ */
+bool
+layout_span_solve(struct layout_span *spans, int n, int32_t total);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
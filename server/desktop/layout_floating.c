@@ -19,13 +19,16 @@
  *
  */
 
+#include <string.h>
 #include <stdlib.h>
 #include <ctypes/helpers.h>
 #include <ctypes/sequential.h>
+#include <alloc.h>
 #include "layout.h"
 #include "workspace.h"
+#include "free_rects.h"
 
-static void
+void
 emplace_float(UNUSED_ARG(const enum layout_command command),
               UNUSED_ARG(const struct layout_op *arg),
               UNUSED_ARG(struct weston_view *v), UNUSED_ARG(struct layout *l),
@@ -47,18 +50,149 @@ emplace_noop(UNUSED_ARG(const enum layout_command command),
 ////////////////////////////////////////////////////////////////////////////////
 
 
+/* the free space of an output, built again from the views there whenever they
+ * are not where it was built from, which the digest tells */
+struct floating_output {
+	struct weston_output *o;
+	struct free_rects space;
+	uint64_t digest;
+};
+
+struct floating_user_data {
+	vector_t outputs;
+};
+
+static void
+_free_floating_output(void *data)
+{
+	struct floating_output *output = data;
+	free_rects_release(&output->space);
+}
+
 void
 floating_layout_init(struct layout *layout, struct weston_layer *layer)
 {
+	struct floating_user_data *user_data;
+
 	layout_init(layout, layer);
 	layout->command = emplace_float;
+	layout->user_data = tw_zalloc(TW_MEM_LAYOUT,
+	                              sizeof(struct floating_user_data));
+	user_data = layout->user_data;
+	vector_init(&user_data->outputs, sizeof(struct floating_output),
+	            _free_floating_output);
 }
 
 void floating_layout_end(struct layout *layout)
 {
+	struct floating_user_data *user_data = layout->user_data;
+	vector_destroy(&user_data->outputs);
+	tw_free(user_data);
 	layout_release(layout);
 }
 
+void
+floating_rm_output(struct layout *l, struct weston_output *o)
+{
+	struct floating_user_data *user_data = l->user_data;
+	vector_t *v = &user_data->outputs;
+	for (int i = 0; i < v->len; i++) {
+		struct floating_output *output = vector_at(v, i);
+		if (output->o == o) {
+			vector_erase(v, i);
+			return;
+		}
+	}
+}
+
+static struct floating_output *
+floating_output_find(struct layout *l, struct weston_output *o)
+{
+	struct floating_user_data *user_data = l->user_data;
+	vector_t *v = &user_data->outputs;
+	struct floating_output *output;
+
+	for (int i = 0; i < v->len; i++) {
+		output = vector_at(v, i);
+		if (output->o == o)
+			return output;
+	}
+	output = vector_newelem(v);
+	output->o = o;
+	output->digest = 0;
+	free_rects_init(&output->space);
+	//nothing matches it, the first placement builds it
+	output->space.area.width = -1;
+	return output;
+}
+
+static inline uint64_t
+floating_geometry_hash(const struct weston_geometry *geo)
+{
+	uint64_t h = (uint32_t)geo->x | (uint64_t)(uint32_t)geo->y << 32;
+	h ^= ((uint64_t)(uint32_t)geo->width |
+	      (uint64_t)(uint32_t)geo->height << 32) * 0x9e3779b97f4a7c15ull;
+	h ^= h >> 29;
+	return h * 0xbf58476d1ce4e5b9ull;
+}
+
+/* where a floating view is on screen, with the size it committed last */
+static struct weston_geometry
+floating_view_geometry(struct weston_view *v)
+{
+	struct weston_desktop_surface *desk_surf =
+		weston_surface_get_desktop_surface(v->surface);
+	struct recent_view *rv = get_recent_view(v);
+	struct weston_geometry geo =
+		weston_desktop_surface_get_geometry(desk_surf);
+	float x, y;
+
+	recent_view_get_origin_coord(rv, &x, &y);
+	if (geo.width <= 0 || geo.height <= 0) {
+		geo.width = rv->visible_geometry.width;
+		geo.height = rv->visible_geometry.height;
+	}
+	geo.x = (int32_t)x;
+	geo.y = (int32_t)y;
+	return geo;
+}
+
+/* the free space of the output for placing v, the views which moved, went
+ * away or changed their sizes since the last placement make it start over,
+ * otherwise it is up to date already. The digest is a sum so the order of
+ * the views does not count */
+static struct floating_output *
+floating_output_space(struct layout *l, struct weston_view *v,
+                      const struct weston_geometry *area, int *count)
+{
+	struct floating_output *output = floating_output_find(l, v->output);
+	struct weston_view *view;
+	uint64_t digest = 0;
+
+	*count = 0;
+	wl_list_for_each(view, &l->layer->view_list.link, layer_link.link) {
+		struct weston_geometry geo;
+		if (view == v || view->output != v->output)
+			continue;
+		geo = floating_view_geometry(view);
+		digest += floating_geometry_hash(&geo);
+		(*count)++;
+	}
+	if (digest == output->digest &&
+	    !memcmp(area, &output->space.area, sizeof(*area)))
+		return output;
+
+	free_rects_reset(&output->space, area);
+	wl_list_for_each(view, &l->layer->view_list.link, layer_link.link) {
+		struct weston_geometry geo;
+		if (view == v || view->output != v->output)
+			continue;
+		geo = floating_view_geometry(view);
+		free_rects_occupy(&output->space, &geo);
+	}
+	output->digest = digest;
+	return output;
+}
 
 static void
 floating_add(UNUSED_ARG(const enum layout_command command),
@@ -66,23 +200,51 @@ floating_add(UNUSED_ARG(const enum layout_command command),
              UNUSED_ARG(struct weston_view *v), UNUSED_ARG(struct layout *l),
              struct layout_op *ops)
 {
-	struct weston_geometry geo = {
+	struct weston_geometry area = {
 		v->output->x, v->output->y,
 		v->output->width, v->output->height,
 	};
+	struct weston_geometry geo = get_recent_view(v)->visible_geometry;
+	struct floating_output *output;
+	int count;
+
+	ops[0].size.width = 0;
+	ops[0].size.height = 0;
 	if (arg->default_geometry.width != -1 &&
 	    arg->default_geometry.height != -1) {
 		ops[0].pos.x = arg->default_geometry.x;
 		ops[0].pos.y = arg->default_geometry.y;
 		ops[0].size.width = arg->default_geometry.width;
 		ops[0].size.height = arg->default_geometry.height;
-	} else {
-		ops[0].pos.x = rand() % (geo.width / 4);
-		ops[0].pos.y = rand() % (geo.height / 4);
-		//so this is invalid size
-		ops[0].size.width = 0;
-		ops[0].size.height = 0;
+		goto out;
+	}
+	//before the first commit there is no size yet, the client picks its
+	//own, so we make room for a guess and leave the size to it
+	if (geo.width <= 0 || geo.height <= 0) {
+		geo.width = area.width / 2;
+		geo.height = area.height / 2;
+	}
+	geo.width = MIN(geo.width, area.width);
+	geo.height = MIN(geo.height, area.height);
+
+	output = floating_output_space(l, v, &area, &count);
+	if (!free_rects_find(&output->space, geo.width, geo.height,
+	                     &ops[0].pos)) {
+		//nowhere free, cascade from the top left corner
+		int32_t step = 32;
+		int32_t room = MIN(area.width - geo.width,
+		                   area.height - geo.height) / step + 1;
+		ops[0].pos.x = area.x + step * (count % room);
+		ops[0].pos.y = area.y + step * (count % room);
 	}
+	//v has its place now, until it commits another size
+	geo.x = ops[0].pos.x;
+	geo.y = ops[0].pos.y;
+	if (free_rects_occupy(&output->space, &geo))
+		output->digest += floating_geometry_hash(&geo);
+	else
+		output->space.area.width = -1;
+out:
 	assert(!ops[0].end);
 	ops[0].end = false;
 	ops[0].v = v;
@@ -115,15 +277,18 @@ floating_resize(UNUSED_ARG(const enum layout_command command),
                 UNUSED_ARG(struct weston_view *v), UNUSED_ARG(struct layout *l),
                 struct layout_op *ops)
 {
-	struct weston_geometry visible = get_recent_view(v)->visible_geometry;
+	struct recent_view *rv = get_recent_view(v);
+	struct weston_geometry visible = rv->visible_geometry;
+	float x, y;
+	//where it is going, the last resize may not have landed yet
+	recent_view_get_origin_coord(rv, &x, &y);
 	struct weston_geometry buttom_right = {
-		.x = v->geometry.x + visible.x + visible.width,
-		.y = v->geometry.y + visible.y + visible.height,
+		.x = x + visible.width,
+		.y = y + visible.height,
 	};
 	//set position unchanged
-	//we are adding visible.xy here because we will subtract
-	ops[0].pos.x = v->geometry.x + visible.x;
-	ops[0].pos.y = v->geometry.y + visible.y;
+	ops[0].pos.x = x;
+	ops[0].pos.y = y;
 	ops[0].v = v;
 	ops[0].end = false;
 
@@ -164,6 +329,11 @@ emplace_float(const enum layout_command command, const struct layout_op *arg,
 		{DPSR_hsplit, emplace_noop},
 		{DPSR_merge, emplace_noop},
 		{DPSR_output_resize, emplace_noop},
+		{DPSR_undo, emplace_noop},
+		{DPSR_redo, emplace_noop},
+		{DPSR_tabbed, emplace_noop},
+		{DPSR_stacked, emplace_noop},
+		{DPSR_swap, emplace_noop},
 	};
 	assert(float_ops[command].command == command);
 	float_ops[command].fun(command, arg, v, l, ops);
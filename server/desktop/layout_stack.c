@@ -0,0 +1,360 @@
+/*
+ * layout_stack.c - taiwins desktop master, grid and monocle layouts
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <ctypes/helpers.h>
+#include "layout.h"
+
+/* The single pass engines of the tiling layer. The only state they keep about
+ * the views is the order they came in, every arrangement brings it up to date
+ * with the layer, then walks it once to count the views of the output, once
+ * more to place them. The layer itself is in focus order, which changes on
+ * every focus while the engines only arrange on add, del and resize, so a
+ * window keeps its slot until an other one comes or goes. The first one is
+ * the master, the ones already there when the engine is picked come in focus
+ * order.
+ *
+ * The outputs are the ones of the tiling layout, it keeps them for all the
+ * engines.
+ */
+
+#define STACK_MIN_PORTION 0.1f
+#define STACK_MAX_PORTION 0.9f
+
+struct stack_area {
+	struct weston_geometry geo;
+	int32_t gap;
+};
+
+typedef void (*stack_place_t)(const struct layout *l,
+                              const struct stack_area *area, int i, int n,
+                              struct weston_geometry *geo);
+
+static void
+emplace_noop(UNUSED_ARG(const enum layout_command command),
+             UNUSED_ARG(const struct layout_op *arg),
+             UNUSED_ARG(struct weston_view *v), UNUSED_ARG(struct layout *l),
+             struct layout_op *ops)
+{
+	ops[0].end = true;
+}
+
+static bool
+stack_area_get(struct layout *l, struct weston_output *o,
+               struct stack_area *area)
+{
+	struct tw_output output;
+
+	if (!o || !tiling_output_area(l, o, &output))
+		return false;
+	area->gap = output.inner_gap;
+	area->geo = output.desktop_area;
+	area->geo.x += output.outer_gap;
+	area->geo.y += output.outer_gap;
+	area->geo.width = MAX(1, area->geo.width - 2 * (int)output.outer_gap);
+	area->geo.height = MAX(1, area->geo.height - 2 * (int)output.outer_gap);
+	return true;
+}
+
+/* the ith of n cells along a line of length len with gaps between, the gaps
+ * go first when there is no room */
+static inline void
+stack_split(int32_t start, int32_t len, int32_t gap, int i, int n,
+            int32_t *pos, int32_t *size)
+{
+	int64_t span;
+
+	if (len - (n - 1) * gap < n)
+		gap = 0;
+	span = (int64_t)len + gap;
+	*pos = start + span * i / n;
+	*size = MAX(1, start + span * (i + 1) / n - gap - *pos);
+}
+
+static int
+stack_count(const struct layout *l, const struct weston_output *o,
+            const struct weston_view *skip)
+{
+	struct weston_view *v;
+	int n = 0;
+
+	wl_list_for_each(v, &l->layer->view_list.link, layer_link.link)
+		if (v->output == o && v != skip)
+			n++;
+	return n;
+}
+
+static bool
+stack_on_layer(const struct layout *l, const struct weston_view *view)
+{
+	struct weston_view *v;
+
+	wl_list_for_each(v, &l->layer->view_list.link, layer_link.link)
+		if (v == view)
+			return true;
+	return false;
+}
+
+static bool
+stack_ordered(const struct layout *l, const struct weston_view *view)
+{
+	struct weston_view **p;
+
+	wl_array_for_each(p, &l->stack.order)
+		if (*p == view)
+			return true;
+	return false;
+}
+
+/* the ones gone from the layer and skip leave the order, the ones it missed,
+ * new or there before the engine, go to its end */
+static void
+stack_order_update(struct layout *l, const struct weston_view *skip)
+{
+	struct weston_view **views = l->stack.order.data, **p, *v;
+	size_t n = 0;
+
+	for (size_t i = 0; i < l->stack.order.size / sizeof(*views); i++)
+		if (views[i] != skip && stack_on_layer(l, views[i]))
+			views[n++] = views[i];
+	l->stack.order.size = n * sizeof(*views);
+	wl_list_for_each(v, &l->layer->view_list.link, layer_link.link) {
+		if (v == skip || stack_ordered(l, v))
+			continue;
+		p = wl_array_add(&l->stack.order, sizeof(*p));
+		if (!p)
+			return;
+		*p = v;
+	}
+}
+
+/* skip is the view being removed, it is still on the layer */
+static void
+stack_arrange(struct layout *l, struct weston_output *o,
+              const struct weston_view *skip, stack_place_t place,
+              struct layout_op *ops)
+{
+	struct weston_view **p;
+	struct stack_area area;
+	int i = 0, n = 0;
+
+	if (!stack_area_get(l, o, &area)) {
+		ops[0].end = true;
+		return;
+	}
+	stack_order_update(l, skip);
+	wl_array_for_each(p, &l->stack.order)
+		n += (*p)->output == o;
+	wl_array_for_each(p, &l->stack.order) {
+		struct weston_geometry geo;
+
+		if ((*p)->output != o)
+			continue;
+		place(l, &area, i, n, &geo);
+		ops[i].v = *p;
+		ops[i].pos.x = geo.x;
+		ops[i].pos.y = geo.y;
+		ops[i].size.width = geo.width;
+		ops[i].size.height = geo.height;
+		ops[i].end = false;
+		i++;
+	}
+	ops[i].end = true;
+}
+
+/*******************************************************************************
+ * master stack
+ ******************************************************************************/
+
+static void
+master_place(const struct layout *l, const struct stack_area *area, int i,
+             int n, struct weston_geometry *geo)
+{
+	const struct weston_geometry *space = &area->geo;
+	int masters = MIN(MAX(l->stack.masters, 1), n);
+	int32_t master_width = (n > masters) ?
+		(space->width - area->gap) * l->stack.master_portion :
+		space->width;
+
+	geo->x = space->x;
+	geo->width = master_width;
+	if (i < masters) {
+		stack_split(space->y, space->height, area->gap, i, masters,
+		            &geo->y, &geo->height);
+		return;
+	}
+	geo->x = space->x + master_width + area->gap;
+	geo->width = MAX(1, space->x + space->width - geo->x);
+	stack_split(space->y, space->height, area->gap, i - masters,
+	            n - masters, &geo->y, &geo->height);
+}
+
+/* the boundary between the master and the stack follows the pointer */
+static void
+master_resize(const struct layout_op *arg, struct weston_view *v,
+              struct layout *l, struct layout_op *ops)
+{
+	struct stack_area area;
+	float portion;
+
+	if (!stack_area_get(l, v->output, &area)) {
+		ops[0].end = true;
+		return;
+	}
+	portion = l->stack.master_portion + arg->dx / area.geo.width;
+	l->stack.master_portion = MIN(MAX(portion, STACK_MIN_PORTION),
+	                              STACK_MAX_PORTION);
+	stack_arrange(l, v->output, NULL, master_place, ops);
+}
+
+void
+emplace_master(const enum layout_command command, const struct layout_op *arg,
+               struct weston_view *v, struct layout *l,
+               struct layout_op *ops)
+{
+	int n;
+
+	switch (command) {
+	case DPSR_add:
+		stack_arrange(l, v->output, NULL, master_place, ops);
+		break;
+	case DPSR_del:
+		stack_arrange(l, v->output, v, master_place, ops);
+		break;
+	case DPSR_resize:
+		master_resize(arg, v, l, ops);
+		break;
+	//more or less views in the master column, never more than there are
+	case DPSR_vsplit:
+		n = MAX(stack_count(l, v->output, NULL), 1);
+		l->stack.masters = MIN(l->stack.masters + 1, n);
+		stack_arrange(l, v->output, NULL, master_place, ops);
+		break;
+	case DPSR_merge:
+		n = MAX(stack_count(l, v->output, NULL), 1);
+		l->stack.masters = MAX(MIN(l->stack.masters, n) - 1, 1);
+		stack_arrange(l, v->output, NULL, master_place, ops);
+		break;
+	case DPSR_output_resize:
+		stack_arrange(l, arg->o, NULL, master_place, ops);
+		break;
+	default:
+		emplace_noop(command, arg, v, l, ops);
+		break;
+	}
+}
+
+/*******************************************************************************
+ * grid
+ ******************************************************************************/
+
+static void
+grid_place(UNUSED_ARG(const struct layout *l), const struct stack_area *area,
+           int i, int n, struct weston_geometry *geo)
+{
+	int cols = 1, rows, row, col, in_row;
+
+	while (cols * cols < n)
+		cols++;
+	rows = (n + cols - 1) / cols;
+	row = i / cols;
+	col = i % cols;
+	//the last row is short, its views get wider
+	in_row = (row == rows - 1) ? n - row * cols : cols;
+
+	stack_split(area->geo.x, area->geo.width, area->gap, col, in_row,
+	            &geo->x, &geo->width);
+	stack_split(area->geo.y, area->geo.height, area->gap, row, rows,
+	            &geo->y, &geo->height);
+}
+
+void
+emplace_grid(const enum layout_command command, const struct layout_op *arg,
+             struct weston_view *v, struct layout *l,
+             struct layout_op *ops)
+{
+	switch (command) {
+	case DPSR_add:
+		stack_arrange(l, v->output, NULL, grid_place, ops);
+		break;
+	case DPSR_del:
+		stack_arrange(l, v->output, v, grid_place, ops);
+		break;
+	case DPSR_output_resize:
+		stack_arrange(l, arg->o, NULL, grid_place, ops);
+		break;
+	default:
+		emplace_noop(command, arg, v, l, ops);
+		break;
+	}
+}
+
+/*******************************************************************************
+ * monocle
+ ******************************************************************************/
+
+static void
+monocle_place(UNUSED_ARG(const struct layout *l),
+              const struct stack_area *area, UNUSED_ARG(int i),
+              UNUSED_ARG(int n), struct weston_geometry *geo)
+{
+	*geo = area->geo;
+}
+
+/* the others already cover the output */
+static void
+monocle_add(struct weston_view *v, struct layout *l, struct layout_op *ops)
+{
+	struct stack_area area;
+
+	ops[0].end = true;
+	if (!stack_area_get(l, v->output, &area))
+		return;
+	ops[0].v = v;
+	ops[0].pos.x = area.geo.x;
+	ops[0].pos.y = area.geo.y;
+	ops[0].size.width = area.geo.width;
+	ops[0].size.height = area.geo.height;
+	ops[0].end = false;
+	ops[1].end = true;
+}
+
+void
+emplace_monocle(const enum layout_command command,
+                const struct layout_op *arg,
+                struct weston_view *v, struct layout *l,
+                struct layout_op *ops)
+{
+	switch (command) {
+	case DPSR_add:
+		monocle_add(v, l, ops);
+		break;
+	case DPSR_del:
+		ops[0].end = true;
+		break;
+	case DPSR_output_resize:
+		stack_arrange(l, arg->o, NULL, monocle_place, ops);
+		break;
+	default:
+		emplace_noop(command, arg, v, l, ops);
+		break;
+	}
+}
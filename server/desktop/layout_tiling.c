@@ -24,8 +24,10 @@
 #include <ctypes/helpers.h>
 #include <ctypes/sequential.h>
 #include <ctypes/tree.h>
+#include <alloc.h>
 #include "workspace.h"
 #include "layout.h"
+#include "layout_constraint.h"
 
 static void
 emplace_noop(UNUSED_ARG(const enum layout_command command),
@@ -46,15 +48,33 @@ emplace_tiling(const enum layout_command command, const struct layout_op *arg,
  * tiling lyaout
  ******************************************************************************/
 
+/* a tabbed or stacked container gives all its space to one child, the others
+ * are kept at the same size but hidden, so bringing one up configures nothing.
+ * Without decorations of our own the two look the same, the type is kept for
+ * the ones to come. The portions of the children are kept for the split */
+enum tiling_container {
+	TILING_SPLIT = 0,
+	TILING_TABBED = 1,
+	TILING_STACKED = 2,
+};
+
 struct tiling_output;
 struct tiling_view {
 	//vertical split or horizental split
 	bool vertical;
+	enum tiling_container container;
+	//the child shown by a tabbed container, the first one if NULL
+	struct tiling_view *tab;
 	float portion;
 	//the interval is updated when inserting/deleting/resizing
 	float interval[2];
+	//what the clients in the subtree take, with the gaps, 0 for no limit.
+	//Updated before a subtree is laid out
+	struct weston_size min, max;
 	//you can check empty by view or check the size of the node
 	struct weston_view *v;
+	//a leaf of a restored session, waiting for its view. It has no view
+	uint32_t placeholder;
 	struct weston_output *output;
 	struct vtree_node node;
 	//we have 32 layers of split
@@ -73,16 +93,65 @@ struct tiling_output {
 	struct weston_geometry curr_geo;
 };
 
+/* undo history. An entry does not keep the tree, only the nodes a command is
+ * going to touch, found again by their coding. A shallow frame is a node with
+ * the portions of its children, which is all toggle and resize change. A deep
+ * frame is a whole subtree, for split and merge which change the shape.
+ */
+#define TILING_HISTORY 32
+
+struct tiling_record {
+	struct weston_view *v;
+	uint32_t placeholder;
+	float portion;
+	bool vertical;
+	enum tiling_container container;
+	int tab; //index of the child, -1 for none
+	int nchildren;
+};
+
+struct tiling_frame {
+	int8_t coding[32];
+	int8_t level;
+	bool deep;
+	bool vertical;
+	enum tiling_container container;
+	int tab;
+	struct weston_view *v;
+	int nchildren;
+	//children for shallow frames, all the subtree in preorder for deep ones
+	int len;
+	struct tiling_record *records;
+};
+
+struct tiling_history {
+	struct weston_output *output;
+	int len;
+	struct tiling_frame frames[];
+};
+
 struct tiling_user_data {
 	vector_t outputs;
 	//the floating layout which is on
 	struct layout *floating;
+	//the last one on top
+	struct tiling_history *undo[TILING_HISTORY];
+	struct tiling_history *redo[TILING_HISTORY];
+	int nundo, nredo;
+	//a drag resizes many times, only the first one is recorded
+	struct weston_view *resizing;
 };
 
+static void
+tiling_history_forget(struct tiling_user_data *user_data,
+                      const struct weston_output *o,
+                      const struct weston_view *v);
+
 static inline struct tiling_view *
 tiling_new_view(struct weston_view *v)
 {
-	struct tiling_view *tv = zalloc(sizeof(struct tiling_view));
+	struct tiling_view *tv =
+		tw_zalloc(TW_MEM_LAYOUT, sizeof(struct tiling_view));
 	vtree_node_init(&tv->node,
 			offsetof(struct tiling_view, node));
 	tv->v = v;
@@ -92,7 +161,7 @@ tiling_new_view(struct weston_view *v)
 static inline void
 tiling_free_view(struct tiling_view *v)
 {
-	free(v);
+	tw_free(v);
 }
 
 static void
@@ -101,7 +170,7 @@ _free_tiling_output_view(void *data)
 	struct tiling_view *view = data;
 	if (view->v)
 		weston_desktop_surface_unlink_view(view->v);
-	free(data);
+	tw_free(data);
 }
 
 static void
@@ -117,7 +186,8 @@ tiling_layout_init(struct layout *l, struct weston_layer *ly,
 {
 	layout_init(l, ly);
 
-	l->user_data = zalloc(sizeof(struct tiling_user_data));
+	l->user_data = tw_zalloc(TW_MEM_LAYOUT,
+	                          sizeof(struct tiling_user_data));
 	struct tiling_user_data *user_data =  l->user_data;
 	user_data->floating = floating;
 
@@ -131,9 +201,10 @@ void
 tiling_layout_end(struct layout *l)
 {
 	struct tiling_user_data *user_data =  l->user_data;
+	tiling_history_forget(user_data, NULL, NULL);
 	layout_release(l);
 	vector_destroy(&user_data->outputs);
-	free(user_data);
+	tw_free(user_data);
 }
 
 /****************************************************************
@@ -164,6 +235,7 @@ tiling_rm_output(struct layout *l, struct weston_output *o)
 {
 	struct tiling_user_data *user_data =  l->user_data;
 
+	tiling_history_forget(user_data, o, NULL);
 	for (int i = 0; i < user_data->outputs.len; i++) {
 		struct tiling_output *to = vector_at(&user_data->outputs, i);
 		if (to->o == o)
@@ -193,6 +265,21 @@ tiling_resize_output(struct layout *l, struct tw_output *o)
 	output->outer_gap = o->outer_gap;
 }
 
+bool
+tiling_output_area(struct layout *l, struct weston_output *o,
+                   struct tw_output *area)
+{
+	struct tiling_output *output = tiling_output_find(l, o);
+
+	if (!output)
+		return false;
+	area->output = o;
+	area->desktop_area = output->curr_geo;
+	area->inner_gap = output->inner_gap;
+	area->outer_gap = output->outer_gap;
+	return true;
+}
+
 /**************************************************************
  * tiling view tree operations
  *************************************************************/
@@ -204,6 +291,57 @@ tiling_view_ith_node(struct tiling_view *parent, off_t index)
 		node);
 }
 
+static inline struct tiling_view *
+tiling_view_parent(struct tiling_view *tv)
+{
+	return tv->node.parent ?
+		container_of(tv->node.parent, struct tiling_view, node) : NULL;
+}
+
+static inline bool
+tiling_is_tabbed(const struct tiling_view *tv)
+{
+	return tv->container != TILING_SPLIT;
+}
+
+static inline struct tiling_view *
+tiling_shown_tab(struct tiling_view *parent)
+{
+	if (parent->tab)
+		return parent->tab;
+	return parent->node.children.len ?
+		tiling_view_ith_node(parent, 0) : NULL;
+}
+
+static inline int
+tiling_tab_index(const struct tiling_view *parent)
+{
+	return parent->tab ? parent->tab->coding[parent->tab->level-1] : -1;
+}
+
+/* behind an other tab, anywhere up the tree */
+static bool
+tiling_view_hidden(struct tiling_view *tv)
+{
+	struct tiling_view *parent;
+
+	for (; (parent = tiling_view_parent(tv)); tv = parent)
+		if (tiling_is_tabbed(parent) && tiling_shown_tab(parent) != tv)
+			return true;
+	return false;
+}
+
+static bool
+tiling_subtree_empty(struct tiling_view *tv)
+{
+	if (tv->v)
+		return false;
+	for (int i = 0; i < tv->node.children.len; i++)
+		if (!tiling_subtree_empty(tiling_view_ith_node(tv, i)))
+			return false;
+	return true;
+}
+
 static int
 cmp_views(const void *v, const struct vtree_node *n)
 {
@@ -212,12 +350,24 @@ cmp_views(const void *v, const struct vtree_node *n)
 	return (v == tv->v) ? 0 : -1;
 }
 
+//the given placeholder, or any of them for 0
+static int
+cmp_placeholders(const void *placeholder, const struct vtree_node *n)
+{
+	const struct tiling_view *tv =
+		container_of(n, const struct tiling_view, node);
+	uint32_t want = *(const uint32_t *)placeholder;
+	return (tv->placeholder && (!want || want == tv->placeholder)) ?
+		0 : -1;
+}
+
 static struct tiling_view *
 tiling_view_find(struct tiling_view *root, struct weston_view *v)
 {
 	struct vtree_node *tnode = vtree_search(&root->node, v,
 						cmp_views);
-	return container_of(tnode, struct tiling_view, node);
+	//views the tree had no room for are not in it
+	return tnode ? container_of(tnode, struct tiling_view, node) : NULL;
 }
 
 static inline struct weston_geometry
@@ -290,7 +440,8 @@ tiling_view_insert(struct tiling_view *parent,
 	double occupied = 1.0 - (double)parent->node.children.len /
 		((double)parent->node.children.len+1);
 	double occupied_rest = 1.0 - occupied;
-	{
+	//the tabs do not share the space, there is room for any number of them
+	if (!tiling_is_tabbed(parent)) {
 		//test possibility of insert
 		size_t len = parent->node.children.len;
 		float portions[len+1];
@@ -319,6 +470,9 @@ tiling_view_insert(struct tiling_view *parent,
 	tv->output = parent->output;
 	tv->vertical = parent->vertical;
 	vtree_node_insert(&parent->node, &tv->node, offset);
+	//a new tab comes up
+	if (tiling_is_tabbed(parent))
+		parent->tab = tv;
 
 	//update the subtree
 	tiling_update_children(parent);
@@ -338,10 +492,18 @@ tiling_view_erase(struct tiling_view *view)
 	struct tiling_view *parent = view->node.parent ?
 		container_of(view->node.parent, struct tiling_view, node) :
 		NULL;
+	bool shown = parent && parent->tab == view;
 	vtree_node_remove(view->node.parent, index);
 	tiling_free_view(view);
 	if (!parent)
 		return NULL;
+	//the next tab comes up, or the previous one for the last
+	if (shown)
+		parent->tab = parent->node.children.len ?
+			tiling_view_ith_node(parent,
+			                     MIN(index,
+			                         parent->node.children.len-1)) :
+			NULL;
 	//updating children info
 	float leading = 0.0;
 	for (int i = 0; i < parent->node.children.len; i++) {
@@ -379,8 +541,9 @@ tiling_view_resize(struct tiling_view *view,
 	struct tiling_view *parent = view->node.parent ?
 		container_of(view->node.parent, struct tiling_view, node) :
 		NULL;
-	//I am the only node
-	if (!parent || parent->node.children.len <= 1)
+	//I am the only node, or the tabs all have the space of the container
+	if (!parent || parent->node.children.len <= 1 ||
+	    tiling_is_tabbed(parent))
 		return false;
 	//deal with delta_tail, delta_head
 	if (view->coding[view->level-1] == parent->node.children.len-1)
@@ -411,6 +574,19 @@ tiling_view_resize(struct tiling_view *view,
 	if (!is_subtree_valid(parent_geo, parent->vertical, portions,
 			      parent->node.children.len, output))
 		return false;
+	//nobody is pushed further past its limits, the layout would not follow
+	//but the portions would be gone
+	for (int i = 0; i < parent->node.children.len; i++) {
+		struct tiling_view *tv = tiling_view_ith_node(parent, i);
+		int32_t size = portions[i] * (parent->vertical ?
+		                              parent_geo->height :
+		                              parent_geo->width);
+		int32_t min = parent->vertical ? tv->min.height : tv->min.width;
+		int32_t max = parent->vertical ? tv->max.height : tv->max.width;
+		if ((portions[i] < tv->portion && size < min) ||
+		    (portions[i] > tv->portion && max && size > max))
+			return false;
+	}
 
 	for (int i = 0; i < parent->node.children.len; i++) {
 		struct tiling_view *tv = tiling_view_ith_node(parent, i);
@@ -433,17 +609,121 @@ tiling_view_shift(struct tiling_view *view, bool forward)
 		                       vtree_container(view->node.parent));
 }
 
+/* the size limits of a leaf come from its client, plus the gaps around it */
+static void
+tiling_view_limits(struct tiling_view *tv, const struct tiling_output *o)
+{
+	struct weston_desktop_surface *desk_surf;
+	struct weston_size min, max;
+	int32_t gap_w = 2 * (tv->vertical ? o->outer_gap : o->inner_gap);
+	int32_t gap_h = 2 * (tv->vertical ? o->inner_gap : o->outer_gap);
+
+	if (!tv->v->surface ||
+	    !weston_surface_is_desktop_surface(tv->v->surface))
+		return;
+	desk_surf = weston_surface_get_desktop_surface(tv->v->surface);
+	min = weston_desktop_surface_get_min_size(desk_surf);
+	max = weston_desktop_surface_get_max_size(desk_surf);
+	tv->min.width = (min.width > 0) ? min.width + gap_w : 0;
+	tv->min.height = (min.height > 0) ? min.height + gap_h : 0;
+	tv->max.width = (max.width > 0) ? max.width + gap_w : 0;
+	tv->max.height = (max.height > 0) ? max.height + gap_h : 0;
+}
+
+/**
+ * /brief update the size limits of a subtree, bottom up
+ *
+ * A split adds up the limits of its children along the split, it has a max
+ * only if all of them have one. Across the split it takes the largest min, a
+ * child with a max leaves the rest empty. The tabs have the largest min of
+ * them and no max, the shown one would leave the rest empty.
+ */
+static void
+tiling_subtree_limits(struct tiling_view *tv, const struct tiling_output *o)
+{
+	bool bounded = tv->node.children.len > 0;
+	int32_t *min_along = tv->vertical ? &tv->min.height : &tv->min.width;
+	int32_t *min_across = tv->vertical ? &tv->min.width : &tv->min.height;
+	int32_t *max_along = tv->vertical ? &tv->max.height : &tv->max.width;
+
+	tv->min = (struct weston_size){0, 0};
+	tv->max = (struct weston_size){0, 0};
+	if (tv->v) {
+		tiling_view_limits(tv, o);
+		return;
+	}
+	for (int i = 0; i < tv->node.children.len; i++) {
+		struct tiling_view *sv = tiling_view_ith_node(tv, i);
+
+		tiling_subtree_limits(sv, o);
+		if (tiling_is_tabbed(tv)) {
+			tv->min.width = MAX(tv->min.width, sv->min.width);
+			tv->min.height = MAX(tv->min.height, sv->min.height);
+			continue;
+		}
+		*min_along += tv->vertical ? sv->min.height : sv->min.width;
+		*min_across = MAX(*min_across, tv->vertical ?
+		                  sv->min.width : sv->min.height);
+		*max_along += tv->vertical ? sv->max.height : sv->max.width;
+		bounded = bounded &&
+			(tv->vertical ? sv->max.height : sv->max.width);
+	}
+	if (!bounded || tiling_is_tabbed(tv))
+		*max_along = 0;
+}
+
+/**
+ * /brief the space of every child of a split
+ *
+ * The portions are followed as far as the limits of the children let them, so
+ * no client is configured to a size it would refuse. The limits have to be up
+ * to date.
+ */
+static void
+tiling_split_divide(struct tiling_view *split,
+                    const struct weston_geometry *space,
+                    struct weston_geometry *spaces)
+{
+	int len = split->node.children.len;
+	struct layout_span spans[len];
+	int32_t offset = 0;
+
+	for (int i = 0; i < len; i++) {
+		struct tiling_view *sv = tiling_view_ith_node(split, i);
+		spans[i] = (struct layout_span){
+			.min = split->vertical ? sv->min.height : sv->min.width,
+			.max = split->vertical ? sv->max.height : sv->max.width,
+			.portion = sv->interval[1] - sv->interval[0],
+		};
+	}
+	layout_span_solve(spans, len, split->vertical ?
+	                  space->height : space->width);
+	for (int i = 0; i < len; i++) {
+		spaces[i] = *space;
+		if (split->vertical) {
+			spaces[i].y += offset;
+			spaces[i].height = spans[i].size;
+		} else {
+			spaces[i].x += offset;
+			spaces[i].width = spans[i].size;
+		}
+		offset += spans[i].size;
+	}
+}
+
 /**
  * /brief dividing a space of subtree from its parent
  */
 static struct weston_geometry
 tiling_subtree_space(struct tiling_view *v,
                      struct tiling_view *root,
-                     const struct weston_geometry *space)
+                     const struct weston_geometry *space,
+                     const struct tiling_output *o)
 {
 	struct tiling_view *subtree = root;
 	struct weston_geometry geo = *space;
 
+	tiling_subtree_limits(root, o);
 	//from 0 to level - 1
 	for (int i = root->level; i < v->level; i++) {
 		struct vtree_node *node =
@@ -451,12 +731,12 @@ tiling_subtree_space(struct tiling_view *v,
 					v->coding[i]);
 		struct tiling_view *n =
 			container_of(node, struct tiling_view, node);
-		if (subtree->vertical) {
-			geo.y = geo.y + geo.height * n->interval[0];
-			geo.height = n->portion * geo.height;
-		} else {
-			geo.x = geo.x + geo.width * n->interval[0];
-			geo.width = n->portion * geo.width;
+		//the same space for all the tabs
+		if (!tiling_is_tabbed(subtree)) {
+			struct weston_geometry
+				spaces[subtree->node.children.len];
+			tiling_split_divide(subtree, &geo, spaces);
+			geo = spaces[v->coding[i]];
 		}
 		subtree = n;
 	}
@@ -464,13 +744,20 @@ tiling_subtree_space(struct tiling_view *v,
 }
 
 static int
-tiling_arrange_subtree(struct tiling_view *subtree, struct weston_geometry *geo,
-                       struct layout_op *data_out,
-                       const struct tiling_output *o)
+_tiling_arrange_subtree(struct tiling_view *subtree,
+                        struct weston_geometry *geo,
+                        struct layout_op *data_out,
+                        const struct tiling_output *o, bool hidden)
 {
 	//leaf
 	if (subtree->v) {
+		//no more than the client takes, the rest stays empty
+		int32_t width = subtree->max.width ?
+			MIN(geo->width, subtree->max.width) : geo->width;
+		int32_t height = subtree->max.height ?
+			MIN(geo->height, subtree->max.height) : geo->height;
 		data_out->v = subtree->v;
+		data_out->hidden = hidden;
 		data_out->pos.x = geo->x + ((subtree->vertical) ?
 					    o->outer_gap :
 					    o->inner_gap);
@@ -478,35 +765,51 @@ tiling_arrange_subtree(struct tiling_view *subtree, struct weston_geometry *geo,
 					    o->inner_gap :
 					    o->outer_gap);
 		data_out->size.width =
-			geo->width - 2 * ((subtree->vertical) ?
-					  o->outer_gap :
-					  o->inner_gap);
+			width - 2 * ((subtree->vertical) ?
+				     o->outer_gap :
+				     o->inner_gap);
 		data_out->size.height =
-			geo->height - 2 * ((subtree->vertical) ?
-					   o->inner_gap :
-					   o->outer_gap);
+			height - 2 * ((subtree->vertical) ?
+				      o->inner_gap :
+				      o->outer_gap);
 		data_out->end = false;
 		return 1;
 	}
 	//internal node
 	int count = 0;
+	struct tiling_view *shown = tiling_is_tabbed(subtree) ?
+		tiling_shown_tab(subtree) : NULL;
+	struct weston_geometry spaces[subtree->node.children.len];
+	if (!shown)
+		tiling_split_divide(subtree, geo, spaces);
 	for (int i = 0; i < subtree->node.children.len; i++) {
 		struct vtree_node *node =
 			vtree_ith_child(&subtree->node, i);
 		struct tiling_view *n = container_of(node, struct tiling_view, node);
 
 		struct weston_geometry sub_space = *geo;
-		float portion = n->interval[1] - n->interval[0];
-		sub_space.x += (subtree->vertical) ? 0 : n->interval[0] * geo->width;
-		sub_space.width = (subtree->vertical) ? geo->width : portion * geo->width;
-		sub_space.y += (subtree->vertical) ? n->interval[0] * geo->height : 0;
-		sub_space.height = (subtree->vertical) ? portion * geo->height : geo->height;
-
-		count += tiling_arrange_subtree(n, &sub_space, &data_out[count], o);
+		if (shown) {
+			count += _tiling_arrange_subtree(n, &sub_space,
+			                                 &data_out[count], o,
+			                                 hidden || n != shown);
+			continue;
+		}
+		count += _tiling_arrange_subtree(n, &spaces[i],
+		                                 &data_out[count], o, hidden);
 	}
 	return count;
 }
 
+static inline int
+tiling_arrange_subtree(struct tiling_view *subtree, struct weston_geometry *geo,
+                       struct layout_op *data_out,
+                       const struct tiling_output *o)
+{
+	tiling_subtree_limits(subtree, o);
+	return _tiling_arrange_subtree(subtree, geo, data_out, o,
+	                               tiling_view_hidden(subtree));
+}
+
 static inline struct tiling_view *
 tiling_focused_view(struct layout *l)
 {
@@ -537,17 +840,226 @@ tiling_find_launch_point(struct layout *l, struct tiling_output *to)
 }
 
 
+void
+tiling_layout_rebuild(struct layout *l)
+{
+	struct tiling_user_data *user_data = l->user_data;
+	struct tiling_output *to;
+	struct tiling_view *tv;
+	struct weston_view *v;
+
+	//the codings in the history mean nothing to the new tree
+	tiling_history_forget(user_data, NULL, NULL);
+	for (int i = 0; i < user_data->outputs.len; i++) {
+		to = vector_at(&user_data->outputs, i);
+		vtree_destroy_children(&to->root->node, tw_free);
+		to->root->tab = NULL;
+	}
+	//bottom up, so the focused view ends up first like tiling_add does
+	wl_list_for_each_reverse(v, &l->layer->view_list.link,
+	                         layer_link.link) {
+		if (!(to = tiling_output_find(l, v->output)))
+			continue;
+		tv = tiling_new_view(v);
+		if (!tiling_view_insert(to->root, tv, 0, &to->curr_geo, to))
+			tiling_free_view(tv);
+	}
+}
+
+/*****************************************************************
+ * session
+ ****************************************************************/
+/* the children left out are not in the portions of the others */
+static int
+tiling_subtree_export(struct tiling_view *tv, struct tw_session_node *nodes,
+                      int max,
+                      int32_t (*slot_of)(struct weston_view *, uint32_t,
+                                         void *),
+                      void *data)
+{
+	int count = 1, kept = 0;
+	int children[tv->node.children.len+1];
+	float sum = 0.0;
+
+	if (max < 1)
+		return -1;
+	nodes[0] = (struct tw_session_node){
+		.slot = -1,
+		.vertical = tv->vertical,
+		.portion = tv->portion,
+		.container = tv->container,
+	};
+	if (tv->v || tv->placeholder) {
+		nodes[0].slot = slot_of(tv->v, tv->placeholder, data);
+		return nodes[0].slot >= 0 ? 1 : 0;
+	}
+	for (int i = 0; i < tv->node.children.len; i++) {
+		struct tiling_view *sv = tiling_view_ith_node(tv, i);
+		int n = tiling_subtree_export(sv, &nodes[count], max - count,
+		                              slot_of, data);
+		if (n < 0)
+			return -1;
+		if (!n)
+			continue;
+		children[kept++] = count;
+		sum += sv->portion;
+		count += n;
+	}
+	for (int i = 0; i < kept; i++)
+		nodes[children[i]].portion /= sum;
+	nodes[0].nchildren = kept;
+	//the root stays, even empty
+	return (kept || !tv->node.parent) ? count : 0;
+}
+
+int
+tiling_layout_save(struct layout *l, struct weston_output *o,
+                   struct tw_session_node *nodes, int max,
+                   int32_t (*slot_of)(struct weston_view *v,
+                                      uint32_t placeholder, void *data),
+                   void *data)
+{
+	struct tiling_output *to = tiling_output_find(l, o);
+
+	if (!to || l->command != emplace_tiling)
+		return 0;
+	return tiling_subtree_export(to->root, nodes, max, slot_of, data);
+}
+
+static bool
+tiling_subtree_import(struct tiling_view *parent,
+                      const struct tw_session_node *nodes, uint32_t len,
+                      uint32_t *pos)
+{
+	const struct tw_session_node *node = &nodes[*pos];
+
+	//the coding is an int8_t
+	if (node->nchildren > INT8_MAX || parent->level >= 31)
+		return false;
+	for (int i = 0; i < node->nchildren; i++) {
+		const struct tw_session_node *child;
+		struct tiling_view *tv;
+
+		if (++(*pos) >= len)
+			return false;
+		child = &nodes[*pos];
+		tv = tiling_new_view(NULL);
+		tv->placeholder = (child->slot >= 0) ? child->slot + 1 : 0;
+		tv->portion = child->portion;
+		tv->vertical = child->vertical;
+		tv->container = child->container;
+		tv->output = parent->output;
+		tv->level = parent->level + 1;
+		memcpy(tv->coding, parent->coding, sizeof(tv->coding));
+		tv->coding[tv->level-1] = i;
+		vtree_node_insert(&parent->node, &tv->node, i);
+		if (!tiling_subtree_import(tv, nodes, len, pos))
+			return false;
+	}
+	tiling_update_children(parent);
+	return true;
+}
+
+static int
+cmp_empty_split(UNUSED_ARG(const void *data), const struct vtree_node *n)
+{
+	const struct tiling_view *tv =
+		container_of(n, const struct tiling_view, node);
+	return (!tv->v && !tv->placeholder && !n->children.len && n->parent) ?
+		0 : -1;
+}
+
+bool
+tiling_layout_load(struct layout *l, struct weston_output *o,
+                   const struct tw_session_node *nodes, uint32_t len)
+{
+	struct tiling_output *to = tiling_output_find(l, o);
+	struct vtree_node *empty;
+	uint32_t pos = 0;
+
+	if (!to || !len || to->root->node.children.len ||
+	    l->command != emplace_tiling)
+		return false;
+	to->root->vertical = nodes[0].vertical;
+	to->root->container = nodes[0].container;
+	to->root->tab = NULL;
+	if (!tiling_subtree_import(to->root, nodes, len, &pos)) {
+		vtree_destroy_children(&to->root->node, tw_free);
+		to->root->container = TILING_SPLIT;
+		return false;
+	}
+	while ((empty = vtree_search(&to->root->node, NULL, cmp_empty_split)))
+		tiling_view_erase(container_of(empty, struct tiling_view,
+		                               node));
+	return true;
+}
+
+bool
+tiling_layout_drop_placeholders(struct layout *l)
+{
+	struct tiling_user_data *user_data = l->user_data;
+	const uint32_t any = 0;
+	struct vtree_node *node;
+	bool dropped = false;
+
+	for (int i = 0; i < user_data->outputs.len; i++) {
+		struct tiling_output *to = vector_at(&user_data->outputs, i);
+		while ((node = vtree_search(&to->root->node, &any,
+		                            cmp_placeholders))) {
+			tiling_view_erase(container_of(node, struct tiling_view,
+			                               node));
+			dropped = true;
+		}
+	}
+	return dropped;
+}
+
 /*****************************************************************
  * tiling apis
  ****************************************************************/
+/* a view coming back after a restart, it fills its placeholder and nothing
+ * else moves */
+static bool
+tiling_take_placeholder(struct tiling_output *to, struct weston_view *v,
+                        uint32_t placeholder, struct layout_op *ops)
+{
+	struct vtree_node *node = to ?
+		vtree_search(&to->root->node, &placeholder, cmp_placeholders) :
+		NULL;
+	struct tiling_view *tv, *parent;
+
+	if (!node)
+		return false;
+	tv = container_of(node, struct tiling_view, node);
+	parent = container_of(tv->node.parent, struct tiling_view, node);
+	tv->v = v;
+	tv->placeholder = 0;
+	tv->vertical = parent->vertical;
+	//a tab with nothing in it yet gives its place to the first one back
+	for (struct tiling_view *c = tv; (parent = tiling_view_parent(c));
+	     c = parent)
+		if (tiling_is_tabbed(parent) && tiling_shown_tab(parent) != c &&
+		    tiling_subtree_empty(tiling_shown_tab(parent)))
+			parent->tab = c;
+
+	struct weston_geometry space =
+		tiling_subtree_space(tv, to->root, &to->curr_geo, to);
+	int count = tiling_arrange_subtree(tv, &space, ops, to);
+	ops[count].end = true;
+	return true;
+}
+
 static void
 tiling_add(UNUSED_ARG(const enum layout_command command),
-           UNUSED_ARG(const struct layout_op *arg),
+           const struct layout_op *arg,
 	   struct weston_view *v, struct layout *l,
 	   struct layout_op *ops)
 {
 	//insert view based on lasted focused view
 	struct tiling_output *to = tiling_output_find(l, v->output);
+	if (arg->placeholder &&
+	    tiling_take_placeholder(to, v, arg->placeholder, ops))
+		return;
 	//TODO remove this hack: because v is already in the layer link, we need
 	//to temporarily remove it to get the correct result
 	weston_layer_entry_remove(&v->layer_link);
@@ -556,7 +1068,8 @@ tiling_add(UNUSED_ARG(const enum layout_command command),
 	struct tiling_output *tiling_output = tiling_output_find(l, pv->output);
 	struct tiling_view *root = tiling_output->root;
 	struct weston_geometry space =
-		tiling_subtree_space(pv, root, &tiling_output->curr_geo);
+		tiling_subtree_space(pv, root, &tiling_output->curr_geo,
+		                     tiling_output);
 
 	struct tiling_view *new_view = tiling_new_view(v);
 	//we could fail to insert
@@ -584,7 +1097,8 @@ tiling_del(UNUSED_ARG(const enum layout_command command),
 	if (parent) {
 		struct weston_geometry space =
 			tiling_subtree_space(parent, tiling_output->root,
-					     &tiling_output->curr_geo);
+					     &tiling_output->curr_geo,
+					     tiling_output);
 		int count = tiling_arrange_subtree(parent, &space,
 		                                   ops, tiling_output);
 		ops[count].end = true;
@@ -603,9 +1117,10 @@ _tiling_resize(const struct layout_op *arg, struct tiling_view *view,
 						  struct tiling_view, node);
 	struct weston_geometry space =
 		tiling_subtree_space(parent, tiling_output->root,
-				     &tiling_output->curr_geo);
+				     &tiling_output->curr_geo,
+				     tiling_output);
 	struct weston_geometry view_space =
-		tiling_subtree_space(view, parent, &space);
+		tiling_subtree_space(view, parent, &space, tiling_output);
 	//get the ratio from global coordinates
 	double rx = wl_fixed_to_double(arg->sx) / view_space.width;
 	double ry = wl_fixed_to_double(arg->sy) / view_space.height;
@@ -641,7 +1156,10 @@ tiling_resize(const enum layout_command command, const struct layout_op *arg,
 {
 	struct tiling_output *tiling_output = tiling_output_find(l, v->output);
 	struct tiling_view *view = tiling_view_find(tiling_output->root, v);
-	_tiling_resize(arg, view, l, ops, false);
+
+	ops[0].end = true;
+	if (view)
+		_tiling_resize(arg, view, l, ops, false);
 }
 
 static void
@@ -670,19 +1188,38 @@ _tiling_split(UNUSED_ARG(const enum layout_command command),
 {
 	struct tiling_output *tiling_output = tiling_output_find(l, v->output);
 	struct tiling_view *view = tiling_view_find(tiling_output->root, v);
-	struct tiling_view *parent = container_of(view->node.parent,
-						  struct tiling_view, node);
+	struct tiling_view *parent;
+
+	if (!view) {
+		ops[0].end = true;
+		return;
+	}
+	parent = container_of(view->node.parent, struct tiling_view, node);
 
 	//test if the view is the only child. So we do not need to split
 	if (parent->node.children.len <= 1) {
+		bool changed = parent->vertical != vertical;
+
 		parent->vertical = vertical;
-		ops[0].end = true;
+		if (!changed) {
+			ops[0].end = true;
+			return;
+		}
+		//nothing moves, but the arranging keeps the undo entry
+		struct weston_geometry space =
+			tiling_subtree_space(parent, tiling_output->root,
+			                     &tiling_output->curr_geo,
+			                     tiling_output);
+		int count = tiling_arrange_subtree(parent, &space, ops,
+		                                   tiling_output);
+		ops[count].end = true;
 		return;
 	}
 
 	struct weston_geometry space =
 		tiling_subtree_space(view, tiling_output->root,
-				     &tiling_output->curr_geo);
+				     &tiling_output->curr_geo,
+				     tiling_output);
 	struct tiling_view *new_view = tiling_new_view(v);
 	view->v = NULL;
 	view->vertical = vertical;
@@ -716,8 +1253,13 @@ tiling_merge(UNUSED_ARG(const enum layout_command command),
 	//remove current view and then insert at grandparent list
 	struct tiling_output *tiling_output = tiling_output_find(l, v->output);
 	struct tiling_view *view = tiling_view_find(tiling_output->root, v);
-	struct tiling_view *parent = container_of(view->node.parent,
-						  struct tiling_view, node);
+	struct tiling_view *parent;
+
+	if (!view) {
+		ops[0].end = true;
+		return;
+	}
+	parent = container_of(view->node.parent, struct tiling_view, node);
 	struct tiling_view *gparent = parent->node.parent ?
 		container_of(parent->node.parent, struct tiling_view, node) :
 		NULL;
@@ -728,7 +1270,8 @@ tiling_merge(UNUSED_ARG(const enum layout_command command),
 	}
 	struct weston_geometry space =
 		tiling_subtree_space(gparent, tiling_output->root,
-				     &tiling_output->curr_geo);
+				     &tiling_output->curr_geo,
+				     tiling_output);
 
 	tiling_view_erase(view);
 	view = tiling_new_view(v);
@@ -749,11 +1292,17 @@ tiling_toggle(UNUSED_ARG(const enum layout_command command),
 {
 	struct tiling_output *tiling_output = tiling_output_find(l, v->output);
 	struct tiling_view *view = tiling_view_find(tiling_output->root, v);
-	struct tiling_view *parent = container_of(view->node.parent,
-						  struct tiling_view, node);
+	struct tiling_view *parent;
+
+	if (!view) {
+		ops[0].end = true;
+		return;
+	}
+	parent = container_of(view->node.parent, struct tiling_view, node);
 	struct weston_geometry space =
 		tiling_subtree_space(parent, tiling_output->root,
-				     &tiling_output->curr_geo);
+				     &tiling_output->curr_geo,
+				     tiling_output);
 
 	if (parent) {
 		parent->vertical = !parent->vertical;
@@ -763,6 +1312,585 @@ tiling_toggle(UNUSED_ARG(const enum layout_command command),
 	}
 }
 
+/* the positions of a subtree, the sizes stay what they are */
+static int
+tiling_subtree_place(struct tiling_view *tv, struct tiling_output *to,
+                     struct layout_op *ops)
+{
+	struct weston_geometry space =
+		tiling_subtree_space(tv, to->root, &to->curr_geo, to);
+	int count = tiling_arrange_subtree(tv, &space, ops, to);
+
+	for (int i = 0; i < count; i++)
+		ops[i].size = (struct weston_size){0, 0};
+	return count;
+}
+
+/**
+ * /brief bring up the tabs of a view going to be focused
+ *
+ * The tabs have the size of their container already, the ones going away and
+ * the ones coming up only change their visibility, nothing is configured.
+ */
+static void
+tiling_focus(UNUSED_ARG(const enum layout_command command),
+             UNUSED_ARG(const struct layout_op *arg),
+             struct weston_view *v, struct layout *l,
+             struct layout_op *ops)
+{
+	struct tiling_output *tiling_output = tiling_output_find(l, v->output);
+	struct tiling_view *view = tiling_output ?
+		tiling_view_find(tiling_output->root, v) : NULL;
+	struct tiling_view *parent, *shown = NULL, *top = NULL;
+	int count = 0;
+
+	for (; view && (parent = tiling_view_parent(view)); view = parent) {
+		if (!tiling_is_tabbed(parent) ||
+		    tiling_shown_tab(parent) == view)
+			continue;
+		//the tabs switched below are all in the highest one
+		shown = tiling_shown_tab(parent);
+		top = view;
+		parent->tab = view;
+	}
+	if (top) {
+		count += tiling_subtree_place(shown, tiling_output, ops);
+		count += tiling_subtree_place(top, tiling_output, &ops[count]);
+	}
+	ops[count].end = true;
+}
+
+static void
+_tiling_container(struct weston_view *v, struct layout *l,
+                  enum tiling_container container, struct layout_op *ops)
+{
+	struct tiling_output *tiling_output = tiling_output_find(l, v->output);
+	struct tiling_view *view = tiling_output ?
+		tiling_view_find(tiling_output->root, v) : NULL;
+	struct tiling_view *parent = view ? tiling_view_parent(view) : NULL;
+
+	if (!parent) {
+		ops[0].end = true;
+		return;
+	}
+	parent->container = (parent->container == container) ?
+		TILING_SPLIT : container;
+	//the view stays on top of its tabs
+	parent->tab = view;
+	struct weston_geometry space =
+		tiling_subtree_space(parent, tiling_output->root,
+		                     &tiling_output->curr_geo,
+		                     tiling_output);
+	int count = tiling_arrange_subtree(parent, &space, ops, tiling_output);
+	ops[count].end = true;
+}
+
+static void
+tiling_tabbed(UNUSED_ARG(const enum layout_command command),
+              UNUSED_ARG(const struct layout_op *arg),
+              struct weston_view *v, struct layout *l,
+              struct layout_op *ops)
+{
+	_tiling_container(v, l, TILING_TABBED, ops);
+}
+
+static void
+tiling_stacked(UNUSED_ARG(const enum layout_command command),
+               UNUSED_ARG(const struct layout_op *arg),
+               struct weston_view *v, struct layout *l,
+               struct layout_op *ops)
+{
+	_tiling_container(v, l, TILING_STACKED, ops);
+}
+
+static bool
+tiling_subtree_has(const struct tiling_view *subtree, struct tiling_view *tv)
+{
+	for (; tv; tv = tiling_view_parent(tv))
+		if (tv == subtree)
+			return true;
+	return false;
+}
+
+static int
+tiling_split_place(struct tiling_view *split, struct tiling_output *to,
+                   struct layout_op *ops)
+{
+	struct weston_geometry space =
+		tiling_subtree_space(split, to->root, &to->curr_geo, to);
+	return tiling_arrange_subtree(split, &space, ops, to);
+}
+
+/* arg->v and v trade their leaves, on the same output or not. The limits of
+ * the clients change, so the splits they are in are laid out again */
+static void
+tiling_swap(UNUSED_ARG(const enum layout_command command),
+            const struct layout_op *arg, struct weston_view *v,
+            struct layout *l, struct layout_op *ops)
+{
+	struct tiling_user_data *user_data = l->user_data;
+	struct tiling_output *to = tiling_output_find(l, v->output);
+	struct tiling_output *other_to = arg->v ?
+		tiling_output_find(l, arg->v->output) : NULL;
+	struct tiling_view *view = to ? tiling_view_find(to->root, v) : NULL;
+	struct tiling_view *other = other_to ?
+		tiling_view_find(other_to->root, arg->v) : NULL;
+	struct tiling_view *parent, *other_parent;
+	int count = 0;
+
+	ops[0].end = true;
+	if (!view || !other || view == other)
+		return;
+	//the history would put them back where they were
+	tiling_history_forget(user_data, NULL, v);
+	tiling_history_forget(user_data, NULL, arg->v);
+	view->v = arg->v;
+	other->v = v;
+
+	parent = tiling_view_parent(view);
+	other_parent = tiling_view_parent(other);
+	if (tiling_subtree_has(parent, other_parent)) {
+		count = tiling_split_place(parent, to, ops);
+	} else if (tiling_subtree_has(other_parent, parent)) {
+		count = tiling_split_place(other_parent, other_to, ops);
+	} else {
+		count = tiling_split_place(parent, to, ops);
+		count += tiling_split_place(other_parent, other_to,
+		                            &ops[count]);
+	}
+	ops[count].end = true;
+}
+
+/*****************************************************************
+ * tiling history
+ ****************************************************************/
+static void
+tiling_history_free(struct tiling_history *h)
+{
+	for (int i = 0; i < h->len; i++)
+		tw_free(h->frames[i].records);
+	tw_free(h);
+}
+
+static struct tiling_history *
+tiling_history_new(struct weston_output *o, int len)
+{
+	struct tiling_history *h =
+		tw_zalloc(TW_MEM_LAYOUT, sizeof(struct tiling_history) +
+		          len * sizeof(struct tiling_frame));
+	if (h) {
+		h->output = o;
+		h->len = len;
+	}
+	return h;
+}
+
+static void
+tiling_history_push(struct tiling_history **stack, int *n,
+                    struct tiling_history *h)
+{
+	if (*n == TILING_HISTORY) {
+		tiling_history_free(stack[0]);
+		memmove(stack, stack+1, sizeof(*stack) * (TILING_HISTORY-1));
+		(*n)--;
+	}
+	stack[(*n)++] = h;
+}
+
+static bool
+tiling_history_has_view(const struct tiling_history *h,
+                        const struct weston_view *v)
+{
+	for (int i = 0; i < h->len; i++) {
+		const struct tiling_frame *f = &h->frames[i];
+		if (f->v == v)
+			return true;
+		for (int j = 0; j < f->len; j++)
+			if (f->records[j].v == v)
+				return true;
+	}
+	return false;
+}
+
+static void
+tiling_history_filter(struct tiling_history **stack, int *n,
+                      const struct weston_output *o,
+                      const struct weston_view *v)
+{
+	int kept = 0;
+
+	for (int i = 0; i < *n; i++) {
+		if ((!o || stack[i]->output == o) &&
+		    (!v || tiling_history_has_view(stack[i], v)))
+			tiling_history_free(stack[i]);
+		else
+			stack[kept++] = stack[i];
+	}
+	*n = kept;
+}
+
+/* drop the entries on the output o and with the view v, NULL matches all. A
+ * view is forgotten when it leaves, its pointer can come back as another view
+ */
+static void
+tiling_history_forget(struct tiling_user_data *user_data,
+                      const struct weston_output *o,
+                      const struct weston_view *v)
+{
+	tiling_history_filter(user_data->undo, &user_data->nundo, o, v);
+	tiling_history_filter(user_data->redo, &user_data->nredo, o, v);
+	user_data->resizing = NULL;
+}
+
+static inline struct tiling_record
+tiling_record_of(struct tiling_view *tv)
+{
+	return (struct tiling_record){
+		.v = tv->v,
+		.placeholder = tv->placeholder,
+		.portion = tv->portion,
+		.vertical = tv->vertical,
+		.container = tv->container,
+		.tab = tiling_tab_index(tv),
+		.nchildren = tv->node.children.len,
+	};
+}
+
+static int
+tiling_subtree_count(struct tiling_view *tv)
+{
+	int count = 0;
+	for (int i = 0; i < tv->node.children.len; i++)
+		count += 1 + tiling_subtree_count(tiling_view_ith_node(tv, i));
+	return count;
+}
+
+static int
+tiling_subtree_save(struct tiling_view *tv, struct tiling_record *records)
+{
+	int count = 0;
+	for (int i = 0; i < tv->node.children.len; i++) {
+		struct tiling_view *sv = tiling_view_ith_node(tv, i);
+		records[count++] = tiling_record_of(sv);
+		count += tiling_subtree_save(sv, &records[count]);
+	}
+	return count;
+}
+
+static bool
+tiling_frame_save(struct tiling_frame *f, struct tiling_view *tv, bool deep)
+{
+	memcpy(f->coding, tv->coding, sizeof(f->coding));
+	f->level = tv->level;
+	f->deep = deep;
+	f->vertical = tv->vertical;
+	f->container = tv->container;
+	f->tab = tiling_tab_index(tv);
+	f->v = tv->v;
+	f->nchildren = tv->node.children.len;
+	f->len = deep ? tiling_subtree_count(tv) : f->nchildren;
+	if (!f->len)
+		return true;
+	f->records = tw_zalloc(TW_MEM_LAYOUT,
+	                       sizeof(struct tiling_record) * f->len);
+	if (!f->records)
+		return false;
+	if (deep)
+		tiling_subtree_save(tv, f->records);
+	else
+		for (int i = 0; i < f->len; i++)
+			f->records[i] =
+				tiling_record_of(tiling_view_ith_node(tv, i));
+	return true;
+}
+
+static struct tiling_view *
+tiling_frame_locate(const struct tiling_frame *f, struct tiling_output *to)
+{
+	struct tiling_view *tv = to->root;
+
+	for (int i = 0; i < f->level; i++) {
+		if (f->coding[i] >= tv->node.children.len)
+			return NULL;
+		tv = tiling_view_ith_node(tv, f->coding[i]);
+	}
+	return tv;
+}
+
+static int
+tiling_subtree_views(struct tiling_view *tv, struct weston_view **views)
+{
+	int count = 0;
+	for (int i = 0; i < tv->node.children.len; i++) {
+		struct tiling_view *sv = tiling_view_ith_node(tv, i);
+		if (sv->v)
+			views[count++] = sv->v;
+		count += tiling_subtree_views(sv, &views[count]);
+	}
+	return count;
+}
+
+static int
+cmp_view_ptrs(const void *a, const void *b)
+{
+	uintptr_t l = (uintptr_t)*(struct weston_view * const *)a;
+	uintptr_t r = (uintptr_t)*(struct weston_view * const *)b;
+	return (l > r) - (l < r);
+}
+
+/* the frame is good as long as it would not lose or duplicate a view. The
+ * shape under a deep frame can be anything, add and delete can change it */
+static bool
+tiling_frame_matches(const struct tiling_frame *f, struct tiling_view *tv)
+{
+	int ns = 0, nc = 0, n = tiling_subtree_count(tv);
+
+	if (!f->deep) {
+		if (tv->v != f->v || tv->node.children.len != f->len)
+			return false;
+		for (int i = 0; i < f->len; i++)
+			if (tiling_view_ith_node(tv, i)->v != f->records[i].v)
+				return false;
+		return true;
+	}
+	struct weston_view *saved[f->len+1], *current[n+1];
+	if (f->v)
+		saved[ns++] = f->v;
+	for (int i = 0; i < f->len; i++)
+		if (f->records[i].v)
+			saved[ns++] = f->records[i].v;
+	if (tv->v)
+		current[nc++] = tv->v;
+	nc += tiling_subtree_views(tv, &current[nc]);
+	if (ns != nc)
+		return false;
+	qsort(saved, ns, sizeof(saved[0]), cmp_view_ptrs);
+	qsort(current, nc, sizeof(current[0]), cmp_view_ptrs);
+	return memcmp(saved, current, sizeof(saved[0]) * ns) == 0;
+}
+
+static inline void
+tiling_tab_restore(struct tiling_view *tv, int tab)
+{
+	tv->tab = (tab >= 0 && tab < tv->node.children.len) ?
+		tiling_view_ith_node(tv, tab) : NULL;
+}
+
+static int
+tiling_subtree_restore(struct tiling_view *parent,
+                       const struct tiling_record *records, int nchildren)
+{
+	int count = 0;
+	for (int i = 0; i < nchildren; i++) {
+		const struct tiling_record *r = &records[count++];
+		struct tiling_view *tv = tiling_new_view(r->v);
+
+		tv->placeholder = r->placeholder;
+		tv->portion = r->portion;
+		tv->vertical = r->vertical;
+		tv->container = r->container;
+		tv->output = parent->output;
+		tv->level = parent->level+1;
+		memcpy(tv->coding, parent->coding, sizeof(tv->coding));
+		tv->coding[tv->level-1] = i;
+		vtree_node_insert(&parent->node, &tv->node, i);
+		count += tiling_subtree_restore(tv, &records[count],
+		                                r->nchildren);
+		tiling_tab_restore(tv, r->tab);
+	}
+	tiling_update_children(parent);
+	return count;
+}
+
+static void
+tiling_frame_restore(const struct tiling_frame *f, struct tiling_view *tv)
+{
+	tv->vertical = f->vertical;
+	tv->container = f->container;
+	if (f->deep) {
+		vtree_destroy_children(&tv->node, tw_free);
+		tv->v = f->v;
+		tiling_subtree_restore(tv, f->records, f->nchildren);
+	} else {
+		for (int i = 0; i < f->len; i++)
+			tiling_view_ith_node(tv, i)->portion =
+				f->records[i].portion;
+		tiling_update_children(tv);
+	}
+	tiling_tab_restore(tv, f->tab);
+}
+
+/* the highest node tiling_merge changes, the erasing may go up through the
+ * parents left empty, the inserting goes to the grandparent */
+static struct tiling_view *
+tiling_merge_top(struct tiling_view *view)
+{
+	struct tiling_view *top = view, *parent;
+	struct tiling_view *gparent = tiling_view_parent(tiling_view_parent(view));
+
+	if (!gparent)
+		return NULL;
+	while ((parent = tiling_view_parent(top)) && !parent->v &&
+	       parent->node.children.len == 1 && parent->node.parent)
+		top = parent;
+	top = tiling_view_parent(top);
+	return (top->level < gparent->level) ? top : gparent;
+}
+
+/**
+ * @brief save what the command is about to change, before running it
+ */
+static struct tiling_history *
+tiling_history_record(const enum layout_command command,
+                      struct weston_view *v, struct layout *l)
+{
+	struct tiling_user_data *user_data = l->user_data;
+	struct tiling_output *to = v ? tiling_output_find(l, v->output) : NULL;
+	struct tiling_view *view = to ? tiling_view_find(to->root, v) : NULL;
+	struct tiling_view *parent = view ? tiling_view_parent(view) : NULL;
+	struct tiling_history *h = NULL;
+	struct tiling_view *top;
+	bool saved = true;
+
+	if (!parent)
+		return NULL;
+	switch (command) {
+	case DPSR_toggle:
+	case DPSR_tabbed:
+	case DPSR_stacked:
+		if ((h = tiling_history_new(to->o, 1)))
+			saved = tiling_frame_save(&h->frames[0], parent, false);
+		break;
+	case DPSR_resize:
+		//it goes all the way up to the root
+		if (user_data->resizing == v)
+			return NULL;
+		if (!(h = tiling_history_new(to->o, view->level)))
+			break;
+		for (int i = 0; parent && saved; i++) {
+			saved = tiling_frame_save(&h->frames[i], parent, false);
+			parent = tiling_view_parent(parent);
+		}
+		break;
+	case DPSR_vsplit:
+	case DPSR_hsplit:
+		//an only child does not split, the parent changes direction
+		if (!(h = tiling_history_new(to->o, 1)))
+			break;
+		if (parent->node.children.len <= 1)
+			saved = tiling_frame_save(&h->frames[0], parent, false);
+		else
+			saved = tiling_frame_save(&h->frames[0], view, true);
+		break;
+	case DPSR_merge:
+		if ((top = tiling_merge_top(view)) &&
+		    (h = tiling_history_new(to->o, 1)))
+			saved = tiling_frame_save(&h->frames[0], top, true);
+		break;
+	default:
+		break;
+	}
+	if (h && !saved) {
+		tiling_history_free(h);
+		h = NULL;
+	}
+	return h;
+}
+
+/**
+ * @brief keep the entry if the command moved anything
+ */
+static void
+tiling_history_commit(const enum layout_command command,
+                      struct tiling_history *h, struct weston_view *v,
+                      struct layout *l, const struct layout_op *ops)
+{
+	struct tiling_user_data *user_data = l->user_data;
+
+	if (command == DPSR_del) {
+		tiling_history_forget(user_data, NULL, v);
+		return;
+	}
+	if (!h)
+		return;
+	if (ops[0].end) {
+		tiling_history_free(h);
+		return;
+	}
+	tiling_history_filter(user_data->redo, &user_data->nredo, NULL, NULL);
+	tiling_history_push(user_data->undo, &user_data->nundo, h);
+	user_data->resizing = (command == DPSR_resize) ? v : NULL;
+}
+
+/* pop the entries until one still fits the tree, put what it replaces on the
+ * other stack */
+static void
+tiling_history_apply(struct layout *l, bool redo, struct layout_op *ops)
+{
+	struct tiling_user_data *user_data = l->user_data;
+	struct tiling_history **from = redo ? user_data->redo : user_data->undo;
+	struct tiling_history **to = redo ? user_data->undo : user_data->redo;
+	int *nfrom = redo ? &user_data->nredo : &user_data->nundo;
+	int *nto = redo ? &user_data->nundo : &user_data->nredo;
+
+	ops[0].end = true;
+	user_data->resizing = NULL;
+	while (*nfrom > 0) {
+		struct tiling_history *h = from[--(*nfrom)];
+		struct tiling_output *output = tiling_output_find(l, h->output);
+		struct tiling_history *back = output ?
+			tiling_history_new(h->output, h->len) : NULL;
+		struct tiling_view *nodes[h->len], *top;
+		bool valid = back != NULL;
+
+		for (int i = 0; i < h->len && valid; i++) {
+			nodes[i] = tiling_frame_locate(&h->frames[i], output);
+			valid = nodes[i] &&
+				tiling_frame_matches(&h->frames[i], nodes[i]) &&
+				tiling_frame_save(&back->frames[i], nodes[i],
+				                  h->frames[i].deep);
+		}
+		if (!valid) {
+			tiling_history_free(h);
+			if (back)
+				tiling_history_free(back);
+			continue;
+		}
+		top = nodes[0];
+		for (int i = 0; i < h->len; i++) {
+			tiling_frame_restore(&h->frames[i], nodes[i]);
+			top = (nodes[i]->level < top->level) ? nodes[i] : top;
+		}
+		tiling_history_free(h);
+		tiling_history_push(to, nto, back);
+
+		struct weston_geometry space =
+			tiling_subtree_space(top, output->root,
+			                     &output->curr_geo, output);
+		int count = tiling_arrange_subtree(top, &space, ops, output);
+		ops[count].end = true;
+		return;
+	}
+}
+
+static void
+tiling_undo(UNUSED_ARG(const enum layout_command command),
+            UNUSED_ARG(const struct layout_op *arg),
+            UNUSED_ARG(struct weston_view *v), struct layout *l,
+            struct layout_op *ops)
+{
+	tiling_history_apply(l, false, ops);
+}
+
+static void
+tiling_redo(UNUSED_ARG(const enum layout_command command),
+            UNUSED_ARG(const struct layout_op *arg),
+            UNUSED_ARG(struct weston_view *v), struct layout *l,
+            struct layout_op *ops)
+{
+	tiling_history_apply(l, true, ops);
+}
+
 void
 emplace_tiling(const enum layout_command command, const struct layout_op *arg,
 	       struct weston_view *v, struct layout *l,
@@ -775,7 +1903,7 @@ emplace_tiling(const enum layout_command command, const struct layout_op *arg,
 	};
 
 	static struct placement_node t_ops[] = {
-		{DPSR_focus, emplace_noop},
+		{DPSR_focus, tiling_focus},
 		{DPSR_add, tiling_add},
 		{DPSR_del, tiling_del},
 		{DPSR_deplace, emplace_noop},
@@ -785,7 +1913,14 @@ emplace_tiling(const enum layout_command command, const struct layout_op *arg,
 		{DPSR_hsplit, tiling_hsplit},
 		{DPSR_merge, tiling_merge},
 		{DPSR_output_resize, tiling_update},
+		{DPSR_undo, tiling_undo},
+		{DPSR_redo, tiling_redo},
+		{DPSR_tabbed, tiling_tabbed},
+		{DPSR_stacked, tiling_stacked},
+		{DPSR_swap, tiling_swap},
 	};
 	assert(t_ops[command].command == command);
+	struct tiling_history *h = tiling_history_record(command, v, l);
 	t_ops[command].fun(command, arg, v, l, ops);
+	tiling_history_commit(command, h, v, l, ops);
 }
@@ -0,0 +1,430 @@
+/*
+ * overview.c - taiwins desktop overview
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <alloc.h>
+#include <ctypes/helpers.h>
+#include <libweston/libweston.h>
+
+#include "shell.h"
+#include "workspace.h"
+#include "overview.h"
+#include "overview_grid.h"
+
+#define OVERVIEW_GAP 32
+#define OVERVIEW_DIM 0.6f
+
+struct overview_view {
+	struct weston_view *view; /**< NULL once it is gone */
+	int output, workspace;
+	struct weston_geometry from;
+	struct overview_slot slot;
+	struct weston_transform transform;
+	float alpha;
+};
+
+_Static_assert(MAX_WORKSPACE <= 32, "the shown workspaces do not fit");
+
+static struct desktop_overview {
+	struct workspace *wss[MAX_WORKSPACE]; /**< NULL for the ones not used */
+	int nws;
+	uint32_t shown_workspaces;
+	//allocated once, the transforms are linked into the views
+	struct overview_view *views;
+	int len, selected;
+	struct view_index index;
+} s_overview = {
+	.selected = -1,
+};
+
+bool
+desktop_overview_active(void)
+{
+	return s_overview.views != NULL;
+}
+
+static inline bool
+overview_shows(const struct workspace *ws, const struct weston_view *view)
+{
+	const struct weston_layer *layer = view->layer_link.layer;
+
+	return layer == &ws->tiling_layer || layer == &ws->floating_layer ||
+		layer == &ws->fullscreen_layer;
+}
+
+/* by output, then workspace, then where the views were, so the grid looks
+ * like the screen */
+static int
+overview_cmp(const void *a, const void *b)
+{
+	const struct overview_view *va = a, *vb = b;
+
+	if (va->output != vb->output)
+		return va->output - vb->output;
+	if (va->workspace != vb->workspace)
+		return va->workspace - vb->workspace;
+	if (va->from.y != vb->from.y)
+		return (va->from.y < vb->from.y) ? -1 : 1;
+	return (va->from.x < vb->from.x) ? -1 : (va->from.x > vb->from.x);
+}
+
+static void
+overview_apply(struct overview_view *ov)
+{
+	struct weston_view *view = ov->view;
+	struct recent_view *rv = get_recent_view(view);
+	struct weston_matrix *matrix = &ov->transform.matrix;
+	float s = ov->slot.scale, dx, dy;
+
+	//the visible part, scaled, lands on the slot
+	overview_slot_offset(&ov->slot,
+	                     view->geometry.x + rv->visible_geometry.x,
+	                     view->geometry.y + rv->visible_geometry.y,
+	                     &dx, &dy);
+	weston_matrix_init(matrix);
+	weston_matrix_scale(matrix, s, s, 1.0);
+	weston_matrix_translate(matrix, dx, dy, 0.0);
+	weston_view_geometry_dirty(view);
+	weston_view_schedule_repaint(view);
+}
+
+static void
+overview_highlight(int selected)
+{
+	struct desktop_overview *o = &s_overview;
+
+	o->selected = selected;
+	for (int i = 0; i < o->len; i++) {
+		struct overview_view *ov = &o->views[i];
+
+		if (!ov->view)
+			continue;
+		ov->view->alpha = (i == selected) ?
+			ov->alpha : ov->alpha * OVERVIEW_DIM;
+		weston_surface_damage(ov->view->surface);
+	}
+}
+
+static void
+overview_index(void)
+{
+	struct desktop_overview *o = &s_overview;
+
+	view_index_reset(&o->index);
+	for (int i = 0; i < o->len; i++)
+		if (o->views[i].view)
+			view_index_add(&o->index, o->views[i].view,
+			               &o->views[i].slot.geo);
+	view_index_build(&o->index);
+}
+
+static int
+overview_count(struct workspace **wss, int n)
+{
+	struct recent_view *rv;
+	int count = 0;
+
+	for (int i = 0; i < n; i++) {
+		if (!wss[i])
+			continue;
+		wl_list_for_each(rv, &wss[i]->recent_views, link)
+			count += overview_shows(wss[i], rv->view);
+	}
+	return count;
+}
+
+static void
+overview_collect(struct workspace **wss, int n, struct weston_compositor *ec)
+{
+	struct desktop_overview *o = &s_overview;
+	struct recent_view *rv;
+
+	for (int i = 0; i < n; i++) {
+		if (!wss[i])
+			continue;
+		wl_list_for_each(rv, &wss[i]->recent_views, link) {
+			struct overview_view *ov = &o->views[o->len];
+			struct weston_output *output;
+			float x, y;
+			int rank = 0;
+
+			if (!overview_shows(wss[i], rv->view))
+				continue;
+			//a hidden workspace may still point to an output
+			//which is gone, its views go to the first one
+			ov->output = 0;
+			wl_list_for_each(output, &ec->output_list, link) {
+				if (output == rv->view->output)
+					ov->output = rank;
+				rank++;
+			}
+			recent_view_get_origin_coord(rv, &x, &y);
+			ov->view = rv->view;
+			ov->workspace = i;
+			ov->from = (struct weston_geometry){
+				x, y,
+				rv->visible_geometry.width ?
+				rv->visible_geometry.width :
+				rv->view->surface->width,
+				rv->visible_geometry.height ?
+				rv->visible_geometry.height :
+				rv->view->surface->height,
+			};
+			ov->alpha = rv->view->alpha;
+			o->len++;
+		}
+	}
+	qsort(o->views, o->len, sizeof(*o->views), overview_cmp);
+}
+
+/* the grid of each output, over the space the shell leaves */
+static bool
+overview_arrange(struct weston_compositor *ec, struct shell *shell)
+{
+	struct desktop_overview *o = &s_overview;
+	struct weston_output *output;
+	struct weston_size *sizes = tw_zalloc(TW_MEM_WORKSPACE,
+	                                      o->len * sizeof(*sizes));
+	struct overview_slot *slots = tw_zalloc(TW_MEM_WORKSPACE,
+	                                        o->len * sizeof(*slots));
+	int rank = 0, start = 0;
+
+	if (!sizes || !slots) {
+		tw_free(sizes);
+		tw_free(slots);
+		return false;
+	}
+	wl_list_for_each(output, &ec->output_list, link) {
+		struct weston_geometry area =
+			shell_output_available_space(shell, output);
+		int end = start, cols;
+
+		while (end < o->len && o->views[end].output == rank)
+			end++;
+		for (int i = start; i < end; i++)
+			sizes[i] = (struct weston_size){
+				o->views[i].from.width,
+				o->views[i].from.height};
+		cols = overview_grid(&area, OVERVIEW_GAP, &sizes[start],
+		                     end - start, &slots[start]);
+		for (int i = start; i < end; i++)
+			o->views[i].slot = cols ? slots[i] :
+				(struct overview_slot){o->views[i].from, 1.0f};
+		start = end;
+		rank++;
+	}
+	tw_free(sizes);
+	tw_free(slots);
+	return true;
+}
+
+bool
+desktop_overview_start(struct weston_compositor *ec, struct workspace **wss,
+                       int n, struct workspace *current, struct shell *shell)
+{
+	struct desktop_overview *o = &s_overview;
+	int count = overview_count(wss, MIN(n, MAX_WORKSPACE));
+
+	if (o->views || !count)
+		return false;
+	o->views = tw_zalloc(TW_MEM_WORKSPACE, count * sizeof(*o->views));
+	if (!o->views)
+		return false;
+	o->len = 0;
+	n = MIN(n, MAX_WORKSPACE);
+	overview_collect(wss, n, ec);
+	if (!overview_arrange(ec, shell)) {
+		tw_free(o->views);
+		o->views = NULL;
+		return false;
+	}
+
+	memcpy(o->wss, wss, n * sizeof(*wss));
+	o->nws = n;
+	o->shown_workspaces = 0;
+	for (int i = 0; i < n; i++) {
+		if (wss[i] == current || !overview_count(&wss[i], 1))
+			continue;
+		weston_layer_set_position(&wss[i]->tiling_layer,
+		                          BACK_LAYER_POS);
+		weston_layer_set_position(&wss[i]->floating_layer,
+		                          FRONT_LAYER_POS);
+		weston_layer_set_position(&wss[i]->fullscreen_layer,
+		                          WESTON_LAYER_POSITION_FULLSCREEN);
+		o->shown_workspaces |= 1u << i;
+	}
+	//at the end of the list, so whatever else transforms the view stays
+	//as it is
+	for (int i = 0; i < o->len; i++) {
+		struct overview_view *ov = &o->views[i];
+		wl_list_insert(ov->view->geometry.transformation_list.prev,
+		               &ov->transform.link);
+		overview_apply(ov);
+	}
+	view_index_init(&o->index);
+	overview_index();
+	//the focused view of the current workspace first, if it has one
+	o->selected = 0;
+	for (int i = 0; i < o->len; i++)
+		if (o->views[i].view == workspace_get_top_view(current)) {
+			o->selected = i;
+			break;
+		}
+	overview_highlight(o->selected);
+	return true;
+}
+
+struct weston_view *
+desktop_overview_end(void)
+{
+	struct desktop_overview *o = &s_overview;
+	struct weston_view *selected = desktop_overview_selected();
+
+	if (!o->views)
+		return NULL;
+	for (int i = 0; i < o->len; i++) {
+		struct overview_view *ov = &o->views[i];
+
+		if (!ov->view)
+			continue;
+		wl_list_remove(&ov->transform.link);
+		ov->view->alpha = ov->alpha;
+		weston_view_geometry_dirty(ov->view);
+		weston_surface_damage(ov->view->surface);
+		weston_view_schedule_repaint(ov->view);
+	}
+	for (int i = 0; i < o->nws; i++)
+		if (o->shown_workspaces & (1u << i)) {
+			weston_layer_unset_position(&o->wss[i]->tiling_layer);
+			weston_layer_unset_position(
+				&o->wss[i]->floating_layer);
+			weston_layer_unset_position(
+				&o->wss[i]->fullscreen_layer);
+		}
+	view_index_release(&o->index);
+	tw_free(o->views);
+	o->views = NULL;
+	o->len = 0;
+	o->selected = -1;
+	o->shown_workspaces = 0;
+	return selected;
+}
+
+struct weston_view *
+desktop_overview_selected(void)
+{
+	struct desktop_overview *o = &s_overview;
+
+	return (o->views && o->selected >= 0) ?
+		o->views[o->selected].view : NULL;
+}
+
+static int
+overview_find(const struct weston_view *view)
+{
+	struct desktop_overview *o = &s_overview;
+
+	for (int i = 0; view && i < o->len; i++)
+		if (o->views[i].view == view)
+			return i;
+	return -1;
+}
+
+void
+desktop_overview_select(enum tw_desktop_direction direction)
+{
+	struct desktop_overview *o = &s_overview;
+	struct overview_view *ov;
+	int next;
+
+	if (!o->views || o->selected < 0)
+		return;
+	ov = &o->views[o->selected];
+	next = overview_find(view_index_nearest(&o->index, &ov->slot.geo,
+	                                        ov->view, direction));
+	if (next >= 0)
+		overview_highlight(next);
+}
+
+void
+desktop_overview_select_next(void)
+{
+	struct desktop_overview *o = &s_overview;
+
+	if (!o->views)
+		return;
+	for (int i = 1; i <= o->len; i++) {
+		int next = (o->selected + i) % o->len;
+		if (o->views[next].view) {
+			overview_highlight(next);
+			return;
+		}
+	}
+}
+
+struct weston_view *
+desktop_overview_pick(double x, double y)
+{
+	struct desktop_overview *o = &s_overview;
+
+	for (int i = 0; o->views && i < o->len; i++) {
+		const struct weston_geometry *g = &o->views[i].slot.geo;
+
+		if (!o->views[i].view ||
+		    x < g->x || x >= g->x + g->width ||
+		    y < g->y || y >= g->y + g->height)
+			continue;
+		if (i != o->selected)
+			overview_highlight(i);
+		return o->views[i].view;
+	}
+	return NULL;
+}
+
+bool
+desktop_overview_remove(struct weston_view *view)
+{
+	struct desktop_overview *o = &s_overview;
+	int i = overview_find(view);
+
+	if (i < 0)
+		return false;
+	wl_list_remove(&o->views[i].transform.link);
+	o->views[i].view = NULL;
+	//the others stay where they are, a view jumping away under the
+	//pointer is worse than a hole
+	overview_index();
+	if (i == o->selected) {
+		o->selected = -1;
+		desktop_overview_select_next();
+	}
+	return o->selected < 0;
+}
+
+void
+desktop_overview_commit(struct weston_view *view)
+{
+	int i = overview_find(view);
+
+	if (i >= 0)
+		overview_apply(&s_overview.views[i]);
+}
@@ -0,0 +1,108 @@
+/*
+ * overview.h - taiwins desktop overview
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_DESKTOP_OVERVIEW_H
+#define TW_DESKTOP_OVERVIEW_H
+
+#include <stdbool.h>
+#include <libweston/libweston.h>
+
+#include "desktop.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+struct workspace;
+struct shell;
+
+/*
+ * The overview shows the views of one or all workspaces side by side, each
+ * output its own views. It only puts a scaling transform on them, they keep
+ * their size and place in the layouts, so no client is configured or draws
+ * again. One view is selected, the others are dimmed.
+ */
+
+bool
+desktop_overview_active(void);
+
+/**
+ * @brief put the shown views of the workspaces in the overview, the ones of
+ * the workspaces other than current come on screen for the time of it
+ *
+ * The n workspaces may have NULLs for the ones not in use, none is freed
+ * while the overview is on.
+ *
+ * @return false if there is nothing to show
+ */
+bool
+desktop_overview_start(struct weston_compositor *ec, struct workspace **wss,
+                       int n, struct workspace *current, struct shell *shell);
+
+/**
+ * @brief take the transforms out and the hidden workspaces away again, the
+ * views are as before the overview
+ *
+ * @return the view selected last
+ */
+struct weston_view *
+desktop_overview_end(void);
+
+struct weston_view *
+desktop_overview_selected(void);
+
+/**
+ * @brief select the closest view on that side, on any output
+ */
+void
+desktop_overview_select(enum tw_desktop_direction direction);
+
+/**
+ * @brief select the view after the selected one, back to the first one
+ */
+void
+desktop_overview_select_next(void);
+
+/**
+ * @brief select the view at x, y of the global space, if there is one
+ */
+struct weston_view *
+desktop_overview_pick(double x, double y);
+
+/**
+ * @brief the view is going away, before it is destroyed
+ *
+ * @return true if it was the last one
+ */
+bool
+desktop_overview_remove(struct weston_view *view);
+
+/**
+ * @brief the view may have moved or changed, put it in its place again
+ */
+void
+desktop_overview_commit(struct weston_view *view);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,96 @@
+/*
+ * overview_grid.c - taiwins desktop overview arrangement
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <ctypes/helpers.h>
+
+#include "overview_grid.h"
+
+static inline double
+overview_scale(const struct weston_size *size, int32_t cw, int32_t ch)
+{
+	int32_t w = MAX(size->width, 1), h = MAX(size->height, 1);
+
+	return MIN(MIN((double)cw / w, (double)ch / h), 1.0);
+}
+
+int
+overview_grid(const struct weston_geometry *area, int32_t gap,
+              const struct weston_size *sizes, int n,
+              struct overview_slot *slots)
+{
+	int cols = 0, rows;
+	int32_t cw = 0, ch = 0;
+	double best = -1.0;
+
+	//more columns only help until all views are on a single row
+	for (int c = 1; c <= n; c++) {
+		int r = (n + c - 1) / c;
+		int32_t w = (area->width - gap * (c + 1)) / c;
+		int32_t h = (area->height - gap * (r + 1)) / r;
+		double covered = 0.0;
+
+		if (w <= 0)
+			break;
+		if (h <= 0)
+			continue;
+		for (int i = 0; i < n; i++) {
+			double s = overview_scale(&sizes[i], w, h);
+			covered += s * s * MAX(sizes[i].width, 1) *
+				MAX(sizes[i].height, 1);
+		}
+		if (covered > best) {
+			best = covered;
+			cols = c;
+			cw = w;
+			ch = h;
+		}
+	}
+	if (!cols)
+		return 0;
+
+	rows = (n + cols - 1) / cols;
+	for (int i = 0; i < n; i++) {
+		int row = i / cols, col = i % cols;
+		int in_row = (row == rows - 1) ? n - row * cols : cols;
+		int32_t x = area->x + gap + col * (cw + gap) +
+			(cols - in_row) * (cw + gap) / 2;
+		int32_t y = area->y + gap + row * (ch + gap);
+		double s = overview_scale(&sizes[i], cw, ch);
+		int32_t w = MIN(MAX((int32_t)(MAX(sizes[i].width, 1) * s), 1),
+		                cw);
+		int32_t h = MIN(MAX((int32_t)(MAX(sizes[i].height, 1) * s), 1),
+		                ch);
+
+		slots[i].scale = s;
+		slots[i].geo = (struct weston_geometry){
+			x + (cw - w) / 2, y + (ch - h) / 2, w, h,
+		};
+	}
+	return cols;
+}
+
+void
+overview_slot_offset(const struct overview_slot *slot, int32_t x, int32_t y,
+                     float *dx, float *dy)
+{
+	*dx = slot->geo.x - slot->scale * x;
+	*dy = slot->geo.y - slot->scale * y;
+}
@@ -0,0 +1,70 @@
+/*
+ * overview_grid.h - taiwins desktop overview arrangement
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_OVERVIEW_GRID_H
+#define TW_OVERVIEW_GRID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libweston/libweston.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Where the views of an output go in the overview: a grid of equal cells over
+ * the area, each view scaled down into its cell, keeping its aspect, and
+ * centered in it. The views are never scaled up, and the last row is centered
+ * when it is not full.
+ */
+struct overview_slot {
+	struct weston_geometry geo; /**< of the scaled view */
+	float scale;
+};
+
+/**
+ * @brief the grid the views cover most of the area with, in the order given,
+ * row by row
+ *
+ * @return the number of columns, 0 if the area has no room for any cell
+ */
+int
+overview_grid(const struct weston_geometry *area, int32_t gap,
+              const struct weston_size *sizes, int n,
+              struct overview_slot *slots);
+
+/**
+ * @brief the translation after the scale that puts a visible part at x, y on
+ * the slot
+ *
+ * The overview transform is the last one of the view, it works on the global
+ * coordinates, so x, y is where the visible part is on the desktop.
+ */
+void
+overview_slot_offset(const struct overview_slot *slot, int32_t x, int32_t y,
+                     float *dx, float *dy);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
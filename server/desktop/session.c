@@ -0,0 +1,599 @@
+/*
+ * session.c - taiwins desktop session save and restore
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
+#include <string.h>
+#include <libweston/libweston.h>
+#include <libweston-desktop/libweston-desktop.h>
+#include <ctypes/helpers.h>
+
+#include <alloc.h>
+#include <jobs.h>
+#include <trace.h>
+#include "../compositor.h"
+#include "layout.h"
+#include "workspace.h"
+#include "desktop.h"
+#include "session_file.h"
+#include "session.h"
+
+/*
+ * The session is saved a second after the desktop changed, however many
+ * changes there were in between. The snapshot is taken on the main thread, it
+ * is only a walk over the trees, the file is written on the job pool.
+ *
+ * On a restart the tiling trees come back with placeholders in their leaves,
+ * so the windows fill their old places one by one as their clients come back,
+ * nothing else in the tree moves. The placeholders nobody took are dropped a
+ * minute later.
+ */
+
+_Static_assert(TW_SESSION_WORKSPACES == MAX_WORKSPACE,
+               "the session does not have all the workspaces");
+_Static_assert(TW_SESSION_LAYOUT_TILING == LAYOUT_TILING,
+               "the session file has its own tiling layout");
+
+#define SESSION_SAVE_DELAY_MS 1000
+#define SESSION_PLACEHOLDER_MS 60000
+#define SESSION_END_WAIT_MS 1000
+
+struct session_job {
+	struct tw_job *job;
+	char path[PATH_MAX];
+	void *buf;
+	size_t size;
+	bool written;
+};
+
+static struct desktop_session {
+	struct weston_compositor *ec;
+	struct desktop *desktop;
+	char path[PATH_MAX];
+
+	//the last session, its slots wait for their windows
+	struct tw_session last;
+	bool *claimed;
+
+	struct wl_event_source *save_timer;
+	struct wl_event_source *expire_timer;
+	bool save_armed;
+	struct session_job *writing;
+	bool save_again;
+} s_session;
+
+/*******************************************************************************
+ * saving
+ ******************************************************************************/
+
+struct session_capture {
+	struct tw_session *session;
+	struct weston_view **views; //of the slots
+	int32_t *remap; //slots of the last session still waiting
+	bool failed;
+};
+
+static int32_t
+session_slot_of(struct weston_view *v, uint32_t placeholder, void *data)
+{
+	struct session_capture *capture = data;
+	struct desktop_session *s = &s_session;
+	struct tw_session_slot *slot;
+	uint32_t last = placeholder - 1;
+
+	if (v) {
+		for (uint32_t i = 0; i < capture->session->nslots; i++)
+			if (capture->views[i] == v)
+				return i;
+		return -1;
+	}
+	//a placeholder, it is saved again in case we go down before its
+	//window comes back
+	if (last >= s->last.nslots || s->claimed[last])
+		return -1;
+	if (capture->remap[last] >= 0)
+		return capture->remap[last];
+	if (!(slot = tw_session_add_slots(capture->session, 1))) {
+		capture->failed = true;
+		return -1;
+	}
+	*slot = s->last.slots[last];
+	capture->views[capture->session->nslots-1] = NULL;
+	capture->remap[last] = capture->session->nslots-1;
+	return capture->remap[last];
+}
+
+static bool
+session_capture_slots(struct desktop_session *s,
+                      struct session_capture *capture)
+{
+	struct tw_session *session = capture->session;
+	struct recent_view *rv;
+
+	for (int i = 0; i < TW_SESSION_WORKSPACES; i++) {
+		struct workspace *ws =
+			tw_desktop_get_workspace(s->desktop, i, false);
+		if (!ws)
+			continue;
+		wl_list_for_each(rv, &ws->recent_views, link) {
+			struct weston_desktop_surface *ds =
+				weston_surface_get_desktop_surface(
+					rv->view->surface);
+			const char *app_id =
+				weston_desktop_surface_get_app_id(ds);
+			const char *title =
+				weston_desktop_surface_get_title(ds);
+			struct weston_output *output = rv->view->output;
+			struct tw_session_slot *slot;
+			float x, y;
+
+			//nothing to find it with on the way back
+			if (!app_id || !*app_id)
+				continue;
+			if (!(slot = tw_session_add_slots(session, 1)))
+				return false;
+			recent_view_get_origin_coord(rv, &x, &y);
+			slot->workspace = i;
+			slot->type = (rv->type == LAYOUT_FLOATING) ?
+				LAYOUT_FLOATING : LAYOUT_TILING;
+			slot->x = x;
+			slot->y = y;
+			slot->width = rv->visible_geometry.width;
+			slot->height = rv->visible_geometry.height;
+			snprintf(slot->app_id, sizeof(slot->app_id), "%s",
+			         app_id);
+			snprintf(slot->title, sizeof(slot->title), "%s",
+			         title ? title : "");
+			snprintf(slot->output, sizeof(slot->output), "%s",
+			         (output && output->name) ? output->name : "");
+		}
+	}
+	return true;
+}
+
+static bool
+session_capture_tree(struct desktop_session *s,
+                     struct session_capture *capture, int i,
+                     struct workspace *ws, struct weston_output *output)
+{
+	struct tw_session *session = capture->session;
+	struct tw_session_node *nodes = NULL, *grown;
+	struct tw_session_tree *tree;
+	int max = 64, n;
+
+	//a tree is rarely bigger than twice its views
+	while (true) {
+		if (!(grown = tw_realloc(TW_MEM_WORKSPACE, nodes,
+		                         max * sizeof(*nodes))))
+			goto err;
+		nodes = grown;
+		n = tiling_layout_save(&ws->tiling_layout, output,
+		                       nodes, max, session_slot_of, capture);
+		if (n >= 0 || max >= INT_MAX / 2)
+			break;
+		max *= 2;
+	}
+	if (capture->failed || n < 0)
+		goto err;
+	//nothing in it
+	if (n <= 1) {
+		tw_free(nodes);
+		return true;
+	}
+	if (!(tree = tw_session_add_trees(session, 1)))
+		goto err;
+	tree->workspace = i;
+	snprintf(tree->output, sizeof(tree->output), "%s", output->name);
+	tree->first = session->nnodes;
+	tree->len = n;
+	if (!(grown = tw_session_add_nodes(session, n)))
+		goto err;
+	memcpy(grown, nodes, n * sizeof(*nodes));
+	tw_free(nodes);
+	return true;
+err:
+	tw_free(nodes);
+	return false;
+}
+
+static void *
+session_encode(struct desktop_session *s, size_t *size)
+{
+	struct tw_session session;
+	struct weston_output *output;
+	struct session_capture capture = {
+		.session = &session,
+	};
+	void *buf = NULL;
+	uint32_t nviews;
+
+	TW_TRACE_SCOPE("desktop", "session_encode");
+	tw_session_init(&session);
+	for (int i = 0; i < TW_SESSION_WORKSPACES; i++) {
+		struct workspace_conf conf;
+		tw_desktop_get_workspace_conf(s->desktop, i, &conf);
+		session.workspaces[i].layout = conf.layout;
+		session.workspaces[i].masters = conf.masters;
+		session.workspaces[i].master_portion = conf.master_portion;
+	}
+	if (!session_capture_slots(s, &capture))
+		goto out;
+	//the placeholders may add as many slots as the last session had
+	nviews = session.nslots + s->last.nslots;
+	capture.views = tw_calloc(TW_MEM_WORKSPACE, nviews + 1,
+	                          sizeof(struct weston_view *));
+	capture.remap = tw_calloc(TW_MEM_WORKSPACE, s->last.nslots + 1,
+	                          sizeof(int32_t));
+	if (!capture.views || !capture.remap)
+		goto out;
+	//the slots are in the order of the recent views
+	for (int i = 0, j = 0; i < TW_SESSION_WORKSPACES; i++) {
+		struct recent_view *rv;
+		struct workspace *ws =
+			tw_desktop_get_workspace(s->desktop, i, false);
+		if (!ws)
+			continue;
+		wl_list_for_each(rv, &ws->recent_views, link) {
+			struct weston_desktop_surface *ds =
+				weston_surface_get_desktop_surface(
+					rv->view->surface);
+			const char *app_id =
+				weston_desktop_surface_get_app_id(ds);
+			if (app_id && *app_id)
+				capture.views[j++] = rv->view;
+		}
+	}
+	for (uint32_t i = 0; i < s->last.nslots; i++)
+		capture.remap[i] = -1;
+
+	for (int i = 0; i < TW_SESSION_WORKSPACES; i++) {
+		struct workspace *ws =
+			tw_desktop_get_workspace(s->desktop, i, false);
+		if (!ws)
+			continue;
+		wl_list_for_each(output, &s->ec->output_list, link)
+			if (output->name &&
+			    !session_capture_tree(s, &capture, i, ws, output))
+				goto out;
+	}
+
+	*size = tw_session_encode(&session, NULL, 0);
+	if ((buf = tw_malloc(TW_MEM_WORKSPACE, *size)))
+		tw_session_encode(&session, buf, *size);
+out:
+	tw_free(capture.views);
+	tw_free(capture.remap);
+	tw_session_release(&session);
+	return buf;
+}
+
+static void
+session_job_destroy(struct session_job *sj)
+{
+	tw_free(sj->buf);
+	tw_free(sj);
+}
+
+/* on a worker, it only touches the job */
+static void
+session_write(UNUSED_ARG(struct tw_job *job), void *data)
+{
+	struct session_job *sj = data;
+
+	sj->written = tw_session_write_file(sj->path, sj->buf, sj->size);
+}
+
+static void
+session_written(void *data, bool cancelled)
+{
+	struct session_job *sj = data;
+	struct desktop_session *s = &s_session;
+
+	if (s->writing == sj)
+		s->writing = NULL;
+	if (!cancelled && !sj->written)
+		tw_log_warn("session", "failed to write %s", sj->path);
+	session_job_destroy(sj);
+	if (!cancelled && s->save_again) {
+		s->save_again = false;
+		desktop_session_changed();
+	}
+}
+
+static void
+session_save(struct desktop_session *s)
+{
+	struct tw_job_sink *sink = tw_get_job_sink();
+	struct session_job *sj =
+		tw_zalloc(TW_MEM_WORKSPACE, sizeof(struct session_job));
+
+	if (!sj)
+		return;
+	if (!(sj->buf = session_encode(s, &sj->size))) {
+		session_job_destroy(sj);
+		return;
+	}
+	memcpy(sj->path, s->path, sizeof(sj->path));
+	if (sink && (sj->job = tw_job_submit(sink, session_write,
+	                                     session_written, sj))) {
+		s->writing = sj;
+		return;
+	}
+	//without the pool, it is not often anyway
+	if (!tw_session_write_file(s->path, sj->buf, sj->size))
+		tw_log_warn("session", "failed to write %s", s->path);
+	session_job_destroy(sj);
+}
+
+static int
+session_save_timeout(void *data)
+{
+	struct desktop_session *s = data;
+	TW_WATCHDOG_SOURCE("session");
+
+	s->save_armed = false;
+	//one file at a time, the next one has what came in the meantime
+	if (s->writing)
+		s->save_again = true;
+	else
+		session_save(s);
+	return 0;
+}
+
+void
+desktop_session_changed(void)
+{
+	struct desktop_session *s = &s_session;
+
+	if (!s->save_timer || s->save_armed)
+		return;
+	s->save_armed = true;
+	wl_event_source_timer_update(s->save_timer, SESSION_SAVE_DELAY_MS);
+}
+
+/*******************************************************************************
+ * restoring
+ ******************************************************************************/
+
+static void
+session_forget_last(struct desktop_session *s)
+{
+	tw_session_release(&s->last);
+	tw_free(s->claimed);
+	s->claimed = NULL;
+}
+
+static int
+session_expire(void *data)
+{
+	struct desktop_session *s = data;
+	uint32_t claimed = 0;
+	TW_WATCHDOG_SOURCE("session");
+
+	for (uint32_t i = 0; i < s->last.nslots; i++)
+		claimed += s->claimed[i];
+	tw_log_info("session", "%u of %u windows came back", claimed,
+	            s->last.nslots);
+	for (int i = 0; i < TW_SESSION_WORKSPACES; i++) {
+		struct workspace *ws =
+			tw_desktop_get_workspace(s->desktop, i, false);
+		if (ws && tiling_layout_drop_placeholders(&ws->tiling_layout))
+			ws->dirty_outputs = UINT32_MAX;
+	}
+	workspace_arrange(tw_desktop_get_workspace(
+		s->desktop, tw_desktop_get_current_workspace(s->desktop),
+		false));
+	session_forget_last(s);
+	wl_event_source_remove(s->expire_timer);
+	s->expire_timer = NULL;
+	//nothing waits any more, the workspaces kept for it can go
+	tw_desktop_reclaim_workspaces(s->desktop);
+	desktop_session_changed();
+	return 0;
+}
+
+void
+desktop_session_add_output(struct weston_output *output)
+{
+	struct desktop_session *s = &s_session;
+
+	if (!s->claimed || !output->name)
+		return;
+	for (uint32_t i = 0; i < s->last.ntrees; i++) {
+		const struct tw_session_tree *tree = &s->last.trees[i];
+		struct workspace *ws;
+
+		if (strcmp(tree->output, output->name))
+			continue;
+		//the placeholders are a use of the workspace
+		ws = tw_desktop_get_workspace(s->desktop, tree->workspace,
+		                              true);
+		if (ws)
+			tiling_layout_load(&ws->tiling_layout, output,
+			                   &s->last.nodes[tree->first],
+			                   tree->len);
+	}
+}
+
+bool
+desktop_session_waiting(void)
+{
+	return s_session.claimed != NULL;
+}
+
+static struct weston_output *
+session_find_output(struct desktop_session *s, const char *name)
+{
+	struct weston_output *output;
+
+	wl_list_for_each(output, &s->ec->output_list, link)
+		if (output->name && !strcmp(output->name, name))
+			return output;
+	return NULL;
+}
+
+bool
+desktop_session_claim(struct weston_desktop_surface *surface,
+                      struct desktop_session_place *place)
+{
+	struct desktop_session *s = &s_session;
+	const char *app_id = weston_desktop_surface_get_app_id(surface);
+	const char *title = weston_desktop_surface_get_title(surface);
+	const struct tw_session_slot *slot;
+	int64_t found = -1;
+
+	if (!s->claimed || !app_id)
+		return false;
+	title = title ? title : "";
+	//the same title first, they change though
+	for (int pass = 0; pass < 2 && found < 0; pass++)
+		for (uint32_t i = 0; i < s->last.nslots && found < 0; i++) {
+			slot = &s->last.slots[i];
+			if (s->claimed[i] || strcmp(slot->app_id, app_id) ||
+			    (!pass && strcmp(slot->title, title)))
+				continue;
+			found = i;
+		}
+	if (found < 0)
+		return false;
+	slot = &s->last.slots[found];
+	s->claimed[found] = true;
+	*place = (struct desktop_session_place){
+		.workspace = slot->workspace,
+		.type = (slot->type == LAYOUT_FLOATING) ?
+			LAYOUT_FLOATING : LAYOUT_TILING,
+		.placeholder = found + 1,
+		.geometry = {-1, -1, -1, -1},
+		.output = session_find_output(s, slot->output),
+	};
+	//on the same output or the floating layout places it
+	if (place->output && slot->width > 0 && slot->height > 0)
+		place->geometry = (struct weston_geometry){
+			slot->x, slot->y, slot->width, slot->height};
+	return true;
+}
+
+static void
+session_restore_workspaces(struct desktop_session *s)
+{
+	for (int i = 0; i < TW_SESSION_WORKSPACES; i++) {
+		const struct tw_session_workspace *sw = &s->last.workspaces[i];
+		struct workspace_conf conf;
+
+		if (sw->layout > LAYOUT_MONOCLE)
+			continue;
+		tw_desktop_get_workspace_conf(s->desktop, i, &conf);
+		if (sw->masters)
+			conf.masters = sw->masters;
+		if (isfinite(sw->master_portion) &&
+		    sw->master_portion >= 0.1 && sw->master_portion <= 0.9)
+			conf.master_portion = sw->master_portion;
+		conf.layout = sw->layout;
+		tw_desktop_set_workspace_conf(s->desktop, i, &conf);
+	}
+}
+
+void
+desktop_session_init(struct weston_compositor *ec, struct desktop *desktop)
+{
+	struct desktop_session *s = &s_session;
+	struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+	size_t size = 0;
+	void *buf;
+
+	s->ec = ec;
+	s->desktop = desktop;
+	tw_session_path(s->path, sizeof(s->path));
+	tw_session_init(&s->last);
+	s->save_timer = wl_event_loop_add_timer(loop, session_save_timeout, s);
+
+	if (!(buf = tw_session_read_file(s->path, &size)))
+		return;
+	if (!tw_session_decode(&s->last, buf, size)) {
+		tw_log_warn("session", "ignoring %s, damaged or of an other "
+		            "version", s->path);
+		free(buf);
+		return;
+	}
+	free(buf);
+	session_restore_workspaces(s);
+	if (!s->last.nslots)
+		return;
+	s->claimed = tw_calloc(TW_MEM_WORKSPACE, s->last.nslots, sizeof(bool));
+	s->expire_timer = s->claimed ?
+		wl_event_loop_add_timer(loop, session_expire, s) : NULL;
+	if (!s->expire_timer) {
+		session_forget_last(s);
+		return;
+	}
+	wl_event_source_timer_update(s->expire_timer, SESSION_PLACEHOLDER_MS);
+	tw_log_info("session", "waiting for %u windows of %s", s->last.nslots,
+	            s->path);
+}
+
+/* the worker renames its file at the end, a file written after has to wait
+ * for it, or the older snapshot could land last */
+static void
+session_wait_writing(struct desktop_session *s)
+{
+	struct tw_job_sink *sink = tw_get_job_sink();
+	struct pollfd pfd = { .events = POLLIN };
+
+	if (!s->writing || !sink)
+		return;
+	//a queued one never runs, a running one finishes its file
+	tw_job_cancel(s->writing->job);
+	pfd.fd = tw_job_sink_get_fd(sink);
+	while (s->writing && poll(&pfd, 1, SESSION_END_WAIT_MS) > 0)
+		tw_job_sink_dispatch(sink);
+}
+
+void
+desktop_session_end(void)
+{
+	struct desktop_session *s = &s_session;
+	bool pending = s->save_armed || s->save_again || s->writing;
+	void *buf;
+	size_t size;
+
+	if (s->save_timer)
+		wl_event_source_remove(s->save_timer);
+	if (s->expire_timer)
+		wl_event_source_remove(s->expire_timer);
+	s->save_timer = s->expire_timer = NULL;
+	s->save_armed = s->save_again = false;
+	//a change not on the disk yet is written here, the desktop is still up
+	if (pending && s->desktop) {
+		session_wait_writing(s);
+		if ((buf = session_encode(s, &size))) {
+			if (!tw_session_write_file(s->path, buf, size))
+				tw_log_warn("session", "failed to write %s",
+				            s->path);
+			tw_free(buf);
+		}
+	}
+	//the done callback still comes, from the sink
+	if (s->writing)
+		tw_job_cancel(s->writing->job);
+	session_forget_last(s);
+	*s = (struct desktop_session){0};
+}
@@ -0,0 +1,88 @@
+/*
+ * session.h - taiwins desktop session save and restore
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_DESKTOP_SESSION_H
+#define TW_DESKTOP_SESSION_H
+
+#include <stdbool.h>
+#include <libweston/libweston.h>
+#include <libweston-desktop/libweston-desktop.h>
+
+#include "../taiwins.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+struct desktop;
+
+/* where a window of the last session goes */
+struct desktop_session_place {
+	int workspace;
+	enum tw_layout_type type;
+	uint32_t placeholder; /**< for layout_op::placeholder */
+	struct weston_geometry geometry; /**< floating only */
+	struct weston_output *output; /**< NULL if it is gone */
+};
+
+/**
+ * @brief read the last session, the workspaces get their layouts back
+ *
+ * The tiling trees wait for the outputs, see desktop_session_add_output. The
+ * saving starts here too.
+ */
+void
+desktop_session_init(struct weston_compositor *ec, struct desktop *desktop);
+
+void
+desktop_session_end(void);
+
+/**
+ * @brief put the saved trees of the output in the workspaces, as placeholders
+ */
+void
+desktop_session_add_output(struct weston_output *output);
+
+/**
+ * @brief true while windows of the last session may still come back, the
+ * workspaces keep their placeholders until then
+ */
+bool
+desktop_session_waiting(void);
+
+/**
+ * @brief find the slot of a new window by its app id and title
+ */
+bool
+desktop_session_claim(struct weston_desktop_surface *surface,
+                      struct desktop_session_place *place);
+
+/**
+ * @brief the desktop changed, the session is saved a little later
+ */
+void
+desktop_session_changed(void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
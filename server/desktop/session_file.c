@@ -0,0 +1,479 @@
+/*
+ * session_file.c - taiwins desktop session file
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <alloc.h>
+
+#include "session_file.h"
+
+/*
+ * header:    "TWSN" u16 version, u16 workspaces, u32 slots, u32 trees
+ * workspace: u8 layout, u8 masters, f32 master portion
+ * slot:      u8 workspace, u8 type, i32 x, y, width, height,
+ *            str app id, str title, str output
+ * tree:      u8 workspace, str output, u32 nodes, then the nodes
+ * node:      i32 slot, u8 vertical, f32 portion, u16 children, u8 container
+ * trailer:   u32 fnv-1a of everything before it
+ *
+ * a str is a u8 length and the bytes, without the zero.
+ */
+
+static const char session_magic[4] = {'T', 'W', 'S', 'N'};
+
+//the tiling tree has 32 levels at most
+#define SESSION_MAX_DEPTH 32
+//split, tabbed and stacked
+#define SESSION_MAX_CONTAINER 2
+
+void
+tw_session_init(struct tw_session *session)
+{
+	*session = (struct tw_session){0};
+	//the ones a shorter file has not stay tiled, like a new workspace
+	for (int i = 0; i < TW_SESSION_WORKSPACES; i++) {
+		session->workspaces[i].layout = TW_SESSION_LAYOUT_TILING;
+		session->workspaces[i].masters = 1;
+		session->workspaces[i].master_portion = 0.5;
+	}
+}
+
+void
+tw_session_release(struct tw_session *session)
+{
+	tw_free(session->slots);
+	tw_free(session->trees);
+	tw_free(session->nodes);
+	tw_session_init(session);
+}
+
+static void *
+session_grow(void **array, uint32_t *len, uint32_t n, size_t elem)
+{
+	char *grown;
+
+	if (n > UINT32_MAX - *len)
+		return NULL;
+	grown = tw_realloc(TW_MEM_WORKSPACE, *array, (*len + n) * elem);
+	if (!grown)
+		return NULL;
+	memset(grown + *len * elem, 0, n * elem);
+	*array = grown;
+	*len += n;
+	return grown + (*len - n) * elem;
+}
+
+struct tw_session_slot *
+tw_session_add_slots(struct tw_session *session, uint32_t n)
+{
+	return session_grow((void **)&session->slots, &session->nslots, n,
+	                    sizeof(struct tw_session_slot));
+}
+
+struct tw_session_tree *
+tw_session_add_trees(struct tw_session *session, uint32_t n)
+{
+	return session_grow((void **)&session->trees, &session->ntrees, n,
+	                    sizeof(struct tw_session_tree));
+}
+
+struct tw_session_node *
+tw_session_add_nodes(struct tw_session *session, uint32_t n)
+{
+	return session_grow((void **)&session->nodes, &session->nnodes, n,
+	                    sizeof(struct tw_session_node));
+}
+
+/*******************************************************************************
+ * encoding
+ ******************************************************************************/
+
+/* the writer counts everything, it only writes what fits */
+struct session_writer {
+	uint8_t *buf;
+	size_t size, pos;
+};
+
+static void
+put(struct session_writer *w, const void *data, size_t len)
+{
+	if (w->buf && w->pos + len <= w->size)
+		memcpy(w->buf + w->pos, data, len);
+	w->pos += len;
+}
+
+static inline void
+put_u8(struct session_writer *w, uint8_t v)
+{
+	put(w, &v, sizeof(v));
+}
+
+static inline void
+put_u16(struct session_writer *w, uint16_t v)
+{
+	put(w, &v, sizeof(v));
+}
+
+static inline void
+put_u32(struct session_writer *w, uint32_t v)
+{
+	put(w, &v, sizeof(v));
+}
+
+static inline void
+put_f32(struct session_writer *w, float v)
+{
+	put(w, &v, sizeof(v));
+}
+
+static inline void
+put_str(struct session_writer *w, const char *str, size_t max)
+{
+	size_t len = strnlen(str, max);
+
+	len = len > UINT8_MAX ? UINT8_MAX : len;
+	put_u8(w, len);
+	put(w, str, len);
+}
+
+static uint32_t
+session_hash(const uint8_t *data, size_t len)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+size_t
+tw_session_encode(const struct tw_session *session, void *buf, size_t size)
+{
+	struct session_writer w = {.buf = buf, .size = size};
+
+	put(&w, session_magic, sizeof(session_magic));
+	put_u16(&w, TW_SESSION_VERSION);
+	put_u16(&w, TW_SESSION_WORKSPACES);
+	put_u32(&w, session->nslots);
+	put_u32(&w, session->ntrees);
+	for (int i = 0; i < TW_SESSION_WORKSPACES; i++) {
+		const struct tw_session_workspace *ws =
+			&session->workspaces[i];
+		put_u8(&w, ws->layout);
+		put_u8(&w, ws->masters);
+		put_f32(&w, ws->master_portion);
+	}
+	for (uint32_t i = 0; i < session->nslots; i++) {
+		const struct tw_session_slot *slot = &session->slots[i];
+		put_u8(&w, slot->workspace);
+		put_u8(&w, slot->type);
+		put_u32(&w, slot->x);
+		put_u32(&w, slot->y);
+		put_u32(&w, slot->width);
+		put_u32(&w, slot->height);
+		put_str(&w, slot->app_id, sizeof(slot->app_id));
+		put_str(&w, slot->title, sizeof(slot->title));
+		put_str(&w, slot->output, sizeof(slot->output));
+	}
+	for (uint32_t i = 0; i < session->ntrees; i++) {
+		const struct tw_session_tree *tree = &session->trees[i];
+		put_u8(&w, tree->workspace);
+		put_str(&w, tree->output, sizeof(tree->output));
+		put_u32(&w, tree->len);
+		for (uint32_t j = 0; j < tree->len; j++) {
+			const struct tw_session_node *node =
+				&session->nodes[tree->first + j];
+			put_u32(&w, node->slot);
+			put_u8(&w, node->vertical);
+			put_f32(&w, node->portion);
+			put_u16(&w, node->nchildren);
+			put_u8(&w, node->container);
+		}
+	}
+	if (w.buf && w.pos + sizeof(uint32_t) <= w.size)
+		put_u32(&w, session_hash(w.buf, w.pos));
+	else
+		w.pos += sizeof(uint32_t);
+	return w.pos;
+}
+
+/*******************************************************************************
+ * decoding
+ ******************************************************************************/
+
+/* the reader fails for good at the first short read */
+struct session_reader {
+	const uint8_t *buf;
+	size_t size, pos;
+	bool failed;
+};
+
+static bool
+get(struct session_reader *r, void *data, size_t len)
+{
+	if (r->failed || len > r->size - r->pos) {
+		r->failed = true;
+		memset(data, 0, len);
+		return false;
+	}
+	memcpy(data, r->buf + r->pos, len);
+	r->pos += len;
+	return true;
+}
+
+static inline uint8_t
+get_u8(struct session_reader *r)
+{
+	uint8_t v;
+	get(r, &v, sizeof(v));
+	return v;
+}
+
+static inline uint16_t
+get_u16(struct session_reader *r)
+{
+	uint16_t v;
+	get(r, &v, sizeof(v));
+	return v;
+}
+
+static inline uint32_t
+get_u32(struct session_reader *r)
+{
+	uint32_t v;
+	get(r, &v, sizeof(v));
+	return v;
+}
+
+static inline float
+get_f32(struct session_reader *r)
+{
+	float v;
+	get(r, &v, sizeof(v));
+	return v;
+}
+
+static void
+get_str(struct session_reader *r, char *str, size_t max)
+{
+	size_t len = get_u8(r);
+
+	if (len >= max || !get(r, str, len)) {
+		r->failed = true;
+		len = 0;
+	}
+	str[len] = '\0';
+	//a zero inside would make it a different string than the one written
+	if (strlen(str) != len)
+		r->failed = true;
+}
+
+/* one node and its subtree, returns how many nodes it took, 0 on error */
+static uint32_t
+session_check_subtree(const struct tw_session_node *nodes, uint32_t len,
+                      uint32_t nslots, int depth)
+{
+	uint32_t count = 1;
+
+	if (!len || depth >= SESSION_MAX_DEPTH)
+		return 0;
+	//the portions are renormalized on every insert, they drift a little
+	if (!isfinite(nodes[0].portion) || nodes[0].portion <= 0.0 ||
+	    nodes[0].portion > 1.001)
+		return 0;
+	if (nodes[0].slot >= 0 &&
+	    ((uint32_t)nodes[0].slot >= nslots || nodes[0].nchildren))
+		return 0;
+	if (nodes[0].slot < -1 || nodes[0].container > SESSION_MAX_CONTAINER)
+		return 0;
+	for (int i = 0; i < nodes[0].nchildren; i++) {
+		uint32_t taken = session_check_subtree(&nodes[count],
+		                                       len - count, nslots,
+		                                       depth + 1);
+		if (!taken)
+			return 0;
+		count += taken;
+	}
+	return count;
+}
+
+bool
+tw_session_decode(struct tw_session *session, const void *buf, size_t size)
+{
+	struct session_reader r = {.buf = buf, .size = size};
+	char magic[sizeof(session_magic)];
+	uint16_t version, nworkspaces;
+	uint32_t nslots, ntrees, hash;
+
+	tw_session_init(session);
+	if (size < sizeof(uint32_t))
+		return false;
+	r.size = size - sizeof(uint32_t);
+	memcpy(&hash, (const uint8_t *)buf + r.size, sizeof(hash));
+	if (hash != session_hash(buf, r.size))
+		return false;
+
+	get(&r, magic, sizeof(magic));
+	version = get_u16(&r);
+	nworkspaces = get_u16(&r);
+	nslots = get_u32(&r);
+	ntrees = get_u32(&r);
+	if (r.failed || memcmp(magic, session_magic, sizeof(magic)) ||
+	    version != TW_SESSION_VERSION)
+		return false;
+	//every slot takes more than 16 bytes, so it cannot ask for too much
+	if (nslots > r.size / 16 || ntrees > r.size / 8)
+		return false;
+
+	for (int i = 0; i < nworkspaces; i++) {
+		struct tw_session_workspace ws = {
+			.layout = get_u8(&r),
+			.masters = get_u8(&r),
+			.master_portion = get_f32(&r),
+		};
+		if (i < TW_SESSION_WORKSPACES)
+			session->workspaces[i] = ws;
+	}
+	if (nslots && !tw_session_add_slots(session, nslots))
+		goto err;
+	for (uint32_t i = 0; i < nslots && !r.failed; i++) {
+		struct tw_session_slot *slot = &session->slots[i];
+		slot->workspace = get_u8(&r);
+		slot->type = get_u8(&r);
+		slot->x = get_u32(&r);
+		slot->y = get_u32(&r);
+		slot->width = get_u32(&r);
+		slot->height = get_u32(&r);
+		get_str(&r, slot->app_id, sizeof(slot->app_id));
+		get_str(&r, slot->title, sizeof(slot->title));
+		get_str(&r, slot->output, sizeof(slot->output));
+		if (slot->workspace >= TW_SESSION_WORKSPACES)
+			r.failed = true;
+	}
+	if (ntrees && !tw_session_add_trees(session, ntrees))
+		goto err;
+	for (uint32_t i = 0; i < ntrees && !r.failed; i++) {
+		struct tw_session_tree *tree = &session->trees[i];
+		struct tw_session_node *nodes;
+		uint32_t len;
+
+		tree->workspace = get_u8(&r);
+		get_str(&r, tree->output, sizeof(tree->output));
+		len = get_u32(&r);
+		//a node is 12 bytes
+		if (r.failed || !len || len > (r.size - r.pos) / 12 ||
+		    tree->workspace >= TW_SESSION_WORKSPACES)
+			goto err;
+		tree->first = session->nnodes;
+		tree->len = len;
+		if (!(nodes = tw_session_add_nodes(session, len)))
+			goto err;
+		for (uint32_t j = 0; j < len; j++) {
+			nodes[j].slot = get_u32(&r);
+			nodes[j].vertical = get_u8(&r);
+			nodes[j].portion = get_f32(&r);
+			nodes[j].nchildren = get_u16(&r);
+			nodes[j].container = get_u8(&r);
+		}
+		if (session_check_subtree(nodes, len, nslots, 0) != len)
+			goto err;
+	}
+	if (r.failed || r.pos != r.size)
+		goto err;
+	return true;
+err:
+	tw_session_release(session);
+	return false;
+}
+
+/*******************************************************************************
+ * files
+ ******************************************************************************/
+
+bool
+tw_session_write_file(const char *path, const void *buf, size_t size)
+{
+	char tmp[PATH_MAX];
+	const uint8_t *data = buf;
+	size_t written = 0;
+	int fd;
+
+	if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp))
+		return false;
+	if ((fd = mkostemp(tmp, O_CLOEXEC)) < 0)
+		return false;
+	while (written < size) {
+		ssize_t n = write(fd, data + written, size - written);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			goto err;
+		written += n;
+	}
+	if (fsync(fd) < 0)
+		goto err;
+	close(fd);
+	if (rename(tmp, path) < 0) {
+		unlink(tmp);
+		return false;
+	}
+	return true;
+err:
+	close(fd);
+	unlink(tmp);
+	return false;
+}
+
+void *
+tw_session_read_file(const char *path, size_t *size)
+{
+	struct stat st;
+	uint8_t *buf = NULL;
+	size_t got = 0;
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0)
+		return NULL;
+	//nobody has this many windows
+	if (fstat(fd, &st) < 0 || st.st_size <= 0 || st.st_size > (1 << 24))
+		goto out;
+	if (!(buf = malloc(st.st_size)))
+		goto out;
+	while (got < (size_t)st.st_size) {
+		ssize_t n = read(fd, buf + got, st.st_size - got);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+		got += n;
+	}
+	*size = got;
+out:
+	close(fd);
+	return buf;
+}
@@ -0,0 +1,150 @@
+/*
+ * session_file.h - taiwins desktop session file
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_SESSION_FILE_H
+#define TW_SESSION_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * What the desktop looked like, to put the windows back after a restart. A
+ * slot is a window we expect to come back, found by its app id and title. The
+ * tiling trees are in preorder and point at the slots in their leaves.
+ *
+ * The file is in native byte order, it never leaves the machine. Any change of
+ * the layout below bumps TW_SESSION_VERSION, an other version is not read.
+ */
+
+#define TW_SESSION_VERSION 2
+#define TW_SESSION_WORKSPACES 32 /**< MAX_WORKSPACE */
+#define TW_SESSION_LAYOUT_TILING 1 /**< LAYOUT_TILING */
+
+struct tw_session_workspace {
+	uint8_t layout; /**< enum tw_layout_type */
+	uint8_t masters;
+	float master_portion;
+};
+
+struct tw_session_slot {
+	uint8_t workspace;
+	uint8_t type; /**< LAYOUT_TILING or LAYOUT_FLOATING */
+	int32_t x, y, width, height; /**< floating geometry */
+	char app_id[128];
+	char title[256];
+	char output[64];
+};
+
+struct tw_session_node {
+	int32_t slot; /**< -1 for a split */
+	bool vertical;
+	float portion;
+	uint16_t nchildren;
+	uint8_t container; /**< 0 a split, 1 tabbed, 2 stacked */
+};
+
+struct tw_session_tree {
+	uint8_t workspace;
+	char output[64];
+	uint32_t first, len; /**< in the nodes, the first one is the root */
+};
+
+struct tw_session {
+	struct tw_session_workspace workspaces[TW_SESSION_WORKSPACES];
+	struct tw_session_slot *slots;
+	struct tw_session_tree *trees;
+	struct tw_session_node *nodes;
+	uint32_t nslots, ntrees, nnodes;
+};
+
+void
+tw_session_init(struct tw_session *session);
+
+void
+tw_session_release(struct tw_session *session);
+
+/**
+ * @brief append n zeroed ones, NULL without memory
+ */
+struct tw_session_slot *
+tw_session_add_slots(struct tw_session *session, uint32_t n);
+
+struct tw_session_tree *
+tw_session_add_trees(struct tw_session *session, uint32_t n);
+
+struct tw_session_node *
+tw_session_add_nodes(struct tw_session *session, uint32_t n);
+
+/**
+ * @brief serialize into buf if it is large enough
+ *
+ * @return the size of the encoding, pass a NULL buf to get it first
+ */
+size_t
+tw_session_encode(const struct tw_session *session, void *buf, size_t size);
+
+/**
+ * @brief the opposite of tw_session_encode, the session is initialized in here
+ *
+ * Everything is checked, a truncated or corrupted file, or one of an other
+ * version, gives false and an empty session.
+ */
+bool
+tw_session_decode(struct tw_session *session, const void *buf, size_t size);
+
+/**
+ * @brief replace the file at path in one piece, it is fsync'ed, so not for the
+ * main thread
+ */
+bool
+tw_session_write_file(const char *path, const void *buf, size_t size);
+
+/**
+ * @brief read the whole file, free it with free
+ */
+void *
+tw_session_read_file(const char *path, size_t *size);
+
+static inline void
+tw_session_path(char *path, size_t len)
+{
+	const char *env = getenv("TAIWINS_SESSION");
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+
+	if (env)
+		snprintf(path, len, "%s", env);
+	else
+		snprintf(path, len, "%s/taiwins-session",
+		         runtime ? runtime : "/tmp");
+}
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -31,6 +31,7 @@
 #include <ctypes/os/file.h>
 #include <ctypes/vector.h>
 #include <shared_config.h>
+#include <alloc.h>
 
 #include "../taiwins.h"
 #include "shell.h"
@@ -245,7 +246,7 @@ shell_ui_unbind_free(struct wl_resource *resource)
 {
 	struct shell_ui *ui = wl_resource_get_user_data(resource);
 	shell_ui_unbind(resource);
-	free(ui);
+	tw_free(ui);
 }
 
 static bool
@@ -404,6 +405,7 @@ commit_background(struct weston_surface *surface,
 	struct weston_view *view =
 		container_of(surface->views.next,
 			     struct weston_view, surface_link);
+	tw_client_stats_commit(surface);
 	//it is not true for both
 	if (surface->buffer_ref.buffer)
 		setup_view(view, ui->layer, ui->x, ui->y);
@@ -423,6 +425,7 @@ commit_panel(struct weston_surface *surface,
 	struct wl_display *display = shell->ec->wl_display;
 	struct wl_event_loop *loop = wl_display_get_event_loop(display);
 
+	tw_client_stats_commit(surface);
 	if (!surface->buffer_ref.buffer)
 		return;
 	ui->y = (output->shell->panel_pos == TAIWINS_SHELL_PANEL_POS_TOP) ?
@@ -453,6 +456,7 @@ commit_ui_surface(struct weston_surface *surface,
 	struct weston_view *view =
 		container_of(surface->views.next,
 		             struct weston_view, surface_link);
+	tw_client_stats_commit(surface);
 	//it is not true for both
 	if (surface->buffer_ref.buffer)
 		setup_view(view, ui->layer, ui->x, ui->y);
@@ -464,6 +468,8 @@ commit_lock_surface(struct weston_surface *surface,
 {
 	struct weston_view *view;
 	struct shell_ui *ui = surface->committed_private;
+
+	tw_client_stats_commit(surface);
 	wl_list_for_each(view, &surface->views, surface_link)
 		setup_view(view, ui->layer, 0, 0);
 }
@@ -560,7 +566,7 @@ create_ui_element(struct wl_client *client,
 		return;
 	}
 	if (!elem)
-		elem = zalloc(sizeof(struct shell_ui));
+		elem = tw_zalloc(TW_MEM_SHELL_UI, sizeof(struct shell_ui));
 
 	if (type == TAIWINS_UI_TYPE_WIDGET)
 		shell_ui_create_with_binding(elem, tw_ui_resource, surface);
@@ -0,0 +1,285 @@
+/*
+ * switcher.c - taiwins desktop task switcher table
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <libweston/libweston.h>
+#include <libweston-desktop/libweston-desktop.h>
+#include <ctypes/strops.h>
+
+#include <shared_switcher.h>
+#include "workspace.h"
+#include "switcher.h"
+#include "thumb_atlas.h"
+
+static struct desktop_switcher {
+	char path[256];
+	int fd;
+	struct tw_switcher_page *page;
+	//the thumbnails, drawn only while the switcher is on screen
+	char thumbs_path[256];
+	int thumbs_fd;
+	void *thumbs;
+	struct thumb_atlas atlas;
+	bool shown;
+} s_switcher = {
+	.fd = -1,
+	.thumbs_fd = -1,
+};
+
+static void *
+switcher_map(const char *path, size_t size, int *fd)
+{
+	void *mem;
+
+	//a file left by a crashed compositor goes away, then we only create a
+	//fresh one, never follow a link or reuse what someone else put there
+	unlink(path);
+	*fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+	           0600);
+	if (*fd < 0)
+		return NULL;
+	if (ftruncate(*fd, size) < 0)
+		return NULL;
+	mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+	return (mem == MAP_FAILED) ? NULL : mem;
+}
+
+static void
+switcher_unmap(const char *path, void *mem, size_t size, int *fd)
+{
+	if (mem)
+		munmap(mem, size);
+	if (*fd >= 0) {
+		close(*fd);
+		unlink(path);
+	}
+	*fd = -1;
+}
+
+bool
+desktop_switcher_init(void)
+{
+	struct desktop_switcher *s = &s_switcher;
+
+	if (!tw_switcher_page_path(s->path, sizeof(s->path)))
+		return false;
+	s->page = switcher_map(s->path, sizeof(struct tw_switcher_page),
+	                       &s->fd);
+	if (!s->page)
+		goto err;
+	s->page->magic = TW_SWITCHER_MAGIC;
+	s->page->version = TW_SWITCHER_VERSION;
+
+	if (!tw_thumbs_page_path(s->thumbs_path, sizeof(s->thumbs_path)))
+		goto err;
+	s->thumbs = switcher_map(s->thumbs_path, TW_THUMBS_SIZE,
+	                         &s->thumbs_fd);
+	if (!s->thumbs)
+		goto err;
+	thumb_atlas_init(&s->atlas, s->thumbs);
+
+	setenv("TAIWINS_SWITCHER", s->path, 1);
+	setenv("TAIWINS_THUMBS", s->thumbs_path, 1);
+	return true;
+err:
+	desktop_switcher_end();
+	return false;
+}
+
+void
+desktop_switcher_end(void)
+{
+	struct desktop_switcher *s = &s_switcher;
+
+	switcher_unmap(s->path, s->page, sizeof(struct tw_switcher_page),
+	               &s->fd);
+	switcher_unmap(s->thumbs_path, s->thumbs, TW_THUMBS_SIZE,
+	               &s->thumbs_fd);
+	s->page = NULL;
+	s->thumbs = NULL;
+	s->shown = false;
+}
+
+static void
+switcher_brief(struct recent_view *rv, struct tw_window_brief *brief)
+{
+	struct weston_desktop_surface *surface =
+		weston_surface_get_desktop_surface(rv->view->surface);
+	const char *title = weston_desktop_surface_get_title(surface);
+
+	//zeroed to the end, so two of them compare with memcmp
+	memset(brief, 0, sizeof(*brief));
+	if (title)
+		strop_ncpy(brief->name, title, sizeof(brief->name));
+	recent_view_get_origin_coord(rv, &brief->x, &brief->y);
+	brief->w = rv->view->surface->width;
+	brief->h = rv->view->surface->height;
+}
+
+void
+desktop_switcher_add(struct recent_view *rv)
+{
+	struct tw_switcher_page *page = s_switcher.page;
+	uint32_t slot;
+
+	rv->slot = -1;
+	if (!page)
+		return;
+	for (slot = 0; slot < page->nslots; slot++)
+		if (!page->slots[slot].id)
+			break;
+	if (slot == TW_SWITCHER_MAX_VIEWS)
+		return;
+
+	tw_switcher_page_write_begin(page);
+	page->slots[slot].id = rv->id;
+	switcher_brief(rv, &page->slots[slot].brief);
+	if (slot == page->nslots)
+		page->nslots++;
+	tw_switcher_page_write_end(page);
+	rv->slot = slot;
+}
+
+void
+desktop_switcher_remove(struct recent_view *rv)
+{
+	struct tw_switcher_page *page = s_switcher.page;
+
+	if (s_switcher.thumbs)
+		thumb_atlas_forget(&s_switcher.atlas, rv->id);
+	if (!page || rv->slot < 0)
+		return;
+	tw_switcher_page_write_begin(page);
+	page->slots[rv->slot].id = 0;
+	while (page->nslots && !page->slots[page->nslots-1].id)
+		page->nslots--;
+	//the slot may come back for an other window
+	for (uint32_t i = 0; i < page->norder; i++)
+		if (page->order[i] == rv->slot) {
+			memmove(&page->order[i], &page->order[i+1],
+			        (page->norder - i - 1) * sizeof(page->order[0]));
+			page->norder--;
+			break;
+		}
+	tw_switcher_page_write_end(page);
+	rv->slot = -1;
+}
+
+void
+desktop_switcher_update(struct recent_view *rv)
+{
+	struct tw_switcher_page *page = s_switcher.page;
+	struct tw_window_brief brief;
+
+	if (!page || rv->slot < 0)
+		return;
+	switcher_brief(rv, &brief);
+	if (!memcmp(&brief, &page->slots[rv->slot].brief, sizeof(brief)))
+		return;
+	tw_switcher_page_write_begin(page);
+	page->slots[rv->slot].brief = brief;
+	tw_switcher_page_write_end(page);
+}
+
+uint32_t
+desktop_switcher_order(struct workspace *ws)
+{
+	struct tw_switcher_page *page = s_switcher.page;
+	struct recent_view *rv;
+	uint32_t n = 0;
+
+	if (!page)
+		return UINT32_MAX;
+	tw_switcher_page_write_begin(page);
+	wl_list_for_each(rv, &ws->recent_views, link)
+		if (rv->slot >= 0)
+			page->order[n++] = rv->slot;
+	page->norder = n;
+	tw_switcher_page_write_end(page);
+	//the most recent windows are the last to lose their thumbnails
+	if (s_switcher.thumbs)
+		wl_list_for_each_reverse(rv, &ws->recent_views, link)
+			thumb_atlas_touch(&s_switcher.atlas, rv->id);
+	return n ? page->order[0] : UINT32_MAX;
+}
+
+void
+desktop_switcher_show(bool shown)
+{
+	s_switcher.shown = shown;
+}
+
+static inline uint64_t
+switcher_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void
+desktop_switcher_commit(struct recent_view *rv)
+{
+	struct desktop_switcher *s = &s_switcher;
+	struct weston_buffer *buffer = rv->view->surface->buffer_ref.buffer;
+	struct wl_shm_buffer *shm = NULL;
+	pixman_format_code_t format;
+	pixman_image_t *image;
+	uint64_t now = switcher_now_ms();
+
+	if (!s->thumbs || !s->shown || !thumb_atlas_due(&s->atlas, rv->id, now))
+		return;
+	//reading back dmabuf or egl buffers needs the renderer, they keep
+	//their old thumbnail if they have one
+	if (buffer && buffer->resource)
+		shm = wl_shm_buffer_get(buffer->resource);
+	if (!shm)
+		return;
+	switch (wl_shm_buffer_get_format(shm)) {
+	case WL_SHM_FORMAT_ARGB8888:
+		format = PIXMAN_a8r8g8b8;
+		break;
+	case WL_SHM_FORMAT_XRGB8888:
+		format = PIXMAN_x8r8g8b8;
+		break;
+	case WL_SHM_FORMAT_RGB565:
+		format = PIXMAN_r5g6b5;
+		break;
+	default:
+		return;
+	}
+	wl_shm_buffer_begin_access(shm);
+	image = pixman_image_create_bits(format,
+	                                 wl_shm_buffer_get_width(shm),
+	                                 wl_shm_buffer_get_height(shm),
+	                                 wl_shm_buffer_get_data(shm),
+	                                 wl_shm_buffer_get_stride(shm));
+	if (image) {
+		thumb_atlas_update(&s->atlas, rv->id, image, now);
+		pixman_image_unref(image);
+	}
+	wl_shm_buffer_end_access(shm);
+}
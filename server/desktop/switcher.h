@@ -0,0 +1,89 @@
+/*
+ * switcher.h - taiwins desktop task switcher table
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_DESKTOP_SWITCHER_H
+#define TW_DESKTOP_SWITCHER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+struct recent_view;
+struct workspace;
+
+/**
+ * @brief map the table and the thumbnails the shell reads, see
+ * shared_switcher.h
+ *
+ * Their paths go to TAIWINS_SWITCHER and TAIWINS_THUMBS for the clients we
+ * launch.
+ */
+bool
+desktop_switcher_init(void);
+
+void
+desktop_switcher_end(void);
+
+/**
+ * @brief give the view a slot, no slot is taken if the table is full
+ */
+void
+desktop_switcher_add(struct recent_view *rv);
+
+void
+desktop_switcher_remove(struct recent_view *rv);
+
+/**
+ * @brief write the slot of the view again, if its title or geometry changed
+ */
+void
+desktop_switcher_update(struct recent_view *rv);
+
+/**
+ * @brief write the order of the workspace
+ *
+ * @return the slot of its first view, UINT32_MAX if it has none in the table
+ */
+uint32_t
+desktop_switcher_order(struct workspace *ws);
+
+/**
+ * @brief the switcher went on or off screen, thumbnails are drawn only while
+ * it is on
+ */
+void
+desktop_switcher_show(bool shown);
+
+/**
+ * @brief draw the thumbnail of the view from the buffer it just committed, if
+ * the switcher is on and the last one is old enough
+ */
+void
+desktop_switcher_commit(struct recent_view *rv);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,147 @@
+/*
+ * thumb_atlas.c - taiwins desktop task switcher thumbnails
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include <string.h>
+#include <ctypes/helpers.h>
+
+#include "thumb_atlas.h"
+
+void
+thumb_atlas_init(struct thumb_atlas *atlas, void *mem)
+{
+	memset(atlas, 0, sizeof(*atlas));
+	atlas->page = mem;
+	memset(atlas->page, 0, sizeof(*atlas->page));
+	atlas->page->magic = TW_THUMBS_MAGIC;
+	atlas->page->version = TW_THUMBS_VERSION;
+	atlas->page->ncells = TW_THUMB_CELLS;
+}
+
+int
+thumb_atlas_find(const struct thumb_atlas *atlas, uint32_t id)
+{
+	if (!id)
+		return -1;
+	for (int i = 0; i < TW_THUMB_CELLS; i++)
+		if (atlas->page->cells[i].id == id)
+			return i;
+	return -1;
+}
+
+bool
+thumb_atlas_due(const struct thumb_atlas *atlas, uint32_t id,
+                uint64_t now_ms)
+{
+	int cell = thumb_atlas_find(atlas, id);
+
+	return cell < 0 ||
+		now_ms >= atlas->drawn_ms[cell] + THUMB_ATLAS_INTERVAL_MS;
+}
+
+/* a free cell, or the one shown the longest time ago */
+static int
+thumb_atlas_take(const struct thumb_atlas *atlas)
+{
+	int oldest = 0;
+
+	for (int i = 0; i < TW_THUMB_CELLS; i++) {
+		if (!atlas->page->cells[i].id)
+			return i;
+		if (atlas->used[i] < atlas->used[oldest])
+			oldest = i;
+	}
+	return oldest;
+}
+
+int
+thumb_atlas_update(struct thumb_atlas *atlas, uint32_t id,
+                   pixman_image_t *src, uint64_t now_ms)
+{
+	struct tw_thumbs_page *page = atlas->page;
+	int width = pixman_image_get_width(src);
+	int height = pixman_image_get_height(src);
+	int cell, tw, th;
+	double scale;
+	pixman_image_t *dst;
+	pixman_transform_t transform;
+
+	if (!id || width <= 0 || height <= 0)
+		return -1;
+	//never scaled up, a small dialog stays as it is
+	scale = MIN(MIN((double)TW_THUMB_WIDTH / width,
+	                (double)TW_THUMB_HEIGHT / height), 1.0);
+	tw = MIN(MAX((int)(width * scale + 0.5), 1), TW_THUMB_WIDTH);
+	th = MIN(MAX((int)(height * scale + 0.5), 1), TW_THUMB_HEIGHT);
+
+	if ((cell = thumb_atlas_find(atlas, id)) < 0)
+		cell = thumb_atlas_take(atlas);
+	dst = pixman_image_create_bits(PIXMAN_a8r8g8b8, tw, th,
+	                               tw_thumbs_cell_pixels(page, cell),
+	                               TW_THUMB_STRIDE);
+	if (!dst)
+		return -1;
+	pixman_transform_init_scale(&transform,
+	                            pixman_double_to_fixed((double)width / tw),
+	                            pixman_double_to_fixed((double)height / th));
+	pixman_image_set_transform(src, &transform);
+	pixman_image_set_filter(src, PIXMAN_FILTER_GOOD, NULL, 0);
+
+	tw_thumbs_page_write_begin(page);
+	pixman_image_composite32(PIXMAN_OP_SRC, src, NULL, dst,
+	                         0, 0, 0, 0, 0, 0, tw, th);
+	page->cells[cell].id = id;
+	page->cells[cell].serial++;
+	page->cells[cell].width = tw;
+	page->cells[cell].height = th;
+	tw_thumbs_page_write_end(page);
+
+	pixman_image_set_transform(src, NULL);
+	pixman_image_unref(dst);
+	atlas->used[cell] = ++atlas->clock;
+	atlas->drawn_ms[cell] = now_ms;
+	return cell;
+}
+
+void
+thumb_atlas_touch(struct thumb_atlas *atlas, uint32_t id)
+{
+	int cell = thumb_atlas_find(atlas, id);
+
+	if (cell >= 0)
+		atlas->used[cell] = ++atlas->clock;
+}
+
+void
+thumb_atlas_forget(struct thumb_atlas *atlas, uint32_t id)
+{
+	int cell = thumb_atlas_find(atlas, id);
+
+	if (cell < 0)
+		return;
+	tw_thumbs_page_write_begin(atlas->page);
+	atlas->page->cells[cell].id = 0;
+	atlas->page->cells[cell].width = 0;
+	atlas->page->cells[cell].height = 0;
+	tw_thumbs_page_write_end(atlas->page);
+	atlas->used[cell] = 0;
+	atlas->drawn_ms[cell] = 0;
+}
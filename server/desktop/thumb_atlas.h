@@ -0,0 +1,95 @@
+/*
+ * thumb_atlas.h - taiwins desktop task switcher thumbnails
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_THUMB_ATLAS_H
+#define TW_THUMB_ATLAS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pixman.h>
+#include <shared_switcher.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+//a window gets a new thumbnail at most this often
+#define THUMB_ATLAS_INTERVAL_MS 250
+
+/*
+ * The cells of the thumbnail file, see shared_switcher.h, with what the
+ * compositor keeps to itself: when each cell was last shown, for the
+ * eviction, and when it was last drawn, for the rate limit. It never
+ * allocates, the memory is the file.
+ */
+struct thumb_atlas {
+	struct tw_thumbs_page *page;
+	uint64_t clock;
+	uint64_t used[TW_THUMB_CELLS];
+	uint64_t drawn_ms[TW_THUMB_CELLS];
+};
+
+/**
+ * @brief start with all cells free in mem, of TW_THUMBS_SIZE bytes
+ */
+void
+thumb_atlas_init(struct thumb_atlas *atlas, void *mem);
+
+/**
+ * @return the cell of the window, -1 if it has none
+ */
+int
+thumb_atlas_find(const struct thumb_atlas *atlas, uint32_t id);
+
+/**
+ * @brief if the window may get a new thumbnail at now_ms, before reading its
+ * buffer
+ */
+bool
+thumb_atlas_due(const struct thumb_atlas *atlas, uint32_t id,
+                uint64_t now_ms);
+
+/**
+ * @brief scale src down into the cell of the window, keeping its aspect
+ *
+ * A window without a cell takes a free one, or the one shown the longest time
+ * ago.
+ *
+ * @return the cell, -1 if src is empty
+ */
+int
+thumb_atlas_update(struct thumb_atlas *atlas, uint32_t id,
+                   pixman_image_t *src, uint64_t now_ms);
+
+/**
+ * @brief the thumbnail of the window was shown, it is the last to go
+ */
+void
+thumb_atlas_touch(struct thumb_atlas *atlas, uint32_t id);
+
+void
+thumb_atlas_forget(struct thumb_atlas *atlas, uint32_t id);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
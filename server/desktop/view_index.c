@@ -0,0 +1,172 @@
+/*
+ * view_index.c - taiwins desktop spatial index of the views
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <alloc.h>
+
+#include "view_index.h"
+
+void
+view_index_init(struct view_index *index)
+{
+	memset(index, 0, sizeof(*index));
+	index->stale = true;
+}
+
+void
+view_index_release(struct view_index *index)
+{
+	tw_free(index->by_x);
+	tw_free(index->by_y);
+	view_index_init(index);
+}
+
+void
+view_index_reset(struct view_index *index)
+{
+	index->len = 0;
+	index->stale = true;
+}
+
+bool
+view_index_add(struct view_index *index, struct weston_view *view,
+               const struct weston_geometry *geo)
+{
+	if (index->len == index->cap) {
+		int cap = index->cap ? index->cap * 2 : 16;
+		struct view_index_entry *by_x =
+			tw_realloc(TW_MEM_WORKSPACE, index->by_x,
+			           cap * sizeof(*by_x));
+		struct view_index_entry *by_y;
+
+		if (!by_x)
+			return false;
+		index->by_x = by_x;
+		by_y = tw_realloc(TW_MEM_WORKSPACE, index->by_y,
+		                  cap * sizeof(*by_y));
+		if (!by_y)
+			return false;
+		index->by_y = by_y;
+		index->cap = cap;
+	}
+	index->by_x[index->len++] = (struct view_index_entry){
+		.view = view,
+		.geo = *geo,
+		.cx = 2 * geo->x + geo->width,
+		.cy = 2 * geo->y + geo->height,
+	};
+	return true;
+}
+
+static int
+cmp_center_x(const void *a, const void *b)
+{
+	const struct view_index_entry *ea = a, *eb = b;
+	return (ea->cx > eb->cx) - (ea->cx < eb->cx);
+}
+
+static int
+cmp_center_y(const void *a, const void *b)
+{
+	const struct view_index_entry *ea = a, *eb = b;
+	return (ea->cy > eb->cy) - (ea->cy < eb->cy);
+}
+
+void
+view_index_build(struct view_index *index)
+{
+	memcpy(index->by_y, index->by_x, index->len * sizeof(*index->by_y));
+	qsort(index->by_x, index->len, sizeof(*index->by_x), cmp_center_x);
+	qsort(index->by_y, index->len, sizeof(*index->by_y), cmp_center_y);
+	index->stale = false;
+}
+
+/* the first entry with a center at c or after it, or only after it */
+static int
+view_index_bound(const struct view_index_entry *entries, int len, bool along_x,
+                 int32_t c, bool after)
+{
+	int lo = 0, hi = len;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		int32_t m = along_x ? entries[mid].cx : entries[mid].cy;
+		if (m < c || (after && m == c))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* how far two spans are out of line, doubled like the centers */
+static inline int64_t
+span_offset(int32_t a, int32_t alen, int32_t b, int32_t blen)
+{
+	int64_t start = MAX(a, b);
+	int64_t end = MIN((int64_t)a + alen, (int64_t)b + blen);
+	int64_t offset = (2 * (int64_t)a + alen) - (2 * (int64_t)b + blen);
+	return (start < end) ? 0 : (offset < 0 ? -offset : offset);
+}
+
+struct weston_view *
+view_index_nearest(const struct view_index *index,
+                   const struct weston_geometry *geo,
+                   const struct weston_view *self,
+                   enum tw_desktop_direction direction)
+{
+	bool along_x = direction == TW_DIRECTION_LEFT ||
+		direction == TW_DIRECTION_RIGHT;
+	bool forward = direction == TW_DIRECTION_RIGHT ||
+		direction == TW_DIRECTION_DOWN;
+	const struct view_index_entry *entries =
+		along_x ? index->by_x : index->by_y;
+	int32_t c = along_x ? 2 * geo->x + geo->width :
+		2 * geo->y + geo->height;
+	int step = forward ? 1 : -1;
+	int i = view_index_bound(entries, index->len, along_x, c, forward);
+	struct weston_view *nearest = NULL;
+	int64_t best = INT64_MAX;
+
+	for (i = forward ? i : i - 1; i >= 0 && i < index->len; i += step) {
+		const struct view_index_entry *e = &entries[i];
+		int64_t dist = along_x ? e->cx - c : e->cy - c;
+		int64_t score;
+
+		dist = forward ? dist : -dist;
+		//sorted, nothing further can be closer
+		if (dist >= best)
+			break;
+		if (e->view == self)
+			continue;
+		score = dist + 2 * (along_x ?
+		                    span_offset(e->geo.y, e->geo.height,
+		                                geo->y, geo->height) :
+		                    span_offset(e->geo.x, e->geo.width,
+		                                geo->x, geo->width));
+		if (score < best) {
+			best = score;
+			nearest = e->view;
+		}
+	}
+	return nearest;
+}
@@ -0,0 +1,96 @@
+/*
+ * view_index.h - taiwins desktop spatial index of the views
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_VIEW_INDEX_H
+#define TW_VIEW_INDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <libweston/libweston.h>
+
+#include "desktop.h"
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Where the views of a workspace are, in global coordinates so it goes across
+ * the outputs. The views are kept twice, sorted by the centers along x and
+ * along y, a query walks one of them away from the view it starts from and
+ * stops as soon as nothing further can be closer.
+ *
+ * The index does not follow the views by itself, the workspace marks it stale
+ * when it moves them and fills it again on the next query.
+ */
+struct view_index_entry {
+	struct weston_view *view;
+	struct weston_geometry geo;
+	//twice the center, no rounding
+	int32_t cx, cy;
+};
+
+struct view_index {
+	struct view_index_entry *by_x, *by_y;
+	int len, cap;
+	bool stale;
+};
+
+void
+view_index_init(struct view_index *index);
+
+void
+view_index_release(struct view_index *index);
+
+/**
+ * @brief empty the index to fill it again, the memory is kept
+ */
+void
+view_index_reset(struct view_index *index);
+
+bool
+view_index_add(struct view_index *index, struct weston_view *view,
+               const struct weston_geometry *geo);
+
+/**
+ * @brief sort the views added since the reset, before any query
+ */
+void
+view_index_build(struct view_index *index);
+
+/**
+ * @brief the closest view on the side of geo, skipping self
+ *
+ * Closeness is the distance of the centers along the direction, plus twice
+ * their distance across it unless the two overlap across it, views merely
+ * touching are not in line.
+ */
+struct weston_view *
+view_index_nearest(const struct view_index *index,
+                   const struct weston_geometry *geo,
+                   const struct weston_view *self,
+                   enum tw_desktop_direction direction);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -25,10 +25,13 @@
 #include <libweston-desktop/libweston-desktop.h>
 #include <wayland-util.h>
 
+#include <alloc.h>
+#include <trace.h>
 #include "../taiwins.h"
 #include "shell.h"
 #include "workspace.h"
 #include "layout.h"
+#include "session.h"
 
 
 struct recent_view *
@@ -36,10 +39,14 @@ recent_view_create(struct weston_view *v, enum tw_layout_type type)
 {
 	struct weston_desktop_surface *ds =
 		weston_surface_get_desktop_surface(v->surface);
-	struct recent_view *rv = zalloc(sizeof(struct recent_view));
+	static uint32_t next_id = 0;
+	struct recent_view *rv =
+		tw_zalloc(TW_MEM_WORKSPACE, sizeof(struct recent_view));
 	wl_list_init(&rv->link);
 	rv->view = v;
+	rv->id = ++next_id;
 	rv->type = type;
+	rv->slot = -1;
 	rv->xwayland.is_xwayland = false;
 	//right now visible geomtry should be (0,0,0,0)
 	rv->visible_geometry = weston_desktop_surface_get_geometry(ds);
@@ -53,10 +60,90 @@ recent_view_destroy(struct recent_view *rv)
 	struct weston_desktop_surface *ds =
 		weston_surface_get_desktop_surface(rv->view->surface);
 	wl_list_remove(&rv->link);
-	free(rv);
+	if (rv->pending.timer)
+		wl_event_source_remove(rv->pending.timer);
+	tw_free(rv);
 	weston_desktop_surface_set_user_data(ds, NULL);
 }
 
+//about what a client takes to draw one frame at a new size
+#define RECENT_VIEW_PENDING_TIMEOUT 200
+
+bool
+recent_view_commit_pending(struct recent_view *rv,
+                           const struct weston_geometry *geo, bool force)
+{
+	bool asked = geo->width == rv->pending.size.width &&
+		geo->height == rv->pending.size.height;
+	//a client can take an other size than the one asked for
+	bool answered = geo->width != rv->pending.from.width ||
+		geo->height != rv->pending.from.height;
+
+	if (!rv->pending.set || !(force || asked || answered))
+		return false;
+	rv->pending.set = false;
+	wl_event_source_timer_update(rv->pending.timer, 0);
+	rv->visible_geometry.x = geo->x;
+	rv->visible_geometry.y = geo->y;
+	weston_view_set_position(rv->view, rv->pending.pos.x - geo->x,
+	                         rv->pending.pos.y - geo->y);
+	weston_view_geometry_dirty(rv->view);
+	weston_view_schedule_repaint(rv->view);
+	return true;
+}
+
+static int
+recent_view_pending_timeout(void *data)
+{
+	struct recent_view *rv = data;
+	struct weston_desktop_surface *ds =
+		weston_surface_get_desktop_surface(rv->view->surface);
+	struct weston_geometry geo = weston_desktop_surface_get_geometry(ds);
+
+	recent_view_commit_pending(rv, &geo, true);
+	return 0;
+}
+
+static void
+recent_view_defer(struct recent_view *rv, const struct weston_position *pos,
+                  const struct weston_size *size,
+                  const struct weston_geometry *committed)
+{
+	struct weston_compositor *ec = rv->view->surface->compositor;
+
+	if (!rv->pending.timer)
+		rv->pending.timer = wl_event_loop_add_timer(
+			wl_display_get_event_loop(ec->wl_display),
+			recent_view_pending_timeout, rv);
+	//without a timer it moves now, a frame at the old size is better than
+	//a view stuck in place
+	if (!rv->pending.timer) {
+		weston_view_set_position(rv->view,
+		                         pos->x - rv->visible_geometry.x,
+		                         pos->y - rv->visible_geometry.y);
+		return;
+	}
+	rv->pending.pos = *pos;
+	rv->pending.size = *size;
+	rv->pending.from = (struct weston_size){
+		committed->width, committed->height,
+	};
+	//the first one sets the time, later layouts only change the target
+	if (!rv->pending.set)
+		wl_event_source_timer_update(rv->pending.timer,
+		                             RECENT_VIEW_PENDING_TIMEOUT);
+	rv->pending.set = true;
+}
+
+static inline void
+recent_view_drop_pending(struct recent_view *rv)
+{
+	if (!rv->pending.set)
+		return;
+	rv->pending.set = false;
+	wl_event_source_timer_update(rv->pending.timer, 0);
+}
+
 
 /**
  * workspace implementation
@@ -68,12 +155,15 @@ workspace_init(struct workspace *wp, struct weston_compositor *compositor)
 	weston_layer_init(&wp->floating_layer, compositor);
 	weston_layer_init(&wp->hidden_layer, compositor);
 	weston_layer_init(&wp->fullscreen_layer, compositor);
+	weston_layer_init(&wp->tab_layer, compositor);
 	//init layout
 	floating_layout_init(&wp->floating_layout, &wp->floating_layer);
 	tiling_layout_init(&wp->tiling_layout, &wp->tiling_layer,
 			   &wp->floating_layout);
 	wl_list_init(&wp->recent_views);
 	wp->current_layout = LAYOUT_TILING;
+	wp->dirty_outputs = 0;
+	view_index_init(&wp->index);
 }
 
 void
@@ -82,14 +172,15 @@ workspace_release(struct workspace *ws)
 	struct weston_view *view, *next;
 	struct weston_surface *surf;
 
-	struct weston_layer *layers[4]  = {
+	struct weston_layer *layers[5]  = {
 		&ws->floating_layer,
 		&ws->tiling_layer,
 		&ws->hidden_layer,
 		&ws->fullscreen_layer,
+		&ws->tab_layer,
 	};
 	//get rid of all the surface, maybe
-	for (int i = 0; i < 4; i++) {
+	for (int i = 0; i < 5; i++) {
 		if (!wl_list_length(&layers[i]->view_list.link))
 			continue;
 		wl_list_for_each_safe(view, next,
@@ -99,8 +190,29 @@ workspace_release(struct workspace *ws)
 			wl_resource_destroy(surf->resource);
 		}
 	}
+	//a workspace freed while hidden may still have a focused layer placed
+	for (int i = 0; i < 5; i++)
+		weston_layer_unset_position(layers[i]);
 	floating_layout_end(&ws->floating_layout);
 	tiling_layout_end(&ws->tiling_layout);
+	view_index_release(&ws->index);
+}
+
+void
+workspace_get_conf(const struct workspace *ws, struct workspace_conf *conf)
+{
+	conf->layout = ws->current_layout;
+	conf->masters = ws->tiling_layout.stack.masters;
+	conf->master_portion = ws->tiling_layout.stack.master_portion;
+}
+
+void
+workspace_set_conf(struct workspace *ws, const struct workspace_conf *conf)
+{
+	ws->tiling_layout.stack.masters = conf->masters;
+	ws->tiling_layout.stack.master_portion = conf->master_portion;
+	if (conf->layout != ws->current_layout)
+		workspace_set_layout(ws, conf->layout);
 }
 
 struct weston_view *
@@ -123,26 +235,77 @@ workspace_view_get_layout(const struct workspace *ws,
 		return NULL;
 	else if (v->layer_link.layer == &ws->floating_layer)
 		return (struct layout *)&ws->floating_layout;
-	else if (v->layer_link.layer == &ws->tiling_layer)
+	else if (v->layer_link.layer == &ws->tiling_layer ||
+	         v->layer_link.layer == &ws->tab_layer)
 		return (struct layout *)&ws->tiling_layout;
 	return NULL;
 }
 
+/* a size out of the limits is not taken, the client commits its own and the
+ * layout tries again */
+static bool
+workspace_size_fits(struct weston_desktop_surface *desk_surf,
+                    const struct weston_size *size)
+{
+	struct weston_size min = weston_desktop_surface_get_min_size(desk_surf);
+	struct weston_size max = weston_desktop_surface_get_max_size(desk_surf);
+
+	return size->width >= min.width && size->height >= min.height &&
+		(!max.width || size->width <= max.width) &&
+		(!max.height || size->height <= max.height);
+}
+
+/* a tab going behind leaves the layers on screen, so it has no frame callbacks
+ * until it comes back */
+static void
+workspace_hide_tab(struct workspace *ws, struct weston_view *v, bool hidden)
+{
+	weston_view_damage_below(v);
+	weston_layer_entry_remove(&v->layer_link);
+	weston_layer_entry_insert(hidden ? &ws->tab_layer.view_list :
+	                          &ws->tiling_layer.view_list, &v->layer_link);
+	weston_view_schedule_repaint(v);
+}
+
 static void
-apply_layout_operations(const struct layout_op *ops, const int len)
+apply_layout_operations(struct workspace *ws, const struct layout_op *ops,
+                        const int len)
 {
+	TW_TRACE_SCOPE("desktop", "apply_layout_operations");
+	ws->index.stale = true;
 	for (int i = 0; i < len && !ops[i].end; i++) {
 		struct weston_desktop_surface *desk_surf =
 			weston_surface_get_desktop_surface(ops[i].v->surface);
 		struct recent_view *rv =
 			weston_desktop_surface_get_user_data(desk_surf);
-		weston_view_set_position(ops[i].v,
-					 ops[i].pos.x - rv->visible_geometry.x,
-					 ops[i].pos.y - rv->visible_geometry.y);
-		if (ops[i].size.height && ops[i].size.width) {
+		struct weston_geometry committed =
+			weston_desktop_surface_get_geometry(desk_surf);
+		bool resized = ops[i].size.height && ops[i].size.width;
+
+		if (ops[i].hidden !=
+		    (ops[i].v->layer_link.layer == &ws->tab_layer))
+			workspace_hide_tab(ws, ops[i].v, ops[i].hidden);
+		//a view with no buffer yet gets the size in its first configure
+		//and shows up in place, the others move with their new buffers
+		if (resized && ops[i].v->surface->width > 0 &&
+		    (committed.width != ops[i].size.width ||
+		     committed.height != ops[i].size.height)) {
+			recent_view_defer(rv, &ops[i].pos, &ops[i].size,
+			                  &committed);
+		} else {
+			recent_view_drop_pending(rv);
+			weston_view_set_position(
+				ops[i].v,
+				ops[i].pos.x - rv->visible_geometry.x,
+				ops[i].pos.y - rv->visible_geometry.y);
+		}
+		if (resized) {
 			weston_desktop_surface_set_size(desk_surf,
 			                                ops[i].size.width,
 			                                ops[i].size.height);
+			tw_client_stats_configure(
+				ops[i].v->surface,
+				workspace_size_fits(desk_surf, &ops[i].size));
 			rv->visible_geometry.width = ops[i].size.width;
 			rv->visible_geometry.height = ops[i].size.height;
 		}
@@ -162,11 +325,13 @@ arrange_view_for_layout(struct workspace *ws, struct layout *layout,
 	//extra buffer
 	int max_len = wl_list_length(&ws->floating_layer.view_list.link) +
 		wl_list_length(&ws->tiling_layer.view_list.link) +
+		wl_list_length(&ws->tab_layer.view_list.link) +
 		((command == DPSR_add) ? 2 : 1);
 	struct layout_op ops[max_len];
 	memset(ops, 0, sizeof(ops));
 	layout->command(command, arg, v, layout, ops);
-	apply_layout_operations(ops, max_len);
+	apply_layout_operations(ws, ops, max_len);
+	desktop_session_changed();
 }
 
 static void
@@ -192,6 +357,9 @@ arrange_view_for_workspace(struct workspace *ws, struct weston_view *v,
 struct weston_view *
 workspace_switch(struct workspace *to, struct workspace *from)
 {
+	//catch up with the outputs changed while it was hidden
+	workspace_arrange(to);
+
 	weston_layer_unset_position(&from->floating_layer);
 	weston_layer_unset_position(&from->tiling_layer);
 	weston_layer_unset_position(&from->fullscreen_layer);
@@ -212,6 +380,14 @@ workspace_focus_view(struct workspace *ws, struct weston_view *v)
 
 	if (!is_view_on_workspace(v, ws))
 		return false;
+	//a tab behind an other one comes up first
+	if (v->layer_link.layer == &ws->tab_layer) {
+		struct layout_op arg = {
+			.v = v,
+		};
+		arrange_view_for_layout(ws, &ws->tiling_layout, v, DPSR_focus,
+		                        &arg);
+	}
 	//this front back layer is optional. view could be on hidden layer or
 	//fullscreen layer. Then front and back layers do not apply
 	front = (v) ? v->layer_link.layer : NULL;
@@ -267,16 +443,38 @@ void
 workspace_resize_output(struct workspace *wp, struct tw_output *output)
 {
 	layout_resize_output(&wp->tiling_layout, output);
-	const struct layout_op arg = {
-		.o = output->output,
-	};
-	arrange_view_for_workspace(wp, NULL, DPSR_output_resize, &arg);
+	//views move in workspace_arrange, the configures are not sent to the
+	//clients on a hidden workspace
+	wp->dirty_outputs |= 1u << output->output->id;
+}
+
+void
+workspace_arrange(struct workspace *wp)
+{
+	struct weston_output *output;
+	struct weston_compositor *ec = wp->tiling_layer.compositor;
+
+	if (!wp->dirty_outputs)
+		return;
+	TW_TRACE_SCOPE("desktop", "workspace_arrange");
+	wl_list_for_each(output, &ec->output_list, link) {
+		const struct layout_op arg = {
+			.o = output,
+		};
+		if (!(wp->dirty_outputs & (1u << output->id)))
+			continue;
+		arrange_view_for_workspace(wp, NULL, DPSR_output_resize, &arg);
+	}
+	wp->dirty_outputs = 0;
 }
 
 void
 workspace_remove_output(struct workspace *w, struct weston_output *output)
 {
 	layout_rm_output(&w->tiling_layout, output);
+	layout_rm_output(&w->floating_layout, output);
+	//the id goes back to the pool
+	w->dirty_outputs &= ~(1u << output->id);
 }
 
 bool
@@ -286,7 +484,8 @@ is_view_on_workspace(const struct weston_view *v, const struct workspace *ws)
 		return false;
 	const struct weston_layer *layer = v->layer_link.layer;
 	return (layer == &ws->floating_layer || layer == &ws->tiling_layer ||
-		layer == &ws->fullscreen_layer || layer == &ws->hidden_layer);
+		layer == &ws->fullscreen_layer || layer == &ws->hidden_layer ||
+		layer == &ws->tab_layer);
 
 }
 
@@ -295,7 +494,8 @@ is_workspace_empty(const struct workspace *ws)
 {
 	return wl_list_empty(&ws->tiling_layer.view_list.link) &&
 		wl_list_empty(&ws->floating_layer.view_list.link) &&
-		wl_list_empty(&ws->hidden_layer.view_list.link);
+		wl_list_empty(&ws->hidden_layer.view_list.link) &&
+		wl_list_empty(&ws->tab_layer.view_list.link);
 }
 
 void
@@ -314,11 +514,42 @@ workspace_add_view(struct workspace *w, struct weston_view *view)
 		weston_layer_entry_insert(&w->floating_layer.view_list,
 					  &view->layer_link);
 
+	rv->workspace = w;
 	arrange_view_for_workspace(w, view, DPSR_add, &arg);
 
 	workspace_focus_view(w, view);
 }
 
+void
+workspace_restore_view(struct workspace *w, struct weston_view *view,
+                       uint32_t placeholder,
+                       const struct weston_geometry *geometry, bool focus)
+{
+	struct layout_op arg = {
+		.v = view,
+		.placeholder = placeholder,
+		.default_geometry = *geometry,
+	};
+	struct recent_view *rv = get_recent_view(view);
+	weston_layer_entry_remove(&view->layer_link);
+	if (rv->type == LAYOUT_TILING)
+		weston_layer_entry_insert(&w->tiling_layer.view_list,
+					  &view->layer_link);
+	else
+		weston_layer_entry_insert(&w->floating_layer.view_list,
+					  &view->layer_link);
+
+	rv->workspace = w;
+	arrange_view_for_workspace(w, view, DPSR_add, &arg);
+	if (focus) {
+		workspace_focus_view(w, view);
+		return;
+	}
+	//behind the ones already here, the workspace is not shown anyway
+	wl_list_remove(&rv->link);
+	wl_list_insert(w->recent_views.prev, &rv->link);
+}
+
 static void
 workspace_reinsert_view(struct workspace *w, struct weston_view *view)
 {
@@ -346,9 +577,12 @@ workspace_remove_view(struct workspace *w, struct weston_view *view)
 	struct layout_op arg = {
 		.v = view,
 	};
+	struct recent_view *rv = get_recent_view(view);
 	arrange_view_for_workspace(w, view, DPSR_del, &arg);
 	weston_layer_entry_remove(&view->layer_link);
 	wl_list_init(&view->layer_link.link);
+	if (rv)
+		rv->workspace = NULL;
 	return true;
 }
 
@@ -363,8 +597,11 @@ workspace_move_view(struct workspace *w, struct weston_view *view,
 	bool fullscreened = weston_desktop_surface_get_fullscreen(dsurf);
 	if (layer == &w->floating_layer &&
 	    !maximized && !fullscreened ) {
+		recent_view_drop_pending(get_recent_view(view));
 		weston_view_set_position(view, pos->x, pos->y);
 		weston_view_schedule_repaint(view);
+		w->index.stale = true;
+		desktop_session_changed();
 		return true;
 	}
 	return false;
@@ -387,7 +624,7 @@ workspace_resize_view(struct workspace *w, struct weston_view *v,
 }
 
 static void
-workspace_fullmax_view(UNUSED_ARG(struct workspace *w), struct weston_view *v,
+workspace_fullmax_view(struct workspace *w, struct weston_view *v,
                        bool max, const struct weston_geometry *geo)
 {
 	struct layout_op ops[2];
@@ -397,8 +634,10 @@ workspace_fullmax_view(UNUSED_ARG(struct workspace *w), struct weston_view *v,
 		weston_desktop_surface_get_user_data(dsurf);
 
 	if (max) {
-		rv->old_geometry.x = v->geometry.x + rv->visible_geometry.x;
-		rv->old_geometry.y = v->geometry.y + rv->visible_geometry.y;
+		float x, y;
+		recent_view_get_origin_coord(rv, &x, &y);
+		rv->old_geometry.x = x;
+		rv->old_geometry.y = y;
 		rv->old_geometry.width = rv->visible_geometry.width;
 		rv->old_geometry.height = rv->visible_geometry.height;
 	}
@@ -408,10 +647,11 @@ workspace_fullmax_view(UNUSED_ARG(struct workspace *w), struct weston_view *v,
 	ops[0].pos.y = (max) ? geo->y : rv->old_geometry.y;
 	ops[0].size.width = (max) ? geo->width : rv->old_geometry.width;
 	ops[0].size.height = (max) ? geo->height : rv->old_geometry.height;
+	ops[0].hidden = false;
 	ops[1].end = true;
 
 	if (max) {
-		apply_layout_operations(ops, 2);
+		apply_layout_operations(w, ops, 2);
 	}
 }
 
@@ -473,6 +713,78 @@ workspace_view_run_command(struct workspace *w, struct weston_view *v,
 	arrange_view_for_workspace(w, v, command, &arg);
 }
 
+static struct weston_geometry
+workspace_view_geometry(struct weston_view *v)
+{
+	struct recent_view *rv = get_recent_view(v);
+	float x, y;
+
+	recent_view_get_origin_coord(rv, &x, &y);
+	return (struct weston_geometry){
+		x, y, rv->visible_geometry.width, rv->visible_geometry.height,
+	};
+}
+
+struct weston_view *
+workspace_nearest_view(struct workspace *w, struct weston_view *v,
+                       enum tw_desktop_direction direction)
+{
+	struct weston_layer *layers[2] = {
+		&w->tiling_layer,
+		&w->floating_layer,
+	};
+	struct weston_view *view;
+	struct weston_geometry geo;
+
+	if (!is_view_on_workspace(v, w))
+		return NULL;
+	//filled again only after the views moved
+	if (w->index.stale) {
+		TW_TRACE_SCOPE("desktop", "workspace_index_views");
+		view_index_reset(&w->index);
+		for (int i = 0; i < 2; i++)
+			wl_list_for_each(view, &layers[i]->view_list.link,
+			                 layer_link.link) {
+				geo = workspace_view_geometry(view);
+				view_index_add(&w->index, view, &geo);
+			}
+		view_index_build(&w->index);
+	}
+	geo = workspace_view_geometry(v);
+	return view_index_nearest(&w->index, &geo, v, direction);
+}
+
+bool
+workspace_swap_views(struct workspace *w, struct weston_view *v,
+                     struct weston_view *other)
+{
+	struct weston_output *output = v->output;
+	struct layout_op arg = {
+		.v = other,
+	};
+
+	if (v->layer_link.layer != &w->tiling_layer ||
+	    other->layer_link.layer != &w->tiling_layer)
+		return false;
+	arrange_view_for_layout(w, &w->tiling_layout, v, DPSR_swap, &arg);
+	//the tiling layout finds views by their outputs, which are updated
+	//on the repaint otherwise
+	if (other->output != output) {
+		weston_view_update_transform(v);
+		weston_view_update_transform(other);
+	}
+	return true;
+}
+
+void
+workspace_undo_layout(struct workspace *w, bool redo)
+{
+	struct layout_op arg = {0};
+
+	arrange_view_for_layout(w, &w->tiling_layout, NULL,
+	                        redo ? DPSR_redo : DPSR_undo, &arg);
+}
+
 void
 workspace_switch_layout(struct workspace *w, struct weston_view *view)
 {
@@ -489,8 +801,41 @@ workspace_switch_layout(struct workspace *w, struct weston_view *view)
 }
 
 const char *
-workspace_layout_name(struct workspace *ws)
+workspace_layout_name(enum tw_layout_type type)
 {
-	return (ws->current_layout == LAYOUT_TILING) ?
-		"tiling" : "floating";
+	switch (type) {
+	case LAYOUT_TILING:
+		return "tiling";
+	case LAYOUT_MASTER:
+		return "master";
+	case LAYOUT_GRID:
+		return "grid";
+	case LAYOUT_MONOCLE:
+		return "monocle";
+	default:
+		return "floating";
+	}
+}
+
+void
+workspace_set_layout(struct workspace *ws, enum tw_layout_type type)
+{
+	struct weston_output *output;
+	struct weston_view *view, *next;
+	struct weston_compositor *ec = ws->tiling_layer.compositor;
+	layout_fun_t engine = ws->tiling_layout.command;
+
+	ws->current_layout = type;
+	desktop_session_changed();
+	if (type == LAYOUT_FLOATING ||
+	    !layout_set_engine(&ws->tiling_layout, type) ||
+	    ws->tiling_layout.command == engine)
+		return;
+	//the other engines have no tabs, the tree is rebuilt flat on the way
+	//back
+	wl_list_for_each_safe(view, next, &ws->tab_layer.view_list.link,
+	                      layer_link.link)
+		workspace_hide_tab(ws, view, false);
+	wl_list_for_each(output, &ec->output_list, link)
+		ws->dirty_outputs |= 1u << output->id;
 }
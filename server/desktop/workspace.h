@@ -29,6 +29,7 @@
 
 #include "../taiwins.h"
 #include "layout.h"
+#include "view_index.h"
 
 #define FRONT_LAYER_POS WESTON_LAYER_POSITION_NORMAL+1
 #define BACK_LAYER_POS  WESTON_LAYER_POSITION_NORMAL
@@ -47,6 +48,8 @@ struct workspace {
 	struct weston_layer tiling_layer;
 	struct weston_layer floating_layer;
 	struct weston_layer fullscreen_layer;
+	//tiled views behind an other tab of their container, never shown
+	struct weston_layer tab_layer;
 
 	/** current workspace can be in state like floating, tiling, fullscreen */
 	enum tw_layout_type current_layout;
@@ -56,13 +59,28 @@ struct workspace {
 	//go through the list
 	//what about a hashed link-list ? Will it be faster?
 	struct wl_list recent_views;
+	/**< bits of weston_output::id changed since the last arrangement, a
+	 * hidden workspace is only arranged when it is switched to */
+	uint32_t dirty_outputs;
+	/**< the tiled and floating views shown, stale once they move */
+	struct view_index index;
 
 	//the only tiling layer here will create the problem when we want to do
 	//the stacking layout, for example. Only show two views.
 };
 
+/* what the user set a workspace to, the desktop keeps it while the workspace
+ * is freed, so it comes back the same */
+struct workspace_conf {
+	enum tw_layout_type layout;
+	int masters;
+	float master_portion;
+};
+
 struct recent_view {
 	struct weston_view *view;
+	uint32_t id; /**< unique id, never reused */
+	struct workspace *workspace; /**< the one it is on, NULL in between */
 	/*
 	  desktop surface has decorations(invisible portion)
 	  -----------------------
@@ -84,6 +102,17 @@ struct recent_view {
 	struct weston_geometry old_geometry;
 	struct wl_list link;
 	enum tw_layout_type type;
+	int32_t slot; /**< in the task switcher table, -1 for none */
+
+	/* where the layout put a view it also resized. The view stays where
+	 * it is until the client commits a new size, so its old buffer is never
+	 * shown at the new place, or until the timer gives up on it */
+	struct {
+		struct weston_position pos; /**< of the visible part */
+		struct weston_size size, from;
+		bool set;
+		struct wl_event_source *timer;
+	} pending;
 
 	struct {
 		int32_t x;
@@ -108,13 +137,29 @@ get_recent_view(struct weston_view *v)
 	return rv;
 }
 
+/* where the visible part is, or is going to be once the client catches up */
 static inline void
 recent_view_get_origin_coord(const struct recent_view *v, float *x, float *y)
 {
+	if (v->pending.set) {
+		*x = v->pending.pos.x;
+		*y = v->pending.pos.y;
+		return;
+	}
 	*x = v->view->geometry.x + v->visible_geometry.x;
 	*y = v->view->geometry.y + v->visible_geometry.y;
 }
 
+/**
+ * @brief move the view where the layout put it, if the committed geometry is
+ * the one asked for, or any other if force
+ *
+ * @return true if the view moved
+ */
+bool
+recent_view_commit_pending(struct recent_view *rv,
+                           const struct weston_geometry *geo, bool force);
+
 
 /************************************************************
  * workspace API
@@ -125,6 +170,15 @@ workspace_init(struct workspace *wp, struct weston_compositor *compositor);
 void
 workspace_release(struct workspace *);
 
+void
+workspace_get_conf(const struct workspace *ws, struct workspace_conf *conf);
+
+/**
+ * @brief the layout and the master stack of the conf, see workspace_set_layout
+ */
+void
+workspace_set_conf(struct workspace *ws, const struct workspace_conf *conf);
+
 struct weston_view *
 workspace_switch(struct workspace *to, struct workspace *from);
 
@@ -132,7 +186,15 @@ struct weston_view *
 workspace_get_top_view(const struct workspace *ws);
 
 const char *
-workspace_layout_name(struct workspace *ws);
+workspace_layout_name(enum tw_layout_type type);
+
+/**
+ * @brief the layout of new views, and the engine of the tiling layer
+ *
+ * Changing the engine marks all outputs, see workspace_arrange.
+ */
+void
+workspace_set_layout(struct workspace *ws, enum tw_layout_type type);
 
 bool
 is_view_on_workspace(const struct weston_view *v, const struct workspace *ws);
@@ -150,6 +212,18 @@ workspace_defocus_view(struct workspace *ws, struct weston_view *v);
 void
 workspace_add_view(struct workspace *w, struct weston_view *view);
 
+/**
+ * @brief add a view of the last session, into its placeholder if it has one
+ *
+ * The geometry is where a floating view was, the tiling ones take the space of
+ * the placeholder, only the view is configured. Unless focus, the view goes
+ * behind the others.
+ */
+void
+workspace_restore_view(struct workspace *w, struct weston_view *view,
+                       uint32_t placeholder,
+                       const struct weston_geometry *geometry, bool focus);
+
 bool
 workspace_move_view(struct workspace *w, struct weston_view *v,
                     const struct weston_position *pos);
@@ -162,6 +236,27 @@ void
 workspace_view_run_command(struct workspace *w, struct weston_view *v,
                            enum layout_command command);
 
+/**
+ * @brief the closest view shown on that side of v, on any output
+ */
+struct weston_view *
+workspace_nearest_view(struct workspace *w, struct weston_view *v,
+                       enum tw_desktop_direction direction);
+
+/**
+ * @brief two tiled views trade places, on the same output or not
+ */
+bool
+workspace_swap_views(struct workspace *w, struct weston_view *v,
+                     struct weston_view *other);
+
+/**
+ * @brief undo or redo the last split, merge, toggle or resize of the tiling
+ * layout, on any output of the workspace
+ */
+void
+workspace_undo_layout(struct workspace *w, bool redo);
+
 //resize is done directly inside desktop for now
 bool
 workspace_remove_view(struct workspace *w, struct weston_view *v);
@@ -189,6 +284,13 @@ workspace_remove_output(struct workspace *w, struct weston_output *output);
 void
 workspace_resize_output(struct workspace *wp, struct tw_output *output);
 
+/**
+ * @brief arrange the outputs marked by workspace_resize_output, once for any
+ * number of changes
+ */
+void
+workspace_arrange(struct workspace *wp);
+
 
 #ifdef  __cplusplus
 }
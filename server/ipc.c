@@ -0,0 +1,851 @@
+/*
+ * ipc.c - taiwins server ipc socket
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <libweston/libweston.h>
+#include <libweston-desktop/libweston-desktop.h>
+#include <ctypes/helpers.h>
+#include <ctypes/strops.h>
+
+#include <shared_ipc.h>
+#include <alloc.h>
+#include "compositor.h"
+
+/* every client has this much buffered output, it has to be power of 2 */
+#define TW_IPC_RING_SIZE (1 << 16)
+
+struct tw_ipc_client {
+	struct wl_list link;
+	struct tw_ipc *ipc;
+	int fd;
+	struct wl_event_source *source;
+	bool writing;
+
+	uint32_t events;
+	uint32_t event_seq;
+	uint32_t lost;
+
+	size_t in_len;
+	char in[sizeof(struct tw_ipc_header) + TW_IPC_MAX_REQUEST];
+
+	size_t out_head, out_tail;
+	char out[TW_IPC_RING_SIZE];
+};
+
+struct tw_ipc_seat {
+	struct wl_list link;
+	struct weston_seat *seat;
+	struct wl_listener caps_listener;
+	struct wl_listener focus_listener;
+	struct wl_listener destroy_listener;
+};
+
+static struct tw_ipc {
+	struct weston_compositor *compositor;
+	struct desktop *desktop;
+	int fd;
+	char path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+	struct wl_event_source *source;
+	struct wl_list clients;
+	struct wl_list seats;
+	//scratch buffer for replies, it only grows until a trim
+	struct wl_array scratch;
+
+	struct wl_listener view_created_listener;
+	struct wl_listener view_destroyed_listener;
+	struct wl_listener workspace_listener;
+	struct wl_listener seat_created_listener;
+	struct wl_listener trim_listener;
+	struct wl_listener compositor_destroy_listener;
+} s_ipc;
+
+static void ipc_client_destroy(struct tw_ipc_client *client);
+
+/******************************************************************************
+ * client output
+ *****************************************************************************/
+
+static inline size_t
+ipc_ring_free(const struct tw_ipc_client *client)
+{
+	return TW_IPC_RING_SIZE - (client->out_tail - client->out_head);
+}
+
+static void
+ipc_ring_copy(struct tw_ipc_client *client, const void *data, size_t size)
+{
+	size_t off = client->out_tail & (TW_IPC_RING_SIZE-1);
+	size_t first = MIN(size, TW_IPC_RING_SIZE - off);
+
+	memcpy(client->out + off, data, first);
+	memcpy(client->out, (const char *)data + first, size - first);
+	client->out_tail += size;
+}
+
+/**
+ * @brief queue a message for the client, the write happens when the socket
+ * becomes writable, so multiple messages go out in one send.
+ */
+static bool
+ipc_client_queue(struct tw_ipc_client *client, uint16_t type,
+                 const void *payload, uint32_t size)
+{
+	struct tw_ipc_header header = {
+		.magic = TW_IPC_MAGIC,
+		.version = TW_IPC_VERSION,
+		.type = type,
+		.size = size,
+	};
+
+	if (ipc_ring_free(client) < sizeof(header) + size)
+		return false;
+	ipc_ring_copy(client, &header, sizeof(header));
+	if (size)
+		ipc_ring_copy(client, payload, size);
+	if (!client->writing) {
+		wl_event_source_fd_update(client->source, WL_EVENT_READABLE |
+		                          WL_EVENT_WRITABLE);
+		client->writing = true;
+	}
+	return true;
+}
+
+static bool
+ipc_client_error(struct tw_ipc_client *client, int32_t code)
+{
+	struct tw_ipc_error error = { .code = code };
+	return ipc_client_queue(client, TW_IPC_ERROR, &error, sizeof(error));
+}
+
+static bool
+ipc_client_flush(struct tw_ipc_client *client)
+{
+	while (client->out_tail != client->out_head) {
+		size_t off = client->out_head & (TW_IPC_RING_SIZE-1);
+		size_t len = MIN(client->out_tail - client->out_head,
+		                 TW_IPC_RING_SIZE - off);
+		ssize_t n = send(client->fd, client->out + off, len,
+		                 MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0 && errno == EINTR)
+			continue;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true;
+		else if (n < 0)
+			return false;
+		client->out_head += n;
+	}
+	wl_event_source_fd_update(client->source, WL_EVENT_READABLE);
+	client->writing = false;
+	return true;
+}
+
+/******************************************************************************
+ * requests
+ *****************************************************************************/
+
+static inline struct weston_surface *
+ipc_focused_surface(struct tw_ipc *ipc)
+{
+	struct weston_seat *seat;
+	struct weston_keyboard *keyboard;
+
+	wl_list_for_each(seat, &ipc->compositor->seat_list, link) {
+		keyboard = weston_seat_get_keyboard(seat);
+		if (keyboard && keyboard->focus)
+			return keyboard->focus;
+	}
+	return NULL;
+}
+
+static void
+ipc_fill_view(struct tw_ipc_view *out, const struct tw_desktop_view_info *info,
+              struct weston_surface *focused)
+{
+	struct weston_view *view = info->view;
+	struct weston_desktop_surface *ds =
+		weston_surface_get_desktop_surface(view->surface);
+	struct weston_geometry geo = weston_desktop_surface_get_geometry(ds);
+	const char *title = weston_desktop_surface_get_title(ds);
+	const char *app_id = weston_desktop_surface_get_app_id(ds);
+
+	memset(out, 0, sizeof(*out));
+	out->id = info->id;
+	out->workspace = info->workspace;
+	out->x = (int32_t)view->geometry.x + geo.x;
+	out->y = (int32_t)view->geometry.y + geo.y;
+	out->width = geo.width;
+	out->height = geo.height;
+	if (view->surface == focused)
+		out->flags |= TW_IPC_VIEW_FOCUSED;
+	if (info->type == LAYOUT_FLOATING)
+		out->flags |= TW_IPC_VIEW_FLOATING;
+	if (weston_view_is_mapped(view) &&
+	    info->workspace == tw_desktop_get_current_workspace(s_ipc.desktop))
+		out->flags |= TW_IPC_VIEW_VISIBLE;
+	strop_ncpy(out->app_id, app_id ? app_id : "", sizeof(out->app_id));
+	strop_ncpy(out->title, title ? title : "", sizeof(out->title));
+}
+
+static void
+ipc_collect_view(const struct tw_desktop_view_info *info, void *data)
+{
+	struct tw_ipc *ipc = data;
+	struct tw_ipc_view *out = wl_array_add(&ipc->scratch, sizeof(*out));
+
+	if (out)
+		ipc_fill_view(out, info, ipc_focused_surface(ipc));
+}
+
+static void
+ipc_count_view(const struct tw_desktop_view_info *info, void *data)
+{
+	struct tw_ipc_workspace *workspaces = data;
+	workspaces[info->workspace].nviews++;
+}
+
+static bool
+ipc_list_views(struct tw_ipc *ipc, struct tw_ipc_client *client)
+{
+	ipc->scratch.size = 0;
+	tw_desktop_for_each_view(ipc->desktop, ipc_collect_view, ipc);
+	return ipc_client_queue(client, TW_IPC_LIST_VIEWS | TW_IPC_REPLY,
+	                        ipc->scratch.data, ipc->scratch.size);
+}
+
+static bool
+ipc_list_workspaces(struct tw_ipc *ipc, struct tw_ipc_client *client)
+{
+	int n = tw_desktop_num_workspaces(ipc->desktop);
+	int current = tw_desktop_get_current_workspace(ipc->desktop);
+	struct tw_ipc_workspace *workspaces;
+
+	ipc->scratch.size = 0;
+	workspaces = wl_array_add(&ipc->scratch, n * sizeof(*workspaces));
+	if (!workspaces)
+		return ipc_client_error(client, TW_IPC_ERR_FAILED);
+	memset(workspaces, 0, n * sizeof(*workspaces));
+	for (int i = 0; i < n; i++) {
+		workspaces[i].index = i;
+		workspaces[i].flags = (i == current) ?
+			TW_IPC_WORKSPACE_ACTIVE : 0;
+		strop_ncpy(workspaces[i].layout,
+		           tw_desktop_get_workspace_layout(ipc->desktop, i),
+		           sizeof(workspaces[i].layout));
+	}
+	tw_desktop_for_each_view(ipc->desktop, ipc_count_view, workspaces);
+	return ipc_client_queue(client, TW_IPC_LIST_WORKSPACES | TW_IPC_REPLY,
+	                        ipc->scratch.data, ipc->scratch.size);
+}
+
+static bool
+ipc_list_outputs(struct tw_ipc *ipc, struct tw_ipc_client *client)
+{
+	struct weston_output *output;
+	struct tw_ipc_output *out;
+
+	ipc->scratch.size = 0;
+	wl_list_for_each(output, &ipc->compositor->output_list, link) {
+		out = wl_array_add(&ipc->scratch, sizeof(*out));
+		if (!out)
+			break;
+		memset(out, 0, sizeof(*out));
+		out->id = output->id;
+		out->x = output->x;
+		out->y = output->y;
+		out->width = output->width;
+		out->height = output->height;
+		out->scale = output->current_scale;
+		strop_ncpy(out->name, output->name ? output->name : "",
+		           sizeof(out->name));
+	}
+	return ipc_client_queue(client, TW_IPC_LIST_OUTPUTS | TW_IPC_REPLY,
+	                        ipc->scratch.data, ipc->scratch.size);
+}
+
+static void
+ipc_collect_client(const struct tw_client_stats *stats, void *data)
+{
+	struct tw_ipc *ipc = data;
+	struct tw_ipc_client_stats *out =
+		wl_array_add(&ipc->scratch, sizeof(*out));
+
+	if (!out)
+		return;
+	*out = (struct tw_ipc_client_stats){
+		.shm_bytes = stats->shm_bytes,
+		.commits = stats->commits,
+		.damage_per_sec = stats->damage_per_sec,
+		.pid = stats->pid,
+		.surfaces = stats->surfaces,
+		.views = stats->views,
+		.commits_per_sec = stats->commits_per_sec,
+		.configure_rtt_us = stats->configure_rtt_us,
+		.configure_rtt_max_us = stats->configure_rtt_max_us,
+	};
+}
+
+static bool
+ipc_list_clients(struct tw_ipc *ipc, struct tw_ipc_client *client)
+{
+	ipc->scratch.size = 0;
+	tw_client_stats_for_each(ipc_collect_client, ipc);
+	return ipc_client_queue(client, TW_IPC_LIST_CLIENTS | TW_IPC_REPLY,
+	                        ipc->scratch.data, ipc->scratch.size);
+}
+
+static bool
+ipc_list_memory(struct tw_ipc *ipc, struct tw_ipc_client *client)
+{
+	struct tw_ipc_mem_stats *out;
+	struct tw_mem_stats stats;
+
+	ipc->scratch.size = 0;
+	for (int i = 0; i < TW_MEM_TAG_COUNT; i++) {
+		if (!(out = wl_array_add(&ipc->scratch, sizeof(*out))))
+			return ipc_client_error(client, TW_IPC_ERR_FAILED);
+		tw_mem_get_stats(i, &stats);
+		*out = (struct tw_ipc_mem_stats){
+			.live_bytes = stats.live_bytes,
+			.live_allocs = stats.live_allocs,
+			.peak_bytes = stats.peak_bytes,
+			.total_allocs = stats.total_allocs,
+		};
+		strop_ncpy(out->tag, tw_mem_tag_name(i), sizeof(out->tag));
+	}
+	return ipc_client_queue(client, TW_IPC_LIST_MEMORY | TW_IPC_REPLY,
+	                        ipc->scratch.data, ipc->scratch.size);
+}
+
+static bool
+ipc_get_focus(struct tw_ipc *ipc, struct tw_ipc_client *client)
+{
+	struct weston_surface *focused = ipc_focused_surface(ipc);
+	struct weston_view *view = focused ?
+		tw_default_view_from_surface(focused) : NULL;
+	struct tw_desktop_view_info info;
+	struct tw_ipc_view out;
+
+	if (!tw_desktop_get_view_info(ipc->desktop, view, &info))
+		return ipc_client_queue(client, TW_IPC_GET_FOCUS |
+		                        TW_IPC_REPLY, NULL, 0);
+	ipc_fill_view(&out, &info, focused);
+	return ipc_client_queue(client, TW_IPC_GET_FOCUS | TW_IPC_REPLY,
+	                        &out, sizeof(out));
+}
+
+static void
+ipc_switch_workspace(struct tw_ipc *ipc, int to)
+{
+	struct weston_view *view;
+	struct weston_surface *focused = ipc_focused_surface(ipc);
+
+	view = tw_desktop_switch_workspace(ipc->desktop, to);
+	if (focused)
+		tw_lose_surface_focus(focused);
+	if (view)
+		tw_focus_surface(view->surface);
+	weston_compositor_damage_all(ipc->compositor);
+	weston_compositor_schedule_repaint(ipc->compositor);
+}
+
+static bool
+ipc_layout_command(struct tw_ipc *ipc, struct tw_ipc_client *client,
+                   const void *payload, uint32_t size)
+{
+	struct tw_ipc_layout_command cmd;
+	struct weston_view *view = NULL;
+	struct weston_surface *focused;
+	int n_ws = tw_desktop_num_workspaces(ipc->desktop);
+
+	if (size != sizeof(cmd))
+		return ipc_client_error(client, TW_IPC_ERR_INVALID);
+	memcpy(&cmd, payload, sizeof(cmd));
+
+	//workspace commands do not need a view
+	switch (cmd.op) {
+	case TW_IPC_LAYOUT_SWITCH_WORKSPACE:
+		if (cmd.arg < 0 || cmd.arg >= n_ws)
+			return ipc_client_error(client, TW_IPC_ERR_INVALID);
+		ipc_switch_workspace(ipc, cmd.arg);
+		goto done;
+	case TW_IPC_LAYOUT_SET_WORKSPACE_LAYOUT:
+		if (cmd.arg < LAYOUT_FLOATING || cmd.arg > LAYOUT_MONOCLE)
+			return ipc_client_error(client, TW_IPC_ERR_INVALID);
+		if (!tw_desktop_set_workspace_layout(
+			    ipc->desktop,
+			    tw_desktop_get_current_workspace(ipc->desktop),
+			    cmd.arg))
+			return ipc_client_error(client, TW_IPC_ERR_FAILED);
+		goto done;
+	default:
+		break;
+	}
+
+	if (cmd.view) {
+		view = tw_desktop_find_view(ipc->desktop, cmd.view);
+	} else {
+		focused = ipc_focused_surface(ipc);
+		view = focused ? tw_default_view_from_surface(focused) : NULL;
+	}
+	if (!view || !weston_surface_is_desktop_surface(view->surface))
+		return ipc_client_error(client, TW_IPC_ERR_NO_VIEW);
+
+	switch (cmd.op) {
+	case TW_IPC_LAYOUT_FOCUS:
+		if (!tw_desktop_activate_view(ipc->desktop, view))
+			return ipc_client_error(client, TW_IPC_ERR_FAILED);
+		tw_focus_surface(view->surface);
+		break;
+	case TW_IPC_LAYOUT_TOGGLE_FLOATING:
+		tw_desktop_toggle_view_layout(ipc->desktop, view);
+		break;
+	case TW_IPC_LAYOUT_TOGGLE_SPLIT:
+		tw_desktop_toggle_view_split(ipc->desktop, view);
+		break;
+	case TW_IPC_LAYOUT_VSPLIT:
+	case TW_IPC_LAYOUT_HSPLIT:
+		tw_desktop_split_on_view(ipc->desktop, view,
+		                         cmd.op == TW_IPC_LAYOUT_VSPLIT);
+		break;
+	case TW_IPC_LAYOUT_MERGE:
+		tw_desktop_merge_view(ipc->desktop, view);
+		break;
+	default:
+		return ipc_client_error(client, TW_IPC_ERR_INVALID);
+	}
+done:
+	return ipc_client_queue(client, TW_IPC_LAYOUT_COMMAND | TW_IPC_REPLY,
+	                        NULL, 0);
+}
+
+static bool
+ipc_subscribe(struct tw_ipc_client *client, const void *payload,
+              uint32_t size)
+{
+	uint32_t mask;
+
+	if (size != sizeof(mask))
+		return ipc_client_error(client, TW_IPC_ERR_INVALID);
+	memcpy(&mask, payload, sizeof(mask));
+	client->events = mask & TW_IPC_EVENT_ALL;
+	return ipc_client_queue(client, TW_IPC_SUBSCRIBE | TW_IPC_REPLY,
+	                        NULL, 0);
+}
+
+/* return false if the client has to go, either it spoke nonsense or it does
+ * not read its replies */
+static bool
+ipc_handle_request(struct tw_ipc_client *client,
+                   const struct tw_ipc_header *header, const void *payload)
+{
+	struct tw_ipc *ipc = client->ipc;
+
+	switch (header->type) {
+	case TW_IPC_LIST_VIEWS:
+		return ipc_list_views(ipc, client);
+	case TW_IPC_LIST_WORKSPACES:
+		return ipc_list_workspaces(ipc, client);
+	case TW_IPC_LIST_OUTPUTS:
+		return ipc_list_outputs(ipc, client);
+	case TW_IPC_GET_FOCUS:
+		return ipc_get_focus(ipc, client);
+	case TW_IPC_LAYOUT_COMMAND:
+		return ipc_layout_command(ipc, client, payload, header->size);
+	case TW_IPC_SUBSCRIBE:
+		return ipc_subscribe(client, payload, header->size);
+	case TW_IPC_LIST_CLIENTS:
+		return ipc_list_clients(ipc, client);
+	case TW_IPC_LIST_MEMORY:
+		return ipc_list_memory(ipc, client);
+	default:
+		return ipc_client_error(client, TW_IPC_ERR_INVALID);
+	}
+}
+
+static bool
+ipc_client_read(struct tw_ipc_client *client)
+{
+	struct tw_ipc_header header;
+	size_t consumed = 0;
+	ssize_t n;
+
+	n = recv(client->fd, client->in + client->in_len,
+	         sizeof(client->in) - client->in_len, MSG_DONTWAIT);
+	if (n < 0 && (errno == EAGAIN || errno == EINTR))
+		return true;
+	else if (n <= 0)
+		return false;
+	client->in_len += n;
+
+	while (client->in_len - consumed >= sizeof(header)) {
+		memcpy(&header, client->in + consumed, sizeof(header));
+		if (header.magic != TW_IPC_MAGIC ||
+		    header.version != TW_IPC_VERSION ||
+		    header.size > TW_IPC_MAX_REQUEST)
+			return false;
+		if (client->in_len - consumed < sizeof(header) + header.size)
+			break;
+		if (!ipc_handle_request(client, &header,
+		                        client->in + consumed + sizeof(header)))
+			return false;
+		consumed += sizeof(header) + header.size;
+	}
+	memmove(client->in, client->in + consumed, client->in_len - consumed);
+	client->in_len -= consumed;
+	return true;
+}
+
+static int
+ipc_client_dispatch(UNUSED_ARG(int fd), uint32_t mask, void *data)
+{
+	struct tw_ipc_client *client = data;
+	TW_WATCHDOG_SOURCE("ipc client");
+
+	if (mask & (WL_EVENT_HANGUP | WL_EVENT_ERROR))
+		goto err;
+	if ((mask & WL_EVENT_READABLE) && !ipc_client_read(client))
+		goto err;
+	if ((mask & WL_EVENT_WRITABLE) && !ipc_client_flush(client))
+		goto err;
+	return 0;
+err:
+	ipc_client_destroy(client);
+	return 0;
+}
+
+static void
+ipc_client_destroy(struct tw_ipc_client *client)
+{
+	wl_list_remove(&client->link);
+	wl_event_source_remove(client->source);
+	close(client->fd);
+	free(client);
+}
+
+static int
+ipc_accept(int fd, UNUSED_ARG(uint32_t mask), void *data)
+{
+	struct tw_ipc *ipc = data;
+	struct tw_ipc_client *client;
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(ipc->compositor->wl_display);
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	int cfd;
+
+	cfd = accept4(fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+	if (cfd < 0)
+		return 0;
+	//only the user running the compositor
+	if (getsockopt(cfd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0 ||
+	    cred.uid != geteuid()) {
+		close(cfd);
+		return 0;
+	}
+	client = zalloc(sizeof(*client));
+	if (!client)
+		goto err;
+	client->fd = cfd;
+	client->ipc = ipc;
+	client->source = wl_event_loop_add_fd(loop, cfd, WL_EVENT_READABLE,
+	                                      ipc_client_dispatch, client);
+	if (!client->source)
+		goto err;
+	wl_list_insert(&ipc->clients, &client->link);
+	return 0;
+err:
+	free(client);
+	close(cfd);
+	return 0;
+}
+
+/******************************************************************************
+ * events
+ *****************************************************************************/
+
+static void
+ipc_broadcast(struct tw_ipc *ipc, uint16_t type, uint32_t view,
+              int32_t workspace, int32_t from)
+{
+	struct tw_ipc_client *client;
+	uint32_t mask = tw_ipc_event_mask(type);
+	struct tw_ipc_event event = {
+		.view = view,
+		.workspace = workspace,
+		.from = from,
+	};
+
+	wl_list_for_each(client, &ipc->clients, link) {
+		if (!(client->events & mask))
+			continue;
+		event.seq = client->event_seq++;
+		event.lost = client->lost;
+		//slow client simply loses events, we never wait for it
+		if (ipc_client_queue(client, type, &event, sizeof(event)))
+			client->lost = 0;
+		else
+			client->lost++;
+	}
+}
+
+static void
+ipc_view_created(struct wl_listener *listener, void *data)
+{
+	struct tw_ipc *ipc =
+		container_of(listener, struct tw_ipc, view_created_listener);
+	const struct tw_desktop_view_info *info = data;
+
+	ipc_broadcast(ipc, TW_IPC_EVENT_VIEW_CREATED, info->id,
+	              info->workspace, -1);
+}
+
+static void
+ipc_view_destroyed(struct wl_listener *listener, void *data)
+{
+	struct tw_ipc *ipc =
+		container_of(listener, struct tw_ipc, view_destroyed_listener);
+	const struct tw_desktop_view_info *info = data;
+
+	ipc_broadcast(ipc, TW_IPC_EVENT_VIEW_DESTROYED, info->id,
+	              info->workspace, -1);
+}
+
+static void
+ipc_workspace_switched(struct wl_listener *listener, void *data)
+{
+	struct tw_ipc *ipc =
+		container_of(listener, struct tw_ipc, workspace_listener);
+	const int *switched = data;
+
+	ipc_broadcast(ipc, TW_IPC_EVENT_WORKSPACE, 0, switched[1],
+	              switched[0]);
+}
+
+static void
+ipc_keyboard_focus(UNUSED_ARG(struct wl_listener *listener), void *data)
+{
+	struct weston_keyboard *keyboard = data;
+	struct tw_desktop_view_info info = {0};
+	struct weston_view *view;
+	struct tw_ipc *ipc = &s_ipc;
+
+	view = keyboard->focus ?
+		tw_default_view_from_surface(keyboard->focus) : NULL;
+	if (!tw_desktop_get_view_info(ipc->desktop, view, &info))
+		info.workspace = tw_desktop_get_current_workspace(ipc->desktop);
+	ipc_broadcast(ipc, TW_IPC_EVENT_FOCUS, info.id, info.workspace, -1);
+}
+
+static void
+ipc_seat_caps(struct wl_listener *listener, void *data)
+{
+	struct weston_seat *seat = data;
+	struct tw_ipc_seat *ipc_seat =
+		container_of(listener, struct tw_ipc_seat, caps_listener);
+
+	//keyboard state lives as long as seat once created
+	if (seat->keyboard_state && wl_list_empty(&ipc_seat->focus_listener.link))
+		wl_signal_add(&seat->keyboard_state->focus_signal,
+		              &ipc_seat->focus_listener);
+}
+
+static void
+ipc_seat_destroy(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_ipc_seat *ipc_seat =
+		container_of(listener, struct tw_ipc_seat, destroy_listener);
+
+	wl_list_remove(&ipc_seat->caps_listener.link);
+	wl_list_remove(&ipc_seat->focus_listener.link);
+	wl_list_remove(&ipc_seat->destroy_listener.link);
+	wl_list_remove(&ipc_seat->link);
+	free(ipc_seat);
+}
+
+static void
+ipc_seat_created(struct wl_listener *listener, void *data)
+{
+	struct weston_seat *seat = data;
+	struct tw_ipc *ipc =
+		container_of(listener, struct tw_ipc, seat_created_listener);
+	struct tw_ipc_seat *ipc_seat = zalloc(sizeof(*ipc_seat));
+
+	if (!ipc_seat)
+		return;
+	ipc_seat->seat = seat;
+	wl_list_init(&ipc_seat->focus_listener.link);
+	ipc_seat->focus_listener.notify = ipc_keyboard_focus;
+	ipc_seat->caps_listener.notify = ipc_seat_caps;
+	ipc_seat->destroy_listener.notify = ipc_seat_destroy;
+	wl_signal_add(&seat->updated_caps_signal, &ipc_seat->caps_listener);
+	wl_signal_add(&seat->destroy_signal, &ipc_seat->destroy_listener);
+	wl_list_insert(&ipc->seats, &ipc_seat->link);
+	ipc_seat_caps(&ipc_seat->caps_listener, seat);
+}
+
+/******************************************************************************
+ * setup
+ *****************************************************************************/
+
+static void
+ipc_trim(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_ipc *ipc = container_of(listener, struct tw_ipc,
+	                                  trim_listener);
+	//replies are copied into the client rings, nothing points in here
+	wl_array_release(&ipc->scratch);
+	wl_array_init(&ipc->scratch);
+}
+
+static void
+end_ipc(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_ipc *ipc =
+		container_of(listener, struct tw_ipc,
+		             compositor_destroy_listener);
+	struct tw_ipc_client *client, *tmp;
+	struct tw_ipc_seat *seat, *next;
+
+	wl_list_for_each_safe(client, tmp, &ipc->clients, link)
+		ipc_client_destroy(client);
+	wl_list_for_each_safe(seat, next, &ipc->seats, link)
+		ipc_seat_destroy(&seat->destroy_listener, NULL);
+
+	wl_list_remove(&ipc->view_created_listener.link);
+	wl_list_remove(&ipc->view_destroyed_listener.link);
+	wl_list_remove(&ipc->workspace_listener.link);
+	wl_list_remove(&ipc->seat_created_listener.link);
+	wl_list_remove(&ipc->trim_listener.link);
+	wl_list_remove(&ipc->compositor_destroy_listener.link);
+
+	if (ipc->source)
+		wl_event_source_remove(ipc->source);
+	if (ipc->fd >= 0) {
+		close(ipc->fd);
+		unlink(ipc->path);
+	}
+	wl_array_release(&ipc->scratch);
+}
+
+/* a stale socket from a crashed compositor goes, one that still answers
+ * belongs to a running compositor and stays */
+static bool
+ipc_clear_path(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	struct stat st;
+	int fd, ret, err;
+
+	if (lstat(path, &st) < 0)
+		return errno == ENOENT;
+	if (!S_ISSOCK(st.st_mode) || st.st_uid != geteuid())
+		return false;
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return false;
+	strop_ncpy(addr.sun_path, path, sizeof(addr.sun_path));
+	ret = connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+	err = errno;
+	close(fd);
+	if (!ret || err != ECONNREFUSED)
+		return false;
+	return !unlink(path);
+}
+
+static int
+ipc_listen(struct tw_ipc *ipc)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fd;
+
+	if (!tw_ipc_socket_path(ipc->path)) {
+		weston_log("no XDG_RUNTIME_DIR for the ipc socket\n");
+		return -1;
+	}
+	if (!ipc_clear_path(ipc->path)) {
+		weston_log("ipc socket %s is in use\n", ipc->path);
+		return -1;
+	}
+	strop_ncpy(addr.sun_path, ipc->path, sizeof(addr.sun_path));
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd < 0)
+		return -1;
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+	    listen(fd, 16) < 0) {
+		close(fd);
+		return -1;
+	}
+	setenv("TAIWINS_IPC", ipc->path, 1);
+	return fd;
+}
+
+struct tw_ipc *
+tw_setup_ipc(struct weston_compositor *ec, struct desktop *desktop)
+{
+	struct tw_ipc *ipc = &s_ipc;
+	struct tw_desktop_signals *signals = tw_desktop_get_signals(desktop);
+	struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+	struct weston_seat *seat;
+
+	ipc->compositor = ec;
+	ipc->desktop = desktop;
+	wl_list_init(&ipc->clients);
+	wl_list_init(&ipc->seats);
+	wl_array_init(&ipc->scratch);
+
+	ipc->fd = ipc_listen(ipc);
+	if (ipc->fd < 0) {
+		weston_log("failed to create ipc socket %s\n", ipc->path);
+		return NULL;
+	}
+	ipc->source = wl_event_loop_add_fd(loop, ipc->fd, WL_EVENT_READABLE,
+	                                   ipc_accept, ipc);
+	if (!ipc->source) {
+		close(ipc->fd);
+		unlink(ipc->path);
+		return NULL;
+	}
+
+	ipc->view_created_listener.notify = ipc_view_created;
+	ipc->view_destroyed_listener.notify = ipc_view_destroyed;
+	ipc->workspace_listener.notify = ipc_workspace_switched;
+	ipc->seat_created_listener.notify = ipc_seat_created;
+	ipc->trim_listener.notify = ipc_trim;
+	ipc->compositor_destroy_listener.notify = end_ipc;
+	wl_signal_add(&signals->view_created, &ipc->view_created_listener);
+	wl_signal_add(&signals->view_destroyed, &ipc->view_destroyed_listener);
+	wl_signal_add(&signals->workspace_switched, &ipc->workspace_listener);
+	wl_signal_add(&ec->seat_created_signal, &ipc->seat_created_listener);
+	tw_pressure_add_trim_listener(&ipc->trim_listener);
+	wl_signal_add(&ec->destroy_signal, &ipc->compositor_destroy_listener);
+
+	wl_list_for_each(seat, &ec->seat_list, link)
+		ipc_seat_created(&ipc->seat_created_listener, seat);
+
+	return ipc;
+}
@@ -0,0 +1,97 @@
+/*
+ * jobs.c - taiwins compositor worker pool
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <libweston/libweston.h>
+#include <ctypes/helpers.h>
+
+#include <jobs.h>
+#include "compositor.h"
+
+/* the compositor does not need many workers, they are for the occasional
+ * blocking call, not for throughput */
+#define TW_COMPOSITOR_JOB_THREADS 2
+
+static struct tw_jobs {
+	struct tw_job_pool *pool;
+	struct tw_job_sink *sink;
+	struct wl_event_source *source;
+	struct wl_listener compositor_destroy_listener;
+} s_jobs;
+
+static int
+jobs_dispatch(UNUSED_ARG(int fd), UNUSED_ARG(uint32_t mask), void *data)
+{
+	struct tw_jobs *jobs = data;
+	TW_WATCHDOG_SOURCE("jobs");
+
+	tw_job_sink_dispatch(jobs->sink);
+	return 0;
+}
+
+static void
+end_jobs(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_jobs *jobs =
+		container_of(listener, struct tw_jobs,
+		             compositor_destroy_listener);
+
+	wl_list_remove(&listener->link);
+	wl_event_source_remove(jobs->source);
+	//the pending done callbacks run in here, cancelled
+	tw_job_sink_destroy(jobs->sink);
+	tw_job_pool_destroy(jobs->pool);
+	*jobs = (struct tw_jobs){0};
+}
+
+struct tw_job_sink *
+tw_setup_jobs(struct weston_compositor *ec)
+{
+	struct tw_jobs *jobs = &s_jobs;
+	struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+
+	if (!(jobs->pool = tw_job_pool_create(TW_COMPOSITOR_JOB_THREADS)))
+		return NULL;
+	if (!(jobs->sink = tw_job_sink_create(jobs->pool)))
+		goto err_sink;
+	jobs->source = wl_event_loop_add_fd(loop,
+	                                    tw_job_sink_get_fd(jobs->sink),
+	                                    WL_EVENT_READABLE, jobs_dispatch,
+	                                    jobs);
+	if (!jobs->source)
+		goto err_source;
+
+	wl_list_init(&jobs->compositor_destroy_listener.link);
+	jobs->compositor_destroy_listener.notify = end_jobs;
+	wl_signal_add(&ec->destroy_signal, &jobs->compositor_destroy_listener);
+	return jobs->sink;
+err_source:
+	tw_job_sink_destroy(jobs->sink);
+err_sink:
+	tw_job_pool_destroy(jobs->pool);
+	*jobs = (struct tw_jobs){0};
+	return NULL;
+}
+
+struct tw_job_sink *
+tw_get_job_sink(void)
+{
+	return s_jobs.sink;
+}
@@ -0,0 +1,393 @@
+/*
+ * log.c - taiwins asynchronous logger
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <linux/limits.h>
+#include <sys/eventfd.h>
+
+#include <ctypes/helpers.h>
+
+#include "log.h"
+#include "spsc_queue.h"
+
+#define TW_LOG_RECORD_SIZE 256
+#define TW_LOG_RING_SIZE 512 /* records per thread, power of 2 */
+#define TW_LOG_ROTATE_KEEP 3
+#define TW_LOG_FLUSH_MS 100
+
+struct tw_log_record {
+	uint64_t ts; /**< monotonic nanoseconds */
+	uint8_t level;
+	uint8_t line_start; /**< continuation of weston_log does not */
+	uint16_t len;
+	char tag[12];
+	char msg[TW_LOG_RECORD_SIZE - 24];
+};
+
+struct tw_log_ring {
+	struct tw_spsc_queue queue;
+	_Atomic uint64_t dropped;
+	atomic_bool dead; /**< thread exited, free it once drained */
+	uint64_t reported; /**< writer side view of dropped */
+	bool line_start; /**< producer side */
+	struct tw_log_ring *next;
+};
+
+static struct tw_logger {
+	pthread_mutex_t lock; /**< only protects the ring list */
+	struct tw_log_ring *rings;
+	pthread_key_t ring_key;
+
+	pthread_t thread;
+	atomic_bool running;
+	atomic_bool quit;
+	int wakeup;
+	_Atomic int level;
+
+	/**< writer thread only */
+	FILE *file;
+	struct tw_log_ring *open_line; /**< ring with an unfinished line */
+	char path[PATH_MAX];
+	size_t rotate_size;
+	size_t size;
+
+	_Atomic uint64_t written;
+	_Atomic uint64_t dropped;
+	_Atomic uint64_t rotations;
+} s_logger = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wakeup = -1,
+	.level = TW_LOG_INFO,
+};
+
+static __thread struct tw_log_ring *t_ring;
+
+static const char *tw_log_level_names[] = {
+	[TW_LOG_DBUG] = "DBUG",
+	[TW_LOG_INFO] = "INFO",
+	[TW_LOG_WARN] = "WARN",
+	[TW_LOG_ERRO] = "ERRO",
+};
+
+/******************************************************************************
+ * producer side
+ *****************************************************************************/
+
+static void
+tw_log_ring_retire(void *data)
+{
+	struct tw_log_ring *ring = data;
+	atomic_store(&ring->dead, true);
+}
+
+static struct tw_log_ring *
+tw_log_get_ring(void)
+{
+	struct tw_log_ring *ring;
+
+	if (t_ring)
+		return t_ring;
+	ring = calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+	if (!tw_spsc_queue_init(&ring->queue, sizeof(struct tw_log_record),
+	                        TW_LOG_RING_SIZE)) {
+		free(ring);
+		return NULL;
+	}
+	ring->line_start = true;
+	atomic_init(&ring->dropped, 0);
+	atomic_init(&ring->dead, false);
+
+	pthread_mutex_lock(&s_logger.lock);
+	ring->next = s_logger.rings;
+	s_logger.rings = ring;
+	pthread_mutex_unlock(&s_logger.lock);
+
+	pthread_setspecific(s_logger.ring_key, ring);
+	t_ring = ring;
+	return ring;
+}
+
+static inline uint64_t
+tw_log_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int
+tw_logv(enum tw_log_level level, const char *tag, const char *format,
+        va_list args)
+{
+	struct tw_log_record record;
+	struct tw_log_ring *ring;
+	int n;
+
+	if ((int)level < atomic_load_explicit(&s_logger.level,
+	                                      memory_order_relaxed))
+		return 0;
+	if (!atomic_load_explicit(&s_logger.running, memory_order_acquire) ||
+	    !(ring = tw_log_get_ring()))
+		return vfprintf(stderr, format, args);
+
+	record.ts = tw_log_now();
+	record.level = level;
+	strncpy(record.tag, tag ? tag : "", sizeof(record.tag));
+	record.tag[sizeof(record.tag)-1] = '\0';
+	n = vsnprintf(record.msg, sizeof(record.msg), format, args);
+	if (n < 0)
+		return n;
+	record.len = MIN((size_t)n, sizeof(record.msg)-1);
+	record.line_start = ring->line_start;
+	//a truncated message always ends its line
+	ring->line_start = (size_t)n != record.len ||
+		(record.len && record.msg[record.len-1] == '\n');
+
+	if (!tw_spsc_queue_push(&ring->queue, &record)) {
+		atomic_fetch_add_explicit(&ring->dropped, 1,
+		                          memory_order_relaxed);
+		return 0;
+	}
+	//errors should hit the disk soon, the rest waits for the next flush
+	if (level >= TW_LOG_WARN)
+		eventfd_write(s_logger.wakeup, 1);
+	return n;
+}
+
+/******************************************************************************
+ * writer side
+ *****************************************************************************/
+
+static void
+tw_logger_rotate(struct tw_logger *logger)
+{
+	char from[PATH_MAX+8], to[PATH_MAX+8];
+
+	fclose(logger->file);
+	for (int i = TW_LOG_ROTATE_KEEP-1; i > 0; i--) {
+		snprintf(from, sizeof(from), "%s.%d", logger->path, i);
+		snprintf(to, sizeof(to), "%s.%d", logger->path, i+1);
+		rename(from, to);
+	}
+	snprintf(to, sizeof(to), "%s.1", logger->path);
+	rename(logger->path, to);
+	logger->file = fopen(logger->path, "w");
+	if (!logger->file)
+		logger->file = stderr;
+	logger->size = 0;
+	atomic_fetch_add(&logger->rotations, 1);
+}
+
+static void
+tw_logger_write(struct tw_logger *logger, struct tw_log_ring *ring,
+                const struct tw_log_record *record)
+{
+	int n = 0;
+	bool other = logger->open_line && logger->open_line != ring;
+
+	//do not glue a line from another thread onto an unfinished one
+	if (other)
+		fputc('\n', logger->file);
+	if (record->line_start || logger->open_line != ring)
+		n = fprintf(logger->file, "[%6llu.%06llu] %s [%s] ",
+		            (unsigned long long)(record->ts / 1000000000ull),
+		            (unsigned long long)(record->ts % 1000000000ull)/1000,
+		            tw_log_level_names[record->level], record->tag);
+	fwrite(record->msg, 1, record->len, logger->file);
+	logger->size += MAX(n, 0) + record->len + other;
+	logger->open_line =
+		(record->len && record->msg[record->len-1] != '\n') ?
+		ring : NULL;
+	atomic_fetch_add_explicit(&logger->written, 1, memory_order_relaxed);
+}
+
+static void
+tw_logger_drain(struct tw_logger *logger)
+{
+	struct tw_log_record record;
+	struct tw_log_ring *ring, **prev;
+
+	pthread_mutex_lock(&logger->lock);
+	prev = &logger->rings;
+	while ((ring = *prev)) {
+		uint64_t dropped;
+		bool dead = atomic_load(&ring->dead);
+
+		while (tw_spsc_queue_pop(&ring->queue, &record))
+			tw_logger_write(logger, ring, &record);
+
+		dropped = atomic_load_explicit(&ring->dropped,
+		                               memory_order_relaxed);
+		if (dropped != ring->reported) {
+			if (logger->open_line)
+				fputc('\n', logger->file);
+			logger->open_line = NULL;
+			fprintf(logger->file, "[logger] dropped %llu records\n",
+			        (unsigned long long)(dropped - ring->reported));
+			atomic_fetch_add(&logger->dropped,
+			                 dropped - ring->reported);
+			ring->reported = dropped;
+		}
+		//the thread is gone, nobody pushes anymore
+		if (dead) {
+			while (tw_spsc_queue_pop(&ring->queue, &record))
+				tw_logger_write(logger, ring, &record);
+			if (logger->open_line == ring)
+				logger->open_line = NULL;
+			*prev = ring->next;
+			tw_spsc_queue_release(&ring->queue);
+			free(ring);
+			continue;
+		}
+		prev = &ring->next;
+	}
+	pthread_mutex_unlock(&logger->lock);
+
+	fflush(logger->file);
+	if (logger->rotate_size && logger->size > logger->rotate_size &&
+	    logger->file != stderr)
+		tw_logger_rotate(logger);
+}
+
+static void *
+tw_logger_run(void *data)
+{
+	struct tw_logger *logger = data;
+	struct pollfd pfd = { .fd = logger->wakeup, .events = POLLIN };
+	eventfd_t count;
+
+	while (!atomic_load(&logger->quit)) {
+		if (poll(&pfd, 1, TW_LOG_FLUSH_MS) > 0)
+			eventfd_read(logger->wakeup, &count);
+		tw_logger_drain(logger);
+	}
+	tw_logger_drain(logger);
+	return NULL;
+}
+
+/******************************************************************************
+ * API
+ *****************************************************************************/
+
+bool
+tw_logger_init(const char *path, size_t rotate_size)
+{
+	struct tw_logger *logger = &s_logger;
+	sigset_t all, saved;
+	int err;
+
+	if (atomic_load(&logger->running))
+		return true;
+	strncpy(logger->path, path, sizeof(logger->path)-1);
+	logger->rotate_size = rotate_size;
+	logger->size = 0;
+	logger->file = fopen(path, "w");
+	if (!logger->file)
+		return false;
+	logger->wakeup = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (logger->wakeup < 0)
+		goto err_eventfd;
+	if (pthread_key_create(&logger->ring_key, tw_log_ring_retire))
+		goto err_key;
+
+	atomic_store(&logger->quit, false);
+	//the logger thread must never take a signal, it inherits our mask, so
+	//block everything while creating it, whatever the caller blocks later
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &saved);
+	err = pthread_create(&logger->thread, NULL, tw_logger_run, logger);
+	pthread_sigmask(SIG_SETMASK, &saved, NULL);
+	if (err)
+		goto err_thread;
+	atomic_store_explicit(&logger->running, true, memory_order_release);
+	return true;
+
+err_thread:
+	pthread_key_delete(logger->ring_key);
+err_key:
+	close(logger->wakeup);
+	logger->wakeup = -1;
+err_eventfd:
+	fclose(logger->file);
+	logger->file = NULL;
+	return false;
+}
+
+void
+tw_logger_fini(void)
+{
+	struct tw_logger *logger = &s_logger;
+	struct tw_log_ring *ring, *next;
+
+	if (!atomic_load(&logger->running))
+		return;
+	//following records go to stderr
+	atomic_store_explicit(&logger->running, false, memory_order_release);
+	atomic_store(&logger->quit, true);
+	eventfd_write(logger->wakeup, 1);
+	pthread_join(logger->thread, NULL);
+
+	for (ring = logger->rings; ring; ring = next) {
+		next = ring->next;
+		tw_spsc_queue_release(&ring->queue);
+		free(ring);
+	}
+	logger->rings = NULL;
+	t_ring = NULL;
+	pthread_key_delete(logger->ring_key);
+	close(logger->wakeup);
+	logger->wakeup = -1;
+	if (logger->file != stderr)
+		fclose(logger->file);
+	logger->file = NULL;
+}
+
+void
+tw_logger_set_level(enum tw_log_level level)
+{
+	atomic_store(&s_logger.level, level);
+}
+
+void
+tw_logger_get_stats(struct tw_logger_stats *stats)
+{
+	struct tw_log_ring *ring;
+
+	stats->written = atomic_load(&s_logger.written);
+	stats->dropped = atomic_load(&s_logger.dropped);
+	stats->rotations = atomic_load(&s_logger.rotations);
+	//also count what writer has not seen yet
+	pthread_mutex_lock(&s_logger.lock);
+	for (ring = s_logger.rings; ring; ring = ring->next)
+		stats->dropped += atomic_load(&ring->dropped) - ring->reported;
+	pthread_mutex_unlock(&s_logger.lock);
+}
@@ -0,0 +1,94 @@
+/*
+ * log.h - taiwins asynchronous logger
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_LOG_H
+#define TW_LOG_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+enum tw_log_level {
+	TW_LOG_DBUG,
+	TW_LOG_INFO,
+	TW_LOG_WARN,
+	TW_LOG_ERRO,
+};
+
+struct tw_logger_stats {
+	uint64_t written; /**< records reached the file */
+	uint64_t dropped; /**< records lost to full rings */
+	uint64_t rotations;
+};
+
+/**
+ * @brief start the logger thread
+ *
+ * every thread logging gets its own lock-free ring, they are drained by a
+ * writer thread, so logging never touches the disk in the caller. When the file
+ * grows over rotate_size, it is moved to path.1 (path.1 to path.2 and so on).
+ *
+ * before init (or after it fails) records go to stderr synchronously.
+ */
+bool
+tw_logger_init(const char *path, size_t rotate_size);
+
+void
+tw_logger_fini(void);
+
+void
+tw_logger_set_level(enum tw_log_level level);
+
+void
+tw_logger_get_stats(struct tw_logger_stats *stats);
+
+int
+tw_logv(enum tw_log_level level, const char *tag, const char *format,
+        va_list args);
+
+static inline int
+__attribute__ ((format (printf, 3, 4)))
+tw_log_level(enum tw_log_level level, const char *tag,
+             const char *format, ...)
+{
+	int ret;
+	va_list ap;
+	va_start(ap, format);
+	ret = tw_logv(level, tag, format, ap);
+	va_end(ap);
+	return ret;
+}
+
+#define tw_log_dbug(tag, ...) tw_log_level(TW_LOG_DBUG, tag, __VA_ARGS__)
+#define tw_log_info(tag, ...) tw_log_level(TW_LOG_INFO, tag, __VA_ARGS__)
+#define tw_log_warn(tag, ...) tw_log_level(TW_LOG_WARN, tag, __VA_ARGS__)
+#define tw_log_erro(tag, ...) tw_log_level(TW_LOG_ERRO, tag, __VA_ARGS__)
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,149 @@
+/*
+ * pressure.c - taiwins compositor memory pressure response
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include <malloc.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <libweston/libweston.h>
+#include <ctypes/helpers.h>
+
+#include <alloc.h>
+#include <pressure.h>
+#include "compositor.h"
+
+static struct tw_pressure_handler {
+	struct tw_pressure *pressure;
+	struct wl_event_source *source;
+	struct wl_signal trim_signal;
+	struct wl_listener compositor_destroy_listener;
+} s_pressure;
+
+//listeners can come before the setup, or without it
+static inline struct wl_signal *
+pressure_trim_signal(void)
+{
+	if (!s_pressure.trim_signal.listener_list.next)
+		wl_signal_init(&s_pressure.trim_signal);
+	return &s_pressure.trim_signal;
+}
+
+static int64_t
+pressure_tagged_bytes(void)
+{
+	struct tw_mem_stats stats;
+	int64_t bytes = 0;
+
+	for (int i = 0; i < TW_MEM_TAG_COUNT; i++) {
+		tw_mem_get_stats(i, &stats);
+		bytes += stats.live_bytes;
+	}
+	return bytes;
+}
+
+static long
+pressure_rss_kb(void)
+{
+	long pages, resident = 0;
+	FILE *file = fopen("/proc/self/statm", "r");
+
+	if (!file)
+		return 0;
+	if (fscanf(file, "%ld %ld", &pages, &resident) != 2)
+		resident = 0;
+	fclose(file);
+	return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void
+pressure_trim(enum tw_pressure_reason reason)
+{
+	int64_t before = pressure_tagged_bytes();
+	long rss = pressure_rss_kb();
+
+	//the listeners drop what they can rebuild, then malloc gives it back
+	wl_signal_emit(pressure_trim_signal(), NULL);
+	malloc_trim(0);
+	tw_log_info("pressure", "trim on %s: tagged %lld -> %lld bytes, "
+	            "rss %ld -> %ld kB", tw_pressure_reason_name(reason),
+	            (long long)before, (long long)pressure_tagged_bytes(), rss,
+	            pressure_rss_kb());
+}
+
+static int
+pressure_dispatch(UNUSED_ARG(int fd), UNUSED_ARG(uint32_t mask), void *data)
+{
+	struct tw_pressure_handler *handler = data;
+	enum tw_pressure_reason reason;
+	TW_WATCHDOG_SOURCE("pressure");
+
+	if ((reason = tw_pressure_dispatch(handler->pressure)))
+		pressure_trim(reason);
+	return 0;
+}
+
+static void
+end_pressure(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_pressure_handler *handler =
+		container_of(listener, struct tw_pressure_handler,
+		             compositor_destroy_listener);
+
+	wl_list_remove(&listener->link);
+	wl_event_source_remove(handler->source);
+	tw_pressure_destroy(handler->pressure);
+	handler->source = NULL;
+	handler->pressure = NULL;
+}
+
+struct tw_pressure *
+tw_setup_pressure(struct weston_compositor *ec)
+{
+	struct tw_pressure_handler *handler = &s_pressure;
+	struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+
+	if (!(handler->pressure = tw_pressure_create(NULL)))
+		return NULL;
+	handler->source = wl_event_loop_add_fd(loop,
+	                                       tw_pressure_get_fd(
+		                                       handler->pressure),
+	                                       WL_EVENT_READABLE,
+	                                       pressure_dispatch, handler);
+	if (!handler->source) {
+		tw_pressure_destroy(handler->pressure);
+		handler->pressure = NULL;
+		return NULL;
+	}
+	tw_log_info("pressure", "watching memory pressure with %s",
+	            tw_pressure_source(handler->pressure));
+
+	wl_list_init(&handler->compositor_destroy_listener.link);
+	handler->compositor_destroy_listener.notify = end_pressure;
+	wl_signal_add(&ec->destroy_signal,
+	              &handler->compositor_destroy_listener);
+	return handler->pressure;
+}
+
+void
+tw_pressure_add_trim_listener(struct wl_listener *listener)
+{
+	wl_signal_add(pressure_trim_signal(), listener);
+}
@@ -0,0 +1,101 @@
+/*
+ * spsc_queue.h - taiwins single producer single consumer queue
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_SPSC_QUEUE_H
+#define TW_SPSC_QUEUE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief lock-free ring of fixed size elements
+ *
+ * Exactly one thread may push and exactly one thread may pop. The capacity has
+ * to be a power of two, head and tail grows monotonically and are masked on
+ * access, so a full queue still uses all of its slots.
+ */
+struct tw_spsc_queue {
+	_Atomic size_t head; /**< written by consumer */
+	_Atomic size_t tail; /**< written by producer */
+	size_t elemsize;
+	size_t mask;
+	char *data;
+};
+
+static inline bool
+tw_spsc_queue_init(struct tw_spsc_queue *q, size_t elemsize, size_t cap)
+{
+	if (!cap || (cap & (cap - 1)))
+		return false;
+	q->data = calloc(cap, elemsize);
+	if (!q->data)
+		return false;
+	q->elemsize = elemsize;
+	q->mask = cap - 1;
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+	return true;
+}
+
+static inline void
+tw_spsc_queue_release(struct tw_spsc_queue *q)
+{
+	free(q->data);
+	q->data = NULL;
+}
+
+static inline bool
+tw_spsc_queue_push(struct tw_spsc_queue *q, const void *elem)
+{
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+
+	if (tail - head > q->mask)
+		return false;
+	memcpy(q->data + (tail & q->mask) * q->elemsize, elem, q->elemsize);
+	atomic_store_explicit(&q->tail, tail+1, memory_order_release);
+	return true;
+}
+
+static inline bool
+tw_spsc_queue_pop(struct tw_spsc_queue *q, void *elem)
+{
+	size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+	if (head == tail)
+		return false;
+	memcpy(elem, q->data + (head & q->mask) * q->elemsize, q->elemsize);
+	atomic_store_explicit(&q->head, head+1, memory_order_release);
+	return true;
+}
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,293 @@
+/*
+ * stats_page.c - taiwins compositor statistics page
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <libweston/libweston.h>
+#include <ctypes/helpers.h>
+#include <ctypes/strops.h>
+
+#include <shared_stats.h>
+#include "compositor.h"
+
+struct tw_stats_procfs {
+	pid_t pid;
+	int stat_fd;
+	int statm_fd;
+	uint64_t last_ticks;
+};
+
+static struct tw_stats {
+	struct weston_compositor *compositor;
+	char path[256];
+	int fd;
+	struct tw_stats_page *page;
+	struct wl_event_source *timer;
+	struct wl_listener compositor_destroy_listener;
+
+	uint64_t last_tick_ms;
+	long clk_tck, page_kb;
+	struct tw_stats_procfs procs[TW_STATS_MAX_PROCS];
+
+	//accumulating for the current second
+	uint32_t frames, dropped;
+	uint64_t frame_time_sum;
+	uint32_t frame_time_max;
+} s_stats;
+
+static inline uint64_t
+stats_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void
+tw_stats_page_frame(struct weston_output *output, uint32_t repaint_us)
+{
+	struct tw_stats *stats = &s_stats;
+	int refresh = output->current_mode ? output->current_mode->refresh : 0;
+
+	if (!stats->page)
+		return;
+	stats->frames++;
+	stats->frame_time_sum += repaint_us;
+	stats->frame_time_max = MAX(stats->frame_time_max, repaint_us);
+	//refresh is in mHz
+	if (refresh > 0 && repaint_us > 1000000000u / refresh)
+		stats->dropped++;
+}
+
+static void
+stats_procfs_close(struct tw_stats_procfs *proc)
+{
+	if (proc->stat_fd >= 0)
+		close(proc->stat_fd);
+	if (proc->statm_fd >= 0)
+		close(proc->statm_fd);
+	*proc = (struct tw_stats_procfs){ .stat_fd = -1, .statm_fd = -1 };
+}
+
+/* the proc files are opened once per process and re-read with pread, no
+ * allocation and no path lookup per second */
+static void
+stats_procfs_open(struct tw_stats_procfs *proc, pid_t pid,
+                  struct tw_stats_proc *out)
+{
+	char path[64];
+	int fd;
+	ssize_t n;
+
+	stats_procfs_close(proc);
+	proc->pid = pid;
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	proc->stat_fd = open(path, O_RDONLY | O_CLOEXEC);
+	snprintf(path, sizeof(path), "/proc/%d/statm", pid);
+	proc->statm_fd = open(path, O_RDONLY | O_CLOEXEC);
+
+	memset(out->name, 0, sizeof(out->name));
+	snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd >= 0) {
+		n = read(fd, out->name, sizeof(out->name) - 1);
+		if (n > 0 && out->name[n-1] == '\n')
+			out->name[n-1] = '\0';
+		close(fd);
+	}
+}
+
+static void
+stats_procfs_read(struct tw_stats *stats, struct tw_stats_procfs *proc,
+                  struct tw_stats_proc *out, uint64_t elapsed_ms)
+{
+	char buf[512];
+	unsigned long utime = 0, stime = 0, resident = 0;
+	uint64_t ticks;
+	ssize_t n;
+	char *p;
+
+	out->pid = proc->pid;
+	n = proc->stat_fd >= 0 ?
+		pread(proc->stat_fd, buf, sizeof(buf) - 1, 0) : -1;
+	//comm may have spaces, the fields start after the last ')'
+	if (n > 0) {
+		buf[n] = '\0';
+		p = strrchr(buf, ')');
+		if (p && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u "
+		                "%*u %*u %lu %lu", &utime, &stime) == 2) {
+			ticks = utime + stime;
+			if (proc->last_ticks && elapsed_ms)
+				out->cpu_permille = (ticks - proc->last_ticks) *
+					1000000 / (stats->clk_tck * elapsed_ms);
+			proc->last_ticks = ticks;
+		}
+	}
+	n = proc->statm_fd >= 0 ?
+		pread(proc->statm_fd, buf, sizeof(buf) - 1, 0) : -1;
+	if (n > 0) {
+		buf[n] = '\0';
+		if (sscanf(buf, "%*u %lu", &resident) == 1)
+			out->rss_kb = resident * stats->page_kb;
+	}
+}
+
+/* the /proc reads take a while, they go to a local copy first so the page only
+ * stays odd for the copy */
+static int
+stats_publish(void *data)
+{
+	struct tw_stats *stats = data;
+	struct tw_stats_page *page = stats->page;
+	struct tw_subprocess *subproc;
+	struct tw_stats_proc procs[TW_STATS_MAX_PROCS];
+	pid_t pids[TW_STATS_MAX_PROCS] = {getpid()};
+	uint64_t now = stats_now_ms();
+	uint64_t elapsed = now - stats->last_tick_ms;
+	unsigned int n = 1;
+
+	//the compositor, then whatever we launched, the shell and console
+	wl_list_for_each(subproc, tw_get_clients_head(), link) {
+		if (n >= TW_STATS_MAX_PROCS)
+			break;
+		pids[n++] = subproc->pid;
+	}
+
+	//we are the only writer, the names are kept from last time
+	memcpy(procs, page->procs, sizeof(procs));
+	for (unsigned i = 0; i < TW_STATS_MAX_PROCS; i++) {
+		if (i >= n) {
+			stats_procfs_close(&stats->procs[i]);
+			memset(&procs[i], 0, sizeof(procs[i]));
+			continue;
+		}
+		if (stats->procs[i].pid != pids[i]) {
+			memset(&procs[i], 0, sizeof(procs[i]));
+			stats_procfs_open(&stats->procs[i], pids[i],
+			                  &procs[i]);
+		}
+		stats_procfs_read(stats, &stats->procs[i], &procs[i],
+		                  elapsed);
+	}
+
+	tw_stats_page_write_begin(page);
+	memcpy(page->procs, procs, sizeof(procs));
+	page->nprocs = n;
+	page->updated_ms = now;
+	page->frames = stats->frames;
+	page->dropped_frames = stats->dropped;
+	page->dropped_total += stats->dropped;
+	page->frame_time_us = stats->frames ?
+		stats->frame_time_sum / stats->frames : 0;
+	page->frame_time_max_us = stats->frame_time_max;
+	tw_stats_page_write_end(page);
+
+	stats->frames = stats->dropped = stats->frame_time_max = 0;
+	stats->frame_time_sum = 0;
+	stats->last_tick_ms = now;
+	wl_event_source_timer_update(stats->timer, 1000);
+	return 0;
+}
+
+static void
+end_stats_page(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct tw_stats *stats =
+		container_of(listener, struct tw_stats,
+		             compositor_destroy_listener);
+
+	wl_list_remove(&stats->compositor_destroy_listener.link);
+	for (unsigned i = 0; i < TW_STATS_MAX_PROCS; i++)
+		stats_procfs_close(&stats->procs[i]);
+	if (stats->timer)
+		wl_event_source_remove(stats->timer);
+	if (stats->page)
+		munmap(stats->page, sizeof(struct tw_stats_page));
+	if (stats->fd >= 0) {
+		close(stats->fd);
+		unlink(stats->path);
+	}
+	stats->page = NULL;
+	stats->timer = NULL;
+	stats->fd = -1;
+}
+
+struct tw_stats *
+tw_setup_stats_page(struct weston_compositor *ec)
+{
+	struct tw_stats *stats = &s_stats;
+	struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+
+	stats->compositor = ec;
+	stats->clk_tck = sysconf(_SC_CLK_TCK);
+	stats->page_kb = sysconf(_SC_PAGESIZE) / 1024;
+	for (unsigned i = 0; i < TW_STATS_MAX_PROCS; i++)
+		stats->procs[i] = (struct tw_stats_procfs){
+			.stat_fd = -1, .statm_fd = -1 };
+
+	stats->fd = -1;
+	if (!tw_stats_page_path(stats->path, sizeof(stats->path)))
+		return NULL;
+	//a page left by a crashed compositor goes away, then we only create a
+	//fresh file, never follow a link or reuse what someone else put there
+	unlink(stats->path);
+	stats->fd = open(stats->path,
+	                 O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+	                 0600);
+	if (stats->fd < 0)
+		return NULL;
+	if (ftruncate(stats->fd, sizeof(struct tw_stats_page)) < 0)
+		goto err;
+	stats->page = mmap(NULL, sizeof(struct tw_stats_page),
+	                   PROT_READ | PROT_WRITE, MAP_SHARED, stats->fd, 0);
+	if (stats->page == MAP_FAILED) {
+		stats->page = NULL;
+		goto err;
+	}
+	stats->page->magic = TW_STATS_MAGIC;
+	stats->page->version = TW_STATS_VERSION;
+
+	stats->timer = wl_event_loop_add_timer(loop, stats_publish, stats);
+	if (!stats->timer)
+		goto err;
+	stats->last_tick_ms = stats_now_ms();
+	wl_event_source_timer_update(stats->timer, 1000);
+	setenv("TAIWINS_STATS", stats->path, 1);
+
+	wl_list_init(&stats->compositor_destroy_listener.link);
+	stats->compositor_destroy_listener.notify = end_stats_page;
+	wl_signal_add(&ec->destroy_signal,
+	              &stats->compositor_destroy_listener);
+	return stats;
+err:
+	if (stats->page)
+		munmap(stats->page, sizeof(struct tw_stats_page));
+	stats->page = NULL;
+	close(stats->fd);
+	unlink(stats->path);
+	stats->fd = -1;
+	return NULL;
+}
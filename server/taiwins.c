@@ -34,12 +34,10 @@
 
 #include "taiwins.h"
 
-FILE *logfile;
-
 int
 tw_log(const char *format, va_list args)
 {
-	return vfprintf(logfile, format, args);
+	return tw_logv(TW_LOG_INFO, "weston", format, args);
 }
 
 static int
@@ -27,16 +27,24 @@
 #include <wayland-server.h>
 #include <libweston/libweston.h>
 
+#include "log.h"
+#include "client_stats.h"
+#include "watchdog.h"
 
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE
 #endif
 
-#define MAX_WORKSPACE 8
+//the desktop only allocates the ones in use
+#define MAX_WORKSPACE 32
 
 enum tw_layout_type {
 	LAYOUT_FLOATING,
 	LAYOUT_TILING,
+	/* the other tiling engines, views on them are still LAYOUT_TILING */
+	LAYOUT_MASTER,
+	LAYOUT_GRID,
+	LAYOUT_MONOCLE,
 };
 
 
@@ -49,6 +57,7 @@ struct tw_config;
 /*******************************************************************************
  * logging functions
  ******************************************************************************/
+/* weston log handler, goes into the async logger, see log.h */
 int
 tw_log(const char *format, va_list args);
 
@@ -58,7 +67,7 @@ tw_logl(const char *format, ...)
 	int ret;
 	va_list ap;
 	va_start(ap, format);
-	ret = tw_log(format, ap);
+	ret = tw_logv(TW_LOG_INFO, "taiwins", format, ap);
 	va_end(ap);
 
 	return ret;
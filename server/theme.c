@@ -30,14 +30,19 @@
 #include <ctypes/helpers.h>
 #include <ctypes/os/os-compatibility.h>
 #include <twclient/theme.h>
+#include <alloc.h>
+#include <jobs.h>
 
-#include "taiwins.h"
+#include "compositor.h"
 
 struct shell;
 
+struct theme_job;
+
 struct theme {
 	struct weston_compositor *ec;
 	struct wl_listener compositor_destroy_listener;
+	struct wl_listener trim_listener;
 	struct wl_global *global;
 	struct tw_config *config;
 	//it can apply to many clients
@@ -45,38 +50,174 @@ struct theme {
 
 	struct tw_theme global_theme;
 	int fd;
+	size_t fd_size;
+	//serialization in flight, a newer notify cancels it
+	struct theme_job *pending;
+	//the memfd was dropped on a trim, bind serializes it again
+	bool trimmed;
+	//pools and the serialized copy, charged to TW_MEM_THEME
+	int64_t accounted;
 
 } THEME;
 
+struct theme_job {
+	struct theme *theme;
+	struct tw_job *job;
+	struct tw_theme snapshot;
+	size_t size;
+	int fd;
+};
+
 struct theme *
 tw_theme_get_global(void)
 {
 	return &THEME;
 }
 
+static void
+theme_account(struct theme *theme)
+{
+	struct tw_theme *tw_theme = &theme->global_theme;
+	int64_t bytes = tw_theme->handle_pool.alloc +
+		tw_theme->string_pool.alloc;
 
-void
-tw_theme_notify(struct tw_theme *global_theme)
+	if (theme->fd > 0)
+		bytes += theme->fd_size;
+	tw_mem_account(TW_MEM_THEME, bytes - theme->accounted, 0);
+	theme->accounted = bytes;
+}
+
+static void
+theme_publish(struct theme *theme, int fd, size_t size)
 {
 	struct wl_resource *client;
-	struct theme *theme =
-		container_of(global_theme, struct theme, global_theme);
-	struct tw_theme *tw_theme = &theme->global_theme;
 
 	if (theme->fd > 0)
 		close(theme->fd);
-
-	theme->fd = tw_theme_to_fd(&theme->global_theme);
+	theme->fd = fd;
+	theme->fd_size = size;
+	theme->trimmed = false;
+	theme_account(theme);
 	if (theme->fd <= 0)
 		return;
-	if (wl_list_length(&theme->clients) == 0)
-		return;
 
 	wl_list_for_each(client, &theme->clients, link)
 		taiwins_theme_send_theme(client, "new theme", theme->fd,
-		                         sizeof(struct tw_theme) +
-		                         tw_theme->handle_pool.size +
-		                         tw_theme->string_pool.size);
+		                         theme->fd_size);
+}
+
+static void
+theme_job_destroy(struct theme_job *tj)
+{
+	wl_array_release(&tj->snapshot.handle_pool);
+	wl_array_release(&tj->snapshot.string_pool);
+	free(tj);
+}
+
+static struct theme_job *
+theme_job_create(struct theme *theme)
+{
+	struct theme_job *tj = zalloc(sizeof(struct theme_job));
+	const struct tw_theme *src = &theme->global_theme;
+
+	if (!tj)
+		return NULL;
+	tj->theme = theme;
+	tj->fd = -1;
+	tj->snapshot = *src;
+	wl_array_init(&tj->snapshot.handle_pool);
+	wl_array_init(&tj->snapshot.string_pool);
+	if (wl_array_copy(&tj->snapshot.handle_pool, (struct wl_array *)
+	                  &src->handle_pool) < 0 ||
+	    wl_array_copy(&tj->snapshot.string_pool, (struct wl_array *)
+	                  &src->string_pool) < 0) {
+		theme_job_destroy(tj);
+		return NULL;
+	}
+	tj->size = sizeof(struct tw_theme) + src->handle_pool.size +
+		src->string_pool.size;
+	return tj;
+}
+
+/* on a worker, it only sees the snapshot */
+static void
+theme_serialize(UNUSED_ARG(struct tw_job *job), void *data)
+{
+	struct theme_job *tj = data;
+
+	tj->fd = tw_theme_to_fd(&tj->snapshot);
+}
+
+static void
+theme_serialized(void *data, bool cancelled)
+{
+	struct theme_job *tj = data;
+	struct theme *theme = tj->theme;
+
+	if (theme->pending == tj)
+		theme->pending = NULL;
+	if (!cancelled)
+		theme_publish(theme, tj->fd, tj->size);
+	else if (tj->fd > 0)
+		close(tj->fd);
+	theme_job_destroy(tj);
+}
+
+/**
+ * the theme is serialized into a memfd on the worker pool, the clients get it
+ * when it is done. Without the pool, or out of memory, we do it in place.
+ */
+void
+tw_theme_notify(struct tw_theme *global_theme)
+{
+	struct theme *theme =
+		container_of(global_theme, struct theme, global_theme);
+	struct tw_job_sink *sink = tw_get_job_sink();
+	struct theme_job *tj = sink ? theme_job_create(theme) : NULL;
+
+	if (theme->pending)
+		tw_job_cancel(theme->pending->job);
+	theme->pending = NULL;
+	if (tj && (tj->job = tw_job_submit(sink, theme_serialize,
+	                                   theme_serialized, tj))) {
+		theme->pending = tj;
+		return;
+	}
+	if (tj)
+		theme_job_destroy(tj);
+	theme_publish(theme, tw_theme_to_fd(global_theme),
+	              sizeof(struct tw_theme) +
+	              global_theme->handle_pool.size +
+	              global_theme->string_pool.size);
+}
+
+/* the clients have their copy of the memfd, we only need it for the new ones,
+ * which are rare */
+static void
+notify_theme_trim(struct wl_listener *listener, UNUSED_ARG(void *data))
+{
+	struct theme *theme =
+		container_of(listener, struct theme, trim_listener);
+
+	if (theme->pending || theme->fd <= 0)
+		return;
+	close(theme->fd);
+	theme->fd = -1;
+	theme->trimmed = true;
+	theme_account(theme);
+}
+
+static void
+theme_restore(struct theme *theme)
+{
+	struct tw_theme *global_theme = &theme->global_theme;
+
+	theme->fd = tw_theme_to_fd(global_theme);
+	theme->fd_size = sizeof(struct tw_theme) +
+		global_theme->handle_pool.size +
+		global_theme->string_pool.size;
+	theme->trimmed = false;
+	theme_account(theme);
 }
 
 /*******************************************************************************
@@ -94,7 +235,6 @@ bind_theme(struct wl_client *client, void *data, UNUSED_ARG(uint32_t version),
            uint32_t id)
 {
 	struct theme *theme = data;
-	struct tw_theme *tw_theme = &theme->global_theme;
 	struct wl_resource *resource =
 		wl_resource_create(client, &taiwins_theme_interface,
 				   taiwins_theme_interface.version, id);
@@ -106,11 +246,11 @@ bind_theme(struct wl_client *client, void *data, UNUSED_ARG(uint32_t version),
 	wl_resource_set_implementation(resource, NULL, NULL, unbind_theme);
 	wl_list_insert(&theme->clients, wl_resource_get_link(resource));
 
+	if (theme->trimmed)
+		theme_restore(theme);
 	if (theme->fd > 0)
 		taiwins_theme_send_theme(resource, "new_theme", theme->fd,
-		                         sizeof(struct tw_theme) +
-		                         tw_theme->handle_pool.size +
-		                         tw_theme->string_pool.size);
+		                         theme->fd_size);
 	/* taiwins_theme_send_cursor(resource, "whiteglass", 24); */
 }
 
@@ -120,10 +260,13 @@ end_theme(struct wl_listener *listener, void *data)
 	struct theme *theme = container_of(listener, struct theme,
 					   compositor_destroy_listener);
 	wl_global_destroy(theme->global);
+	wl_list_remove(&theme->trim_listener.link);
 
 	if (theme->fd > 0)
 		close(theme->fd);
 	tw_theme_fini(&theme->global_theme);
+	tw_mem_account(TW_MEM_THEME, -theme->accounted, 0);
+	theme->accounted = 0;
 }
 
 /*******************************************************************************
@@ -146,6 +289,9 @@ tw_setup_theme(struct weston_compositor *ec)
 
 	THEME.compositor_destroy_listener.notify = end_theme;
 	wl_signal_add(&ec->destroy_signal, &THEME.compositor_destroy_listener);
+	wl_list_init(&THEME.trim_listener.link);
+	THEME.trim_listener.notify = notify_theme_trim;
+	tw_pressure_add_trim_listener(&THEME.trim_listener);
 
 	return &THEME.global_theme;
 }
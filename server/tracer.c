@@ -0,0 +1,203 @@
+/*
+ * tracer.c - taiwins compositor trace hooks
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/limits.h>
+#include <libweston/libweston.h>
+#include <ctypes/helpers.h>
+
+#include <alloc.h>
+#include <trace.h>
+#include "compositor.h"
+
+struct tw_tracer_output {
+	struct wl_list link;
+	struct weston_output *output;
+	struct wl_listener frame_listener;
+	struct wl_listener destroy_listener;
+	uint64_t last_frame;
+};
+
+static struct tw_tracer {
+	struct weston_compositor *compositor;
+	struct wl_event_source *signal;
+	struct wl_list outputs;
+	struct wl_listener output_created_listener;
+	struct wl_listener compositor_destroy_listener;
+} s_tracer;
+
+static inline uint64_t
+tracer_now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool
+tw_tracer_dump(void)
+{
+	char path[PATH_MAX];
+
+	if (!tw_trace_dump_path(path, sizeof(path), "taiwins")) {
+		tw_log_warn("trace", "no XDG_RUNTIME_DIR to dump trace");
+		return false;
+	}
+	if (!tw_trace_dump(path)) {
+		tw_log_warn("trace", "failed to dump trace to %s", path);
+		return false;
+	}
+	tw_log_info("trace", "trace dumped to %s", path);
+	return true;
+}
+
+static void
+tracer_dump_memory(void)
+{
+	struct tw_mem_stats stats;
+
+	for (int i = 0; i < TW_MEM_TAG_COUNT; i++) {
+		tw_mem_get_stats(i, &stats);
+		tw_log_info("memory", "%s: %lld bytes in %lld allocations, "
+		            "peak %lld bytes", tw_mem_tag_name(i),
+		            (long long)stats.live_bytes,
+		            (long long)stats.live_allocs,
+		            (long long)stats.peak_bytes);
+	}
+}
+
+static int
+tracer_on_signal(int sig_num, void *data)
+{
+	tw_tracer_dump();
+	tw_client_stats_dump();
+	tracer_dump_memory();
+	tw_damage_dump();
+	tw_watchdog_dump();
+	return 1;
+}
+
+/* libweston has no hook before the repaint, the frame signal comes right after
+ * the output finished drawing, so every frame is an instant plus the interval
+ * since the last one, a stutter shows up as a spike on the counter. */
+static void
+tracer_output_frame(struct wl_listener *listener, void *data)
+{
+	struct tw_tracer_output *to =
+		container_of(listener, struct tw_tracer_output, frame_listener);
+	uint64_t now = tracer_now_us();
+
+	TW_TRACE_INSTANT("weston", "repaint");
+	if (to->last_frame)
+		TW_TRACE_COUNTER("weston", "frame_interval_us",
+		                 now - to->last_frame);
+	to->last_frame = now;
+}
+
+static void
+tracer_output_destroy(struct wl_listener *listener, void *data)
+{
+	struct tw_tracer_output *to =
+		container_of(listener, struct tw_tracer_output,
+		             destroy_listener);
+
+	wl_list_remove(&to->frame_listener.link);
+	wl_list_remove(&to->destroy_listener.link);
+	wl_list_remove(&to->link);
+	free(to);
+}
+
+static void
+tracer_add_output(struct tw_tracer *tracer, struct weston_output *output)
+{
+	struct tw_tracer_output *to = zalloc(sizeof(*to));
+
+	if (!to)
+		return;
+	to->output = output;
+	wl_list_init(&to->frame_listener.link);
+	to->frame_listener.notify = tracer_output_frame;
+	wl_signal_add(&output->frame_signal, &to->frame_listener);
+	wl_list_init(&to->destroy_listener.link);
+	to->destroy_listener.notify = tracer_output_destroy;
+	wl_signal_add(&output->destroy_signal, &to->destroy_listener);
+	wl_list_insert(&tracer->outputs, &to->link);
+}
+
+static void
+tracer_output_created(struct wl_listener *listener, void *data)
+{
+	struct tw_tracer *tracer =
+		container_of(listener, struct tw_tracer,
+		             output_created_listener);
+	tracer_add_output(tracer, data);
+}
+
+static void
+end_tracer(struct wl_listener *listener, void *data)
+{
+	struct tw_tracer *tracer =
+		container_of(listener, struct tw_tracer,
+		             compositor_destroy_listener);
+	struct tw_tracer_output *to, *tmp;
+
+	wl_list_for_each_safe(to, tmp, &tracer->outputs, link)
+		tracer_output_destroy(&to->destroy_listener, NULL);
+	wl_list_remove(&tracer->output_created_listener.link);
+	wl_list_remove(&tracer->compositor_destroy_listener.link);
+	if (tracer->signal)
+		wl_event_source_remove(tracer->signal);
+	tracer->signal = NULL;
+}
+
+struct tw_tracer *
+tw_setup_tracer(struct weston_compositor *ec)
+{
+	struct tw_tracer *tracer = &s_tracer;
+	struct weston_output *output;
+	struct wl_event_loop *loop = wl_display_get_event_loop(ec->wl_display);
+
+	tracer->compositor = ec;
+	wl_list_init(&tracer->outputs);
+	tw_trace_thread_name("compositor");
+
+	tracer->signal = wl_event_loop_add_signal(loop, SIGUSR2,
+	                                          tracer_on_signal, tracer);
+	if (!tracer->signal)
+		return NULL;
+
+	wl_list_for_each(output, &ec->output_list, link)
+		tracer_add_output(tracer, output);
+	wl_list_init(&tracer->output_created_listener.link);
+	tracer->output_created_listener.notify = tracer_output_created;
+	wl_signal_add(&ec->output_created_signal,
+	              &tracer->output_created_listener);
+
+	wl_list_init(&tracer->compositor_destroy_listener.link);
+	tracer->compositor_destroy_listener.notify = end_tracer;
+	wl_signal_add(&ec->destroy_signal,
+	              &tracer->compositor_destroy_listener);
+	return tracer;
+}
@@ -0,0 +1,295 @@
+/*
+ * watchdog.c - taiwins event loop stall watchdog
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-server.h>
+#include <ctypes/helpers.h>
+
+#include "log.h"
+#include "watchdog.h"
+
+#define TW_WATCHDOG_MAX_FRAMES 32
+#define TW_WATCHDOG_KEY_FRAMES 6
+#define TW_WATCHDOG_MAX_SITES 64
+
+_Atomic(const char *) tw_watchdog_source = NULL;
+
+struct tw_stall_site {
+	uint64_t key;
+	const char *source;
+	unsigned int count;
+	uint64_t total_ms, max_ms;
+};
+
+static struct tw_watchdog {
+	struct wl_event_source *timer;
+	unsigned int threshold_ms;
+	unsigned int beat_ms;
+	pthread_t loop_thread;
+	pthread_t thread;
+	bool running;
+	int signo;
+
+	_Atomic uint64_t beat;
+	_Atomic bool quit;
+
+	//filled by the signal handler on the loop thread
+	void *frames[TW_WATCHDOG_MAX_FRAMES];
+	_Atomic int nframes;
+
+	//only the watchdog thread writes, the dump reads
+	pthread_mutex_t lock;
+	struct tw_stall_site sites[TW_WATCHDOG_MAX_SITES];
+	unsigned int nsites;
+	unsigned int overflow;
+} s_watchdog = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static inline uint64_t
+watchdog_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int
+watchdog_beat(void *data)
+{
+	struct tw_watchdog *wd = data;
+
+	atomic_store_explicit(&wd->beat, watchdog_now_ms(),
+	                      memory_order_relaxed);
+	wl_event_source_timer_update(wd->timer, wd->beat_ms);
+	return 0;
+}
+
+static void
+watchdog_sample(int signo)
+{
+	int n = backtrace(s_watchdog.frames, TW_WATCHDOG_MAX_FRAMES);
+	atomic_store_explicit(&s_watchdog.nframes, n, memory_order_release);
+}
+
+/* key of the stack is the functions on it instead of the return addresses, a
+ * loop stuck in one function lands on different addresses every time. The
+ * first two frames are the handler and the signal trampoline */
+static uint64_t
+watchdog_stack_key(void **frames, int n)
+{
+	uint64_t key = 1469598103934665603ull;
+	Dl_info info;
+
+	for (int i = 2; i < MIN(n, 2 + TW_WATCHDOG_KEY_FRAMES); i++) {
+		uintptr_t addr = (uintptr_t)frames[i];
+		if (dladdr(frames[i], &info) && info.dli_saddr)
+			addr = (uintptr_t)info.dli_saddr;
+		key = (key ^ addr) * 1099511628211ull;
+	}
+	return key;
+}
+
+static struct tw_stall_site *
+watchdog_site(struct tw_watchdog *wd, uint64_t key, const char *source,
+              bool *fresh)
+{
+	struct tw_stall_site *site = NULL;
+
+	*fresh = false;
+	for (unsigned i = 0; i < wd->nsites; i++)
+		if (wd->sites[i].key == key)
+			return &wd->sites[i];
+	if (wd->nsites >= TW_WATCHDOG_MAX_SITES) {
+		wd->overflow++;
+		return NULL;
+	}
+	site = &wd->sites[wd->nsites++];
+	*site = (struct tw_stall_site){.key = key, .source = source};
+	*fresh = true;
+	return site;
+}
+
+static struct tw_stall_site *
+watchdog_report(struct tw_watchdog *wd, uint64_t stalled_ms)
+{
+	const char *source = atomic_load_explicit(&tw_watchdog_source,
+	                                          memory_order_relaxed);
+	struct tw_stall_site *site;
+	char **symbols = NULL;
+	bool fresh;
+	int n = -1;
+
+	atomic_store_explicit(&wd->nframes, -1, memory_order_relaxed);
+	pthread_kill(wd->loop_thread, wd->signo);
+	//give the loop thread a moment to take the sample
+	for (int i = 0; i < 100 && n < 0; i++) {
+		nanosleep(&(struct timespec){0, 1000000}, NULL);
+		n = atomic_load_explicit(&wd->nframes, memory_order_acquire);
+	}
+	if (!source)
+		source = "unknown";
+	if (n <= 0) {
+		tw_log_warn("watchdog", "event loop stalled %llums in %s, "
+		            "no backtrace", (unsigned long long)stalled_ms,
+		            source);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&wd->lock);
+	site = watchdog_site(wd, watchdog_stack_key(wd->frames, n), source,
+	                     &fresh);
+	if (site)
+		site->count++;
+	pthread_mutex_unlock(&wd->lock);
+
+	if (site && !fresh) {
+		tw_log_warn("watchdog", "event loop stalled %llums in %s, "
+		            "same stack as stall #%ld (%u times)",
+		            (unsigned long long)stalled_ms, source,
+		            (long)(site - wd->sites), site->count);
+		return site;
+	}
+	tw_log_warn("watchdog", "event loop stalled %llums in %s, stall #%ld:",
+	            (unsigned long long)stalled_ms, source,
+	            site ? (long)(site - wd->sites) : -1l);
+	symbols = backtrace_symbols(wd->frames, n);
+	for (int i = 2; symbols && i < n; i++)
+		tw_log_warn("watchdog", "  #%d %s", i - 2, symbols[i]);
+	free(symbols);
+	return site;
+}
+
+static void *
+watchdog_run(void *data)
+{
+	struct tw_watchdog *wd = data;
+	struct tw_stall_site *site = NULL;
+	uint64_t beat, now, stall_start = 0;
+	struct timespec period = {
+		.tv_sec = wd->beat_ms / 1000,
+		.tv_nsec = (wd->beat_ms % 1000) * 1000000,
+	};
+
+	while (!atomic_load_explicit(&wd->quit, memory_order_relaxed)) {
+		nanosleep(&period, NULL);
+		now = watchdog_now_ms();
+		beat = atomic_load_explicit(&wd->beat, memory_order_relaxed);
+
+		if (now - beat >= wd->threshold_ms && !stall_start) {
+			stall_start = beat;
+			site = watchdog_report(wd, now - beat);
+		} else if (stall_start && beat > stall_start) {
+			//the loop is back, now we know how long it was
+			uint64_t ms = beat - stall_start;
+			tw_log_warn("watchdog", "event loop recovered after "
+			            "%llums", (unsigned long long)ms);
+			pthread_mutex_lock(&wd->lock);
+			if (site) {
+				site->total_ms += ms;
+				site->max_ms = MAX(site->max_ms, ms);
+			}
+			pthread_mutex_unlock(&wd->lock);
+			stall_start = 0;
+			site = NULL;
+		}
+	}
+	return NULL;
+}
+
+void
+tw_watchdog_dump(void)
+{
+	struct tw_watchdog *wd = &s_watchdog;
+
+	pthread_mutex_lock(&wd->lock);
+	for (unsigned i = 0; i < wd->nsites; i++)
+		tw_log_info("watchdog", "stall #%u in %s: %u times, "
+		            "total %llums, max %llums", i,
+		            wd->sites[i].source, wd->sites[i].count,
+		            (unsigned long long)wd->sites[i].total_ms,
+		            (unsigned long long)wd->sites[i].max_ms);
+	if (wd->overflow)
+		tw_log_info("watchdog", "%u stalls on untracked stacks",
+		            wd->overflow);
+	pthread_mutex_unlock(&wd->lock);
+}
+
+bool
+tw_watchdog_start(struct wl_event_loop *loop, unsigned int threshold_ms)
+{
+	struct tw_watchdog *wd = &s_watchdog;
+	struct sigaction sa = {0};
+	void *dummy[1];
+
+	if (wd->running || threshold_ms < 4)
+		return false;
+	wd->threshold_ms = threshold_ms;
+	wd->beat_ms = threshold_ms / 4;
+	wd->loop_thread = pthread_self();
+	wd->signo = SIGRTMIN + 3;
+	atomic_init(&wd->beat, watchdog_now_ms());
+	atomic_init(&wd->quit, false);
+	atomic_init(&wd->nframes, -1);
+
+	//backtrace loads libgcc on first use, that must not happen in the
+	//signal handler
+	backtrace(dummy, 1);
+	sa.sa_handler = watchdog_sample;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(wd->signo, &sa, NULL))
+		return false;
+
+	wd->timer = wl_event_loop_add_timer(loop, watchdog_beat, wd);
+	if (!wd->timer)
+		return false;
+	wl_event_source_timer_update(wd->timer, wd->beat_ms);
+	if (pthread_create(&wd->thread, NULL, watchdog_run, wd)) {
+		wl_event_source_remove(wd->timer);
+		wd->timer = NULL;
+		return false;
+	}
+	wd->running = true;
+	return true;
+}
+
+void
+tw_watchdog_stop(void)
+{
+	struct tw_watchdog *wd = &s_watchdog;
+
+	if (!wd->running)
+		return;
+	atomic_store(&wd->quit, true);
+	pthread_join(wd->thread, NULL);
+	wl_event_source_remove(wd->timer);
+	wd->timer = NULL;
+	wd->running = false;
+	tw_watchdog_dump();
+}
@@ -0,0 +1,88 @@
+/*
+ * watchdog.h - taiwins event loop stall watchdog
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_WATCHDOG_H
+#define TW_WATCHDOG_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+struct wl_event_loop;
+
+/**
+ * @brief watch the event loop of the calling thread
+ *
+ * A timer on the loop beats every threshold/4 ms, a watchdog thread checks the
+ * beats. When the loop misses its beats for threshold ms, the watchdog
+ * interrupts the loop thread with a signal to take its backtrace, then logs it
+ * with the source being dispatched. Stalls are aggregated by the functions on
+ * the stack, so one stuck handler is reported once with a count.
+ */
+bool
+tw_watchdog_start(struct wl_event_loop *loop, unsigned int threshold_ms);
+
+void
+tw_watchdog_stop(void);
+
+/**
+ * @brief log the aggregated stalls
+ */
+void
+tw_watchdog_dump(void);
+
+extern _Atomic(const char *) tw_watchdog_source;
+
+static inline const char *
+tw_watchdog_enter(const char *source)
+{
+	return atomic_exchange_explicit(&tw_watchdog_source, source,
+	                                memory_order_relaxed);
+}
+
+static inline void
+tw_watchdog_leave(const char **prev)
+{
+	atomic_store_explicit(&tw_watchdog_source, *prev,
+	                      memory_order_relaxed);
+}
+
+#define _TW_WATCHDOG_CAT(a, b) a##b
+#define _TW_WATCHDOG_VAR(line) _TW_WATCHDOG_CAT(_tw_watchdog_prev_, line)
+
+/**
+ * @brief name what the loop is doing until the end of the block, shows up in
+ * stall reports. source has to be a string literal.
+ */
+#define TW_WATCHDOG_SOURCE(source) \
+	const char *_TW_WATCHDOG_VAR(__LINE__) \
+	__attribute__((cleanup(tw_watchdog_leave))) = \
+		tw_watchdog_enter(source)
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,358 @@
+/*
+ * alloc.c - taiwins subsystem tagged allocations
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <assert.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+
+#define TW_MEM_MAGIC 0x4d454d54 /* "TMEM" */
+#define TW_MEM_LEAKS_PER_TAG 32
+
+struct tw_mem_header {
+	struct tw_mem_header *prev, *next;
+	void *caller;
+	size_t size;
+	uint32_t tag;
+	uint32_t magic;
+} __attribute__((aligned(16)));
+
+struct tw_mem_counter {
+	_Atomic int64_t live_bytes;
+	_Atomic int64_t live_allocs;
+	_Atomic int64_t peak_bytes;
+	_Atomic uint64_t total_allocs;
+};
+
+static struct {
+	pthread_once_t once;
+	pthread_mutex_t lock;
+	bool leak_check;
+	struct tw_mem_counter counters[TW_MEM_TAG_COUNT];
+	//only in leak check mode
+	struct tw_mem_header lists[TW_MEM_TAG_COUNT];
+} s_mem = {
+	.once = PTHREAD_ONCE_INIT,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static const char *s_tag_names[TW_MEM_TAG_COUNT] = {
+	[TW_MEM_MISC] = "misc",
+	[TW_MEM_LAYOUT] = "layout",
+	[TW_MEM_WORKSPACE] = "workspace",
+	[TW_MEM_BINDINGS] = "bindings",
+	[TW_MEM_CONFIG] = "config",
+	[TW_MEM_THEME] = "theme",
+	[TW_MEM_SHELL_UI] = "shell-ui",
+	[TW_MEM_CONSOLE] = "console",
+	[TW_MEM_ICONS] = "icons",
+};
+
+static void
+mem_dump_leaks_at_exit(void)
+{
+	tw_mem_dump_leaks(stderr);
+}
+
+static void
+mem_init(void)
+{
+	const char *env = getenv("TAIWINS_LEAK_CHECK");
+
+	for (int i = 0; i < TW_MEM_TAG_COUNT; i++)
+		s_mem.lists[i].prev = s_mem.lists[i].next = &s_mem.lists[i];
+	s_mem.leak_check = env && *env && strcmp(env, "0");
+	if (s_mem.leak_check)
+		atexit(mem_dump_leaks_at_exit);
+}
+
+static inline enum tw_mem_tag
+mem_check_tag(enum tw_mem_tag tag)
+{
+	return ((unsigned)tag < TW_MEM_TAG_COUNT) ? tag : TW_MEM_MISC;
+}
+
+static void
+mem_charge(enum tw_mem_tag tag, int64_t bytes, int64_t allocs)
+{
+	struct tw_mem_counter *c = &s_mem.counters[tag];
+	int64_t live, peak;
+
+	live = atomic_fetch_add_explicit(&c->live_bytes, bytes,
+	                                 memory_order_relaxed) + bytes;
+	atomic_fetch_add_explicit(&c->live_allocs, allocs,
+	                          memory_order_relaxed);
+	if (allocs > 0)
+		atomic_fetch_add_explicit(&c->total_allocs, allocs,
+		                          memory_order_relaxed);
+	peak = atomic_load_explicit(&c->peak_bytes, memory_order_relaxed);
+	while (live > peak &&
+	       !atomic_compare_exchange_weak_explicit(&c->peak_bytes, &peak,
+	                                              live,
+	                                              memory_order_relaxed,
+	                                              memory_order_relaxed));
+}
+
+static inline void
+mem_link(struct tw_mem_header *h)
+{
+	struct tw_mem_header *list = &s_mem.lists[h->tag];
+
+	h->prev = list->prev;
+	h->next = list;
+	list->prev->next = h;
+	list->prev = h;
+}
+
+static inline void
+mem_unlink(struct tw_mem_header *h)
+{
+	h->prev->next = h->next;
+	h->next->prev = h->prev;
+	h->prev = h->next = NULL;
+}
+
+static inline struct tw_mem_header *
+mem_header(void *ptr)
+{
+	struct tw_mem_header *h = (struct tw_mem_header *)ptr - 1;
+
+	assert(h->magic == TW_MEM_MAGIC);
+	return h;
+}
+
+static void *
+mem_alloc(enum tw_mem_tag tag, size_t size, bool zero, void *caller)
+{
+	struct tw_mem_header *h;
+
+	pthread_once(&s_mem.once, mem_init);
+	if (size > SIZE_MAX - sizeof(*h))
+		return NULL;
+	h = zero ? calloc(1, sizeof(*h) + size) : malloc(sizeof(*h) + size);
+	if (!h)
+		return NULL;
+	h->tag = mem_check_tag(tag);
+	h->size = size;
+	h->caller = caller;
+	h->magic = TW_MEM_MAGIC;
+	h->prev = h->next = NULL;
+	if (s_mem.leak_check) {
+		pthread_mutex_lock(&s_mem.lock);
+		mem_link(h);
+		pthread_mutex_unlock(&s_mem.lock);
+	}
+	mem_charge(h->tag, (int64_t)size, 1);
+	return h + 1;
+}
+
+void *
+tw_malloc(enum tw_mem_tag tag, size_t size)
+{
+	return mem_alloc(tag, size, false, __builtin_return_address(0));
+}
+
+void *
+tw_zalloc(enum tw_mem_tag tag, size_t size)
+{
+	return mem_alloc(tag, size, true, __builtin_return_address(0));
+}
+
+void *
+tw_calloc(enum tw_mem_tag tag, size_t nmemb, size_t size)
+{
+	if (size && nmemb > SIZE_MAX / size)
+		return NULL;
+	return mem_alloc(tag, nmemb * size, true,
+	                 __builtin_return_address(0));
+}
+
+char *
+tw_strdup(enum tw_mem_tag tag, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *dup = mem_alloc(tag, len, false, __builtin_return_address(0));
+
+	if (dup)
+		memcpy(dup, str, len);
+	return dup;
+}
+
+void
+tw_free(void *ptr)
+{
+	struct tw_mem_header *h;
+
+	if (!ptr)
+		return;
+	h = mem_header(ptr);
+	if (h->next) {
+		pthread_mutex_lock(&s_mem.lock);
+		mem_unlink(h);
+		pthread_mutex_unlock(&s_mem.lock);
+	}
+	mem_charge(h->tag, -(int64_t)h->size, -1);
+	h->magic = 0;
+	free(h);
+}
+
+void *
+tw_realloc(enum tw_mem_tag tag, void *ptr, size_t size)
+{
+	struct tw_mem_header *h, *n;
+	size_t old;
+
+	if (!ptr)
+		return mem_alloc(tag, size, false,
+		                 __builtin_return_address(0));
+	if (size > SIZE_MAX - sizeof(*h))
+		return NULL;
+	h = mem_header(ptr);
+	old = h->size;
+	//the node moves, keep the list locked until it is linked again
+	if (h->next) {
+		pthread_mutex_lock(&s_mem.lock);
+		mem_unlink(h);
+		n = realloc(h, sizeof(*h) + size);
+		mem_link(n ? n : h);
+		pthread_mutex_unlock(&s_mem.lock);
+	} else {
+		n = realloc(h, sizeof(*h) + size);
+	}
+	if (!n)
+		return NULL;
+	n->size = size;
+	mem_charge(n->tag, (int64_t)size - (int64_t)old, 0);
+	return n + 1;
+}
+
+void *
+tw_mem_lua_alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+	enum tw_mem_tag tag = (enum tw_mem_tag)(intptr_t)ud;
+	(void)osize;
+
+	if (nsize == 0) {
+		tw_free(ptr);
+		return NULL;
+	}
+	return tw_realloc(tag, ptr, nsize);
+}
+
+void
+tw_mem_account(enum tw_mem_tag tag, int64_t bytes, int64_t allocs)
+{
+	mem_charge(mem_check_tag(tag), bytes, allocs);
+}
+
+void
+tw_mem_get_stats(enum tw_mem_tag tag, struct tw_mem_stats *stats)
+{
+	struct tw_mem_counter *c = &s_mem.counters[mem_check_tag(tag)];
+
+	stats->live_bytes = atomic_load(&c->live_bytes);
+	stats->live_allocs = atomic_load(&c->live_allocs);
+	stats->peak_bytes = atomic_load(&c->peak_bytes);
+	stats->total_allocs = atomic_load(&c->total_allocs);
+}
+
+const char *
+tw_mem_tag_name(enum tw_mem_tag tag)
+{
+	return s_tag_names[mem_check_tag(tag)];
+}
+
+void
+tw_mem_dump(FILE *file)
+{
+	struct tw_mem_stats stats;
+
+	fprintf(file, "%-10s %12s %10s %12s %12s\n", "tag", "live bytes",
+	        "allocs", "peak bytes", "total allocs");
+	for (int i = 0; i < TW_MEM_TAG_COUNT; i++) {
+		tw_mem_get_stats(i, &stats);
+		fprintf(file, "%-10s %12lld %10lld %12lld %12llu\n",
+		        s_tag_names[i], (long long)stats.live_bytes,
+		        (long long)stats.live_allocs,
+		        (long long)stats.peak_bytes,
+		        (unsigned long long)stats.total_allocs);
+	}
+}
+
+bool
+tw_mem_leak_check_enabled(void)
+{
+	pthread_once(&s_mem.once, mem_init);
+	return s_mem.leak_check;
+}
+
+static void
+mem_print_site(FILE *file, const struct tw_mem_header *h)
+{
+	Dl_info info;
+
+	if (dladdr(h->caller, &info) && info.dli_sname)
+		fprintf(file, "\t%8zu bytes from %s+%#lx\n", h->size,
+		        info.dli_sname,
+		        (unsigned long)((char *)h->caller -
+		                        (char *)info.dli_saddr));
+	else
+		fprintf(file, "\t%8zu bytes from %p\n", h->size, h->caller);
+}
+
+void
+tw_mem_dump_leaks(FILE *file)
+{
+	const struct tw_mem_header *list, *h;
+	size_t count, bytes;
+
+	if (!tw_mem_leak_check_enabled())
+		return;
+	pthread_mutex_lock(&s_mem.lock);
+	for (int i = 0; i < TW_MEM_TAG_COUNT; i++) {
+		list = &s_mem.lists[i];
+		if (list->next == list)
+			continue;
+		count = bytes = 0;
+		for (h = list->next; h != list; h = h->next) {
+			count++;
+			bytes += h->size;
+		}
+		fprintf(file, "%s: %zu allocations, %zu bytes outstanding\n",
+		        s_tag_names[i], count, bytes);
+		count = 0;
+		for (h = list->next; h != list; h = h->next) {
+			if (count++ == TW_MEM_LEAKS_PER_TAG)
+				break;
+			mem_print_site(file, h);
+		}
+		if (h != list)
+			fprintf(file, "\t... more not shown\n");
+	}
+	pthread_mutex_unlock(&s_mem.lock);
+}
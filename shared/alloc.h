@@ -0,0 +1,130 @@
+/*
+ * alloc.h - taiwins subsystem tagged allocations
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_ALLOC_H
+#define TW_ALLOC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Every allocation carries a small header in front of it with its tag and
+ * size, so tw_free does not need the tag and the live bytes and allocation
+ * count of every tag are kept exactly. The counters are atomics, the helpers
+ * are safe from any thread.
+ *
+ * With TAIWINS_LEAK_CHECK set in the environment, the allocations are also
+ * linked together with the address of their caller, what is still alive at
+ * exit is dumped to stderr per tag. The mode is decided at the first
+ * allocation and never changes.
+ *
+ * Memory from tw_malloc and friends has to be released by tw_free and
+ * nothing else.
+ */
+
+enum tw_mem_tag {
+	TW_MEM_MISC = 0,
+	TW_MEM_LAYOUT, /**< layout trees */
+	TW_MEM_WORKSPACE, /**< workspaces and recent views */
+	TW_MEM_BINDINGS,
+	TW_MEM_CONFIG, /**< config and the lua state */
+	TW_MEM_THEME,
+	TW_MEM_SHELL_UI,
+	TW_MEM_CONSOLE, /**< console modules and search results */
+	TW_MEM_ICONS,
+	TW_MEM_TAG_COUNT,
+};
+
+struct tw_mem_stats {
+	int64_t live_bytes;
+	int64_t live_allocs;
+	int64_t peak_bytes;
+	uint64_t total_allocs;
+};
+
+void *
+tw_malloc(enum tw_mem_tag tag, size_t size);
+
+void *
+tw_zalloc(enum tw_mem_tag tag, size_t size);
+
+void *
+tw_calloc(enum tw_mem_tag tag, size_t nmemb, size_t size);
+
+/**
+ * @brief realloc, the tag is only used when ptr is NULL
+ */
+void *
+tw_realloc(enum tw_mem_tag tag, void *ptr, size_t size);
+
+char *
+tw_strdup(enum tw_mem_tag tag, const char *str);
+
+void
+tw_free(void *ptr);
+
+/**
+ * @brief lua_Alloc, pass the tag as ud, casted through intptr_t
+ */
+void *
+tw_mem_lua_alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+/**
+ * @brief charge memory we do not allocate ourselves to a tag
+ *
+ * For the containers of ctypes and wayland which owns their own storage, the
+ * caller has to take back exactly what it added.
+ */
+void
+tw_mem_account(enum tw_mem_tag tag, int64_t bytes, int64_t allocs);
+
+void
+tw_mem_get_stats(enum tw_mem_tag tag, struct tw_mem_stats *stats);
+
+const char *
+tw_mem_tag_name(enum tw_mem_tag tag);
+
+/**
+ * @brief one line per tag
+ */
+void
+tw_mem_dump(FILE *file);
+
+bool
+tw_mem_leak_check_enabled(void);
+
+/**
+ * @brief outstanding allocations per tag, nothing without leak check mode
+ */
+void
+tw_mem_dump_leaks(FILE *file);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,357 @@
+/*
+ * jobs.c - taiwins worker pool
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "jobs.h"
+#include "trace.h"
+
+#define TW_JOB_MAX_THREADS 4
+
+enum tw_job_state {
+	TW_JOB_QUEUED,
+	TW_JOB_RUNNING, /**< or finished, either way out of the queue */
+};
+
+struct tw_job {
+	struct tw_job *prev, *next;
+	struct tw_job_sink *sink;
+	tw_job_run_t run;
+	tw_job_done_t done;
+	void *data;
+	enum tw_job_state state; /**< under the pool lock */
+	_Atomic bool cancelled;
+	uint64_t submitted, started;
+};
+
+struct tw_job_sink {
+	struct tw_job_pool *pool;
+	pthread_mutex_t lock;
+	struct tw_job finished;
+	int fd;
+	_Atomic bool closing;
+	unsigned int outstanding; /**< owner thread only */
+};
+
+struct tw_job_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct tw_job queue;
+	bool quit;
+	unsigned int nthreads;
+	pthread_t threads[TW_JOB_MAX_THREADS];
+};
+
+static inline uint64_t
+jobs_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline void
+job_list_init(struct tw_job *list)
+{
+	list->prev = list->next = list;
+}
+
+static inline bool
+job_list_empty(const struct tw_job *list)
+{
+	return list->next == list;
+}
+
+static inline void
+job_list_append(struct tw_job *list, struct tw_job *job)
+{
+	job->prev = list->prev;
+	job->next = list;
+	list->prev->next = job;
+	list->prev = job;
+}
+
+static inline void
+job_list_remove(struct tw_job *job)
+{
+	job->prev->next = job->next;
+	job->next->prev = job->prev;
+	job->prev = job->next = NULL;
+}
+
+/* hand the job back to the owner, the pool is not touching it anymore */
+static void
+job_complete(struct tw_job *job)
+{
+	struct tw_job_sink *sink = job->sink;
+	uint64_t one = 1;
+
+	//the owner may free the sink as soon as it sees the job, so the sink
+	//is only touched with the lock held, see tw_job_sink_destroy
+	pthread_mutex_lock(&sink->lock);
+	job_list_append(&sink->finished, job);
+	//only fails if the counter is about to overflow, it is readable then
+	while (write(sink->fd, &one, sizeof(one)) < 0 && errno == EINTR);
+	pthread_mutex_unlock(&sink->lock);
+}
+
+static void *
+job_worker(void *data)
+{
+	struct tw_job_pool *pool = data;
+	struct tw_job *job;
+
+	tw_trace_thread_name("job-worker");
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while (!pool->quit && job_list_empty(&pool->queue))
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		if (pool->quit)
+			break;
+		job = pool->queue.next;
+		job_list_remove(job);
+		job->state = TW_JOB_RUNNING;
+		pthread_mutex_unlock(&pool->lock);
+
+		job->started = jobs_now();
+		if (!tw_job_cancelled(job)) {
+			TW_TRACE_BEGIN("jobs", "run");
+			job->run(job, job->data);
+			TW_TRACE_END("jobs", "run");
+		}
+		job_complete(job);
+		pthread_mutex_lock(&pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+struct tw_job_pool *
+tw_job_pool_create(unsigned int nthreads)
+{
+	struct tw_job_pool *pool;
+	long ncpus;
+
+	if (!nthreads) {
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpus > 1 ? (unsigned int)ncpus : 1;
+	}
+	if (nthreads > TW_JOB_MAX_THREADS)
+		nthreads = TW_JOB_MAX_THREADS;
+	if (!(pool = calloc(1, sizeof(*pool))))
+		return NULL;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+	job_list_init(&pool->queue);
+
+	for (pool->nthreads = 0; pool->nthreads < nthreads; pool->nthreads++)
+		if (pthread_create(&pool->threads[pool->nthreads], NULL,
+		                   job_worker, pool))
+			break;
+	if (!pool->nthreads) {
+		tw_job_pool_destroy(pool);
+		return NULL;
+	}
+	return pool;
+}
+
+void
+tw_job_pool_destroy(struct tw_job_pool *pool)
+{
+	struct tw_job *job;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	while (!job_list_empty(&pool->queue)) {
+		job = pool->queue.next;
+		job_list_remove(job);
+		job->state = TW_JOB_RUNNING;
+		atomic_store(&job->cancelled, true);
+		job_complete(job);
+	}
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (unsigned int i = 0; i < pool->nthreads; i++)
+		pthread_join(pool->threads[i], NULL);
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+struct tw_job_sink *
+tw_job_sink_create(struct tw_job_pool *pool)
+{
+	struct tw_job_sink *sink = calloc(1, sizeof(*sink));
+
+	if (!sink)
+		return NULL;
+	sink->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (sink->fd < 0) {
+		free(sink);
+		return NULL;
+	}
+	sink->pool = pool;
+	pthread_mutex_init(&sink->lock, NULL);
+	job_list_init(&sink->finished);
+	return sink;
+}
+
+void
+tw_job_sink_destroy(struct tw_job_sink *sink)
+{
+	struct tw_job_pool *pool = sink->pool;
+	struct tw_job *job, *next;
+	struct pollfd pfd = {
+		.fd = sink->fd,
+		.events = POLLIN,
+	};
+
+	atomic_store(&sink->closing, true);
+	pthread_mutex_lock(&pool->lock);
+	for (job = pool->queue.next; job != &pool->queue; job = next) {
+		next = job->next;
+		if (job->sink != sink)
+			continue;
+		job_list_remove(job);
+		job->state = TW_JOB_RUNNING;
+		atomic_store(&job->cancelled, true);
+		job_complete(job);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	//the running ones see closing and come back soon
+	while (sink->outstanding) {
+		if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+			break;
+		tw_job_sink_dispatch(sink);
+	}
+	//wait for the last job_complete to let go of the sink
+	pthread_mutex_lock(&sink->lock);
+	pthread_mutex_unlock(&sink->lock);
+	close(sink->fd);
+	pthread_mutex_destroy(&sink->lock);
+	free(sink);
+}
+
+int
+tw_job_sink_get_fd(const struct tw_job_sink *sink)
+{
+	return sink->fd;
+}
+
+int
+tw_job_sink_dispatch(struct tw_job_sink *sink)
+{
+	struct tw_job finished, *job;
+	uint64_t count;
+	int n = 0;
+
+	if (read(sink->fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		return 0;
+	job_list_init(&finished);
+	pthread_mutex_lock(&sink->lock);
+	if (!job_list_empty(&sink->finished)) {
+		finished.next = sink->finished.next;
+		finished.prev = sink->finished.prev;
+		finished.next->prev = &finished;
+		finished.prev->next = &finished;
+		job_list_init(&sink->finished);
+	}
+	pthread_mutex_unlock(&sink->lock);
+
+	while (!job_list_empty(&finished)) {
+		job = finished.next;
+		job_list_remove(job);
+		sink->outstanding--;
+		job->done(job->data, tw_job_cancelled(job));
+		free(job);
+		n++;
+	}
+	return n;
+}
+
+struct tw_job *
+tw_job_submit(struct tw_job_sink *sink, tw_job_run_t run, tw_job_done_t done,
+              void *data)
+{
+	struct tw_job_pool *pool = sink->pool;
+	struct tw_job *job = calloc(1, sizeof(*job));
+
+	if (!job)
+		return NULL;
+	job->sink = sink;
+	job->run = run;
+	job->done = done;
+	job->data = data;
+	job->state = TW_JOB_QUEUED;
+	job->submitted = jobs_now();
+	atomic_init(&job->cancelled, false);
+	sink->outstanding++;
+
+	pthread_mutex_lock(&pool->lock);
+	job_list_append(&pool->queue, job);
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+	return job;
+}
+
+void
+tw_job_cancel(struct tw_job *job)
+{
+	struct tw_job_pool *pool = job->sink->pool;
+	bool queued;
+
+	atomic_store(&job->cancelled, true);
+	pthread_mutex_lock(&pool->lock);
+	queued = job->state == TW_JOB_QUEUED;
+	if (queued) {
+		job_list_remove(job);
+		job->state = TW_JOB_RUNNING;
+	}
+	pthread_mutex_unlock(&pool->lock);
+	if (queued)
+		job_complete(job);
+}
+
+bool
+tw_job_cancelled(const struct tw_job *job)
+{
+	return atomic_load_explicit(&job->cancelled, memory_order_relaxed) ||
+		atomic_load_explicit(&job->sink->closing,
+		                     memory_order_relaxed);
+}
+
+uint64_t
+tw_job_queued_ns(const struct tw_job *job)
+{
+	return job->started > job->submitted ?
+		job->started - job->submitted : 0;
+}
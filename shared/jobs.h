@@ -0,0 +1,130 @@
+/*
+ * jobs.h - taiwins worker pool
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_JOBS_H
+#define TW_JOBS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A pool runs jobs on a fixed number of worker threads. Every job belongs to a
+ * sink, the sink is where it is submitted and where its completion comes back.
+ * A sink has an eventfd, the owner adds it to its wl_event_loop or
+ * tw_event_queue and calls tw_job_sink_dispatch when it is readable, then the
+ * done callbacks run on the owner thread, in completion order.
+ *
+ * The done callback runs exactly once for every submitted job, cancelled or
+ * not, the job handle is freed right after it. Submit, cancel and dispatch are
+ * for the owner thread of the sink, run is the only thing on the workers.
+ */
+
+struct tw_job_pool;
+struct tw_job_sink;
+struct tw_job;
+
+/**
+ * @brief the work, runs on a worker thread
+ *
+ * It must not touch anything the owner thread uses without a lock, long work
+ * should check tw_job_cancelled now and then.
+ */
+typedef void (*tw_job_run_t)(struct tw_job *job, void *data);
+
+/**
+ * @brief completion, runs in tw_job_sink_dispatch on the owner thread
+ *
+ * cancelled is true if the job was cancelled, run may or may not have been
+ * called in that case.
+ */
+typedef void (*tw_job_done_t)(void *data, bool cancelled);
+
+/**
+ * @brief start nthreads workers, 0 picks from the number of cpus
+ */
+struct tw_job_pool *
+tw_job_pool_create(unsigned int nthreads);
+
+/**
+ * @brief stop the workers, the jobs still queued are cancelled
+ *
+ * The sinks of the pool have to be destroyed first.
+ */
+void
+tw_job_pool_destroy(struct tw_job_pool *pool);
+
+struct tw_job_sink *
+tw_job_sink_create(struct tw_job_pool *pool);
+
+/**
+ * @brief cancel the jobs of this sink and wait for the running ones
+ *
+ * All the outstanding done callbacks are called, with cancelled set.
+ */
+void
+tw_job_sink_destroy(struct tw_job_sink *sink);
+
+/**
+ * @brief the eventfd to watch for reading
+ */
+int
+tw_job_sink_get_fd(const struct tw_job_sink *sink);
+
+/**
+ * @brief run the done callbacks of the finished jobs
+ *
+ * @return the number of callbacks called
+ */
+int
+tw_job_sink_dispatch(struct tw_job_sink *sink);
+
+struct tw_job *
+tw_job_submit(struct tw_job_sink *sink, tw_job_run_t run, tw_job_done_t done,
+              void *data);
+
+/**
+ * @brief cancel a job whose done callback did not run yet
+ *
+ * A queued job is taken off the queue and never runs, a running job only sees
+ * the flag through tw_job_cancelled. Either way done comes with cancelled set,
+ * on the next dispatch.
+ */
+void
+tw_job_cancel(struct tw_job *job);
+
+bool
+tw_job_cancelled(const struct tw_job *job);
+
+/**
+ * @brief monotonic ns from submission to the start of run
+ */
+uint64_t
+tw_job_queued_ns(const struct tw_job *job);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
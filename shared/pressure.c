@@ -0,0 +1,392 @@
+/*
+ * pressure.c - taiwins memory pressure monitor
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#include "pressure.h"
+
+#define TW_PRESSURE_STALL_MS 150
+#define TW_PRESSURE_WINDOW_MS 2000
+#define TW_PRESSURE_INTERVAL_MS 10000
+
+enum pressure_kernel_source {
+	PRESSURE_NONE,
+	PRESSURE_PSI,
+	PRESSURE_CGROUP_PSI,
+	PRESSURE_CGROUP_EVENTS,
+};
+
+struct tw_pressure {
+	int epoll_fd;
+	int psi_fd;
+	int inotify_fd;
+	int inject_fd;
+	int events_wd, trim_wd;
+	enum pressure_kernel_source source;
+
+	char events_path[PATH_MAX];
+	char trim_name[NAME_MAX + 1];
+	uint64_t events_high, events_max;
+
+	uint32_t min_interval_ms;
+	uint64_t last_trim_ms;
+	bool reported;
+};
+
+static inline uint64_t
+pressure_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000ull + ts.tv_nsec / 1000000;
+}
+
+static bool
+pressure_watch(struct tw_pressure *p, int fd, uint32_t events)
+{
+	struct epoll_event ev = {
+		.events = events,
+		.data.fd = fd,
+	};
+
+	return epoll_ctl(p->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+static int
+pressure_open_psi(struct tw_pressure *p, const char *path, uint32_t stall_ms,
+                  uint32_t window_ms)
+{
+	char trigger[64];
+	int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	int len;
+
+	if (fd < 0)
+		return -1;
+	len = snprintf(trigger, sizeof(trigger), "some %u %u",
+	               stall_ms * 1000, window_ms * 1000);
+	//the trigger is the nul terminated string, not a line
+	if (write(fd, trigger, len + 1) < 0 ||
+	    !pressure_watch(p, fd, EPOLLPRI)) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static bool
+pressure_cgroup_dir(char *dir, size_t len)
+{
+	char line[PATH_MAX];
+	FILE *file = fopen("/proc/self/cgroup", "r");
+	bool found = false;
+
+	if (!file)
+		return false;
+	//only the unified hierarchy, its line is 0::/path
+	while (fgets(line, sizeof(line), file)) {
+		if (strncmp(line, "0::", 3))
+			continue;
+		line[strcspn(line, "\n")] = '\0';
+		found = snprintf(dir, len, "/sys/fs/cgroup%s", line + 3) <
+			(int)len;
+		break;
+	}
+	fclose(file);
+	return found;
+}
+
+static bool
+pressure_read_events(const char *path, uint64_t *high, uint64_t *max)
+{
+	char line[128];
+	unsigned long long value;
+	FILE *file = fopen(path, "r");
+
+	if (!file)
+		return false;
+	while (fgets(line, sizeof(line), file)) {
+		if (sscanf(line, "high %llu", &value) == 1)
+			*high = value;
+		else if (sscanf(line, "max %llu", &value) == 1)
+			*max = value;
+	}
+	fclose(file);
+	return true;
+}
+
+static void
+pressure_open_kernel(struct tw_pressure *p,
+                     const struct tw_pressure_options *opts)
+{
+	//room for the file names
+	char cgroup[PATH_MAX - 32], path[PATH_MAX];
+	bool has_cgroup;
+
+	p->psi_fd = pressure_open_psi(p, opts->psi_path ?
+	                              opts->psi_path :
+	                              "/proc/pressure/memory",
+	                              opts->stall_ms, opts->window_ms);
+	if (p->psi_fd >= 0) {
+		p->source = PRESSURE_PSI;
+		return;
+	}
+	if (opts->cgroup_dir)
+		has_cgroup = snprintf(cgroup, sizeof(cgroup), "%s",
+		                      opts->cgroup_dir) < (int)sizeof(cgroup);
+	else
+		has_cgroup = pressure_cgroup_dir(cgroup, sizeof(cgroup));
+	if (!has_cgroup)
+		return;
+
+	//a delegated cgroup lets us have the trigger there
+	snprintf(path, sizeof(path), "%s/memory.pressure", cgroup);
+	p->psi_fd = pressure_open_psi(p, path, opts->stall_ms,
+	                              opts->window_ms);
+	if (p->psi_fd >= 0) {
+		p->source = PRESSURE_CGROUP_PSI;
+		return;
+	}
+	//the counters change on reclaim at memory.high and at memory.max, the
+	//file gets a modify event then
+	snprintf(p->events_path, sizeof(p->events_path), "%s/memory.events",
+	         cgroup);
+	if (!pressure_read_events(p->events_path, &p->events_high,
+	                          &p->events_max))
+		return;
+	p->events_wd = inotify_add_watch(p->inotify_fd, p->events_path,
+	                                 IN_MODIFY);
+	if (p->events_wd >= 0)
+		p->source = PRESSURE_CGROUP_EVENTS;
+}
+
+static void
+pressure_watch_trim_file(struct tw_pressure *p, const char *trim_path)
+{
+	char path[PATH_MAX];
+	char *slash;
+
+	if (trim_path)
+		snprintf(path, sizeof(path), "%s", trim_path);
+	else
+		tw_pressure_trim_path(path, sizeof(path));
+	if (!(slash = strrchr(path, '/')) || !slash[1])
+		return;
+	snprintf(p->trim_name, sizeof(p->trim_name), "%s", slash + 1);
+	*slash = '\0';
+	//the file does not have to exist, we watch the directory
+	p->trim_wd = inotify_add_watch(p->inotify_fd,
+	                               path[0] ? path : "/",
+	                               IN_CLOSE_WRITE | IN_MOVED_TO);
+}
+
+struct tw_pressure *
+tw_pressure_create(const struct tw_pressure_options *opts)
+{
+	struct tw_pressure_options defaults = {
+		.stall_ms = TW_PRESSURE_STALL_MS,
+		.window_ms = TW_PRESSURE_WINDOW_MS,
+		.min_interval_ms = TW_PRESSURE_INTERVAL_MS,
+	};
+	struct tw_pressure *p = calloc(1, sizeof(*p));
+
+	if (opts) {
+		defaults.psi_path = opts->psi_path;
+		defaults.cgroup_dir = opts->cgroup_dir;
+		defaults.trim_path = opts->trim_path;
+		if (opts->stall_ms && opts->window_ms) {
+			defaults.stall_ms = opts->stall_ms;
+			defaults.window_ms = opts->window_ms;
+		}
+		defaults.min_interval_ms = opts->min_interval_ms;
+	}
+	if (!p)
+		return NULL;
+	p->psi_fd = p->inotify_fd = p->inject_fd = -1;
+	p->events_wd = p->trim_wd = -1;
+	p->min_interval_ms = defaults.min_interval_ms;
+
+	p->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	p->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	p->inject_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (p->epoll_fd < 0 || p->inotify_fd < 0 || p->inject_fd < 0 ||
+	    !pressure_watch(p, p->inotify_fd, EPOLLIN) ||
+	    !pressure_watch(p, p->inject_fd, EPOLLIN)) {
+		tw_pressure_destroy(p);
+		return NULL;
+	}
+	pressure_open_kernel(p, &defaults);
+	pressure_watch_trim_file(p, defaults.trim_path);
+	return p;
+}
+
+void
+tw_pressure_destroy(struct tw_pressure *p)
+{
+	if (p->psi_fd >= 0)
+		close(p->psi_fd);
+	if (p->inotify_fd >= 0)
+		close(p->inotify_fd);
+	if (p->inject_fd >= 0)
+		close(p->inject_fd);
+	if (p->epoll_fd >= 0)
+		close(p->epoll_fd);
+	free(p);
+}
+
+int
+tw_pressure_get_fd(const struct tw_pressure *p)
+{
+	return p->epoll_fd;
+}
+
+const char *
+tw_pressure_source(const struct tw_pressure *p)
+{
+	switch (p->source) {
+	case PRESSURE_PSI:
+		return "psi";
+	case PRESSURE_CGROUP_PSI:
+		return "cgroup-psi";
+	case PRESSURE_CGROUP_EVENTS:
+		return "cgroup-events";
+	default:
+		return "none";
+	}
+}
+
+const char *
+tw_pressure_reason_name(enum tw_pressure_reason reason)
+{
+	switch (reason) {
+	case TW_PRESSURE_PSI:
+		return "psi";
+	case TW_PRESSURE_CGROUP:
+		return "cgroup";
+	case TW_PRESSURE_TRIM_FILE:
+		return "trim file";
+	case TW_PRESSURE_INJECTED:
+		return "injected";
+	default:
+		return "none";
+	}
+}
+
+void
+tw_pressure_inject(struct tw_pressure *p)
+{
+	uint64_t one = 1;
+
+	while (write(p->inject_fd, &one, sizeof(one)) < 0 && errno == EINTR);
+}
+
+static bool
+pressure_events_raised(struct tw_pressure *p)
+{
+	uint64_t high = p->events_high, max = p->events_max;
+	bool raised;
+
+	if (!pressure_read_events(p->events_path, &high, &max))
+		return false;
+	raised = high > p->events_high || max > p->events_max;
+	p->events_high = high;
+	p->events_max = max;
+	return raised;
+}
+
+static enum tw_pressure_reason
+pressure_read_inotify(struct tw_pressure *p)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *event;
+	enum tw_pressure_reason reason = TW_PRESSURE_NONE;
+	ssize_t len;
+
+	while ((len = read(p->inotify_fd, buf, sizeof(buf))) > 0) {
+		for (char *ptr = buf; ptr < buf + len;
+		     ptr += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event *)ptr;
+			if (event->wd == p->trim_wd && event->len &&
+			    !strcmp(event->name, p->trim_name))
+				reason = TW_PRESSURE_TRIM_FILE;
+			else if (event->wd == p->events_wd &&
+			         reason == TW_PRESSURE_NONE &&
+			         pressure_events_raised(p))
+				reason = TW_PRESSURE_CGROUP;
+		}
+	}
+	return reason;
+}
+
+enum tw_pressure_reason
+tw_pressure_dispatch(struct tw_pressure *p)
+{
+	struct epoll_event events[4];
+	enum tw_pressure_reason reason = TW_PRESSURE_NONE, r;
+	uint64_t count, now;
+	int n;
+
+	n = epoll_wait(p->epoll_fd, events, 4, 0);
+	for (int i = 0; i < n; i++) {
+		r = TW_PRESSURE_NONE;
+		if (events[i].data.fd == p->inject_fd) {
+			if (read(p->inject_fd, &count, sizeof(count)) > 0)
+				r = TW_PRESSURE_INJECTED;
+		} else if (events[i].data.fd == p->inotify_fd) {
+			r = pressure_read_inotify(p);
+		} else if (events[i].data.fd == p->psi_fd) {
+			//the trigger is gone with the cgroup, stop watching
+			if (events[i].events & EPOLLERR) {
+				epoll_ctl(p->epoll_fd, EPOLL_CTL_DEL,
+				          p->psi_fd, NULL);
+				close(p->psi_fd);
+				p->psi_fd = -1;
+				p->source = PRESSURE_NONE;
+			} else if (events[i].events & EPOLLPRI) {
+				r = TW_PRESSURE_PSI;
+			}
+		}
+		//the explicit reasons win over the kernel ones
+		if (r > reason)
+			reason = r;
+	}
+
+	now = pressure_now_ms();
+	if ((reason == TW_PRESSURE_PSI || reason == TW_PRESSURE_CGROUP) &&
+	    p->reported && now - p->last_trim_ms < p->min_interval_ms)
+		return TW_PRESSURE_NONE;
+	if (reason != TW_PRESSURE_NONE) {
+		p->reported = true;
+		p->last_trim_ms = now;
+	}
+	return reason;
+}
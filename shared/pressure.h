@@ -0,0 +1,124 @@
+/*
+ * pressure.h - taiwins memory pressure monitor
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_PRESSURE_H
+#define TW_PRESSURE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Tells when to drop the caches. The kernel side is a PSI trigger on
+ * /proc/pressure/memory, or on the memory.pressure of our cgroup when we are
+ * not allowed the system wide one, or at last a watch on the memory.events of
+ * the cgroup, which only fires when we hit memory.high or memory.max.
+ *
+ * Every process watches on its own, they all see the same pressure. To fake
+ * one, write anything to the trim file, every taiwins process trims at once:
+ *
+ *   echo > $XDG_RUNTIME_DIR/taiwins-trim
+ *
+ * All the sources are behind one fd which becomes readable, so it goes into a
+ * wl_event_loop or a tw_event_queue as is.
+ */
+
+enum tw_pressure_reason {
+	TW_PRESSURE_NONE = 0,
+	TW_PRESSURE_PSI,
+	TW_PRESSURE_CGROUP, /**< memory.events high or max went up */
+	TW_PRESSURE_TRIM_FILE,
+	TW_PRESSURE_INJECTED,
+};
+
+struct tw_pressure_options {
+	const char *psi_path; /**< NULL for /proc/pressure/memory */
+	const char *cgroup_dir; /**< NULL to find it in /proc/self/cgroup */
+	const char *trim_path; /**< NULL for tw_pressure_trim_path */
+	uint32_t stall_ms; /**< some stall in the window to trigger */
+	uint32_t window_ms; /**< multiple of 2s for unprivileged trigger */
+	uint32_t min_interval_ms; /**< between two kernel reported trims */
+};
+
+struct tw_pressure;
+
+/**
+ * @brief start watching, opts can be NULL for the defaults
+ *
+ * Only fails without memory, when there is no kernel source the trim file
+ * still works.
+ */
+struct tw_pressure *
+tw_pressure_create(const struct tw_pressure_options *opts);
+
+void
+tw_pressure_destroy(struct tw_pressure *pressure);
+
+int
+tw_pressure_get_fd(const struct tw_pressure *pressure);
+
+/**
+ * @brief what the kernel side ended up being, "psi", "cgroup-psi",
+ * "cgroup-events" or "none"
+ */
+const char *
+tw_pressure_source(const struct tw_pressure *pressure);
+
+/**
+ * @brief call when the fd is readable
+ *
+ * @return why the caller should trim now, TW_PRESSURE_NONE for nothing
+ */
+enum tw_pressure_reason
+tw_pressure_dispatch(struct tw_pressure *pressure);
+
+/**
+ * @brief fake a pressure event for this process, seen on the next dispatch
+ */
+void
+tw_pressure_inject(struct tw_pressure *pressure);
+
+const char *
+tw_pressure_reason_name(enum tw_pressure_reason reason);
+
+static inline void
+tw_pressure_trim_path(char *path, size_t len)
+{
+	const char *env = getenv("TAIWINS_TRIM");
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+
+	if (env)
+		snprintf(path, len, "%s", env);
+	else
+		snprintf(path, len, "%s/taiwins-trim",
+		         runtime ? runtime : "/tmp");
+}
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
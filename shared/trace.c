@@ -0,0 +1,308 @@
+/*
+ * trace.c - taiwins trace event recording
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <linux/limits.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define TW_TRACE_RING_SIZE 8192
+
+struct tw_trace_event {
+	uint64_t ts;
+	const char *cat;
+	const char *name;
+	int64_t value;
+	char phase;
+};
+
+struct tw_trace_ring {
+	struct tw_trace_ring *next;
+	_Atomic uint64_t head;
+	_Atomic bool alive;
+	pid_t tid;
+	char name[32];
+	struct tw_trace_event events[TW_TRACE_RING_SIZE];
+};
+
+static struct {
+	pthread_mutex_t lock;
+	pthread_once_t once;
+	pthread_key_t key;
+	struct tw_trace_ring *rings;
+	uint64_t epoch;
+	int signo;
+	char prog[32];
+} s_trace = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.once = PTHREAD_ONCE_INIT,
+};
+
+static _Thread_local struct tw_trace_ring *t_ring;
+
+static inline uint64_t
+trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void
+trace_thread_exit(void *data)
+{
+	struct tw_trace_ring *ring = data;
+	//keep the events around for the dump, the ring is recycled by the next
+	//new thread.
+	atomic_store_explicit(&ring->alive, false, memory_order_release);
+}
+
+static void
+trace_init_once(void)
+{
+	pthread_key_create(&s_trace.key, trace_thread_exit);
+	s_trace.epoch = trace_now();
+}
+
+static struct tw_trace_ring *
+trace_get_ring(void)
+{
+	struct tw_trace_ring *ring;
+
+	if (t_ring)
+		return t_ring;
+	pthread_once(&s_trace.once, trace_init_once);
+
+	pthread_mutex_lock(&s_trace.lock);
+	for (ring = s_trace.rings; ring; ring = ring->next)
+		if (!atomic_load_explicit(&ring->alive, memory_order_acquire))
+			break;
+	if (!ring) {
+		ring = calloc(1, sizeof(*ring));
+		if (!ring) {
+			pthread_mutex_unlock(&s_trace.lock);
+			return NULL;
+		}
+		ring->next = s_trace.rings;
+		s_trace.rings = ring;
+	}
+	//a recycled ring loses the history of the dead thread.
+	atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+	atomic_store_explicit(&ring->alive, true, memory_order_relaxed);
+	ring->tid = syscall(SYS_gettid);
+	snprintf(ring->name, sizeof(ring->name), "thread-%d", ring->tid);
+	pthread_mutex_unlock(&s_trace.lock);
+
+	pthread_setspecific(s_trace.key, ring);
+	t_ring = ring;
+	return ring;
+}
+
+void
+tw_trace_record(char phase, const char *cat, const char *name, int64_t value)
+{
+	struct tw_trace_ring *ring = trace_get_ring();
+	struct tw_trace_event *ev;
+	uint64_t head;
+
+	if (!ring)
+		return;
+	head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	ev = &ring->events[head % TW_TRACE_RING_SIZE];
+	ev->ts = trace_now();
+	ev->cat = cat;
+	ev->name = name;
+	ev->value = value;
+	ev->phase = phase;
+	atomic_store_explicit(&ring->head, head+1, memory_order_release);
+}
+
+void
+tw_trace_thread_name(const char *name)
+{
+	struct tw_trace_ring *ring = trace_get_ring();
+
+	if (!ring)
+		return;
+	pthread_mutex_lock(&s_trace.lock);
+	snprintf(ring->name, sizeof(ring->name), "%s", name);
+	pthread_mutex_unlock(&s_trace.lock);
+}
+
+static void
+trace_write_string(FILE *file, const char *str)
+{
+	fputc('"', file);
+	for (; str && *str; str++) {
+		if (*str == '"' || *str == '\\')
+			fputc('\\', file);
+		if ((unsigned char)*str >= 0x20)
+			fputc(*str, file);
+	}
+	fputc('"', file);
+}
+
+static void
+trace_write_ring(FILE *file, const struct tw_trace_ring *ring,
+                 struct tw_trace_event *copy, bool *first)
+{
+	uint64_t base, start, end, valid;
+	pid_t pid = getpid();
+
+	end = atomic_load_explicit(&ring->head, memory_order_acquire);
+	base = end > TW_TRACE_RING_SIZE ? end - TW_TRACE_RING_SIZE : 0;
+	for (uint64_t i = base; i < end; i++)
+		copy[i - base] = ring->events[i % TW_TRACE_RING_SIZE];
+	//the writer may have lapped us during the copy, the slots it touched
+	//(including the one it may be writing now) are garbage.
+	valid = atomic_load_explicit(&ring->head, memory_order_acquire);
+	start = base;
+	if (valid >= TW_TRACE_RING_SIZE && valid - TW_TRACE_RING_SIZE + 1 > start)
+		start = valid - TW_TRACE_RING_SIZE + 1;
+
+	fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\","
+	        "\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+	        *first ? "" : ",", pid, ring->tid);
+	trace_write_string(file, ring->name);
+	fputs("}}", file);
+	*first = false;
+
+	for (uint64_t i = start; i < end; i++) {
+		const struct tw_trace_event *ev = &copy[i - base];
+		uint64_t ts = ev->ts - s_trace.epoch;
+
+		fputs(",\n{\"name\":", file);
+		trace_write_string(file, ev->name);
+		fputs(",\"cat\":", file);
+		trace_write_string(file, ev->cat);
+		fprintf(file, ",\"ph\":\"%c\",\"ts\":%llu.%03llu,"
+		        "\"pid\":%d,\"tid\":%d", ev->phase,
+		        (unsigned long long)(ts / 1000),
+		        (unsigned long long)(ts % 1000), pid, ring->tid);
+		if (ev->phase == TW_TRACE_PH_INSTANT)
+			fputs(",\"s\":\"t\"", file);
+		else if (ev->phase == TW_TRACE_PH_COUNTER)
+			fprintf(file, ",\"args\":{\"value\":%lld}",
+			        (long long)ev->value);
+		fputc('}', file);
+	}
+}
+
+bool
+tw_trace_dump(const char *path)
+{
+	FILE *file;
+	int fd;
+	struct tw_trace_event *copy;
+	bool first = true;
+	bool ok;
+
+	pthread_once(&s_trace.once, trace_init_once);
+	copy = malloc(sizeof(struct tw_trace_event) * TW_TRACE_RING_SIZE);
+	if (!copy)
+		return false;
+	//never follow or reuse a file someone else put there
+	fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+	          0600);
+	file = fd >= 0 ? fdopen(fd, "w") : NULL;
+	if (!file) {
+		if (fd >= 0)
+			close(fd);
+		free(copy);
+		return false;
+	}
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+	pthread_mutex_lock(&s_trace.lock);
+	for (struct tw_trace_ring *ring = s_trace.rings; ring;
+	     ring = ring->next)
+		trace_write_ring(file, ring, copy, &first);
+	pthread_mutex_unlock(&s_trace.lock);
+	fputs("\n]}\n", file);
+
+	ok = !ferror(file);
+	ok = (fclose(file) == 0) && ok;
+	free(copy);
+	return ok;
+}
+
+bool
+tw_trace_dump_path(char *path, size_t len, const char *prog)
+{
+	static atomic_uint dumps;
+	const char *dir = getenv("XDG_RUNTIME_DIR");
+	int n;
+
+	if (!dir || !*dir)
+		return false;
+	n = snprintf(path, len, "%s/%s-trace-%d-%u.json", dir, prog, getpid(),
+	             atomic_fetch_add(&dumps, 1));
+	return n > 0 && (size_t)n < len;
+}
+
+static void *
+trace_signal_thread(void *arg)
+{
+	sigset_t set;
+	int sig;
+	char path[PATH_MAX];
+
+	sigemptyset(&set);
+	sigaddset(&set, s_trace.signo);
+	tw_trace_thread_name("trace");
+	while (sigwait(&set, &sig) == 0) {
+		if (!tw_trace_dump_path(path, sizeof(path), s_trace.prog)) {
+			fprintf(stderr, "no XDG_RUNTIME_DIR to dump trace\n");
+			continue;
+		}
+		if (tw_trace_dump(path))
+			fprintf(stderr, "trace dumped to %s\n", path);
+	}
+	return NULL;
+}
+
+bool
+tw_trace_dump_on_signal(int signo, const char *prog)
+{
+	sigset_t set;
+	pthread_t thread;
+
+	s_trace.signo = signo;
+	snprintf(s_trace.prog, sizeof(s_trace.prog), "%s", prog);
+	sigemptyset(&set);
+	sigaddset(&set, signo);
+	if (pthread_sigmask(SIG_BLOCK, &set, NULL))
+		return false;
+	if (pthread_create(&thread, NULL, trace_signal_thread, NULL))
+		return false;
+	pthread_detach(thread);
+	return true;
+}
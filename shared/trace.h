@@ -0,0 +1,138 @@
+/*
+ * trace.h - taiwins trace event recording
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_TRACE_H
+#define TW_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Every thread records into its own ring of fixed size events, when the ring
+ * is full the oldest events are overwritten, so a dump always has the most
+ * recent history. Recording is a clock read and a few stores, no locks.
+ *
+ * Category and name are stored as pointers and only read at dump time, they
+ * have to be string literals (or otherwise live forever).
+ *
+ * The dump is the Chrome trace event format, it opens in chrome://tracing or
+ * ui.perfetto.dev.
+ *
+ * Configure with -DTAIWINS_TRACE=OFF and all the macros compile to nothing.
+ */
+
+enum tw_trace_phase {
+	TW_TRACE_PH_BEGIN = 'B',
+	TW_TRACE_PH_END = 'E',
+	TW_TRACE_PH_INSTANT = 'i',
+	TW_TRACE_PH_COUNTER = 'C',
+};
+
+void
+tw_trace_record(char phase, const char *cat, const char *name, int64_t value);
+
+/**
+ * @brief name the calling thread in the dump
+ */
+void
+tw_trace_thread_name(const char *name);
+
+/**
+ * @brief write all the thread rings to path as chrome trace json
+ *
+ * It is safe to call while other threads keep recording, events overwritten
+ * during the dump are left out. The file is created 0600 and the dump fails if
+ * path already exists or is a symlink.
+ */
+bool
+tw_trace_dump(const char *path);
+
+/**
+ * @brief $XDG_RUNTIME_DIR/<prog>-trace-<pid>-<n>.json, n counts the dumps
+ *
+ * @return false if XDG_RUNTIME_DIR is not set or the path does not fit
+ */
+bool
+tw_trace_dump_path(char *path, size_t len, const char *prog);
+
+/**
+ * @brief dump to tw_trace_dump_path every time signo arrives
+ *
+ * For the clients which has no event loop for signals. It has to be called
+ * before creating other threads since it blocks signo for the process.
+ */
+bool
+tw_trace_dump_on_signal(int signo, const char *prog);
+
+struct tw_trace_scope {
+	const char *cat;
+	const char *name;
+};
+
+static inline void
+tw_trace_scope_end(struct tw_trace_scope *scope)
+{
+	tw_trace_record(TW_TRACE_PH_END, scope->cat, scope->name, 0);
+}
+
+#ifdef TW_TRACE
+
+#define TW_TRACE_BEGIN(cat, name) \
+	tw_trace_record(TW_TRACE_PH_BEGIN, cat, name, 0)
+#define TW_TRACE_END(cat, name) \
+	tw_trace_record(TW_TRACE_PH_END, cat, name, 0)
+#define TW_TRACE_INSTANT(cat, name) \
+	tw_trace_record(TW_TRACE_PH_INSTANT, cat, name, 0)
+#define TW_TRACE_COUNTER(cat, name, value) \
+	tw_trace_record(TW_TRACE_PH_COUNTER, cat, name, (int64_t)(value))
+
+#define _TW_TRACE_CAT(a, b) a##b
+#define _TW_TRACE_VAR(line) _TW_TRACE_CAT(_tw_trace_scope_, line)
+
+/**
+ * @brief span from here to the end of the enclosing block
+ */
+#define TW_TRACE_SCOPE(cat, name)	  \
+	struct tw_trace_scope _TW_TRACE_VAR(__LINE__) \
+	__attribute__((cleanup(tw_trace_scope_end))) = \
+		(TW_TRACE_BEGIN(cat, name), \
+		 (struct tw_trace_scope){cat, name})
+
+#else
+
+#define TW_TRACE_BEGIN(cat, name) ((void)0)
+#define TW_TRACE_END(cat, name) ((void)0)
+#define TW_TRACE_INSTANT(cat, name) ((void)0)
+#define TW_TRACE_COUNTER(cat, name, value) ((void)0)
+#define TW_TRACE_SCOPE(cat, name) do {} while (0)
+
+#endif /* TW_TRACE */
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -65,15 +65,6 @@ struct tw_decision_key {
 	int  scale;
 } __attribute__ ((aligned (DECISION_STRIDE)));
 
-/*****************************************************************/
-/*                            shell                              */
-/*****************************************************************/
-
-struct tw_window_brief {
-	float x,y,w,h;
-	char name[32];
-};
-
 /*****************************************************************/
 /*                           config                              */
 /*****************************************************************/
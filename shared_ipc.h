@@ -0,0 +1,215 @@
+/*
+ * shared_ipc.h - taiwins binary ipc protocol
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_SHARED_IPC_H
+#define TW_SHARED_IPC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/un.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The ipc is a stream of messages over a unix socket, every message is a
+ * tw_ipc_header followed by `size` bytes of payload, all in host byte order
+ * since it never leaves the machine.
+ *
+ * A request gets exactly one reply, in the order of the requests. The reply
+ * type is the request type with TW_IPC_REPLY set, or TW_IPC_ERROR. List
+ * replies are packed arrays of the fixed size records below, so the number of
+ * records is size / sizeof(record).
+ *
+ * After TW_IPC_SUBSCRIBE, events may come between replies. Every subscriber
+ * has a bounded buffer in the compositor, if the client does not read fast
+ * enough, events are dropped and the next delivered event reports how many
+ * were lost.
+ */
+
+#define TW_IPC_MAGIC 0x50495754 /* "TWIP" */
+#define TW_IPC_VERSION 1
+#define TW_IPC_MAX_REQUEST 256
+#define TW_IPC_REPLY 0x8000
+#define TW_IPC_EVENT 0x4000
+
+struct tw_ipc_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t type;
+	uint32_t size;
+};
+
+enum tw_ipc_msg_type {
+	/* requests */
+	TW_IPC_LIST_VIEWS = 1,
+	TW_IPC_LIST_WORKSPACES = 2,
+	TW_IPC_LIST_OUTPUTS = 3,
+	TW_IPC_GET_FOCUS = 4, /**< reply has zero or one tw_ipc_view */
+	TW_IPC_LAYOUT_COMMAND = 5, /**< tw_ipc_layout_command */
+	TW_IPC_SUBSCRIBE = 6, /**< uint32_t mask of events */
+	TW_IPC_LIST_CLIENTS = 7, /**< resource usage of wayland clients */
+	TW_IPC_LIST_MEMORY = 8, /**< compositor memory per subsystem */
+
+	TW_IPC_ERROR = 0x7fff, /**< tw_ipc_error */
+
+	/* events, all of them carry a tw_ipc_event */
+	TW_IPC_EVENT_FOCUS = TW_IPC_EVENT | 1,
+	TW_IPC_EVENT_WORKSPACE = TW_IPC_EVENT | 2,
+	TW_IPC_EVENT_VIEW_CREATED = TW_IPC_EVENT | 3,
+	TW_IPC_EVENT_VIEW_DESTROYED = TW_IPC_EVENT | 4,
+};
+
+static inline uint32_t
+tw_ipc_event_mask(uint16_t type)
+{
+	return 1u << (type & 0xff);
+}
+
+#define TW_IPC_EVENT_ALL (tw_ipc_event_mask(TW_IPC_EVENT_FOCUS) |	\
+                          tw_ipc_event_mask(TW_IPC_EVENT_WORKSPACE) |	\
+                          tw_ipc_event_mask(TW_IPC_EVENT_VIEW_CREATED) | \
+                          tw_ipc_event_mask(TW_IPC_EVENT_VIEW_DESTROYED))
+
+enum tw_ipc_error_code {
+	TW_IPC_ERR_INVALID = 1,
+	TW_IPC_ERR_NO_VIEW = 2,
+	TW_IPC_ERR_FAILED = 3,
+};
+
+struct tw_ipc_error {
+	int32_t code;
+};
+
+enum tw_ipc_view_flag {
+	TW_IPC_VIEW_FOCUSED = 1 << 0,
+	TW_IPC_VIEW_FLOATING = 1 << 1,
+	TW_IPC_VIEW_VISIBLE = 1 << 2,
+};
+
+struct tw_ipc_view {
+	uint32_t id;
+	int32_t workspace;
+	int32_t x, y;
+	int32_t width, height;
+	uint32_t flags;
+	char app_id[32];
+	char title[64];
+};
+
+enum tw_ipc_workspace_flag {
+	TW_IPC_WORKSPACE_ACTIVE = 1 << 0,
+};
+
+struct tw_ipc_workspace {
+	uint32_t index;
+	uint32_t nviews;
+	uint32_t flags;
+	char layout[16];
+};
+
+struct tw_ipc_output {
+	uint32_t id;
+	int32_t x, y;
+	int32_t width, height;
+	int32_t scale;
+	char name[32];
+};
+
+struct tw_ipc_client_stats {
+	uint64_t shm_bytes;
+	uint64_t commits;
+	uint64_t damage_per_sec; /**< damaged pixels */
+	int32_t pid;
+	uint32_t surfaces;
+	uint32_t views;
+	uint32_t commits_per_sec;
+	uint32_t configure_rtt_us; /**< configure to next commit, averaged */
+	uint32_t configure_rtt_max_us;
+};
+
+struct tw_ipc_mem_stats {
+	int64_t live_bytes;
+	int64_t live_allocs;
+	int64_t peak_bytes;
+	uint64_t total_allocs;
+	char tag[16];
+};
+
+enum tw_ipc_layout_op {
+	TW_IPC_LAYOUT_SWITCH_WORKSPACE = 1, /**< arg is the workspace */
+	/** arg: 0 floating, 1 tiling, 2 master, 3 grid, 4 monocle */
+	TW_IPC_LAYOUT_SET_WORKSPACE_LAYOUT,
+	TW_IPC_LAYOUT_FOCUS,
+	TW_IPC_LAYOUT_TOGGLE_FLOATING,
+	TW_IPC_LAYOUT_TOGGLE_SPLIT,
+	TW_IPC_LAYOUT_VSPLIT,
+	TW_IPC_LAYOUT_HSPLIT,
+	TW_IPC_LAYOUT_MERGE,
+};
+
+struct tw_ipc_layout_command {
+	uint32_t op;
+	uint32_t view; /**< 0 means the focused view */
+	int32_t arg;
+};
+
+struct tw_ipc_event {
+	uint32_t seq; /**< per subscriber sequence */
+	uint32_t lost; /**< events dropped before this one */
+	uint32_t view; /**< 0 if not a desktop view */
+	int32_t workspace;
+	int32_t from; /**< previous workspace on workspace switch */
+};
+
+/**
+ * @brief where the ipc socket is
+ *
+ * compositor exports TAIWINS_IPC to its children, otherwise it is taiwins-ipc
+ * on the runtime dir.
+ *
+ * @return false if neither is set, the socket is never in /tmp
+ */
+static inline bool
+tw_ipc_socket_path(char path[sizeof(((struct sockaddr_un *)0)->sun_path)])
+{
+	const size_t len = sizeof(((struct sockaddr_un *)0)->sun_path);
+	const char *env = getenv("TAIWINS_IPC");
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+	int n;
+
+	if (env && *env)
+		n = snprintf(path, len, "%s", env);
+	else if (runtime && *runtime)
+		n = snprintf(path, len, "%s/taiwins-ipc", runtime);
+	else
+		return false;
+	return n > 0 && (size_t)n < len;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,132 @@
+/*
+ * shared_stats.h - taiwins compositor statistics page
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_SHARED_STATS_H
+#define TW_SHARED_STATS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The compositor publishes its numbers once per second into a file on the
+ * runtime dir, readers map it read-only. The page is a seqlock, the writer
+ * makes seq odd while updating, readers copy the page and retry if seq moved
+ * or was odd.
+ */
+
+#define TW_STATS_MAGIC 0x54535754 /* "TWST" */
+#define TW_STATS_VERSION 1
+#define TW_STATS_MAX_PROCS 4
+
+struct tw_stats_proc {
+	int32_t pid;
+	uint32_t cpu_permille; /**< of one cpu, over the last second */
+	uint64_t rss_kb;
+	char name[16];
+};
+
+struct tw_stats_page {
+	uint32_t magic;
+	uint32_t version;
+	_Atomic uint32_t seq;
+	uint32_t nprocs;
+	uint64_t updated_ms; /**< CLOCK_MONOTONIC */
+
+	//over the last second, from every output
+	uint32_t frames;
+	uint32_t dropped_frames; /**< repaint took longer than a refresh */
+	uint32_t frame_time_us; /**< average repaint time */
+	uint32_t frame_time_max_us;
+	uint64_t dropped_total;
+
+	struct tw_stats_proc procs[TW_STATS_MAX_PROCS]; /**< compositor first */
+};
+
+/**
+ * @brief TAIWINS_STATS, or taiwins-stats on the runtime dir
+ *
+ * @return false if neither is set, the page is never shared from /tmp
+ */
+static inline bool
+tw_stats_page_path(char *path, size_t len)
+{
+	const char *env = getenv("TAIWINS_STATS");
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+	int n;
+
+	if (env && *env)
+		n = snprintf(path, len, "%s", env);
+	else if (runtime && *runtime)
+		n = snprintf(path, len, "%s/taiwins-stats", runtime);
+	else
+		return false;
+	return n > 0 && (size_t)n < len;
+}
+
+static inline void
+tw_stats_page_write_begin(struct tw_stats_page *page)
+{
+	atomic_fetch_add_explicit(&page->seq, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+static inline void
+tw_stats_page_write_end(struct tw_stats_page *page)
+{
+	atomic_fetch_add_explicit(&page->seq, 1, memory_order_release);
+}
+
+/**
+ * @brief take a consistent copy of the page, false if the writer kept us out
+ * or the page is not what we know
+ */
+static inline bool
+tw_stats_page_read(const struct tw_stats_page *page, struct tw_stats_page *out)
+{
+	uint32_t seq0, seq1;
+
+	for (int i = 0; i < 16; i++) {
+		seq0 = atomic_load_explicit(&page->seq, memory_order_acquire);
+		if (seq0 & 1)
+			continue;
+		memcpy((void *)out, (const void *)page, sizeof(*out));
+		atomic_thread_fence(memory_order_acquire);
+		seq1 = atomic_load_explicit(&page->seq, memory_order_relaxed);
+		if (seq0 == seq1)
+			return out->magic == TW_STATS_MAGIC &&
+				out->version == TW_STATS_VERSION;
+	}
+	return false;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EOF */
@@ -0,0 +1,217 @@
+/*
+ * shared_switcher.h - taiwins task switcher table
+ *
+ * Copyright (c) 2019 Xichen Zhou
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TW_SHARED_SWITCHER_H
+#define TW_SHARED_SWITCHER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The windows the task switcher cycles through, in a file on the runtime dir
+ * the shell maps read-only. A window keeps its slot from its creation to its
+ * destruction, the compositor rewrites a slot only when the title or the
+ * geometry changed. The order of the current workspace is written on every
+ * switch, then the shell gets TAIWINS_SHELL_MSG_TYPE_TASK_SWITCHING with the
+ * slot of the window switched to, a single uint32_t, UINT32_MAX if it has
+ * none.
+ *
+ * Same seqlock as the stats page, seq is odd while the compositor writes.
+ */
+
+#define TW_SWITCHER_MAGIC 0x57535754 /* "TWSW" */
+#define TW_SWITCHER_VERSION 1
+#define TW_SWITCHER_MAX_VIEWS 256
+
+struct tw_window_brief {
+	float x,y,w,h;
+	char name[32];
+};
+
+struct tw_switcher_slot {
+	uint32_t id; /**< of the window, never reused, 0 for a free slot */
+	struct tw_window_brief brief;
+};
+
+struct tw_switcher_page {
+	uint32_t magic;
+	uint32_t version;
+	_Atomic uint32_t seq;
+	uint32_t nslots; /**< the ones after are all free */
+	uint32_t norder;
+	uint16_t order[TW_SWITCHER_MAX_VIEWS]; /**< slots, most recent first */
+	struct tw_switcher_slot slots[TW_SWITCHER_MAX_VIEWS];
+};
+
+/**
+ * @brief TAIWINS_SWITCHER, or taiwins-switcher on the runtime dir
+ *
+ * @return false if neither is set, the table is never shared from /tmp
+ */
+static inline bool
+tw_switcher_page_path(char *path, size_t len)
+{
+	const char *env = getenv("TAIWINS_SWITCHER");
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+	int n;
+
+	if (env && *env)
+		n = snprintf(path, len, "%s", env);
+	else if (runtime && *runtime)
+		n = snprintf(path, len, "%s/taiwins-switcher", runtime);
+	else
+		return false;
+	return n > 0 && (size_t)n < len;
+}
+
+static inline void
+tw_switcher_page_write_begin(struct tw_switcher_page *page)
+{
+	atomic_fetch_add_explicit(&page->seq, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+static inline void
+tw_switcher_page_write_end(struct tw_switcher_page *page)
+{
+	atomic_fetch_add_explicit(&page->seq, 1, memory_order_release);
+}
+
+/**
+ * @brief take a consistent copy of the page, false if the writer kept us out
+ * or the page is not what we know
+ */
+static inline bool
+tw_switcher_page_read(const struct tw_switcher_page *page,
+                      struct tw_switcher_page *out)
+{
+	uint32_t seq0, seq1;
+
+	for (int i = 0; i < 16; i++) {
+		seq0 = atomic_load_explicit(&page->seq, memory_order_acquire);
+		if (seq0 & 1)
+			continue;
+		memcpy((void *)out, (const void *)page, sizeof(*out));
+		atomic_thread_fence(memory_order_acquire);
+		seq1 = atomic_load_explicit(&page->seq, memory_order_relaxed);
+		if (seq0 == seq1)
+			return out->magic == TW_SWITCHER_MAGIC &&
+				out->version == TW_SWITCHER_VERSION &&
+				out->nslots <= TW_SWITCHER_MAX_VIEWS &&
+				out->norder <= TW_SWITCHER_MAX_VIEWS;
+	}
+	return false;
+}
+
+/*
+ * The thumbnails of the windows, in an other file of the runtime dir, next to
+ * the table. The file has a fixed size, the header first, then a cell of
+ * pixels for each thumbnail, one under the other, so the pixels are a single
+ * TW_THUMB_WIDTH wide image in premultiplied ARGB8888 the shell can draw
+ * directly. A thumbnail is at the top left of its cell, at the size in the
+ * cell header, and belongs to the window of the switcher slot with the same
+ * id. The cells are taken back from the windows not shown for the longest
+ * time.
+ *
+ * The compositor makes seq odd while it writes a cell, header and pixels.
+ */
+
+#define TW_THUMBS_MAGIC 0x48545754 /* "TWTH" */
+#define TW_THUMBS_VERSION 1
+#define TW_THUMB_WIDTH 256
+#define TW_THUMB_HEIGHT 160
+#define TW_THUMB_STRIDE (TW_THUMB_WIDTH * 4)
+#define TW_THUMB_CELLS 48
+#define TW_THUMBS_PIXELS 4096 /**< where the pixels start in the file */
+#define TW_THUMBS_SIZE (TW_THUMBS_PIXELS + \
+                        TW_THUMB_CELLS * TW_THUMB_HEIGHT * TW_THUMB_STRIDE)
+
+struct tw_thumb_cell {
+	uint32_t id; /**< of the window, 0 for a free cell */
+	uint32_t serial; /**< changes with the pixels */
+	uint16_t width, height;
+};
+
+struct tw_thumbs_page {
+	uint32_t magic;
+	uint32_t version;
+	_Atomic uint32_t seq;
+	uint32_t ncells;
+	struct tw_thumb_cell cells[TW_THUMB_CELLS];
+};
+
+_Static_assert(sizeof(struct tw_thumbs_page) <= TW_THUMBS_PIXELS,
+               "thumbnail cells overlap the pixels");
+
+/**
+ * @brief TAIWINS_THUMBS, or taiwins-thumbs on the runtime dir
+ *
+ * @return false if neither is set, like tw_switcher_page_path
+ */
+static inline bool
+tw_thumbs_page_path(char *path, size_t len)
+{
+	const char *env = getenv("TAIWINS_THUMBS");
+	const char *runtime = getenv("XDG_RUNTIME_DIR");
+	int n;
+
+	if (env && *env)
+		n = snprintf(path, len, "%s", env);
+	else if (runtime && *runtime)
+		n = snprintf(path, len, "%s/taiwins-thumbs", runtime);
+	else
+		return false;
+	return n > 0 && (size_t)n < len;
+}
+
+static inline void
+tw_thumbs_page_write_begin(struct tw_thumbs_page *page)
+{
+	atomic_fetch_add_explicit(&page->seq, 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+}
+
+static inline void
+tw_thumbs_page_write_end(struct tw_thumbs_page *page)
+{
+	atomic_fetch_add_explicit(&page->seq, 1, memory_order_release);
+}
+
+static inline uint32_t *
+tw_thumbs_cell_pixels(void *page, unsigned cell)
+{
+	return (uint32_t *)((char *)page + TW_THUMBS_PIXELS +
+	                    (size_t)cell * TW_THUMB_HEIGHT * TW_THUMB_STRIDE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EOF */
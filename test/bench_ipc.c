@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <shared_ipc.h>
+
+/* ipc throughput benchmark, first measures the round trip of one request at a
+ * time, then pipelines `depth` requests to see how many the compositor can
+ * answer per second.
+ *
+ *   bench_ipc [requests] [depth]
+ */
+
+static double
+now_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool
+read_full(int fd, void *buf, size_t size)
+{
+	char *p = buf;
+	while (size) {
+		ssize_t n = read(fd, p, size);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static void
+send_requests(int fd, uint16_t type, int n)
+{
+	struct tw_ipc_header headers[64];
+	for (int i = 0; i < n; i++)
+		headers[i] = (struct tw_ipc_header){
+			TW_IPC_MAGIC, TW_IPC_VERSION, type, 0,
+		};
+	if (write(fd, headers, n * sizeof(headers[0])) !=
+	    (ssize_t)(n * sizeof(headers[0]))) {
+		perror("write");
+		exit(1);
+	}
+}
+
+static size_t
+read_reply(int fd)
+{
+	static char payload[1 << 16];
+	struct tw_ipc_header header;
+
+	if (!read_full(fd, &header, sizeof(header)) ||
+	    header.size > sizeof(payload) ||
+	    !read_full(fd, payload, header.size)) {
+		fprintf(stderr, "compositor hung up\n");
+		exit(1);
+	}
+	return sizeof(header) + header.size;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int requests = argc > 1 ? atoi(argv[1]) : 100000;
+	int depth = argc > 2 ? atoi(argv[2]) : 32;
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	double start, lat_min = 1e9, lat_max = 0, lat_sum = 0;
+	size_t bytes = 0;
+	int sent = 0;
+
+	if (depth < 1 || depth > 64)
+		depth = 32;
+	if (!tw_ipc_socket_path(addr.sun_path)) {
+		fprintf(stderr, "neither TAIWINS_IPC nor XDG_RUNTIME_DIR set\n");
+		return 1;
+	}
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		fprintf(stderr, "cannot connect to %s\n", addr.sun_path);
+		return 1;
+	}
+
+	//round trip
+	for (int i = 0; i < 1000; i++) {
+		start = now_us();
+		send_requests(fd, TW_IPC_GET_FOCUS, 1);
+		read_reply(fd);
+		double lat = now_us() - start;
+		lat_sum += lat;
+		lat_min = lat < lat_min ? lat : lat_min;
+		lat_max = lat > lat_max ? lat : lat_max;
+	}
+	printf("round trip: avg %.2fus, min %.2fus, max %.2fus\n",
+	       lat_sum / 1000, lat_min, lat_max);
+
+	//pipelined
+	start = now_us();
+	while (sent < requests) {
+		int n = requests - sent < depth ? requests - sent : depth;
+		send_requests(fd, TW_IPC_LIST_VIEWS, n);
+		for (int i = 0; i < n; i++)
+			bytes += read_reply(fd);
+		sent += n;
+	}
+	double elapsed = now_us() - start;
+	printf("%d list_views at depth %d: %.0f req/s, %.2f MB/s\n",
+	       requests, depth, requests / (elapsed / 1e6),
+	       bytes / elapsed);
+
+	close(fd);
+	return 0;
+}
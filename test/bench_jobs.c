@@ -0,0 +1,123 @@
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <jobs.h>
+
+/* job pool latency benchmark. One job at a time measures the round trip from
+ * submit to the done callback through the eventfd, then `depth` jobs at a time
+ * shows the throughput and the queueing delay with the workers busy.
+ *
+ *   bench_jobs [jobs] [depth] [threads]
+ */
+
+struct sample {
+	uint64_t submitted;
+	uint64_t queued;
+	uint64_t finished;
+	struct tw_job *job;
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void
+job_run(struct tw_job *job, void *data)
+{
+	struct sample *s = data;
+	s->queued = tw_job_queued_ns(job);
+}
+
+static void
+job_done(void *data, bool cancelled)
+{
+	struct sample *s = data;
+	(void)cancelled;
+	s->finished = now_ns();
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+	uint64_t l = *(const uint64_t *)a, r = *(const uint64_t *)b;
+	return (l > r) - (l < r);
+}
+
+static void
+report(const char *what, uint64_t *v, int n)
+{
+	qsort(v, n, sizeof(*v), cmp_u64);
+	printf("%-22s p50 %6.1fus  p99 %6.1fus  max %7.1fus\n", what,
+	       v[n / 2] / 1e3, v[n * 99 / 100] / 1e3, v[n - 1] / 1e3);
+}
+
+static void
+run(struct tw_job_sink *sink, struct sample *samples, int n, int depth)
+{
+	struct pollfd pfd = {
+		.fd = tw_job_sink_get_fd(sink),
+		.events = POLLIN,
+	};
+	int submitted = 0, finished = 0;
+
+	while (finished < n) {
+		while (submitted < n && submitted - finished < depth) {
+			struct sample *s = &samples[submitted++];
+			s->submitted = now_ns();
+			s->job = tw_job_submit(sink, job_run, job_done, s);
+		}
+		if (poll(&pfd, 1, 1000) <= 0) {
+			fprintf(stderr, "no completion in 1s\n");
+			exit(1);
+		}
+		finished += tw_job_sink_dispatch(sink);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int n = argc > 1 ? atoi(argv[1]) : 100000;
+	int depth = argc > 2 ? atoi(argv[2]) : 64;
+	int threads = argc > 3 ? atoi(argv[3]) : 0;
+	struct tw_job_pool *pool = tw_job_pool_create(threads);
+	struct tw_job_sink *sink = pool ? tw_job_sink_create(pool) : NULL;
+	struct sample *samples = calloc(n, sizeof(*samples));
+	uint64_t *queued = calloc(n, sizeof(*queued));
+	uint64_t *total = calloc(n, sizeof(*total));
+	uint64_t start;
+
+	if (!sink || !samples || !queued || !total || n < 1 || depth < 1) {
+		fprintf(stderr, "usage: bench_jobs [jobs] [depth] [threads]\n");
+		return 1;
+	}
+
+	for (int pass = 0; pass < 2; pass++) {
+		int d = pass ? depth : 1;
+
+		start = now_ns();
+		run(sink, samples, n, d);
+		printf("depth %d: %d jobs in %.1fms, %.0f jobs/s\n", d, n,
+		       (now_ns() - start) / 1e6,
+		       n / ((now_ns() - start) / 1e9));
+		for (int i = 0; i < n; i++) {
+			queued[i] = samples[i].queued;
+			total[i] = samples[i].finished - samples[i].submitted;
+		}
+		report("  submit to run", queued, n);
+		report("  submit to done", total, n);
+	}
+
+	tw_job_sink_destroy(sink);
+	tw_job_pool_destroy(pool);
+	free(samples);
+	free(queued);
+	free(total);
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <libweston/libweston.h>
+#include "desktop/layout.h"
+
+/* tiling engine benchmark. Fake views on a fake output go through the layout
+ * commands like workspace.c sends them, the operations are computed but not
+ * applied, so this is only the cost of the engine.
+ *
+ *   bench_layout [views] [output resizes]
+ */
+
+struct engine {
+	const char *name;
+	enum tw_layout_type type;
+};
+
+static const struct engine engines[] = {
+	{"tiling", LAYOUT_TILING},
+	{"master", LAYOUT_MASTER},
+	{"grid", LAYOUT_GRID},
+	{"monocle", LAYOUT_MONOCLE},
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void
+run(const struct engine *engine, int n, int resizes)
+{
+	struct weston_output output = { .id = 0, .width = 3840, .height = 2160 };
+	struct tw_output tw_output = {
+		.output = &output,
+		.desktop_area = {0, 0, 3840, 2160},
+		//the tree refuses views narrower than the gaps
+		.inner_gap = 0,
+		.outer_gap = 0,
+	};
+	struct weston_layer layer, floating_layer;
+	struct layout floating, tiling;
+	struct weston_view *views = calloc(n, sizeof(struct weston_view));
+	struct layout_op *ops = calloc(n + 2, sizeof(struct layout_op));
+	struct layout_op arg = { .o = &output };
+	uint64_t start, add_ns, resize_ns, del_ns;
+
+	weston_layer_init(&layer, NULL);
+	weston_layer_init(&floating_layer, NULL);
+	floating_layout_init(&floating, &floating_layer);
+	tiling_layout_init(&tiling, &layer, &floating);
+	layout_add_output(&tiling, &tw_output);
+	layout_set_engine(&tiling, engine->type);
+
+	start = now_ns();
+	for (int i = 0; i < n; i++) {
+		struct layout_op add = {
+			.v = &views[i],
+			.default_geometry = {-1, -1, -1, -1},
+		};
+		views[i].output = &output;
+		weston_layer_entry_insert(&layer.view_list,
+		                          &views[i].layer_link);
+		tiling.command(DPSR_add, &add, &views[i], &tiling, ops);
+	}
+	add_ns = now_ns() - start;
+
+	start = now_ns();
+	for (int i = 0; i < resizes; i++) {
+		tw_output.desktop_area.width = 3840 - (i & 1) * 32;
+		layout_resize_output(&tiling, &tw_output);
+		tiling.command(DPSR_output_resize, &arg, NULL, &tiling, ops);
+	}
+	resize_ns = now_ns() - start;
+
+	start = now_ns();
+	for (int i = n-1; i >= 0; i--) {
+		struct layout_op del = { .v = &views[i] };
+		tiling.command(DPSR_del, &del, &views[i], &tiling, ops);
+		weston_layer_entry_remove(&views[i].layer_link);
+	}
+	del_ns = now_ns() - start;
+
+	printf("%-8s %5d views: add %8.2fus  arrange %8.2fus  del %8.2fus\n",
+	       engine->name, n, add_ns / 1e3 / n, resize_ns / 1e3 / resizes,
+	       del_ns / 1e3 / n);
+
+	//the tree is empty now, nothing left to unlink
+	tiling_layout_end(&tiling);
+	floating_layout_end(&floating);
+	free(views);
+	free(ops);
+}
+
+int main(int argc, char *argv[])
+{
+	int n = argc > 1 ? atoi(argv[1]) : 0;
+	int resizes = argc > 2 ? atoi(argv[2]) : 1000;
+	int sizes[] = {8, 64, 512};
+
+	if (resizes < 1 || n < 0) {
+		fprintf(stderr, "usage: bench_layout [views] [output resizes]\n");
+		return 1;
+	}
+	for (unsigned i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+		if (n) {
+			run(&engines[i], n, resizes);
+			continue;
+		}
+		for (unsigned j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++)
+			run(&engines[i], sizes[j], resizes);
+	}
+	return 0;
+}
@@ -0,0 +1,183 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <desktop/free_rects.h>
+
+/* floating placement test. Windows of random sizes go one after the other into
+ * the free space of an output, they must never cover each other and one must
+ * be found whenever there is room for it anywhere. Then the placement of a
+ * window among the others, and building the space again, are timed.
+ *
+ *   test_free_rects [windows] [rounds]
+ */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static bool
+overlaps(const struct weston_geometry *a, const struct weston_geometry *b)
+{
+	return a->x < b->x + b->width && b->x < a->x + a->width &&
+		a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+static bool
+is_free(const struct weston_geometry *area, const struct weston_geometry *geos,
+        int n, const struct weston_geometry *g)
+{
+	if (g->x < area->x || g->y < area->y ||
+	    g->x + g->width > area->x + area->width ||
+	    g->y + g->height > area->y + area->height)
+		return false;
+	for (int i = 0; i < n; i++)
+		if (overlaps(&geos[i], g))
+			return false;
+	return true;
+}
+
+/* a free spot slides left and up until it hits something, so if there is one,
+ * there is one at the area edges or the right and bottom edges of a window */
+static bool
+has_room(const struct weston_geometry *area, const struct weston_geometry *geos,
+         int n, int32_t w, int32_t h)
+{
+	for (int i = -1; i < n; i++)
+		for (int j = -1; j < n; j++) {
+			struct weston_geometry g = {
+				(i < 0) ? area->x : geos[i].x + geos[i].width,
+				(j < 0) ? area->y : geos[j].y + geos[j].height,
+				w, h,
+			};
+			if (is_free(area, geos, n, &g))
+				return true;
+		}
+	return false;
+}
+
+static void
+test_fixed(void)
+{
+	struct weston_geometry area = {100, 50, 1000, 800};
+	struct free_rects fr;
+	struct weston_position pos;
+
+	free_rects_init(&fr);
+	free_rects_reset(&fr, &area);
+	CHECK(free_rects_find(&fr, 400, 300, &pos));
+	CHECK(pos.x == 100 && pos.y == 50);
+	//a window across the middle leaves the four sides
+	CHECK(free_rects_occupy(&fr, &(struct weston_geometry){
+				400, 300, 200, 200}));
+	CHECK(fr.len == 4);
+	//only the strip on the right is wide enough and tall enough
+	CHECK(free_rects_find(&fr, 450, 700, &pos));
+	CHECK(pos.x == 600 && pos.y == 50);
+	CHECK(!free_rects_find(&fr, 600, 600, &pos));
+	//the bottom strip fits it tighter than the right one
+	CHECK(free_rects_find(&fr, 900, 300, &pos));
+	CHECK(pos.x == 100 && pos.y == 500);
+	//covering everything leaves nothing
+	CHECK(free_rects_occupy(&fr, &area));
+	CHECK(fr.len == 0);
+	CHECK(!free_rects_find(&fr, 1, 1, &pos));
+	free_rects_release(&fr);
+}
+
+/* crowded, so that many windows do not fit anymore */
+static void
+test_random(int rounds)
+{
+	struct weston_geometry area = {0, 0, 800, 600};
+	struct weston_geometry geos[48];
+	struct free_rects fr;
+
+	free_rects_init(&fr);
+	for (int r = 0; r < rounds; r++) {
+		int placed = 0;
+
+		free_rects_reset(&fr, &area);
+		for (int i = 0; i < 48; i++) {
+			struct weston_position pos;
+			int32_t w = 20 + rand() % 300, h = 20 + rand() % 200;
+			bool room = has_room(&area, geos, placed, w, h);
+
+			CHECK(free_rects_find(&fr, w, h, &pos) == room);
+			if (!room)
+				continue;
+			geos[placed] = (struct weston_geometry){
+				pos.x, pos.y, w, h};
+			CHECK(is_free(&area, geos, placed, &geos[placed]));
+			CHECK(free_rects_occupy(&fr, &geos[placed]));
+			placed++;
+		}
+	}
+	free_rects_release(&fr);
+}
+
+static void
+bench_place(int n, int rounds)
+{
+	struct weston_geometry area = {1920, 0, 2560, 1440};
+	struct weston_geometry *geos = calloc(n, sizeof(*geos));
+	struct free_rects fr;
+	uint64_t start, place_ns = 0, build_ns = 0;
+	int found = 0;
+
+	free_rects_init(&fr);
+	for (int r = 0; r < rounds; r++) {
+		int placed = 0;
+
+		free_rects_reset(&fr, &area);
+		start = now_ns();
+		for (int i = 0; i < n; i++) {
+			struct weston_position pos;
+			int32_t w = 20 + rand() % 300, h = 20 + rand() % 200;
+
+			if (!free_rects_find(&fr, w, h, &pos))
+				continue;
+			geos[placed] = (struct weston_geometry){
+				pos.x, pos.y, w, h};
+			CHECK(free_rects_occupy(&fr, &geos[placed++]));
+		}
+		place_ns += now_ns() - start;
+		found += placed;
+		//after a window closes, the others go in again
+		start = now_ns();
+		free_rects_reset(&fr, &area);
+		for (int i = 1; i < placed; i++)
+			CHECK(free_rects_occupy(&fr, &geos[i]));
+		build_ns += now_ns() - start;
+	}
+	printf("%d windows: %.2f us per placement, %.1f us per rebuild "
+	       "(%d fit)\n", n, place_ns / 1000.0 / ((double)n * rounds),
+	       build_ns / 1000.0 / rounds, found / rounds);
+	free_rects_release(&fr);
+	free(geos);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int n = (argc > 1) ? atoi(argv[1]) : 200;
+	int rounds = (argc > 2) ? atoi(argv[2]) : 100;
+
+	srand(11);
+	test_fixed();
+	test_random(50);
+	bench_place(n, rounds);
+	printf("ok\n");
+	return 0;
+}
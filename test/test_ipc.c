@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <shared_ipc.h>
+
+/* a small client to poke the compositor ipc:
+ *
+ *   test_ipc            list views, workspaces, outputs and focus
+ *   test_ipc -s         then stay subscribed and print the events
+ *   test_ipc -w N       switch to workspace N
+ */
+
+static int
+ipc_connect(void)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+	if (!tw_ipc_socket_path(addr.sun_path)) {
+		fprintf(stderr, "neither TAIWINS_IPC nor XDG_RUNTIME_DIR set\n");
+		exit(1);
+	}
+	if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		fprintf(stderr, "cannot connect to %s\n", addr.sun_path);
+		exit(1);
+	}
+	return fd;
+}
+
+static bool
+read_full(int fd, void *buf, size_t size)
+{
+	char *p = buf;
+	while (size) {
+		ssize_t n = read(fd, p, size);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static void
+send_request(int fd, uint16_t type, const void *payload, uint32_t size)
+{
+	struct tw_ipc_header header = {
+		TW_IPC_MAGIC, TW_IPC_VERSION, type, size,
+	};
+	if (write(fd, &header, sizeof(header)) != sizeof(header) ||
+	    (size && write(fd, payload, size) != (ssize_t)size)) {
+		perror("write");
+		exit(1);
+	}
+}
+
+/* read a message, the payload is malloced */
+static void *
+read_message(int fd, struct tw_ipc_header *header)
+{
+	void *payload;
+
+	if (!read_full(fd, header, sizeof(*header)) ||
+	    header->magic != TW_IPC_MAGIC) {
+		fprintf(stderr, "compositor hung up\n");
+		exit(1);
+	}
+	payload = malloc(header->size + 1);
+	if (!read_full(fd, payload, header->size)) {
+		fprintf(stderr, "compositor hung up\n");
+		exit(1);
+	}
+	return payload;
+}
+
+static void
+print_event(const struct tw_ipc_header *header, const struct tw_ipc_event *e)
+{
+	const char *names[] = {"?", "focus", "workspace", "created",
+	                       "destroyed"};
+	unsigned int idx = header->type & 0xff;
+
+	printf("event %s: seq %u view %u workspace %d from %d (lost %u)\n",
+	       idx < 5 ? names[idx] : "?", e->seq, e->view, e->workspace,
+	       e->from, e->lost);
+}
+
+/* wait for the reply of `type`, events on the way are printed */
+static void *
+wait_reply(int fd, uint16_t type, struct tw_ipc_header *header)
+{
+	void *payload;
+
+	while (true) {
+		payload = read_message(fd, header);
+		if (header->type & TW_IPC_EVENT &&
+		    !(header->type & TW_IPC_REPLY)) {
+			print_event(header, payload);
+			free(payload);
+			continue;
+		}
+		if (header->type == TW_IPC_ERROR) {
+			fprintf(stderr, "request %d failed with %d\n", type,
+			        ((struct tw_ipc_error *)payload)->code);
+			free(payload);
+			return NULL;
+		}
+		return payload;
+	}
+}
+
+static void
+print_view(const struct tw_ipc_view *v)
+{
+	printf("view %u ws %d %dx%d+%d+%d %s%s%s %s: %s\n",
+	       v->id, v->workspace, v->width, v->height, v->x, v->y,
+	       (v->flags & TW_IPC_VIEW_FOCUSED) ? "F" : "-",
+	       (v->flags & TW_IPC_VIEW_FLOATING) ? "f" : "t",
+	       (v->flags & TW_IPC_VIEW_VISIBLE) ? "v" : "-",
+	       v->app_id, v->title);
+}
+
+int main(int argc, char *argv[])
+{
+	struct tw_ipc_header header;
+	int fd = ipc_connect();
+	bool subscribe = argc > 1 && !strcmp(argv[1], "-s");
+	void *payload;
+
+	if (argc > 2 && !strcmp(argv[1], "-w")) {
+		struct tw_ipc_layout_command cmd = {
+			.op = TW_IPC_LAYOUT_SWITCH_WORKSPACE,
+			.arg = atoi(argv[2]),
+		};
+		send_request(fd, TW_IPC_LAYOUT_COMMAND, &cmd, sizeof(cmd));
+		free(wait_reply(fd, TW_IPC_LAYOUT_COMMAND, &header));
+		close(fd);
+		return 0;
+	}
+
+	send_request(fd, TW_IPC_LIST_VIEWS, NULL, 0);
+	if ((payload = wait_reply(fd, TW_IPC_LIST_VIEWS, &header))) {
+		struct tw_ipc_view *views = payload;
+		for (unsigned i = 0; i < header.size / sizeof(*views); i++)
+			print_view(&views[i]);
+		free(payload);
+	}
+
+	send_request(fd, TW_IPC_LIST_WORKSPACES, NULL, 0);
+	if ((payload = wait_reply(fd, TW_IPC_LIST_WORKSPACES, &header))) {
+		struct tw_ipc_workspace *ws = payload;
+		for (unsigned i = 0; i < header.size / sizeof(*ws); i++)
+			printf("workspace %u: %s, %u views%s\n", ws[i].index,
+			       ws[i].layout, ws[i].nviews,
+			       (ws[i].flags & TW_IPC_WORKSPACE_ACTIVE) ?
+			       " (active)" : "");
+		free(payload);
+	}
+
+	send_request(fd, TW_IPC_LIST_OUTPUTS, NULL, 0);
+	if ((payload = wait_reply(fd, TW_IPC_LIST_OUTPUTS, &header))) {
+		struct tw_ipc_output *o = payload;
+		for (unsigned i = 0; i < header.size / sizeof(*o); i++)
+			printf("output %u %s: %dx%d+%d+%d scale %d\n",
+			       o[i].id, o[i].name, o[i].width, o[i].height,
+			       o[i].x, o[i].y, o[i].scale);
+		free(payload);
+	}
+
+	send_request(fd, TW_IPC_LIST_CLIENTS, NULL, 0);
+	if ((payload = wait_reply(fd, TW_IPC_LIST_CLIENTS, &header))) {
+		struct tw_ipc_client_stats *c = payload;
+		for (unsigned i = 0; i < header.size / sizeof(*c); i++)
+			printf("client %d: %u surfaces, %u views, %llu shm bytes, "
+			       "%u commits/s, %llu damage/s, rtt %uus/%uus\n",
+			       c[i].pid, c[i].surfaces, c[i].views,
+			       (unsigned long long)c[i].shm_bytes,
+			       c[i].commits_per_sec,
+			       (unsigned long long)c[i].damage_per_sec,
+			       c[i].configure_rtt_us,
+			       c[i].configure_rtt_max_us);
+		free(payload);
+	}
+
+	send_request(fd, TW_IPC_LIST_MEMORY, NULL, 0);
+	if ((payload = wait_reply(fd, TW_IPC_LIST_MEMORY, &header))) {
+		struct tw_ipc_mem_stats *m = payload;
+		for (unsigned i = 0; i < header.size / sizeof(*m); i++)
+			printf("memory %s: %lld bytes in %lld allocations, "
+			       "peak %lld, %llu allocated so far\n",
+			       m[i].tag, (long long)m[i].live_bytes,
+			       (long long)m[i].live_allocs,
+			       (long long)m[i].peak_bytes,
+			       (unsigned long long)m[i].total_allocs);
+		free(payload);
+	}
+
+	send_request(fd, TW_IPC_GET_FOCUS, NULL, 0);
+	if ((payload = wait_reply(fd, TW_IPC_GET_FOCUS, &header))) {
+		if (header.size == sizeof(struct tw_ipc_view)) {
+			printf("focused: ");
+			print_view(payload);
+		} else
+			printf("nothing focused\n");
+		free(payload);
+	}
+
+	if (subscribe) {
+		uint32_t mask = TW_IPC_EVENT_ALL;
+		send_request(fd, TW_IPC_SUBSCRIBE, &mask, sizeof(mask));
+		free(wait_reply(fd, TW_IPC_SUBSCRIBE, &header));
+		while (true) {
+			payload = read_message(fd, &header);
+			print_event(&header, payload);
+			free(payload);
+		}
+	}
+
+	close(fd);
+	return 0;
+}
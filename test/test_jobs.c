@@ -0,0 +1,158 @@
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <jobs.h>
+
+/* job pool stress test. Several owner threads, each with its own sink, submit
+ * jobs and cancel some of them at random, every job has to come back exactly
+ * once and a cancelled job still queued must never run. Half of the owners
+ * destroy their sink with jobs in flight.
+ *
+ *   test_jobs [owners] [jobs per owner]
+ */
+
+struct job_record {
+	_Atomic int runs;
+	int dones;
+	bool cancel_requested;
+	bool cancelled;
+	struct tw_job *job;
+};
+
+struct owner {
+	pthread_t thread;
+	struct tw_job_pool *pool;
+	int index;
+	int njobs;
+	int finished;
+	struct job_record *records;
+};
+
+static void
+job_run(struct tw_job *job, void *data)
+{
+	struct job_record *rec = data;
+	unsigned int seed = (unsigned int)(uintptr_t)data;
+	unsigned int n = rand_r(&seed) % 2000;
+	volatile unsigned spin = 0;
+
+	atomic_fetch_add(&rec->runs, 1);
+	for (unsigned i = 0; i < n; i++) {
+		if (tw_job_cancelled(job))
+			return;
+		spin += i;
+	}
+}
+
+static void
+job_done(void *data, bool cancelled)
+{
+	struct job_record *rec = data;
+
+	rec->dones++;
+	rec->cancelled = cancelled;
+	rec->job = NULL;
+}
+
+static void *
+owner_main(void *data)
+{
+	struct owner *owner = data;
+	struct tw_job_sink *sink = tw_job_sink_create(owner->pool);
+	struct pollfd pfd;
+	unsigned int seed = owner->index;
+	int submitted = 0;
+
+	assert(sink);
+	pfd.fd = tw_job_sink_get_fd(sink);
+	pfd.events = POLLIN;
+
+	while (owner->finished < owner->njobs) {
+		int burst = submitted;
+
+		//submit in bursts so the queue builds up
+		for (int i = 0; i < 64 && submitted < owner->njobs; i++) {
+			struct job_record *rec = &owner->records[submitted++];
+			rec->job = tw_job_submit(sink, job_run, job_done, rec);
+			assert(rec->job);
+		}
+		//cancel from the previous burst as well, some of them running
+		for (int i = burst > 64 ? burst - 64 : 0; i < submitted; i++) {
+			struct job_record *rec = &owner->records[i];
+			if (rec->job && !rec->cancel_requested &&
+			    rand_r(&seed) % 8 == 0) {
+				rec->cancel_requested = true;
+				tw_job_cancel(rec->job);
+			}
+		}
+		//leave jobs in flight for the sink destroy
+		if (owner->index % 2 && submitted == owner->njobs)
+			break;
+		if (poll(&pfd, 1, 1000) <= 0) {
+			fprintf(stderr, "owner %d: no completion in 1s\n",
+			        owner->index);
+			abort();
+		}
+		owner->finished += tw_job_sink_dispatch(sink);
+	}
+	tw_job_sink_destroy(sink);
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int nowners = argc > 1 ? atoi(argv[1]) : 8;
+	int njobs = argc > 2 ? atoi(argv[2]) : 20000;
+	struct tw_job_pool *pool = tw_job_pool_create(0);
+	struct owner *owners = calloc(nowners, sizeof(*owners));
+	long cancelled = 0, ran_cancelled = 0;
+
+	assert(pool && owners);
+	for (int i = 0; i < nowners; i++) {
+		owners[i].pool = pool;
+		owners[i].index = i;
+		owners[i].njobs = njobs;
+		owners[i].records = calloc(njobs, sizeof(struct job_record));
+		assert(owners[i].records);
+		pthread_create(&owners[i].thread, NULL, owner_main, &owners[i]);
+	}
+	for (int i = 0; i < nowners; i++)
+		pthread_join(owners[i].thread, NULL);
+	tw_job_pool_destroy(pool);
+
+	for (int i = 0; i < nowners; i++) {
+		for (int j = 0; j < njobs; j++) {
+			struct job_record *rec = &owners[i].records[j];
+			if (rec->dones != 1 || atomic_load(&rec->runs) > 1) {
+				fprintf(stderr, "owner %d job %d: %d dones, "
+				        "%d runs\n", i, j, rec->dones,
+				        atomic_load(&rec->runs));
+				return 1;
+			}
+			if (rec->cancel_requested && !rec->cancelled) {
+				fprintf(stderr, "owner %d job %d: cancel lost\n",
+				        i, j);
+				return 1;
+			}
+			if (!rec->cancelled && !atomic_load(&rec->runs)) {
+				fprintf(stderr, "owner %d job %d: never ran\n",
+				        i, j);
+				return 1;
+			}
+			cancelled += rec->cancelled;
+			ran_cancelled += rec->cancelled &&
+				atomic_load(&rec->runs);
+		}
+		free(owners[i].records);
+	}
+	printf("%d owners, %d jobs each: %ld cancelled, %ld of them started\n",
+	       nowners, njobs, cancelled, ran_cancelled);
+	free(owners);
+	return 0;
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <desktop/layout_constraint.h>
+
+/* tiling constraint test. Splits with random portions, mins and maxes go
+ * through the solver, the sizes have to add up to the space whenever the
+ * limits let them, and nobody may be out of its limits unless the mins do not
+ * fit.
+ *
+ *   test_layout_constraint [rounds]
+ */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+static int32_t
+sum_of(const struct layout_span *spans, int n)
+{
+	int32_t sum = 0;
+	for (int i = 0; i < n; i++)
+		sum += spans[i].size;
+	return sum;
+}
+
+static bool
+within(const struct layout_span *span)
+{
+	return span->size >= span->min &&
+		(!span->max || span->size <= span->max);
+}
+
+static void
+test_fixed(void)
+{
+	//a terminal that wants 600 of 1000 pixels at half
+	struct layout_span a[2] = {
+		{.min = 600, .portion = 0.5}, {.portion = 0.5},
+	};
+	CHECK(layout_span_solve(a, 2, 1000));
+	CHECK(a[0].size == 600 && a[1].size == 400);
+
+	//a dialog that stops at 200, the other one takes the rest
+	struct layout_span b[3] = {
+		{.max = 200, .portion = 1}, {.portion = 1}, {.portion = 2},
+	};
+	CHECK(layout_span_solve(b, 3, 1200));
+	CHECK(b[0].size == 200 && sum_of(b, 3) == 1200);
+	CHECK(b[2].size > b[1].size);
+
+	//everybody at its max, the rest stays empty
+	struct layout_span c[2] = {
+		{.max = 100, .portion = 1}, {.max = 300, .portion = 1},
+	};
+	CHECK(layout_span_solve(c, 2, 1000));
+	CHECK(c[0].size == 100 && c[1].size == 300);
+
+	//the mins do not fit, the space is still filled
+	struct layout_span d[3] = {
+		{.min = 400, .portion = 1}, {.min = 400, .portion = 1},
+		{.min = 200, .portion = 1},
+	};
+	CHECK(!layout_span_solve(d, 3, 500));
+	CHECK(sum_of(d, 3) == 500);
+	CHECK(d[0].size == 200 && d[2].size == 100);
+
+	//a max under the min, the min wins
+	struct layout_span e[2] = {
+		{.min = 300, .max = 100, .portion = 1}, {.portion = 1},
+	};
+	CHECK(layout_span_solve(e, 2, 800));
+	CHECK(e[0].size >= 300 && sum_of(e, 2) == 800);
+
+	//no portions at all, the same for all
+	struct layout_span f[4] = {{0}};
+	CHECK(layout_span_solve(f, 4, 1001));
+	CHECK(sum_of(f, 4) == 1001);
+	for (int i = 0; i < 4; i++)
+		CHECK(f[i].size >= 250 && f[i].size <= 251);
+}
+
+static void
+test_random(int rounds)
+{
+	struct layout_span spans[16];
+
+	for (int r = 0; r < rounds; r++) {
+		int n = 1 + rand() % 16;
+		int32_t total = rand() % 4000;
+		int64_t mins = 0, maxes = 0;
+		bool bounded = true, solved;
+
+		for (int i = 0; i < n; i++) {
+			spans[i].portion = (rand() % 100) / 100.0f;
+			spans[i].min = (rand() % 3) ? 0 : rand() % 400;
+			spans[i].max = (rand() % 3) ? 0 :
+				spans[i].min + rand() % 600;
+			spans[i].size = -1;
+			mins += spans[i].min;
+			maxes += spans[i].max;
+			bounded = bounded && spans[i].max;
+		}
+		solved = layout_span_solve(spans, n, total);
+		CHECK(solved == (mins <= total));
+		if (!solved) {
+			CHECK(sum_of(spans, n) == total);
+			continue;
+		}
+		for (int i = 0; i < n; i++)
+			CHECK(within(&spans[i]));
+		if (bounded && maxes < total)
+			CHECK(sum_of(spans, n) == maxes);
+		else
+			CHECK(sum_of(spans, n) == total);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	int rounds = (argc > 1) ? atoi(argv[1]) : 100000;
+
+	srand(42);
+	test_fixed();
+	test_random(rounds);
+	printf("ok\n");
+	return 0;
+}
@@ -0,0 +1,165 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <desktop/overview_grid.h>
+
+/* overview arrangement test. The scaled views have to stay in the area, apart
+ * from each other and of their own aspect, a few obvious grids are checked,
+ * so is where the transform puts a view, then the arrangement of many views is
+ * timed.
+ *
+ *   test_overview_grid [views] [rounds]
+ */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void
+check_slots(const struct weston_geometry *area, int32_t gap,
+            const struct weston_size *sizes, int n,
+            const struct overview_slot *slots)
+{
+	for (int i = 0; i < n; i++) {
+		const struct weston_geometry *g = &slots[i].geo;
+
+		CHECK(slots[i].scale > 0.0 && slots[i].scale <= 1.0);
+		CHECK(g->x >= area->x + gap && g->y >= area->y + gap);
+		CHECK(g->x + g->width <= area->x + area->width - gap);
+		CHECK(g->y + g->height <= area->y + area->height - gap);
+		//the aspect, within the rounding
+		CHECK(fabs(g->width - sizes[i].width * slots[i].scale) < 1.01);
+		CHECK(fabs(g->height - sizes[i].height * slots[i].scale) < 1.01);
+		for (int j = 0; j < i; j++) {
+			const struct weston_geometry *o = &slots[j].geo;
+			CHECK(g->x >= o->x + o->width || o->x >= g->x + g->width ||
+			      g->y >= o->y + o->height ||
+			      o->y >= g->y + g->height);
+		}
+	}
+}
+
+static void
+test_fixed(void)
+{
+	struct weston_geometry area = {1920, 30, 1920, 1050};
+	struct weston_size sizes[5] = {
+		{1920, 1050}, {1920, 1050}, {1920, 1050}, {1920, 1050},
+		{400, 300},
+	};
+	struct overview_slot slots[5];
+
+	//the same four windows as the output go 2x2
+	CHECK(overview_grid(&area, 20, sizes, 4, slots) == 2);
+	check_slots(&area, 20, sizes, 4, slots);
+	CHECK(slots[0].geo.y == slots[1].geo.y);
+	CHECK(slots[0].geo.x == slots[2].geo.x);
+
+	//a small one alone is not scaled up, it is in the middle
+	CHECK(overview_grid(&area, 20, &sizes[4], 1, slots) == 1);
+	CHECK(slots[0].scale == 1.0f);
+	CHECK(slots[0].geo.x == 1920 + 760 && slots[0].geo.y == 30 + 375);
+
+	//three in two columns, the last one under the middle
+	CHECK(overview_grid(&area, 20, sizes, 3, slots) == 2);
+	check_slots(&area, 20, sizes, 3, slots);
+	CHECK(abs((slots[2].geo.x + slots[2].geo.width / 2) -
+	          (area.x + area.width / 2)) <= 1);
+
+	//no room at all
+	CHECK(overview_grid(&(struct weston_geometry){0, 0, 30, 30}, 20,
+	                    sizes, 2, slots) == 0);
+}
+
+/* the transform scales the global coordinates then translates, the corners
+ * of the visible part have to land on the corners of the slot */
+static void
+test_offset(void)
+{
+	struct weston_geometry area = {1920, 30, 1920, 1050};
+	//a window on the second output, its shadow is 26 pixels
+	struct weston_geometry visible = {1920 + 100 + 26, 30 + 50 + 26,
+	                                  1600, 900};
+	struct weston_size sizes[2] = {{1600, 900}, {1920, 1050}};
+	struct overview_slot slots[2];
+	float dx, dy, s;
+
+	CHECK(overview_grid(&area, 20, sizes, 2, slots) == 2);
+	s = slots[0].scale;
+	CHECK(s < 1.0);
+	overview_slot_offset(&slots[0], visible.x, visible.y, &dx, &dy);
+	CHECK(fabs(s * visible.x + dx - slots[0].geo.x) < 0.01);
+	CHECK(fabs(s * visible.y + dy - slots[0].geo.y) < 0.01);
+	CHECK(fabs(s * (visible.x + visible.width) + dx -
+	           (slots[0].geo.x + slots[0].geo.width)) < 1.01);
+	CHECK(fabs(s * (visible.y + visible.height) + dy -
+	           (slots[0].geo.y + slots[0].geo.height)) < 1.01);
+}
+
+static void
+test_random(int rounds)
+{
+	struct weston_geometry area = {0, 0, 2560, 1440};
+	struct weston_size sizes[64];
+	struct overview_slot slots[64];
+
+	for (int r = 0; r < rounds; r++) {
+		int n = 1 + rand() % 64;
+
+		for (int i = 0; i < n; i++)
+			sizes[i] = (struct weston_size){
+				1 + rand() % 2560, 1 + rand() % 1440};
+		CHECK(overview_grid(&area, 16, sizes, n, slots) > 0);
+		check_slots(&area, 16, sizes, n, slots);
+	}
+}
+
+static void
+bench_grid(int n, int rounds)
+{
+	struct weston_geometry area = {0, 0, 3840, 2160};
+	struct weston_size *sizes = calloc(n, sizeof(*sizes));
+	struct overview_slot *slots = calloc(n, sizeof(*slots));
+	uint64_t start, ns;
+	int cols = 0;
+
+	for (int i = 0; i < n; i++)
+		sizes[i] = (struct weston_size){
+			200 + rand() % 1600, 200 + rand() % 1000};
+	start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		cols += overview_grid(&area, 8, sizes, n, slots);
+	ns = now_ns() - start;
+	printf("%d views: %.1f us per arrangement (%d columns)\n", n,
+	       ns / 1000.0 / rounds, cols / rounds);
+	free(slots);
+	free(sizes);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int n = (argc > 1) ? atoi(argv[1]) : 200;
+	int rounds = (argc > 2) ? atoi(argv[2]) : 100;
+
+	srand(5);
+	test_fixed();
+	test_offset();
+	test_random(500);
+	bench_grid(n, rounds);
+	printf("ok\n");
+	return 0;
+}
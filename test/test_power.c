@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <widget/power.h>
+
+/* power sources against a fake sysfs tree and a mock UPower bus */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+static char root[64];
+static char uevent[PATH_MAX];
+
+static void
+write_uevent(const char *status, int capacity)
+{
+	FILE *f = fopen(uevent, "w");
+	CHECK(f);
+	fprintf(f, "POWER_SUPPLY_NAME=BAT0\n"
+	        "POWER_SUPPLY_STATUS=%s\n"
+	        "POWER_SUPPLY_PRESENT=1\n"
+	        "POWER_SUPPLY_CAPACITY=%d\n", status, capacity);
+	fclose(f);
+}
+
+static void
+test_sysfs(void)
+{
+	struct power_source source;
+	char dir[128];
+
+	strcpy(root, "/tmp/tw_power_XXXXXX");
+	CHECK(mkdtemp(root));
+	snprintf(dir, sizeof(dir), "%s/BAT0", root);
+	mkdir(dir, 0755);
+	snprintf(uevent, sizeof(uevent), "%s/uevent", dir);
+	write_uevent("Discharging", 42);
+
+	CHECK(power_source_init_sysfs(&source, root));
+	CHECK(!strcmp(source.name, "BAT0"));
+	CHECK(source.state.percent == 42);
+	CHECK(!source.state.charging);
+	//nothing moved, no redraw
+	CHECK(!power_source_refresh(&source));
+
+	write_uevent("Charging", 42);
+	CHECK(power_source_refresh(&source));
+	CHECK(source.state.charging);
+	write_uevent("Charging", 43);
+	CHECK(power_source_refresh(&source));
+	CHECK(source.state.percent == 43);
+	CHECK(!power_source_refresh(&source));
+
+	power_source_release(&source);
+	unlink(uevent);
+	rmdir(dir);
+	rmdir(root);
+	CHECK(!power_source_init_sysfs(&source, root));
+}
+
+struct mock_bus {
+	struct power_bus base;
+	struct power_source *watched;
+	bool available;
+};
+
+static bool
+mock_watch(struct power_bus *bus, struct power_source *source)
+{
+	struct mock_bus *mock = (struct mock_bus *)bus;
+	if (!mock->available)
+		return false;
+	mock->watched = source;
+	return true;
+}
+
+static void
+mock_unwatch(struct power_bus *bus, struct power_source *source)
+{
+	struct mock_bus *mock = (struct mock_bus *)bus;
+	CHECK(mock->watched == source);
+	mock->watched = NULL;
+}
+
+static void
+count_changes(struct power_source *source, void *data)
+{
+	(*(int *)data)++;
+}
+
+static void
+test_upower(void)
+{
+	struct power_source source;
+	struct mock_bus bus = {
+		.base = {.watch = mock_watch, .unwatch = mock_unwatch},
+		.available = false,
+	};
+	int changes = 0;
+
+	CHECK(!power_source_init_upower(&source, &bus.base));
+	bus.available = true;
+	CHECK(power_source_init_upower(&source, &bus.base));
+	source.changed = count_changes;
+	source.data = &changes;
+
+	CHECK(power_source_upower_property(&source, "Percentage", 80.4));
+	CHECK(source.state.percent == 80);
+	//the same value again is not a change
+	CHECK(!power_source_upower_property(&source, "Percentage", 80.2));
+	CHECK(power_source_upower_property(&source, "State", 1));
+	CHECK(source.state.charging);
+	CHECK(!power_source_upower_property(&source, "Model", 1));
+	CHECK(changes == 2);
+
+	power_source_release(&source);
+	CHECK(!bus.watched);
+}
+
+int main(int argc, char *argv[])
+{
+	test_sysfs();
+	test_upower();
+	printf("power sources are fine\n");
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pressure.h>
+
+/* memory pressure monitor test. The kernel side is faked with a memory.events
+ * in a temporary directory, then the injection and the trim file.
+ */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+static char dir[] = "/tmp/taiwins-pressure-XXXXXX";
+
+static void
+write_file(const char *name, const char *content)
+{
+	char path[256];
+	FILE *file;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	file = fopen(path, "w");
+	CHECK(file);
+	fputs(content, file);
+	fclose(file);
+}
+
+static void
+write_events(unsigned low, unsigned high, unsigned max)
+{
+	char content[128];
+
+	snprintf(content, sizeof(content),
+	         "low %u\nhigh %u\nmax %u\noom 0\noom_kill 0\n",
+	         low, high, max);
+	write_file("memory.events", content);
+}
+
+static enum tw_pressure_reason
+wait_reason(struct tw_pressure *pressure)
+{
+	struct pollfd pfd = {
+		.fd = tw_pressure_get_fd(pressure),
+		.events = POLLIN,
+	};
+
+	if (poll(&pfd, 1, 200) <= 0)
+		return TW_PRESSURE_NONE;
+	return tw_pressure_dispatch(pressure);
+}
+
+#define EXPECT(pressure, expected) do {					\
+		enum tw_pressure_reason r = wait_reason(pressure);	\
+		if (r != (expected)) {					\
+			fprintf(stderr, "line %d: got %s, expected %s\n", \
+			        __LINE__, tw_pressure_reason_name(r),	\
+			        tw_pressure_reason_name(expected));	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+int main(void)
+{
+	char trim[256];
+	struct tw_pressure *pressure;
+	struct tw_pressure_options opts = {
+		.psi_path = "/nonexistent",
+		.cgroup_dir = dir,
+		.trim_path = trim,
+		.min_interval_ms = 300,
+	};
+
+	CHECK(mkdtemp(dir));
+	snprintf(trim, sizeof(trim), "%s/trim", dir);
+	write_events(0, 0, 0);
+
+	pressure = tw_pressure_create(&opts);
+	CHECK(pressure);
+	CHECK(!strcmp(tw_pressure_source(pressure), "cgroup-events"));
+
+	EXPECT(pressure, TW_PRESSURE_NONE);
+	tw_pressure_inject(pressure);
+	EXPECT(pressure, TW_PRESSURE_INJECTED);
+	write_file("trim", "\n");
+	EXPECT(pressure, TW_PRESSURE_TRIM_FILE);
+	//other files in the directory are not the trim file
+	write_file("other", "\n");
+	EXPECT(pressure, TW_PRESSURE_NONE);
+
+	//low does not count, high and max do
+	write_events(3, 0, 0);
+	EXPECT(pressure, TW_PRESSURE_NONE);
+	usleep(350 * 1000);
+	write_events(3, 1, 0);
+	EXPECT(pressure, TW_PRESSURE_CGROUP);
+	//rate limited, but the explicit ones are not
+	write_events(3, 2, 0);
+	EXPECT(pressure, TW_PRESSURE_NONE);
+	tw_pressure_inject(pressure);
+	EXPECT(pressure, TW_PRESSURE_INJECTED);
+	usleep(350 * 1000);
+	write_events(3, 2, 1);
+	EXPECT(pressure, TW_PRESSURE_CGROUP);
+	tw_pressure_destroy(pressure);
+
+	//what this machine would use
+	pressure = tw_pressure_create(NULL);
+	CHECK(pressure);
+	printf("pressure source here: %s\n", tw_pressure_source(pressure));
+	tw_pressure_destroy(pressure);
+
+	unlink(trim);
+	snprintf(trim, sizeof(trim), "%s/other", dir);
+	unlink(trim);
+	snprintf(trim, sizeof(trim), "%s/memory.events", dir);
+	unlink(trim);
+	rmdir(dir);
+	printf("ok\n");
+	return 0;
+}
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <desktop/session_file.h>
+
+/* session file test. A session with two workspaces goes through the encoder,
+ * the decoder and a file, then every truncation and every flipped byte of the
+ * encoding has to be refused.
+ */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+static void
+fill(struct tw_session *s)
+{
+	struct tw_session_slot *slots;
+	struct tw_session_tree *tree;
+	struct tw_session_node *nodes;
+
+	tw_session_init(s);
+	s->workspaces[0].layout = 1;
+	s->workspaces[3].layout = 2;
+	s->workspaces[3].masters = 2;
+	s->workspaces[3].master_portion = 0.6;
+
+	slots = tw_session_add_slots(s, 3);
+	CHECK(slots);
+	slots[0] = (struct tw_session_slot){.workspace = 0, .type = 1};
+	strcpy(slots[0].app_id, "foot");
+	strcpy(slots[0].title, "~/src/taiwins");
+	strcpy(slots[0].output, "DP-1");
+	slots[1] = slots[0];
+	strcpy(slots[1].title, "htop");
+	slots[2] = (struct tw_session_slot){
+		.workspace = 3, .type = 0,
+		.x = 100, .y = -20, .width = 640, .height = 480,
+	};
+	strcpy(slots[2].app_id, "org.gnome.Calculator");
+	strcpy(slots[2].output, "DP-1");
+
+	//root, a vertical split of slot 0 and tabs with slot 1
+	nodes = tw_session_add_nodes(s, 4);
+	tree = tw_session_add_trees(s, 1);
+	CHECK(nodes && tree);
+	nodes[0] = (struct tw_session_node){
+		.slot = -1, .vertical = false, .portion = 1.0, .nchildren = 2,
+	};
+	nodes[1] = (struct tw_session_node){
+		.slot = 0, .vertical = false, .portion = 0.3, .nchildren = 0,
+	};
+	nodes[2] = (struct tw_session_node){
+		.slot = -1, .vertical = true, .portion = 0.7, .nchildren = 1,
+		.container = 1,
+	};
+	nodes[3] = (struct tw_session_node){
+		.slot = 1, .vertical = true, .portion = 1.0, .nchildren = 0,
+	};
+	*tree = (struct tw_session_tree){.workspace = 0, .first = 0, .len = 4};
+	strcpy(tree->output, "DP-1");
+}
+
+static void
+compare(const struct tw_session *a, const struct tw_session *b)
+{
+	CHECK(!memcmp(a->workspaces, b->workspaces, sizeof(a->workspaces)));
+	CHECK(a->nslots == b->nslots);
+	CHECK(a->ntrees == b->ntrees);
+	CHECK(a->nnodes == b->nnodes);
+	for (uint32_t i = 0; i < a->nslots; i++) {
+		const struct tw_session_slot *l = &a->slots[i], *r = &b->slots[i];
+		CHECK(l->workspace == r->workspace && l->type == r->type);
+		CHECK(l->x == r->x && l->y == r->y);
+		CHECK(l->width == r->width && l->height == r->height);
+		CHECK(!strcmp(l->app_id, r->app_id));
+		CHECK(!strcmp(l->title, r->title));
+		CHECK(!strcmp(l->output, r->output));
+	}
+	for (uint32_t i = 0; i < a->ntrees; i++) {
+		CHECK(a->trees[i].workspace == b->trees[i].workspace);
+		CHECK(a->trees[i].len == b->trees[i].len);
+		CHECK(!strcmp(a->trees[i].output, b->trees[i].output));
+	}
+	for (uint32_t i = 0; i < a->nnodes; i++) {
+		CHECK(a->nodes[i].slot == b->nodes[i].slot);
+		CHECK(a->nodes[i].vertical == b->nodes[i].vertical);
+		CHECK(a->nodes[i].portion == b->nodes[i].portion);
+		CHECK(a->nodes[i].nchildren == b->nodes[i].nchildren);
+		CHECK(a->nodes[i].container == b->nodes[i].container);
+	}
+}
+
+int main(void)
+{
+	struct tw_session s, d;
+	char path[] = "/tmp/taiwins-session-XXXXXX";
+	size_t size, read_size = 0;
+	uint8_t *buf, *read_buf;
+	int fd;
+
+	fill(&s);
+	size = tw_session_encode(&s, NULL, 0);
+	buf = malloc(size);
+	CHECK(buf && tw_session_encode(&s, buf, size) == size);
+	printf("%u slots, %u nodes in %zu bytes\n", s.nslots, s.nnodes, size);
+
+	CHECK(tw_session_decode(&d, buf, size));
+	compare(&s, &d);
+	tw_session_release(&d);
+
+	//through a file
+	fd = mkstemp(path);
+	CHECK(fd >= 0);
+	close(fd);
+	CHECK(tw_session_write_file(path, buf, size));
+	read_buf = tw_session_read_file(path, &read_size);
+	CHECK(read_buf && read_size == size);
+	CHECK(!memcmp(read_buf, buf, size));
+	free(read_buf);
+	unlink(path);
+	CHECK(!tw_session_read_file(path, &read_size));
+
+	//nothing short or damaged goes through
+	for (size_t i = 0; i < size; i++)
+		CHECK(!tw_session_decode(&d, buf, i));
+	for (size_t i = 0; i < size; i++) {
+		buf[i] ^= 0x40;
+		CHECK(!tw_session_decode(&d, buf, size));
+		CHECK(d.nslots == 0 && d.nnodes == 0 && !d.slots);
+		buf[i] ^= 0x40;
+	}
+
+	//a tree which does not add up, with a correct checksum
+	s.nodes[0].nchildren = 3;
+	tw_session_encode(&s, buf, size);
+	CHECK(!tw_session_decode(&d, buf, size));
+	s.nodes[0].nchildren = 2;
+	s.nodes[3].slot = 7;
+	tw_session_encode(&s, buf, size);
+	CHECK(!tw_session_decode(&d, buf, size));
+	s.nodes[3].slot = 1;
+	s.nodes[2].container = 3;
+	tw_session_encode(&s, buf, size);
+	CHECK(!tw_session_decode(&d, buf, size));
+
+	tw_session_release(&s);
+	free(buf);
+	printf("ok\n");
+	return 0;
+}
@@ -0,0 +1,206 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <desktop/thumb_atlas.h>
+
+/* thumbnail atlas test. Windows draw into shm like buffers, memfd backed as
+ * the ones of wl_shm, their thumbnails are read back from an other mapping of
+ * the atlas as the shell would, then the eviction and the rate limit are
+ * checked and the scaling of a full screen window is timed.
+ *
+ *   test_thumb_atlas [rounds]
+ */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+struct shm_buffer {
+	int fd, width, height, stride;
+	uint32_t *data;
+	pixman_image_t *image;
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void
+shm_buffer_init(struct shm_buffer *b, pixman_format_code_t format,
+                int width, int height)
+{
+	b->width = width;
+	b->height = height;
+	b->stride = width * 4;
+	b->fd = memfd_create("thumb-test", MFD_CLOEXEC);
+	CHECK(b->fd >= 0);
+	CHECK(ftruncate(b->fd, (size_t)b->stride * height) == 0);
+	b->data = mmap(NULL, (size_t)b->stride * height,
+	               PROT_READ | PROT_WRITE, MAP_SHARED, b->fd, 0);
+	CHECK(b->data != MAP_FAILED);
+	b->image = pixman_image_create_bits(format, width, height, b->data,
+	                                    b->stride);
+	CHECK(b->image);
+}
+
+static void
+shm_buffer_fill(struct shm_buffer *b, uint32_t left, uint32_t right)
+{
+	for (int y = 0; y < b->height; y++)
+		for (int x = 0; x < b->width; x++)
+			b->data[y * b->width + x] =
+				(x < b->width / 2) ? left : right;
+}
+
+static void
+shm_buffer_release(struct shm_buffer *b)
+{
+	pixman_image_unref(b->image);
+	munmap(b->data, (size_t)b->stride * b->height);
+	close(b->fd);
+}
+
+static uint32_t
+pixel(const void *shell, int cell, int x, int y)
+{
+	return tw_thumbs_cell_pixels((void *)shell, cell)
+		[y * TW_THUMB_WIDTH + x];
+}
+
+static void
+test_scale(struct thumb_atlas *atlas, const struct tw_thumbs_page *shell)
+{
+	struct shm_buffer b;
+	int cell;
+
+	//wider than the cell, it is as wide as the cell
+	shm_buffer_init(&b, PIXMAN_a8r8g8b8, 1000, 500);
+	shm_buffer_fill(&b, 0xffff0000, 0xff0000ff);
+	cell = thumb_atlas_update(atlas, 1, b.image, 0);
+	CHECK(cell >= 0 && thumb_atlas_find(atlas, 1) == cell);
+	CHECK(shell->cells[cell].id == 1);
+	CHECK(shell->cells[cell].width == 256);
+	CHECK(shell->cells[cell].height == 128);
+	CHECK(pixel(shell, cell, 10, 64) == 0xffff0000);
+	CHECK(pixel(shell, cell, 245, 64) == 0xff0000ff);
+	shm_buffer_release(&b);
+
+	//no alpha in the buffer, opaque in the thumbnail
+	shm_buffer_init(&b, PIXMAN_x8r8g8b8, 320, 640);
+	shm_buffer_fill(&b, 0x0000ff00, 0x0000ff00);
+	cell = thumb_atlas_update(atlas, 2, b.image, 0);
+	CHECK(shell->cells[cell].width == 80);
+	CHECK(shell->cells[cell].height == 160);
+	CHECK(pixel(shell, cell, 40, 80) == 0xff00ff00);
+	shm_buffer_release(&b);
+
+	//smaller than the cell, kept as it is
+	shm_buffer_init(&b, PIXMAN_a8r8g8b8, 100, 50);
+	shm_buffer_fill(&b, 0x80800000, 0x80800000);
+	cell = thumb_atlas_update(atlas, 3, b.image, 0);
+	CHECK(shell->cells[cell].width == 100);
+	CHECK(shell->cells[cell].height == 50);
+	CHECK(pixel(shell, cell, 99, 49) == 0x80800000);
+	shm_buffer_release(&b);
+
+	for (uint32_t id = 1; id <= 3; id++)
+		thumb_atlas_forget(atlas, id);
+}
+
+static void
+test_evict(struct thumb_atlas *atlas, const struct tw_thumbs_page *shell)
+{
+	struct shm_buffer b;
+	uint32_t serial;
+	int cell;
+
+	shm_buffer_init(&b, PIXMAN_a8r8g8b8, 64, 64);
+	shm_buffer_fill(&b, 0xffffffff, 0xffffffff);
+	for (uint32_t id = 1; id <= TW_THUMB_CELLS; id++)
+		CHECK(thumb_atlas_update(atlas, id, b.image, 1000) >= 0);
+	//the first one was shown again, the second is the oldest now
+	thumb_atlas_touch(atlas, 1);
+	cell = thumb_atlas_update(atlas, 100, b.image, 1000);
+	CHECK(thumb_atlas_find(atlas, 2) < 0);
+	CHECK(thumb_atlas_find(atlas, 1) >= 0);
+	CHECK(shell->cells[cell].id == 100);
+	//never more cells than the file has
+	for (uint32_t id = 200; id < 300; id++)
+		CHECK(thumb_atlas_update(atlas, id, b.image, 1000) <
+		      TW_THUMB_CELLS);
+	CHECK(thumb_atlas_find(atlas, 299) >= 0);
+
+	//at most one thumbnail of a window every interval
+	CHECK(!thumb_atlas_due(atlas, 299, 1000));
+	CHECK(!thumb_atlas_due(atlas, 299,
+	                       1000 + THUMB_ATLAS_INTERVAL_MS - 1));
+	CHECK(thumb_atlas_due(atlas, 299, 1000 + THUMB_ATLAS_INTERVAL_MS));
+	serial = shell->cells[thumb_atlas_find(atlas, 299)].serial;
+	thumb_atlas_update(atlas, 299, b.image, 2000);
+	CHECK(shell->cells[thumb_atlas_find(atlas, 299)].serial != serial);
+
+	//a window gone leaves its cell to the next one
+	cell = thumb_atlas_find(atlas, 299);
+	thumb_atlas_forget(atlas, 299);
+	CHECK(shell->cells[cell].id == 0);
+	CHECK(thumb_atlas_update(atlas, 300, b.image, 2000) == cell);
+	shm_buffer_release(&b);
+}
+
+static void
+bench_update(struct thumb_atlas *atlas, int rounds)
+{
+	struct shm_buffer b;
+	uint64_t start, ns;
+
+	shm_buffer_init(&b, PIXMAN_x8r8g8b8, 1920, 1080);
+	shm_buffer_fill(&b, 0xff336699, 0xff996633);
+	start = now_ns();
+	for (int r = 0; r < rounds; r++)
+		thumb_atlas_update(atlas, 1 + r % 8, b.image, 0);
+	ns = now_ns() - start;
+	printf("1920x1080: %.1f us per thumbnail, %d bytes of atlas\n",
+	       ns / 1000.0 / rounds, TW_THUMBS_SIZE);
+	shm_buffer_release(&b);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+	int fd = memfd_create("thumb-atlas", MFD_CLOEXEC);
+	struct thumb_atlas atlas;
+	void *mem, *shell;
+
+	CHECK(fd >= 0 && ftruncate(fd, TW_THUMBS_SIZE) == 0);
+	mem = mmap(NULL, TW_THUMBS_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+	           fd, 0);
+	shell = mmap(NULL, TW_THUMBS_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+	CHECK(mem != MAP_FAILED && shell != MAP_FAILED);
+
+	thumb_atlas_init(&atlas, mem);
+	CHECK(((struct tw_thumbs_page *)shell)->magic == TW_THUMBS_MAGIC);
+	CHECK(((struct tw_thumbs_page *)shell)->ncells == TW_THUMB_CELLS);
+	test_scale(&atlas, shell);
+	test_evict(&atlas, shell);
+	bench_update(&atlas, rounds);
+
+	munmap(shell, TW_THUMBS_SIZE);
+	munmap(mem, TW_THUMBS_SIZE);
+	close(fd);
+	printf("ok\n");
+	return 0;
+}
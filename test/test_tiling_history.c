@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libweston/libweston.h>
+#include "desktop/layout.h"
+
+/* tiling undo test. Split, merge and toggle go into the history, every undo
+ * has to bring back the arrangement before the command and every redo the one
+ * after it, including the split of an only child, which moves nothing but
+ * turns its container.
+ *
+ *   test_tiling_history
+ */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+#define NVIEWS 3
+#define NSTEPS 5
+
+struct snapshot {
+	struct weston_geometry geo[NVIEWS];
+};
+
+static struct weston_output output = { .id = 0, .width = 1200, .height = 900 };
+static struct weston_view views[NVIEWS];
+
+static bool
+run(struct layout *l, enum layout_command command, struct weston_view *v)
+{
+	struct layout_op ops[NVIEWS + 2];
+	struct layout_op arg = { .v = v };
+
+	memset(ops, 0, sizeof(ops));
+	l->command(command, &arg, v, l, ops);
+	return !ops[0].end;
+}
+
+/* every view placed again, which is what the output sees */
+static void
+take(struct layout *l, struct snapshot *s)
+{
+	struct layout_op ops[NVIEWS + 2];
+	struct layout_op arg = { .o = &output };
+
+	memset(ops, 0, sizeof(ops));
+	memset(s, 0, sizeof(*s));
+	l->command(DPSR_output_resize, &arg, NULL, l, ops);
+	for (int i = 0; !ops[i].end; i++) {
+		int n = ops[i].v - views;
+		CHECK(n >= 0 && n < NVIEWS);
+		s->geo[n] = (struct weston_geometry){
+			ops[i].pos.x, ops[i].pos.y,
+			ops[i].size.width, ops[i].size.height,
+		};
+	}
+}
+
+static bool
+same(const struct snapshot *a, const struct snapshot *b)
+{
+	return !memcmp(a, b, sizeof(*a));
+}
+
+int main(int argc, char *argv[])
+{
+	struct tw_output tw_output = {
+		.output = &output,
+		.desktop_area = {0, 0, 1200, 900},
+		.inner_gap = 0,
+		.outer_gap = 0,
+	};
+	struct weston_layer layer;
+	struct layout tiling;
+	struct snapshot steps[NSTEPS], now;
+	struct layout_op ops[NVIEWS + 2];
+
+	weston_layer_init(&layer, NULL);
+	tiling_layout_init(&tiling, &layer, NULL);
+	layout_add_output(&tiling, &tw_output);
+	for (int i = 0; i < NVIEWS; i++) {
+		struct layout_op add = {
+			.v = &views[i],
+			.default_geometry = {-1, -1, -1, -1},
+		};
+		views[i].output = &output;
+		weston_layer_entry_insert(&layer.view_list,
+		                          &views[i].layer_link);
+		tiling.command(DPSR_add, &add, &views[i], &tiling, ops);
+	}
+
+	take(&tiling, &steps[0]);
+	//the root turns
+	CHECK(run(&tiling, DPSR_toggle, &views[1]));
+	take(&tiling, &steps[1]);
+	CHECK(!same(&steps[0], &steps[1]));
+	//the views go in front, views[0] is the last one, it goes into a
+	//container of its own
+	CHECK(run(&tiling, DPSR_vsplit, &views[0]));
+	take(&tiling, &steps[2]);
+	//only child, the container turns and nothing moves
+	CHECK(run(&tiling, DPSR_hsplit, &views[0]));
+	take(&tiling, &steps[3]);
+	CHECK(same(&steps[2], &steps[3]));
+	//back out to the root, in the front
+	CHECK(run(&tiling, DPSR_merge, &views[0]));
+	take(&tiling, &steps[4]);
+	CHECK(!same(&steps[3], &steps[4]));
+
+	for (int i = NSTEPS-1; i > 0; i--) {
+		CHECK(run(&tiling, DPSR_undo, NULL));
+		take(&tiling, &now);
+		CHECK(same(&now, &steps[i-1]));
+	}
+	//the history is used up
+	CHECK(!run(&tiling, DPSR_undo, NULL));
+
+	for (int i = 1; i < NSTEPS; i++) {
+		CHECK(run(&tiling, DPSR_redo, NULL));
+		take(&tiling, &now);
+		CHECK(same(&now, &steps[i]));
+	}
+	CHECK(!run(&tiling, DPSR_redo, NULL));
+
+	for (int i = NVIEWS-1; i >= 0; i--) {
+		run(&tiling, DPSR_del, &views[i]);
+		weston_layer_entry_remove(&views[i].layer_link);
+	}
+	tiling_layout_end(&tiling);
+	printf("tiling history is fine\n");
+	return 0;
+}
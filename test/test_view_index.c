@@ -0,0 +1,186 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <desktop/view_index.h>
+
+/* view index test. A grid of views across two outputs has to give the obvious
+ * neighbours, random views have to give what a walk over all of them gives,
+ * then the queries are timed.
+ *
+ *   test_view_index [views] [queries]
+ */
+
+#define CHECK(cond) do {						\
+		if (!(cond)) {						\
+			fprintf(stderr, "line %d: %s\n", __LINE__, #cond);	\
+			exit(1);					\
+		}							\
+	} while (0)
+
+#define VIEW(i) ((struct weston_view *)(uintptr_t)((i) + 1))
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int64_t
+offset(int32_t a, int32_t alen, int32_t b, int32_t blen)
+{
+	int64_t start = a > b ? a : b;
+	int64_t end = (int64_t)a + alen < (int64_t)b + blen ?
+		(int64_t)a + alen : (int64_t)b + blen;
+	return start < end ? 0 : llabs((2LL * a + alen) - (2LL * b + blen));
+}
+
+/* the same closeness, over all the views */
+static struct weston_view *
+nearest_slow(const struct weston_geometry *geos, int n, int self,
+             enum tw_desktop_direction dir, int64_t *score_out)
+{
+	const struct weston_geometry *g = &geos[self];
+	int64_t best = INT64_MAX;
+	struct weston_view *nearest = NULL;
+
+	for (int i = 0; i < n; i++) {
+		const struct weston_geometry *e = &geos[i];
+		int64_t dist, score;
+
+		if (i == self)
+			continue;
+		switch (dir) {
+		case TW_DIRECTION_LEFT:
+			dist = (2 * g->x + g->width) - (2 * e->x + e->width);
+			break;
+		case TW_DIRECTION_RIGHT:
+			dist = (2 * e->x + e->width) - (2 * g->x + g->width);
+			break;
+		case TW_DIRECTION_UP:
+			dist = (2 * g->y + g->height) - (2 * e->y + e->height);
+			break;
+		default:
+			dist = (2 * e->y + e->height) - (2 * g->y + g->height);
+			break;
+		}
+		if (dist <= 0)
+			continue;
+		score = dist + 2 * ((dir == TW_DIRECTION_LEFT ||
+		                     dir == TW_DIRECTION_RIGHT) ?
+		                    offset(e->y, e->height, g->y, g->height) :
+		                    offset(e->x, e->width, g->x, g->width));
+		if (score < best) {
+			best = score;
+			nearest = VIEW(i);
+		}
+	}
+	*score_out = best;
+	return nearest;
+}
+
+static int64_t
+score_of(const struct weston_geometry *geos, int self, int other,
+         enum tw_desktop_direction dir)
+{
+	struct weston_geometry pair[2] = {geos[self], geos[other]};
+	int64_t score;
+	nearest_slow(pair, 2, 0, dir, &score);
+	return score;
+}
+
+static void
+test_grid(void)
+{
+	//two outputs side by side, 2x2 on the left, 1x2 on the right
+	struct weston_geometry geos[6] = {
+		{0, 0, 960, 540}, {960, 0, 960, 540},
+		{0, 540, 960, 540}, {960, 540, 960, 540},
+		{1920, 0, 1280, 540}, {1920, 540, 1280, 540},
+	};
+	struct view_index index;
+
+	view_index_init(&index);
+	for (int i = 0; i < 6; i++)
+		CHECK(view_index_add(&index, VIEW(i), &geos[i]));
+	view_index_build(&index);
+	CHECK(view_index_nearest(&index, &geos[0], VIEW(0),
+	                         TW_DIRECTION_RIGHT) == VIEW(1));
+	CHECK(view_index_nearest(&index, &geos[1], VIEW(1),
+	                         TW_DIRECTION_RIGHT) == VIEW(4));
+	CHECK(view_index_nearest(&index, &geos[3], VIEW(3),
+	                         TW_DIRECTION_RIGHT) == VIEW(5));
+	CHECK(view_index_nearest(&index, &geos[5], VIEW(5),
+	                         TW_DIRECTION_LEFT) == VIEW(3));
+	CHECK(view_index_nearest(&index, &geos[2], VIEW(2),
+	                         TW_DIRECTION_UP) == VIEW(0));
+	CHECK(view_index_nearest(&index, &geos[4], VIEW(4),
+	                         TW_DIRECTION_DOWN) == VIEW(5));
+	CHECK(!view_index_nearest(&index, &geos[0], VIEW(0),
+	                          TW_DIRECTION_LEFT));
+	CHECK(!view_index_nearest(&index, &geos[5], VIEW(5),
+	                          TW_DIRECTION_DOWN));
+	view_index_release(&index);
+}
+
+static void
+test_random(int n, int queries)
+{
+	struct weston_geometry *geos = calloc(n, sizeof(*geos));
+	struct view_index index;
+	uint64_t start, ns;
+	int found = 0;
+
+	view_index_init(&index);
+	for (int i = 0; i < n; i++) {
+		geos[i] = (struct weston_geometry){
+			rand() % 7680, rand() % 2160,
+			64 + rand() % 1200, 64 + rand() % 800,
+		};
+		CHECK(view_index_add(&index, VIEW(i), &geos[i]));
+	}
+	view_index_build(&index);
+
+	for (int i = 0; i < n; i++)
+		for (int d = 0; d < 4; d++) {
+			int64_t best;
+			struct weston_view *slow =
+				nearest_slow(geos, n, i, d, &best);
+			struct weston_view *fast =
+				view_index_nearest(&index, &geos[i], VIEW(i),
+				                   d);
+			//ties may go either way
+			CHECK(!slow == !fast);
+			if (fast)
+				CHECK(score_of(geos, i,
+				               (int)((uintptr_t)fast - 1), d) ==
+				      best);
+		}
+
+	start = now_ns();
+	for (int q = 0; q < queries; q++) {
+		int i = q % n;
+		found += view_index_nearest(&index, &geos[i], VIEW(i),
+		                            q & 3) != NULL;
+	}
+	ns = now_ns() - start;
+	printf("%d views: %.1f ns per query (%d found)\n", n,
+	       (double)ns / queries, found);
+	view_index_release(&index);
+	free(geos);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int n = (argc > 1) ? atoi(argv[1]) : 500;
+	int queries = (argc > 2) ? atoi(argv[2]) : 1000000;
+
+	srand(7);
+	test_grid();
+	test_random(n, queries);
+	printf("ok\n");
+	return 0;
+}